@@ -36,6 +36,8 @@ Application::Application()
 	_pVertexShader = nullptr;
 	_pPixelShader = nullptr;
 	_pVertexLayout = nullptr;
+	_pVertexShaderCompressed = nullptr;
+	_pVertexLayoutCompressed = nullptr;
 	_pVertexBuffer = nullptr;
 	_pIndexBuffer = nullptr;
 	_pPyramidIndexBuffer = nullptr;
@@ -43,6 +45,12 @@ Application::Application()
 	_pGridIndexBuffer = nullptr;
 	_pGridVertexBuffer = nullptr;
 	_pConstantBuffer = nullptr;
+	_depthStencilView = nullptr;
+	_depthStencilBuffer = nullptr;
+	_wireframe = nullptr;
+	_solid = nullptr;
+	_backfaceCulling = true;
+	_assets = nullptr;
 }
 
 Application::~Application()
@@ -52,27 +60,93 @@ Application::~Application()
 
 HRESULT Application::Initialise(HINSTANCE hInstance, int nCmdShow)
 {
-    if (FAILED(InitWindow(hInstance, nCmdShow)))
+	//Start reading the meshes and textures straight away, they load in the background while the device is created and the first frames draw.
+	//Update uploads them as they arrive and the objects appear then.
+	_assets = new AssetLoader();
+	//Everything the AssetCooker packed comes out of one mapped file. Without a pack (or for anything not in it) the loose files are used.
+	_assets->OpenPack("Assets.pack");
+	_sphereMesh = _assets->LoadMesh("sphere.obj");
+	//The big meshes use 16 byte compressed vertices, half the memory and vertex fetch bandwidth of SimpleVertex
+	_planeMesh = _assets->LoadMesh("Hercules.obj", true, true);
+	_terrainMesh = _assets->LoadMesh("terrain.obj", true, true);
+	_starMesh = _assets->LoadMesh("star.obj");
+	//Textures stream, they draw with their smallest mips on the first frames and sharpen as the larger ones are read
+	_crateTexture = _assets->LoadTexture("Crate_COLOR.dds", true);
+	_terrainTexture = _assets->LoadTexture("desert.dds", true);
+	_planeTexture = _assets->LoadTexture("Hercules_COLOR.dds", true);
+	//Past this the textures bound least recently lose their largest mips. Well above what this scene needs, it's a cap rather than a target.
+	_assets->SetTextureBudget(64 * 1024 * 1024);
+
+	//The rest of startup runs as a graph of tasks. The shaders compile on workers while the window and device are created, then everything
+	//that only needs the device is created side by side (device methods are free threaded, the immediate context isn't, so binding waits
+	//for the main thread at the end). Startup takes as long as its slowest chain rather than the sum of every step.
+	ID3DBlob* vsBlob = nullptr;
+	ID3DBlob* psBlob = nullptr;
+	ID3DBlob* vsCompressedBlob = nullptr;
+
+	TaskGraph startup;
+	TaskId window = startup.Add("Window", [&]() { return InitWindow(hInstance, nCmdShow); }, true);
+	TaskId compileVS = startup.Add("Compile VS", [&]() { return CompileShaderFromFile(L"DX11 Framework.fx", "VS", "vs_4_0", &vsBlob); });
+	TaskId compilePS = startup.Add("Compile PS", [&]() { return CompileShaderFromFile(L"DX11 Framework.fx", "PS", "ps_4_0", &psBlob); });
+	TaskId compileVSCompressed = startup.Add("Compile VSCompressed",
+		[&]() { return CompileShaderFromFile(L"DX11 Framework.fx", "VSCompressed", "vs_4_0", &vsCompressedBlob); });
+	TaskId device = startup.Add("Device", [this]() { return InitDevice(); }, true);
+	TaskId shaders = startup.Add("Shaders", [&]() { return InitShadersAndInputLayout(vsBlob, psBlob, vsCompressedBlob); });
+	TaskId renderTargets = startup.Add("Render targets", [this]() { return InitRenderTargets(); });
+	TaskId geometry = startup.Add("Geometry", [this]() { return InitGeometry(); });
+	TaskId states = startup.Add("States", [this]() { return InitStates(); });
+	TaskId bind = startup.Add("Bind pipeline", [this]() -> HRESULT { BindPipeline(); return S_OK; }, true);
+
+	startup.AddDependency(device, window);
+	startup.AddDependency(shaders, device);
+	startup.AddDependency(shaders, compileVS);
+	startup.AddDependency(shaders, compilePS);
+	startup.AddDependency(shaders, compileVSCompressed);
+	startup.AddDependency(renderTargets, device);
+	startup.AddDependency(geometry, device);
+	startup.AddDependency(states, device);
+	startup.AddDependency(bind, shaders);
+	startup.AddDependency(bind, renderTargets);
+	startup.AddDependency(bind, geometry);
+	startup.AddDependency(bind, states);
+
+	HRESULT hr = startup.Run();
+	startup.LogTimings("Startup");
+
+	if (vsBlob) vsBlob->Release();
+	if (psBlob) psBlob->Release();
+	if (vsCompressedBlob) vsCompressedBlob->Release();
+
+	if (FAILED(startup.GetResult(compileVS)) || FAILED(startup.GetResult(compilePS)) || FAILED(startup.GetResult(compileVSCompressed)))
 	{
-        return E_FAIL;
+		MessageBox(nullptr,
+				   L"The FX file cannot be compiled.  Please run this executable from the directory that contains the FX file.", L"Error", MB_OK);
 	}
 
-    RECT rc;
-    GetClientRect(_hWnd, &rc);
-    _WindowWidth = rc.right - rc.left;
-    _WindowHeight = rc.bottom - rc.top;
+	if (FAILED(hr))
+	{
+		Cleanup();
 
-    if (FAILED(InitDevice()))
-    {
-        Cleanup();
+		return E_FAIL;
+	}
 
-        return E_FAIL;
-    }
+	// Light direction from surface (XYZ)
+	lightDirection = XMFLOAT3(0.0f, 0.0f, -1.0f);
+	// Diffuse material properties (RGBA)
+	diffuseMaterial = XMFLOAT4(0.8f, 0.5f, 0.5f, 1.0f);
+	// Diffuse light colour (RGBA)
+	diffuseLight = XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f);
+
+	ambientLight = XMFLOAT4(0.2f, 0.2f, 0.2f, 1.0f);
+	ambientMaterial = XMFLOAT4(0.2f, 0.2f, 0.2f, 1.0f);
+
+	specMaterial = XMFLOAT4(0.8f, 0.8f, 0.8f, 1.0f);
+	specLight = XMFLOAT4(0.5f, 0.5f, 0.5f, 1.0f);
+	specPower = float(10.0f);
+	eyePos = XMFLOAT3(0.0f, 5.0f, -10.0f);
 
-	objMeshData = OBJLoader::Load("sphere.obj", _pd3dDevice);
-	planeMesh = OBJLoader::Load("Hercules.obj", _pd3dDevice);
-	terrainMesh = OBJLoader::Load("terrain.obj", _pd3dDevice);
-	starMesh = OBJLoader::Load("star.obj", _pd3dDevice);
+	MeshData noMesh;
+	ZeroMemory(&noMesh, sizeof(noMesh));
 
 	XMFLOAT4 Eye = { 0.0f, 5.0f, -10.0f, 0.0f };
 	XMFLOAT4 At = { 0.0f, 0.0f, 0.0f, 0.0f };
@@ -113,23 +187,23 @@ HRESULT Application::Initialise(HINSTANCE hInstance, int nCmdShow)
 
 	_sphere = new GameObject;
 	
-	_sphere->Initialise(objMeshData);
+	_sphere->Initialise(noMesh);
 	_sphere->SetTranslation(0.0f, 10.0f, 0.0f);
 	_sphere->UpdateWorld();
 
 	_terrain = new GameObject;
-	_terrain->Initialise(terrainMesh);
+	_terrain->Initialise(noMesh);
 	_terrain->SetTranslation(0.0f, -60.0f, 0.0f);
 	_terrain->SetScale(40.0f, 20.0f, 40.0f);
 	_terrain->UpdateWorld();
 
 	_plane = new GameObject;
-	_plane->Initialise(planeMesh);
+	_plane->Initialise(noMesh);
 	_plane->SetTranslation((camera2->GetVector().x), (camera2->GetVector().y - 10), (camera2->GetVector().z - 30));
 	_plane->UpdateWorld();
 
 	_star = new GameObject;
-	_star->Initialise(starMesh);
+	_star->Initialise(noMesh);
 	_star->SetTranslation(0.0f, 0.0f, 10.0f);
 	_star->UpdateWorld();
 
@@ -141,68 +215,21 @@ HRESULT Application::Initialise(HINSTANCE hInstance, int nCmdShow)
 	XMStoreFloat4x4(&_world5, XMMatrixIdentity());
 	XMStoreFloat4x4(&_worldGrid, XMMatrixIdentity());
 
-	
-
-	// Create the sample state
-	D3D11_SAMPLER_DESC sampDesc;
-	ZeroMemory(&sampDesc, sizeof(sampDesc));
-	sampDesc.Filter = D3D11_FILTER_MIN_MAG_MIP_LINEAR;
-	sampDesc.AddressU = D3D11_TEXTURE_ADDRESS_WRAP;
-	sampDesc.AddressV = D3D11_TEXTURE_ADDRESS_WRAP;
-	sampDesc.AddressW = D3D11_TEXTURE_ADDRESS_WRAP;
-	sampDesc.ComparisonFunc = D3D11_COMPARISON_NEVER;
-	sampDesc.MinLOD = 0;
-	sampDesc.MaxLOD = D3D11_FLOAT32_MAX;
-
-	_pd3dDevice->CreateSamplerState(&sampDesc, &_pSamplerLinear);
-
-	_pImmediateContext->PSSetSamplers(0, 1, &_pSamplerLinear);
-
-
-
 	return S_OK;
 }
 
-HRESULT Application::InitShadersAndInputLayout()
+HRESULT Application::InitShadersAndInputLayout(ID3DBlob* pVSBlob, ID3DBlob* pPSBlob, ID3DBlob* pVSCompressedBlob)
 {
 	HRESULT hr;
 
-    // Compile the vertex shader
-    ID3DBlob* pVSBlob = nullptr;
-    hr = CompileShaderFromFile(L"DX11 Framework.fx", "VS", "vs_4_0", &pVSBlob);
-
-    if (FAILED(hr))
-    {
-        MessageBox(nullptr,
-                   L"The FX file cannot be compiled.  Please run this executable from the directory that contains the FX file.", L"Error", MB_OK);
-        return hr;
-    }
-
-
-
 	// Create the vertex shader
 	hr = _pd3dDevice->CreateVertexShader(pVSBlob->GetBufferPointer(), pVSBlob->GetBufferSize(), nullptr, &_pVertexShader);
 
 	if (FAILED(hr))
-	{	
-		pVSBlob->Release();
-        return hr;
-	}
-
-	// Compile the pixel shader
-	ID3DBlob* pPSBlob = nullptr;
-    hr = CompileShaderFromFile(L"DX11 Framework.fx", "PS", "ps_4_0", &pPSBlob);
-
-    if (FAILED(hr))
-    {
-        MessageBox(nullptr,
-                   L"The FX file cannot be compiled.  Please run this executable from the directory that contains the FX file.", L"Error", MB_OK);
         return hr;
-    }
 
 	// Create the pixel shader
 	hr = _pd3dDevice->CreatePixelShader(pPSBlob->GetBufferPointer(), pPSBlob->GetBufferSize(), nullptr, &_pPixelShader);
-	pPSBlob->Release();
 
     if (FAILED(hr))
         return hr;
@@ -221,23 +248,43 @@ HRESULT Application::InitShadersAndInputLayout()
     // Create the input layout
 	hr = _pd3dDevice->CreateInputLayout(layout, numElements, pVSBlob->GetBufferPointer(),
                                         pVSBlob->GetBufferSize(), &_pVertexLayout);
-	pVSBlob->Release();
 
 	if (FAILED(hr))
         return hr;
 
-    // Set the input layout
-    _pImmediateContext->IASetInputLayout(_pVertexLayout);
+	// Compressed vertices get their own vertex shader and input layout, the pixel shader is shared
+	hr = _pd3dDevice->CreateVertexShader(pVSCompressedBlob->GetBufferPointer(), pVSCompressedBlob->GetBufferSize(), nullptr, &_pVertexShaderCompressed);
 
-	CreateDDSTextureFromFile(_pd3dDevice, L"Crate_COLOR.dds", nullptr, &_pTextureRV);
+	if (FAILED(hr))
+		return hr;
 
-	CreateDDSTextureFromFile(_pd3dDevice, L"desert.dds", nullptr, &_pTextureTerrain);
+	// Matches CompressedVertex: UNORM16 position, octahedral SNORM16 normal, half float texture coordinates
+	D3D11_INPUT_ELEMENT_DESC compressedLayout[] =
+	{
+		{ "POSITION", 0, DXGI_FORMAT_R16G16B16A16_UNORM, 0, 0, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+		{ "NORMAL", 0, DXGI_FORMAT_R16G16_SNORM, 0, 8, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+		{ "TEXCOORD", 0, DXGI_FORMAT_R16G16_FLOAT, 0, 12, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+	};
 
-	CreateDDSTextureFromFile(_pd3dDevice, L"Hercules_COLOR.dds", nullptr, &_pTexturePlane);
+	hr = _pd3dDevice->CreateInputLayout(compressedLayout, ARRAYSIZE(compressedLayout), pVSCompressedBlob->GetBufferPointer(),
+										pVSCompressedBlob->GetBufferSize(), &_pVertexLayoutCompressed);
 
 	return hr;
 }
 
+HRESULT Application::InitGeometry()
+{
+	HRESULT hr;
+
+	if (FAILED(hr = InitVertexBuffer()) || FAILED(hr = InitPyramidVertexBuffer()) || FAILED(hr = InitGridVertexBuffer()))
+		return hr;
+
+	if (FAILED(hr = InitIndexBuffer()) || FAILED(hr = InitPyramidIndexBuffer()) || FAILED(hr = InitGridIndexBuffer()))
+		return hr;
+
+	return S_OK;
+}
+
 HRESULT Application::InitVertexBuffer()
 {
 	HRESULT hr;
@@ -558,6 +605,10 @@ HRESULT Application::InitWindow(HINSTANCE hInstance, int nCmdShow)
 
     ShowWindow(_hWnd, nCmdShow);
 
+    GetClientRect(_hWnd, &rc);
+    _WindowWidth = rc.right - rc.left;
+    _WindowHeight = rc.bottom - rc.top;
+
     return S_OK;
 }
 
@@ -612,11 +663,11 @@ HRESULT Application::InitDevice()
 
     UINT numDriverTypes = ARRAYSIZE(driverTypes);
 
+	//The cooker compresses colour textures to BC7 by default, and BC7 can't be sampled below 11_0, so that's the least the game asks for.
+	//Supporting 10.x hardware would need the textures cooked with -bc fast (BC1/BC3) as well, and picking between them by feature level.
     D3D_FEATURE_LEVEL featureLevels[] =
     {
         D3D_FEATURE_LEVEL_11_0,
-        D3D_FEATURE_LEVEL_10_1,
-        D3D_FEATURE_LEVEL_10_0,
     };
 
 	UINT numFeatureLevels = ARRAYSIZE(featureLevels);
@@ -644,8 +695,12 @@ HRESULT Application::InitDevice()
             break;
     }
 
-    if (FAILED(hr))
-        return hr;
+    return hr;
+}
+
+HRESULT Application::InitRenderTargets()
+{
+    HRESULT hr;
 
     // Create a render target view
     ID3D11Texture2D* pBackBuffer = nullptr;
@@ -674,8 +729,17 @@ HRESULT Application::InitDevice()
 	depthStencilDesc.CPUAccessFlags = 0;
 	depthStencilDesc.MiscFlags = 0;
 
-	_pd3dDevice->CreateTexture2D(&depthStencilDesc, nullptr, &_depthStencilBuffer);
-	_pd3dDevice->CreateDepthStencilView(_depthStencilBuffer, nullptr, &_depthStencilView);
+	hr = _pd3dDevice->CreateTexture2D(&depthStencilDesc, nullptr, &_depthStencilBuffer);
+
+	if (FAILED(hr))
+		return hr;
+
+	return _pd3dDevice->CreateDepthStencilView(_depthStencilBuffer, nullptr, &_depthStencilView);
+}
+
+HRESULT Application::InitStates()
+{
+	HRESULT hr;
 
 	D3D11_RASTERIZER_DESC wfdesc;
 	ZeroMemory(&wfdesc, sizeof(D3D11_RASTERIZER_DESC));
@@ -683,6 +747,9 @@ HRESULT Application::InitDevice()
 	wfdesc.CullMode = D3D11_CULL_NONE;
 	hr = _pd3dDevice->CreateRasterizerState(&wfdesc, &_wireframe);
 
+	if (FAILED(hr))
+		return hr;
+
 	ZeroMemory(&wfdesc, sizeof(D3D11_RASTERIZER_DESC));
 	wfdesc.FillMode = D3D11_FILL_SOLID;
 	wfdesc.CullMode = D3D11_CULL_BACK;
@@ -691,6 +758,35 @@ HRESULT Application::InitDevice()
 	if (FAILED(hr))
 		return hr;
 
+	// Create the sample state
+	D3D11_SAMPLER_DESC sampDesc;
+	ZeroMemory(&sampDesc, sizeof(sampDesc));
+	sampDesc.Filter = D3D11_FILTER_MIN_MAG_MIP_LINEAR;
+	sampDesc.AddressU = D3D11_TEXTURE_ADDRESS_WRAP;
+	sampDesc.AddressV = D3D11_TEXTURE_ADDRESS_WRAP;
+	sampDesc.AddressW = D3D11_TEXTURE_ADDRESS_WRAP;
+	sampDesc.ComparisonFunc = D3D11_COMPARISON_NEVER;
+	sampDesc.MinLOD = 0;
+	sampDesc.MaxLOD = D3D11_FLOAT32_MAX;
+
+	hr = _pd3dDevice->CreateSamplerState(&sampDesc, &_pSamplerLinear);
+
+	if (FAILED(hr))
+		return hr;
+
+	// Create the constant buffer
+	D3D11_BUFFER_DESC bd;
+	ZeroMemory(&bd, sizeof(bd));
+	bd.Usage = D3D11_USAGE_DEFAULT;
+	bd.ByteWidth = sizeof(ConstantBuffer);
+	bd.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+	bd.CPUAccessFlags = 0;
+
+    return _pd3dDevice->CreateBuffer(&bd, nullptr, &_pConstantBuffer);
+}
+
+void Application::BindPipeline()
+{
     _pImmediateContext->OMSetRenderTargets(1, &_pRenderTargetView, _depthStencilView);
 
     // Setup the viewport
@@ -703,55 +799,13 @@ HRESULT Application::InitDevice()
     vp.TopLeftY = 0;
     _pImmediateContext->RSSetViewports(1, &vp);
 
-	InitShadersAndInputLayout();
-
-	InitVertexBuffer();
-	InitPyramidVertexBuffer();
-	InitGridVertexBuffer();
-
-    // Set vertex buffer
-    
-    
-
-	InitIndexBuffer();
-	InitPyramidIndexBuffer();
-	InitGridIndexBuffer();
-    // Set index buffer
-    
+    // Set the input layout
+    _pImmediateContext->IASetInputLayout(_pVertexLayout);
 
     // Set primitive topology
     _pImmediateContext->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
 
-
-	// Create the constant buffer
-	D3D11_BUFFER_DESC bd;
-	ZeroMemory(&bd, sizeof(bd));
-	bd.Usage = D3D11_USAGE_DEFAULT;
-	bd.ByteWidth = sizeof(ConstantBuffer);
-	bd.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
-	bd.CPUAccessFlags = 0;
-
-    hr = _pd3dDevice->CreateBuffer(&bd, nullptr, &_pConstantBuffer);
-
-	if (FAILED(hr))
-		return hr;
-	// Light direction from surface (XYZ)
-	lightDirection = XMFLOAT3(0.0f, 0.0f, -1.0f);
-	// Diffuse material properties (RGBA)
-	diffuseMaterial = XMFLOAT4(0.8f, 0.5f, 0.5f, 1.0f);
-	// Diffuse light colour (RGBA)
-	diffuseLight = XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f);
-
-	ambientLight = XMFLOAT4(0.2f, 0.2f, 0.2f, 1.0f);
-	ambientMaterial = XMFLOAT4(0.2f, 0.2f, 0.2f, 1.0f);
-
-	specMaterial = XMFLOAT4(0.8f, 0.8f, 0.8f, 1.0f);
-	specLight = XMFLOAT4(0.5f, 0.5f, 0.5f, 1.0f);
-	specPower = float(10.0f);
-	eyePos = XMFLOAT3(0.0f, 5.0f, -10.0f);
-	
-
-    return S_OK;
+	_pImmediateContext->PSSetSamplers(0, 1, &_pSamplerLinear);
 }
 
 void Application::Cleanup()
@@ -765,8 +819,23 @@ void Application::Cleanup()
 	if (_pPyramidVertexBuffer) _pPyramidVertexBuffer->Release();
 	if (_pGridVertexBuffer) _pGridVertexBuffer->Release();
 	if (_pGridIndexBuffer) _pGridIndexBuffer->Release();
+	if (_assets)
+	{
+		_assets->Release(_sphereMesh);
+		_assets->Release(_planeMesh);
+		_assets->Release(_terrainMesh);
+		_assets->Release(_starMesh);
+		_assets->Release(_crateTexture);
+		_assets->Release(_terrainTexture);
+		_assets->Release(_planeTexture);
+	}
+	//Waits for any load still running on a worker, then releases anything still held
+	delete _assets;
+	_assets = nullptr;
     if (_pVertexLayout) _pVertexLayout->Release();
     if (_pVertexShader) _pVertexShader->Release();
+	if (_pVertexLayoutCompressed) _pVertexLayoutCompressed->Release();
+	if (_pVertexShaderCompressed) _pVertexShaderCompressed->Release();
     if (_pPixelShader) _pPixelShader->Release();
     if (_pRenderTargetView) _pRenderTargetView->Release();
     if (_pSwapChain) _pSwapChain->Release();
@@ -822,10 +891,12 @@ void Application::Update()
 	if (GetAsyncKeyState('V'))
 	{
 		_pImmediateContext->RSSetState(_solid);
+		_backfaceCulling = true;
 	}
 	if (GetAsyncKeyState('B'))
 	{
 		_pImmediateContext->RSSetState(_wireframe);
+		_backfaceCulling = false;
 	}
 
 	if (GetAsyncKeyState('Z'))
@@ -981,12 +1052,32 @@ void Application::Update()
 	XMStoreFloat4x4(&_world4, XMMatrixRotationY(2*t) * XMMatrixTranslation(-25.0f, 0.0f, 0.0f) * XMMatrixRotationY(-t));
 	XMStoreFloat4x4(&_world5, XMMatrixScaling(0.5f, 0.5f, 0.5f) * XMMatrixTranslation(7.0f, 0.0f, 0.0f) * XMMatrixRotationY(-2*t) * XMMatrixTranslation(-25.0f, 0.0f, 0.0f) * XMMatrixRotationY(-t));
 	XMStoreFloat4x4(&_worldGrid, XMMatrixScaling(1.5f, 1.5f, 1.5f) * XMMatrixRotationY(t) * XMMatrixTranslation(0.0f, 0.0f, -5.0f));
+	//Create the GPU resources for whatever finished loading since last frame
+	if (_assets->ProcessCompleted(_pd3dDevice) > 0 && _assets->GetPendingCount() == 0)
+	{
+		_assets->LogMemoryReport();
+	}
+	AttachLoadedMesh(_sphere, _sphereMesh);
+	AttachLoadedMesh(_terrain, _terrainMesh);
+	AttachLoadedMesh(_plane, _planeMesh);
+	AttachLoadedMesh(_star, _starMesh);
+
 	_sphere->Update(t);
 	_terrain->Update(t);
 	_plane->Update(t);
 	_star->Update(t);
 }
 
+void Application::AttachLoadedMesh(GameObject* object, AssetHandle mesh)
+{
+	const MeshData* meshData = _assets->GetMesh(mesh);
+
+	if (meshData && !object->HasMesh())
+	{
+		object->SetMeshData(*meshData);
+	}
+}
+
 void Application::Draw()
 {
     //
@@ -1009,10 +1100,6 @@ void Application::Draw()
 	XMMATRIX world6 = XMLoadFloat4x4(&_worldGrid);
 	XMMATRIX view = XMLoadFloat4x4(&_View);
 	XMMATRIX projection = XMLoadFloat4x4(&_Projection);
-	XMMATRIX sphere = XMLoadFloat4x4(&_sphere->GetWorld());
-	XMMATRIX terrain = XMLoadFloat4x4(&_terrain->GetWorld());
-	XMMATRIX plane = XMLoadFloat4x4(&_plane->GetWorld());
-	XMMATRIX star = XMLoadFloat4x4(&_star->GetWorld());
 
 
 	UINT stride = sizeof(SimpleVertex);
@@ -1037,18 +1124,22 @@ void Application::Draw()
 	cb.SpecularLight = specLight;
 	cb.SpecularPower = specPower;
 	cb.EyePosW = eyePos;
+	cb.PositionScale = XMFLOAT4(1.0f, 1.0f, 1.0f, 0.0f);
+	cb.PositionOffset = XMFLOAT4(0.0f, 0.0f, 0.0f, 0.0f);
 
 	_pImmediateContext->UpdateSubresource(_pConstantBuffer, 0, nullptr, &cb, 0, 0);
 
 
 
+	// DrawGameObject may have left the compressed layout bound last frame
+	_pImmediateContext->IASetInputLayout(_pVertexLayout);
 	_pImmediateContext->IASetVertexBuffers(0, 1, &_pVertexBuffer, &stride, &offset);
 	_pImmediateContext->IASetIndexBuffer(_pIndexBuffer, DXGI_FORMAT_R16_UINT, 0);
 
     //
     // Renders a triangle
     //
-	_pImmediateContext->PSSetShaderResources(0, 1, &_pTextureRV);
+	BindTexture(_crateTexture);
 
 	_pImmediateContext->VSSetShader(_pVertexShader, nullptr, 0);
 	_pImmediateContext->VSSetConstantBuffers(0, 1, &_pConstantBuffer);
@@ -1088,29 +1179,55 @@ void Application::Draw()
 	_pImmediateContext->UpdateSubresource(_pConstantBuffer, 0, nullptr, &cb, 0, 0);
 	_pImmediateContext->DrawIndexed(96, 0, 0);
 
-	cb.mWorld = XMMatrixTranspose(sphere);
-	_pImmediateContext->UpdateSubresource(_pConstantBuffer, 0, nullptr, &cb, 0, 0);
-	_sphere->Draw(_pd3dDevice, _pImmediateContext);
+	DrawGameObject(_sphere, cb);
 
-	_pImmediateContext->PSSetShaderResources(0, 1, &_pTexturePlane);
+	BindTexture(_planeTexture);
 
-	
-	cb.mWorld = XMMatrixTranspose(plane);
-	_pImmediateContext->UpdateSubresource(_pConstantBuffer, 0, nullptr, &cb, 0, 0);
-	_plane->Draw(_pd3dDevice, _pImmediateContext);
+	DrawGameObject(_plane, cb);
 
-	_pImmediateContext->PSSetShaderResources(0, 1, &_pTextureTerrain);
+	BindTexture(_terrainTexture);
 
-	cb.mWorld = XMMatrixTranspose(terrain);
-	_pImmediateContext->UpdateSubresource(_pConstantBuffer, 0, nullptr, &cb, 0, 0);
-	_terrain->Draw(_pd3dDevice, _pImmediateContext);
+	DrawGameObject(_terrain, cb);
 
-	cb.mWorld = XMMatrixTranspose(star);
-	_pImmediateContext->UpdateSubresource(_pConstantBuffer, 0, nullptr, &cb, 0, 0);
-	_star->Draw(_pd3dDevice, _pImmediateContext);
+	DrawGameObject(_star, cb);
 
     //
     // Present our back buffer to our front buffer
     //
     _pSwapChain->Present(0, 0);
+}
+
+void Application::BindTexture(AssetHandle texture)
+{
+	// Textures still loading are null, which samples as black until they arrive. Binding counts as use for the texture budget.
+	ID3D11ShaderResourceView* view = _assets->GetTexture(texture);
+	_assets->MarkTextureBound(texture);
+	_pImmediateContext->PSSetShaderResources(0, 1, &view);
+}
+
+void Application::DrawGameObject(GameObject* object, ConstantBuffer& cb)
+{
+	// Objects whose mesh is still loading aren't drawn yet
+	if (!object->HasMesh())
+	{
+		return;
+	}
+
+	const MeshData& mesh = object->GetMeshData();
+	bool compressed = mesh.Format == VertexFormat_Compressed;
+
+	// Pick the input layout and vertex shader that match the mesh's vertex format
+	_pImmediateContext->IASetInputLayout(compressed ? _pVertexLayoutCompressed : _pVertexLayout);
+	_pImmediateContext->VSSetShader(compressed ? _pVertexShaderCompressed : _pVertexShader, nullptr, 0);
+
+	XMFLOAT4X4 objectWorld = object->GetWorld();
+	cb.mWorld = XMMatrixTranspose(XMLoadFloat4x4(&objectWorld));
+	cb.PositionScale = XMFLOAT4(mesh.PositionScale.x, mesh.PositionScale.y, mesh.PositionScale.z, 0.0f);
+	cb.PositionOffset = XMFLOAT4(mesh.PositionOffset.x, mesh.PositionOffset.y, mesh.PositionOffset.z, 0.0f);
+	_pImmediateContext->UpdateSubresource(_pConstantBuffer, 0, nullptr, &cb, 0, 0);
+
+	// Use the coarsest level of detail that doesn't show at this distance, then skip the clusters that are off screen or facing away from the active camera
+	object->SelectLod(_View, _Projection, (float)_WindowHeight);
+	object->Cull(_View, _Projection, _backfaceCulling);
+	object->Draw(_pd3dDevice, _pImmediateContext);
 }
\ No newline at end of file
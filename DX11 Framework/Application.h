@@ -11,7 +11,10 @@
 #include "LookToCamera.h"
 #include "Structures.h"
 #include "OBJLoader.h"
+#include "MeshUpload.h"
 #include "GameObject.h"
+#include "AssetLoader.h"
+#include "TaskGraph.h"
 
 using namespace DirectX;
 
@@ -24,6 +27,7 @@ private:
 	D3D_FEATURE_LEVEL       _featureLevel;
 	ID3D11RasterizerState*  _wireframe;
 	ID3D11RasterizerState*  _solid;
+	bool                    _backfaceCulling;		// Whether the rasterizer state bound culls back faces, so the cluster cones can too
 	ID3D11Device*           _pd3dDevice;
 	ID3D11DeviceContext*    _pImmediateContext;
 	IDXGISwapChain*         _pSwapChain;
@@ -31,6 +35,8 @@ private:
 	ID3D11VertexShader*     _pVertexShader;
 	ID3D11PixelShader*      _pPixelShader;
 	ID3D11InputLayout*      _pVertexLayout;
+	ID3D11VertexShader*     _pVertexShaderCompressed;
+	ID3D11InputLayout*      _pVertexLayoutCompressed;
 	ID3D11Buffer*           _pVertexBuffer;
 	ID3D11Buffer*           _pPyramidVertexBuffer;
 	ID3D11Buffer*           _pGridVertexBuffer;
@@ -40,14 +46,15 @@ private:
 	ID3D11Buffer*           _pConstantBuffer;
 	ID3D11DepthStencilView* _depthStencilView;
 	ID3D11Texture2D*		_depthStencilBuffer;
-	ID3D11ShaderResourceView * _pTextureRV = nullptr;
-	ID3D11ShaderResourceView * _pTexturePlane = nullptr;
-	ID3D11ShaderResourceView * _pTextureTerrain = nullptr;
 	ID3D11SamplerState * _pSamplerLinear = nullptr;
-	MeshData				objMeshData;
-	MeshData				planeMesh;
-	MeshData				terrainMesh;
-	MeshData				starMesh;
+	AssetLoader*			_assets;
+	AssetHandle				_crateTexture;
+	AssetHandle				_planeTexture;
+	AssetHandle				_terrainTexture;
+	AssetHandle				_sphereMesh;
+	AssetHandle				_planeMesh;
+	AssetHandle				_terrainMesh;
+	AssetHandle				_starMesh;
 	GameObject*				_sphere;
 	GameObject*				_terrain;
 	GameObject*				_plane;
@@ -88,13 +95,20 @@ private:
 	HRESULT InitDevice();
 	void Cleanup();
 	HRESULT CompileShaderFromFile(WCHAR* szFileName, LPCSTR szEntryPoint, LPCSTR szShaderModel, ID3DBlob** ppBlobOut);
-	HRESULT InitShadersAndInputLayout();
+	HRESULT InitRenderTargets();
+	HRESULT InitStates();
+	HRESULT InitShadersAndInputLayout(ID3DBlob* pVSBlob, ID3DBlob* pPSBlob, ID3DBlob* pVSCompressedBlob);
+	HRESULT InitGeometry();
 	HRESULT InitVertexBuffer();
 	HRESULT InitIndexBuffer();
 	HRESULT InitPyramidVertexBuffer();
 	HRESULT InitPyramidIndexBuffer();
 	HRESULT InitGridVertexBuffer();
 	HRESULT InitGridIndexBuffer();
+	void BindPipeline();
+	void DrawGameObject(GameObject* object, ConstantBuffer& cb);
+	void AttachLoadedMesh(GameObject* object, AssetHandle mesh);
+	void BindTexture(AssetHandle texture);
 
 	UINT _WindowHeight;
 	UINT _WindowWidth;
@@ -0,0 +1,639 @@
+//Offline asset cooker. Walks an asset directory and brings every OBJ's mesh cache up to date, so the game only ever maps cooked meshes and
+//never parses text, and checks every DDS file is one the texture loader can read.
+//Uncompressed 8 bit textures are block compressed into a .bc file next to them, in the BC format that suits what they're used for, going by
+//their name: BC5 for normal maps (_nrm, _normal), BC4 for single channel maps (_spec, _specular, _gloss, _rough), and BC7 (or BC1/BC3 with
+//-bc fast) for everything else. BC7 needs a feature level 11_0 device, which is the lowest the game creates.
+//Caches carry a hash of the source they were cooked from, so a second run only cooks what has changed since.
+//With -pack, every cache and texture is then bundled into one Assets.pack in the asset directory, for AssetLoader::OpenPack. Colour textures
+//go in compressed under their source's name, so the game loads them the same way. BC4 and BC5 textures don't sample like their source (no z
+//for normals), so the source goes in under its name as it is, and the compressed one as "<name>.bc" for shaders written to read it.
+//
+//Only uses the mesh pipeline, DDSLayout, TextureCompressor and MappedFile, which build anywhere DirectXMath does, so it runs on build
+//machines without a GPU. CMakeLists.txt in the framework directory builds it on Linux, with the DirectXMath subset in Linux/ if need be.
+
+#include "OBJLoader.h"
+#include "MappedFile.h"
+#include "AssetPack.h"
+#include "DDSLayout.h"
+#include "MeshCache.h"
+#include "TextureCompressor.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <dirent.h>
+#include <sys/stat.h>
+#endif
+
+namespace
+{
+	enum JobType
+	{
+		Job_Mesh,
+		Job_CompressedMesh,
+		Job_Texture,
+	};
+
+	enum JobResult
+	{
+		Job_UpToDate,
+		Job_Cooked,
+		Job_Valid,
+		Job_Failed,
+	};
+
+	struct CookJob
+	{
+		std::string Filename;
+		JobType Type;
+		size_t SourceSize;
+		JobResult Result;
+		std::string Error;
+		double Milliseconds;
+
+		std::string Detail;		//A texture's format, or for compressed meshes how far quantizing moved the vertices
+
+		//Textures only
+		bool Compressed;		//Filename + ".bc" is up to date
+		TextureCompressor::Format Format;
+		uint64_t Pixels;		//The rest only when it was compressed this run
+		double EncodeSeconds;
+		double PSNR;
+	};
+
+	enum TextureMode
+	{
+		Textures_Keep,		//Only validate them
+		Textures_Fast,		//BC1, or BC3 with alpha, for colour
+		Textures_Best,		//BC7 for colour
+	};
+
+	struct CookOptions
+	{
+		bool Force;
+		bool InvertTexCoords;
+		bool FullMeshes;
+		bool CompressedMeshes;
+		bool EncodeStreams;
+		bool Pack;
+		TextureMode Textures;
+		unsigned int Threads;
+	};
+
+	bool HasExtension(const std::string& filename, const char* extension)
+	{
+		size_t length = strlen(extension);
+		if (filename.size() < length)
+		{
+			return false;
+		}
+
+		for (size_t i = 0; i < length; ++i)
+		{
+			if (tolower((unsigned char)filename[filename.size() - length + i]) != extension[i])
+			{
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	//Every .obj and .dds under directory. The caches sit next to their sources and end in .mesh/.qmesh, so they're never picked up.
+	void FindAssets(const std::string& directory, std::vector<std::string>& files)
+	{
+#ifdef _WIN32
+		WIN32_FIND_DATAA found;
+		HANDLE find = FindFirstFileA((directory + "/*").c_str(), &found);
+
+		if (find == INVALID_HANDLE_VALUE)
+		{
+			return;
+		}
+
+		do
+		{
+			std::string name = found.cFileName;
+			if (name == "." || name == "..")
+			{
+				continue;
+			}
+
+			std::string path = directory + "/" + name;
+
+			if (found.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
+			{
+				FindAssets(path, files);
+			}
+			else if (HasExtension(name, ".obj") || HasExtension(name, ".dds"))
+			{
+				files.push_back(path);
+			}
+		}
+		while (FindNextFileA(find, &found));
+
+		FindClose(find);
+#else
+		DIR* dir = opendir(directory.c_str());
+		if (!dir)
+		{
+			return;
+		}
+
+		while (dirent* entry = readdir(dir))
+		{
+			std::string name = entry->d_name;
+			if (name == "." || name == "..")
+			{
+				continue;
+			}
+
+			std::string path = directory + "/" + name;
+
+			struct stat info;
+			if (stat(path.c_str(), &info) != 0)
+			{
+				continue;
+			}
+
+			if (S_ISDIR(info.st_mode))
+			{
+				FindAssets(path, files);
+			}
+			else if (HasExtension(name, ".obj") || HasExtension(name, ".dds"))
+			{
+				files.push_back(path);
+			}
+		}
+
+		closedir(dir);
+#endif
+	}
+
+	//Checks the headers are well formed and the file holds every surface they describe, by the same rules the texture loader goes by
+	bool ValidateDDS(const char* filename, std::string& error)
+	{
+		MappedFile file;
+		if (!file.Open(filename))
+		{
+			error = "can't be opened";
+			return false;
+		}
+
+		DDSLayout::TextureLayout layout;
+		switch (DDSLayout::Parse(file.GetData(), file.GetSize(), layout))
+		{
+		case DDSLayout::Parse_Ok:
+			return true;
+
+		case DDSLayout::Parse_NotDDS:
+			error = "not a DDS file";
+			break;
+
+		case DDSLayout::Parse_Invalid:
+			error = "inconsistent headers, a zero size, or more mips than the texture has levels";
+			break;
+
+		case DDSLayout::Parse_Unsupported:
+			error = "a pixel format or layout the texture loader can't create";
+			break;
+
+		case DDSLayout::Parse_Truncated:
+			error = "truncated, the file ends before the last surface its headers describe";
+			break;
+		}
+
+		return false;
+	}
+
+	//What a texture is for, from the end of its name
+	TextureCompressor::Format ChooseFormat(const std::string& filename, const void* dds, const DDSLayout::TextureLayout& layout,
+		TextureMode mode)
+	{
+		std::string stem = filename.substr(0, filename.size() - 4);
+
+		if (HasExtension(stem, "_nrm") || HasExtension(stem, "_normal"))
+		{
+			return TextureCompressor::Format_BC5;
+		}
+
+		if (HasExtension(stem, "_spec") || HasExtension(stem, "_specular") || HasExtension(stem, "_gloss") || HasExtension(stem, "_rough"))
+		{
+			return TextureCompressor::Format_BC4;
+		}
+
+		if (mode == Textures_Best)
+		{
+			return TextureCompressor::Format_BC7;
+		}
+
+		return TextureCompressor::IsOpaque(dds, layout) ? TextureCompressor::Format_BC1 : TextureCompressor::Format_BC3;
+	}
+
+	bool WriteFile(const std::string& filename, const std::vector<uint8_t>& data)
+	{
+		std::string tempFilename = filename + ".tmp";
+
+		std::ofstream outbin(tempFilename.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+		if (!outbin.good())
+		{
+			return false;
+		}
+
+		outbin.write((const char*)data.data(), data.size());
+		outbin.close();
+
+		if (outbin.fail())
+		{
+			remove(tempFilename.c_str());
+			return false;
+		}
+
+		//rename won't replace an existing file on Windows
+		remove(filename.c_str());
+		return rename(tempFilename.c_str(), filename.c_str()) == 0;
+	}
+
+	//Brings a valid texture's .bc file up to date. Textures that are already compressed, or that BC can't hold, are left as they are.
+	void CompressTexture(CookJob& job, const CookOptions& options)
+	{
+		static const char* const formatNames[] = { "BC1", "BC3", "BC4", "BC5", "BC7" };
+
+		MappedFile source;
+		DDSLayout::TextureLayout layout;
+
+		if (!source.Open(job.Filename.c_str()) || DDSLayout::Parse(source.GetData(), source.GetSize(), layout) != DDSLayout::Parse_Ok)
+		{
+			job.Result = Job_Failed;
+			job.Error = "can't be read";
+			return;
+		}
+
+		if (!TextureCompressor::CanCompress(layout))
+		{
+			job.Detail = "kept as it is";
+			return;
+		}
+
+		TextureCompressor::Format format = ChooseFormat(job.Filename, source.GetData(), layout, options.Textures);
+		uint64_t sourceHash = MeshCache::HashBytes(source.GetData(), source.GetSize(), TextureCompressor::Version * 8 + format);
+		std::string cacheFilename = job.Filename + ".bc";
+
+		job.Detail = formatNames[format];
+		job.Format = format;
+
+		if (!options.Force)
+		{
+			MappedFile cache;
+			uint64_t cachedHash = 0;
+
+			if (cache.Open(cacheFilename.c_str()) && TextureCompressor::ReadSourceHash(cache.GetData(), cache.GetSize(), cachedHash) &&
+				cachedHash == sourceHash)
+			{
+				job.Result = Job_UpToDate;
+				job.Compressed = true;
+				return;
+			}
+		}
+
+		std::vector<uint8_t> output;
+		TextureCompressor::CompressStats stats;
+
+		if (TextureCompressor::Compress(source.GetData(), source.GetSize(), format, options.Threads, sourceHash, output, stats) !=
+			TextureCompressor::Compress_Ok || !WriteFile(cacheFilename, output))
+		{
+			job.Result = Job_Failed;
+			job.Error = "couldn't compress it or write " + cacheFilename;
+			return;
+		}
+
+		job.Result = Job_Cooked;
+		job.Compressed = true;
+		job.Pixels = stats.Pixels;
+		job.EncodeSeconds = stats.Seconds;
+		job.PSNR = stats.PSNR;
+	}
+
+	void RunJob(CookJob& job, const CookOptions& options)
+	{
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+		if (job.Type == Job_Texture)
+		{
+			job.Result = ValidateDDS(job.Filename.c_str(), job.Error) ? Job_Valid : Job_Failed;
+		}
+		else
+		{
+			VertexCompression::CompressionError compressionError;
+			OBJLoader::CookResult result = OBJLoader::Cook(job.Filename.c_str(), options.InvertTexCoords, job.Type == Job_CompressedMesh, options.Force,
+				options.EncodeStreams, &compressionError);
+
+			job.Result = result == OBJLoader::Cook_UpToDate ? Job_UpToDate : result == OBJLoader::Cook_Cooked ? Job_Cooked : Job_Failed;
+			if (result == OBJLoader::Cook_Failed)
+			{
+				job.Error = "couldn't read the OBJ or write its cache";
+			}
+			else if (result == OBJLoader::Cook_Cooked && job.Type == Job_CompressedMesh)
+			{
+				//How much quantizing moved the vertices, so a mesh too big or detailed for 16 bit positions shows up here rather than on screen
+				char detail[96];
+				sprintf(detail, "max error %.3g units, %.3g degrees", compressionError.MaxPositionError, compressionError.MaxNormalErrorDegrees);
+				job.Detail = detail;
+			}
+		}
+
+		job.Milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	//Bundles every cooked cache and valid texture into directory/Assets.pack, named by their path relative to the directory
+	bool WritePack(const std::string& directory, const std::vector<CookJob>& jobs, const CookOptions& options, unsigned int& packed)
+	{
+		std::vector<AssetPackSource> sources;
+
+		for (size_t i = 0; i < jobs.size(); ++i)
+		{
+			const CookJob& job = jobs[i];
+			if (job.Result == Job_Failed)
+			{
+				continue;
+			}
+
+			AssetPackSource source;
+			source.Name = job.Filename.substr(directory.size() + 1);
+			source.Filename = job.Filename;
+			source.Flags = 0;
+
+			if (job.Type == Job_Texture && job.Compressed && !TextureCompressor::SamplesLikeSource(job.Format))
+			{
+				source.Type = AssetPack::Entry_Texture;
+				sources.push_back(source);
+
+				source.Name += ".bc";
+				source.Filename += ".bc";
+			}
+			else if (job.Type == Job_Texture)
+			{
+				source.Filename += job.Compressed ? ".bc" : "";
+				source.Type = AssetPack::Entry_Texture;
+			}
+			else
+			{
+				const char* suffix = MeshCache::CacheSuffix(options.InvertTexCoords, job.Type == Job_CompressedMesh);
+				source.Name += suffix;
+				source.Filename += suffix;
+				source.Type = job.Type == Job_CompressedMesh ? AssetPack::Entry_CompressedMesh : AssetPack::Entry_Mesh;
+				source.Flags = options.InvertTexCoords ? AssetPack::Flag_InvertTexCoords : 0;
+			}
+
+			sources.push_back(source);
+		}
+
+		packed = (unsigned int)sources.size();
+		return WriteAssetPack((directory + "/Assets.pack").c_str(), sources);
+	}
+
+	bool BiggerSource(const CookJob* a, const CookJob* b)
+	{
+		return a->SourceSize > b->SourceSize;
+	}
+
+	void PrintUsage()
+	{
+		printf("Usage: AssetCooker [options] <asset directory>\n"
+			"  -force            Cook every mesh, even ones whose cache is up to date\n"
+			"  -format <format>  full, compressed or both (default) -- which mesh caches to build\n"
+			"  -encode           Store mesh vertices and indices MeshCodec encoded: smaller files, but every load decodes them\n"
+			"  -noinvert         Keep OBJ texture coordinates as they are rather than flipping V, to match OBJLoader::Load(..., false)\n"
+			"  -bc <mode>        best (default), fast or none -- BC7 or BC1/BC3 for colour textures, or no texture compression\n"
+			"  -j <threads>      Worker threads, defaults to one per hardware thread\n"
+			"  -pack             Bundle the caches and textures into Assets.pack in the asset directory\n");
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	CookOptions options;
+	options.Force = false;
+	options.InvertTexCoords = true;
+	options.FullMeshes = true;
+	options.CompressedMeshes = true;
+	options.EncodeStreams = false;
+	options.Pack = false;
+	options.Textures = Textures_Best;
+	options.Threads = std::max(std::thread::hardware_concurrency(), 1u);
+
+	const char* directory = nullptr;
+
+	for (int i = 1; i < argc; ++i)
+	{
+		std::string arg = argv[i];
+
+		if (arg == "-force")
+		{
+			options.Force = true;
+		}
+		else if (arg == "-pack")
+		{
+			options.Pack = true;
+		}
+		else if (arg == "-encode")
+		{
+			options.EncodeStreams = true;
+		}
+		else if (arg == "-noinvert")
+		{
+			options.InvertTexCoords = false;
+		}
+		else if (arg == "-format" && i + 1 < argc)
+		{
+			std::string format = argv[++i];
+			options.FullMeshes = format == "full" || format == "both";
+			options.CompressedMeshes = format == "compressed" || format == "both";
+
+			if (!options.FullMeshes && !options.CompressedMeshes)
+			{
+				PrintUsage();
+				return 2;
+			}
+		}
+		else if (arg == "-bc" && i + 1 < argc)
+		{
+			std::string mode = argv[++i];
+			if (mode != "best" && mode != "fast" && mode != "none")
+			{
+				PrintUsage();
+				return 2;
+			}
+
+			options.Textures = mode == "best" ? Textures_Best : mode == "fast" ? Textures_Fast : Textures_Keep;
+		}
+		else if (arg == "-j" && i + 1 < argc)
+		{
+			options.Threads = std::max(atoi(argv[++i]), 1);
+		}
+		else if (arg[0] != '-' && !directory)
+		{
+			directory = argv[i];
+		}
+		else
+		{
+			PrintUsage();
+			return 2;
+		}
+	}
+
+	if (!directory)
+	{
+		PrintUsage();
+		return 2;
+	}
+
+	std::vector<std::string> files;
+	FindAssets(directory, files);
+	std::sort(files.begin(), files.end());
+
+	std::vector<CookJob> jobs;
+
+	for (size_t i = 0; i < files.size(); ++i)
+	{
+		CookJob job;
+		job.Filename = files[i];
+		job.Result = Job_Failed;
+		job.Milliseconds = 0.0;
+		job.Compressed = false;
+		job.Format = TextureCompressor::Format_BC7;
+		job.Pixels = 0;
+		job.EncodeSeconds = 0.0;
+		job.PSNR = 0.0;
+
+		MappedFile source;
+		job.SourceSize = source.Open(files[i].c_str()) ? source.GetSize() : 0;
+
+		if (HasExtension(files[i], ".dds"))
+		{
+			job.Type = Job_Texture;
+			jobs.push_back(job);
+			continue;
+		}
+
+		if (options.FullMeshes)
+		{
+			job.Type = Job_Mesh;
+			jobs.push_back(job);
+		}
+
+		if (options.CompressedMeshes)
+		{
+			job.Type = Job_CompressedMesh;
+			jobs.push_back(job);
+		}
+	}
+
+	//Biggest first, so a large mesh doesn't start last and leave every other thread idle while it cooks
+	std::vector<CookJob*> order;
+	for (size_t i = 0; i < jobs.size(); ++i)
+	{
+		order.push_back(&jobs[i]);
+	}
+
+	std::stable_sort(order.begin(), order.end(), BiggerSource);
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	std::atomic<size_t> next(0);
+
+	unsigned int numThreads = std::min(options.Threads, (unsigned int)std::max(jobs.size(), (size_t)1));
+	std::vector<std::thread> threads;
+
+	for (unsigned int t = 0; t < numThreads; ++t)
+	{
+		threads.push_back(std::thread([&]()
+		{
+			for (size_t j = next++; j < order.size(); j = next++)
+			{
+				RunJob(*order[j], options);
+			}
+		}));
+	}
+
+	for (size_t t = 0; t < threads.size(); ++t)
+	{
+		threads[t].join();
+	}
+
+	//Then the textures one at a time, each spread over every thread, since even a single texture has thousands of blocks
+	uint64_t encodedPixels = 0;
+	double encodeSeconds = 0.0;
+
+	for (size_t i = 0; i < jobs.size() && options.Textures != Textures_Keep; ++i)
+	{
+		CookJob& job = jobs[i];
+		if (job.Type == Job_Texture && job.Result == Job_Valid)
+		{
+			std::chrono::steady_clock::time_point compressStart = std::chrono::steady_clock::now();
+			CompressTexture(job, options);
+			job.Milliseconds += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - compressStart).count();
+
+			encodedPixels += job.Pixels;
+			encodeSeconds += job.EncodeSeconds;
+		}
+	}
+
+	double total = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+	static const char* const typeNames[] = { "full", "compressed", "texture" };
+	static const char* const resultNames[] = { "up to date", "cooked", "valid", "FAILED" };
+	unsigned int counts[4] = { 0, 0, 0, 0 };
+
+	for (size_t i = 0; i < jobs.size(); ++i)
+	{
+		const CookJob& job = jobs[i];
+		counts[job.Result]++;
+
+		printf("%-10s %-10s %9.1f ms  %s", resultNames[job.Result], typeNames[job.Type], job.Milliseconds, job.Filename.c_str());
+
+		if (job.Pixels > 0)
+		{
+			printf(" (%s, %.1f dB PSNR, %.2f Mpixels/s)", job.Detail.c_str(), job.PSNR, job.Pixels / job.EncodeSeconds / 1000000.0);
+		}
+		else if (!job.Detail.empty())
+		{
+			printf(" (%s)", job.Detail.c_str());
+		}
+
+		printf("%s%s\n", job.Error.empty() ? "" : ": ", job.Error.c_str());
+	}
+
+	printf("%u cooked, %u up to date, %u textures valid, %u failed in %.1f ms on %u threads\n",
+		counts[Job_Cooked], counts[Job_UpToDate], counts[Job_Valid], counts[Job_Failed], total, numThreads);
+
+	if (encodedPixels > 0)
+	{
+		printf("Compressed %.1f Mpixels of textures at %.2f Mpixels/s\n", encodedPixels / 1000000.0, encodedPixels / encodeSeconds / 1000000.0);
+	}
+
+	if (options.Pack)
+	{
+		unsigned int packed = 0;
+		if (!WritePack(directory, jobs, options, packed))
+		{
+			printf("Couldn't write %s/Assets.pack\n", directory);
+			return 1;
+		}
+
+		printf("Packed %u assets into %s/Assets.pack\n", packed, directory);
+	}
+
+	return counts[Job_Failed] > 0 ? 1 : 0;
+}
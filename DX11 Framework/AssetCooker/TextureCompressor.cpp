@@ -0,0 +1,1193 @@
+#include "TextureCompressor.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cfloat>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <mutex>
+#include <thread>
+#include <directxmath.h>
+
+using namespace DirectX;
+
+namespace
+{
+	const uint32_t TagMagic = 0x504D4354;		//"TCMP", in the first reserved word of the header with the source hash after it
+	const size_t HeaderSize = 4 + 124 + 20;		//Magic, DDS_HEADER, DDS_HEADER_DXT10
+
+	//A 4x4 block with each row of four pixels in one vector per channel, so FitPalette covers four pixels per operation
+	struct BlockVectors
+	{
+		XMVECTOR Rows[4][4];		//[channel][row]
+	};
+
+	//The same pixels as floats, for the per block maths that isn't worth vectorising
+	struct BlockPixels
+	{
+		float Values[16][4];
+	};
+
+	void LoadBlock(const uint8_t* pixels, BlockPixels& block, BlockVectors& vectors)
+	{
+		for (int i = 0; i < 16; ++i)
+		{
+			for (int channel = 0; channel < 4; ++channel)
+			{
+				block.Values[i][channel] = pixels[i * 4 + channel];
+			}
+		}
+
+		for (int channel = 0; channel < 4; ++channel)
+		{
+			for (int row = 0; row < 4; ++row)
+			{
+				vectors.Rows[channel][row] = XMVectorSet(block.Values[row * 4][channel], block.Values[row * 4 + 1][channel],
+					block.Values[row * 4 + 2][channel], block.Values[row * 4 + 3][channel]);
+			}
+		}
+	}
+
+	//Squared distance of every pixel to the closest palette entry over the first channels, from firstChannel, summed. indices gets which
+	//entry that was for each pixel, if it isn't null.
+	float FitPalette(const BlockVectors& block, unsigned int firstChannel, unsigned int channels, const XMFLOAT4* palette, unsigned int paletteSize,
+		uint8_t* indices)
+	{
+		XMVECTOR total = XMVectorZero();
+
+		for (unsigned int row = 0; row < 4; ++row)
+		{
+			XMVECTOR best = XMVectorReplicate(FLT_MAX);
+			XMVECTOR bestIndex = XMVectorZero();
+
+			for (unsigned int entry = 0; entry < paletteSize; ++entry)
+			{
+				const float* colour = &palette[entry].x;
+
+				XMVECTOR difference = XMVectorSubtract(block.Rows[firstChannel][row], XMVectorReplicate(colour[0]));
+				XMVECTOR distance = XMVectorMultiply(difference, difference);
+
+				for (unsigned int channel = 1; channel < channels; ++channel)
+				{
+					difference = XMVectorSubtract(block.Rows[firstChannel + channel][row], XMVectorReplicate(colour[channel]));
+					distance = XMVectorMultiplyAdd(difference, difference, distance);
+				}
+
+				XMVECTOR closer = XMVectorLess(distance, best);
+				best = XMVectorSelect(best, distance, closer);
+				bestIndex = XMVectorSelect(bestIndex, XMVectorReplicate((float)entry), closer);
+			}
+
+			total = XMVectorAdd(total, best);
+
+			if (indices)
+			{
+				XMFLOAT4 rowIndices;
+				XMStoreFloat4(&rowIndices, bestIndex);
+				indices[row * 4] = (uint8_t)rowIndices.x;
+				indices[row * 4 + 1] = (uint8_t)rowIndices.y;
+				indices[row * 4 + 2] = (uint8_t)rowIndices.z;
+				indices[row * 4 + 3] = (uint8_t)rowIndices.w;
+			}
+		}
+
+		XMFLOAT4 sum;
+		XMStoreFloat4(&sum, total);
+		return sum.x + sum.y + sum.z + sum.w;
+	}
+
+	//The mean of the pixels and the direction they spread along most, by power iteration on their covariance
+	void PrincipalAxis(const BlockPixels& block, unsigned int channels, float* mean, float* axis)
+	{
+		for (unsigned int c = 0; c < channels; ++c)
+		{
+			mean[c] = 0.0f;
+			for (int i = 0; i < 16; ++i)
+			{
+				mean[c] += block.Values[i][c];
+			}
+
+			mean[c] /= 16.0f;
+		}
+
+		float covariance[4][4] = {};
+		for (int i = 0; i < 16; ++i)
+		{
+			for (unsigned int a = 0; a < channels; ++a)
+			{
+				for (unsigned int b = 0; b < channels; ++b)
+				{
+					covariance[a][b] += (block.Values[i][a] - mean[a]) * (block.Values[i][b] - mean[b]);
+				}
+			}
+		}
+
+		//Start from the diagonal, which is never orthogonal to the answer for real images
+		for (unsigned int c = 0; c < channels; ++c)
+		{
+			axis[c] = 1.0f;
+		}
+
+		for (int iteration = 0; iteration < 8; ++iteration)
+		{
+			float next[4] = {};
+			float length = 0.0f;
+
+			for (unsigned int a = 0; a < channels; ++a)
+			{
+				for (unsigned int b = 0; b < channels; ++b)
+				{
+					next[a] += covariance[a][b] * axis[b];
+				}
+
+				length = std::max(length, std::fabs(next[a]));
+			}
+
+			//Every pixel the same colour
+			if (length < 1e-6f)
+			{
+				break;
+			}
+
+			for (unsigned int c = 0; c < channels; ++c)
+			{
+				axis[c] = next[c] / length;
+			}
+		}
+	}
+
+	//Endpoints at either end of the pixels' spread along the principal axis
+	void AxisEndpoints(const BlockPixels& block, unsigned int channels, float* endpoint0, float* endpoint1)
+	{
+		float mean[4];
+		float axis[4];
+		PrincipalAxis(block, channels, mean, axis);
+
+		float lengthSq = 0.0f;
+		for (unsigned int c = 0; c < channels; ++c)
+		{
+			lengthSq += axis[c] * axis[c];
+		}
+
+		float lowest = 0.0f;
+		float highest = 0.0f;
+
+		for (int i = 0; i < 16; ++i)
+		{
+			float t = 0.0f;
+			for (unsigned int c = 0; c < channels; ++c)
+			{
+				t += (block.Values[i][c] - mean[c]) * axis[c];
+			}
+
+			t /= lengthSq;
+			lowest = std::min(lowest, t);
+			highest = std::max(highest, t);
+		}
+
+		for (unsigned int c = 0; c < channels; ++c)
+		{
+			endpoint0[c] = mean[c] + axis[c] * lowest;
+			endpoint1[c] = mean[c] + axis[c] * highest;
+		}
+	}
+
+	//The endpoints that best fit the pixels for the indices they were given, where index i sits weights[i] of the way from endpoint0 to
+	//endpoint1. False if the indices don't pin both endpoints down (every pixel on the same palette entry).
+	bool RefitEndpoints(const BlockPixels& block, unsigned int channels, const uint8_t* indices, const float* weights, float* endpoint0,
+		float* endpoint1)
+	{
+		float aa = 0.0f;
+		float ab = 0.0f;
+		float bb = 0.0f;
+		float ax[4] = {};
+		float bx[4] = {};
+
+		for (int i = 0; i < 16; ++i)
+		{
+			float b = weights[indices[i]];
+			float a = 1.0f - b;
+
+			aa += a * a;
+			ab += a * b;
+			bb += b * b;
+
+			for (unsigned int c = 0; c < channels; ++c)
+			{
+				ax[c] += a * block.Values[i][c];
+				bx[c] += b * block.Values[i][c];
+			}
+		}
+
+		float determinant = aa * bb - ab * ab;
+		if (std::fabs(determinant) < 1e-6f)
+		{
+			return false;
+		}
+
+		for (unsigned int c = 0; c < channels; ++c)
+		{
+			endpoint0[c] = (bb * ax[c] - ab * bx[c]) / determinant;
+			endpoint1[c] = (aa * bx[c] - ab * ax[c]) / determinant;
+		}
+
+		return true;
+	}
+
+	int Quantise(float value, int maximum)
+	{
+		return std::min(std::max((int)std::floor(value * maximum / 255.0f + 0.5f), 0), maximum);
+	}
+
+	//Fills bits from the least significant of the first byte up, as BC7 lays them out
+	struct BitWriter
+	{
+		BitWriter(uint8_t* bytes) : _bytes(bytes), _position(0) {}
+
+		void Write(uint32_t value, unsigned int count)
+		{
+			for (unsigned int i = 0; i < count; ++i, ++_position)
+			{
+				_bytes[_position >> 3] |= (uint8_t)(((value >> i) & 1) << (_position & 7));
+			}
+		}
+
+	private:
+		uint8_t* _bytes;
+		unsigned int _position;
+	};
+
+	uint32_t ReadBits(const uint8_t* bytes, unsigned int& position, unsigned int count)
+	{
+		uint32_t value = 0;
+		for (unsigned int i = 0; i < count; ++i, ++position)
+		{
+			value |= (uint32_t)((bytes[position >> 3] >> (position & 7)) & 1) << i;
+		}
+
+		return value;
+	}
+
+	//BC1 -------------------------------------------------------------------------------------------------------------------------------
+
+	//Endpoints as 5:6:5 components, red first
+	struct ColourEndpoints
+	{
+		int Values[2][3];
+	};
+
+	const int ColourMaximum[3] = { 31, 63, 31 };
+	const float ColourWeights[4] = { 0.0f, 1.0f, 1.0f / 3.0f, 2.0f / 3.0f };
+
+	int ExpandColour(int value, int channel)
+	{
+		return channel == 1 ? (value << 2) | (value >> 4) : (value << 3) | (value >> 2);
+	}
+
+	float FitColour(const BlockVectors& block, const ColourEndpoints& endpoints, uint8_t* indices)
+	{
+		XMFLOAT4 palette[4];
+		float* entries = &palette[0].x;
+
+		for (int c = 0; c < 3; ++c)
+		{
+			float colour0 = (float)ExpandColour(endpoints.Values[0][c], c);
+			float colour1 = (float)ExpandColour(endpoints.Values[1][c], c);
+
+			for (int entry = 0; entry < 4; ++entry)
+			{
+				entries[entry * 4 + c] = colour0 + (colour1 - colour0) * ColourWeights[entry];
+			}
+		}
+
+		return FitPalette(block, 0, 3, palette, 4, indices);
+	}
+
+	void QuantiseColour(const float* endpoint0, const float* endpoint1, ColourEndpoints& endpoints)
+	{
+		for (int c = 0; c < 3; ++c)
+		{
+			endpoints.Values[0][c] = Quantise(endpoint0[c], ColourMaximum[c]);
+			endpoints.Values[1][c] = Quantise(endpoint1[c], ColourMaximum[c]);
+		}
+	}
+
+	void EncodeColour(const BlockPixels& pixels, const BlockVectors& block, uint8_t* output)
+	{
+		float endpoint0[4];
+		float endpoint1[4];
+		AxisEndpoints(pixels, 3, endpoint0, endpoint1);
+
+		ColourEndpoints best;
+		QuantiseColour(endpoint0, endpoint1, best);
+
+		uint8_t indices[16];
+		float bestError = FitColour(block, best, indices);
+
+		//Least squares on the indices the axis gave, then again on the ones that gives
+		for (int iteration = 0; iteration < 2; ++iteration)
+		{
+			if (!RefitEndpoints(pixels, 3, indices, ColourWeights, endpoint0, endpoint1))
+			{
+				break;
+			}
+
+			ColourEndpoints refitted;
+			QuantiseColour(endpoint0, endpoint1, refitted);
+
+			uint8_t refittedIndices[16];
+			float error = FitColour(block, refitted, refittedIndices);
+			if (error >= bestError)
+			{
+				break;
+			}
+
+			best = refitted;
+			bestError = error;
+			memcpy(indices, refittedIndices, sizeof(indices));
+		}
+
+		//Then one step either way on each component, while that helps
+		for (int pass = 0; pass < 4 && bestError > 0.0f; ++pass)
+		{
+			bool improved = false;
+
+			for (int component = 0; component < 6; ++component)
+			{
+				int endpoint = component / 3;
+				int channel = component % 3;
+
+				for (int step = -1; step <= 1; step += 2)
+				{
+					ColourEndpoints candidate = best;
+					int value = candidate.Values[endpoint][channel] + step;
+					if (value < 0 || value > ColourMaximum[channel])
+					{
+						continue;
+					}
+
+					candidate.Values[endpoint][channel] = value;
+					float error = FitColour(block, candidate, nullptr);
+
+					if (error < bestError)
+					{
+						best = candidate;
+						bestError = error;
+						improved = true;
+					}
+				}
+			}
+
+			if (!improved)
+			{
+				break;
+			}
+		}
+
+		FitColour(block, best, indices);
+
+		uint16_t colour0 = (uint16_t)((best.Values[0][0] << 11) | (best.Values[0][1] << 5) | best.Values[0][2]);
+		uint16_t colour1 = (uint16_t)((best.Values[1][0] << 11) | (best.Values[1][1] << 5) | best.Values[1][2]);
+
+		//The four colour mode needs colour0 > colour1. Swapping the endpoints swaps index 0 with 1 and 2 with 3.
+		if (colour0 < colour1)
+		{
+			std::swap(colour0, colour1);
+			for (int i = 0; i < 16; ++i)
+			{
+				indices[i] ^= 1;
+			}
+		}
+		else if (colour0 == colour1)
+		{
+			memset(indices, 0, sizeof(indices));
+		}
+
+		uint32_t packed = 0;
+		for (int i = 0; i < 16; ++i)
+		{
+			packed |= (uint32_t)indices[i] << (i * 2);
+		}
+
+		output[0] = (uint8_t)colour0;
+		output[1] = (uint8_t)(colour0 >> 8);
+		output[2] = (uint8_t)colour1;
+		output[3] = (uint8_t)(colour1 >> 8);
+		memcpy(output + 4, &packed, 4);
+	}
+
+	void DecodeColour(const uint8_t* input, uint8_t* pixels, bool alwaysFourColours)
+	{
+		uint16_t colour0 = (uint16_t)(input[0] | (input[1] << 8));
+		uint16_t colour1 = (uint16_t)(input[2] | (input[3] << 8));
+
+		int palette[4][4];
+		int components[2][3] = { { colour0 >> 11, (colour0 >> 5) & 63, colour0 & 31 }, { colour1 >> 11, (colour1 >> 5) & 63, colour1 & 31 } };
+
+		for (int c = 0; c < 3; ++c)
+		{
+			int value0 = ExpandColour(components[0][c], c);
+			int value1 = ExpandColour(components[1][c], c);
+			palette[0][c] = value0;
+			palette[1][c] = value1;
+
+			if (alwaysFourColours || colour0 > colour1)
+			{
+				palette[2][c] = (2 * value0 + value1) / 3;
+				palette[3][c] = (value0 + 2 * value1) / 3;
+			}
+			else
+			{
+				palette[2][c] = (value0 + value1) / 2;
+				palette[3][c] = 0;
+			}
+		}
+
+		palette[0][3] = palette[1][3] = palette[2][3] = 255;
+		palette[3][3] = alwaysFourColours || colour0 > colour1 ? 255 : 0;
+
+		uint32_t packed;
+		memcpy(&packed, input + 4, 4);
+
+		for (int i = 0; i < 16; ++i)
+		{
+			const int* colour = palette[(packed >> (i * 2)) & 3];
+			for (int c = 0; c < 4; ++c)
+			{
+				pixels[i * 4 + c] = (uint8_t)colour[c];
+			}
+		}
+	}
+
+	//BC4, and the alpha of BC3 --------------------------------------------------------------------------------------------------------
+
+	//value0 > value1 interpolates eight values, otherwise six plus 0 and 255
+	void SingleChannelPalette(int value0, int value1, XMFLOAT4* palette)
+	{
+		float* entries = &palette[0].x;
+		entries[0] = (float)value0;
+		entries[4] = (float)value1;
+
+		if (value0 > value1)
+		{
+			for (int entry = 2; entry < 8; ++entry)
+			{
+				entries[entry * 4] = ((8 - entry) * value0 + (entry - 1) * value1) / 7.0f;
+			}
+		}
+		else
+		{
+			for (int entry = 2; entry < 6; ++entry)
+			{
+				entries[entry * 4] = ((6 - entry) * value0 + (entry - 1) * value1) / 5.0f;
+			}
+
+			entries[24] = 0.0f;
+			entries[28] = 255.0f;
+		}
+	}
+
+	float FitSingleChannel(const BlockVectors& block, unsigned int channel, int value0, int value1, uint8_t* indices)
+	{
+		XMFLOAT4 palette[8];
+		SingleChannelPalette(value0, value1, palette);
+		return FitPalette(block, channel, 1, palette, 8, indices);
+	}
+
+	void EncodeSingleChannel(const BlockPixels& pixels, const BlockVectors& block, unsigned int channel, uint8_t* output)
+	{
+		int lowest = 255;
+		int highest = 0;
+		int innerLowest = 255;
+		int innerHighest = 0;
+
+		for (int i = 0; i < 16; ++i)
+		{
+			int value = (int)pixels.Values[i][channel];
+			lowest = std::min(lowest, value);
+			highest = std::max(highest, value);
+
+			if (value != 0 && value != 255)
+			{
+				innerLowest = std::min(innerLowest, value);
+				innerHighest = std::max(innerHighest, value);
+			}
+		}
+
+		int best0 = highest;
+		int best1 = lowest;
+		float bestError = FLT_MAX;
+
+		if (lowest == highest)
+		{
+			//Six value mode, index 0 is value0 exactly
+			bestError = 0.0f;
+		}
+		else
+		{
+			//Eight values between the extremes, and a little inside them, since pulling the ends in can bring the steps closer to the pixels
+			for (int value0 = std::max(highest - 3, lowest + 1); value0 <= highest; ++value0)
+			{
+				for (int value1 = lowest; value1 <= std::min(lowest + 3, value0 - 1); ++value1)
+				{
+					float error = FitSingleChannel(block, channel, value0, value1, nullptr);
+					if (error < bestError)
+					{
+						best0 = value0;
+						best1 = value1;
+						bestError = error;
+					}
+				}
+			}
+
+			//Six values between the pixels that aren't 0 or 255, which get those entries to themselves
+			if ((lowest == 0 || highest == 255) && innerLowest <= innerHighest)
+			{
+				float error = FitSingleChannel(block, channel, innerLowest, innerHighest, nullptr);
+				if (error < bestError)
+				{
+					best0 = innerLowest;
+					best1 = innerHighest;
+					bestError = error;
+				}
+			}
+		}
+
+		uint8_t indices[16];
+		FitSingleChannel(block, channel, best0, best1, indices);
+
+		uint64_t packed = 0;
+		for (int i = 0; i < 16; ++i)
+		{
+			packed |= (uint64_t)indices[i] << (i * 3);
+		}
+
+		output[0] = (uint8_t)best0;
+		output[1] = (uint8_t)best1;
+		for (int i = 0; i < 6; ++i)
+		{
+			output[2 + i] = (uint8_t)(packed >> (i * 8));
+		}
+	}
+
+	void DecodeSingleChannel(const uint8_t* input, uint8_t* pixels, unsigned int channel)
+	{
+		int value0 = input[0];
+		int value1 = input[1];
+		int palette[8] = { value0, value1 };
+
+		if (value0 > value1)
+		{
+			for (int entry = 2; entry < 8; ++entry)
+			{
+				palette[entry] = ((8 - entry) * value0 + (entry - 1) * value1) / 7;
+			}
+		}
+		else
+		{
+			for (int entry = 2; entry < 6; ++entry)
+			{
+				palette[entry] = ((6 - entry) * value0 + (entry - 1) * value1) / 5;
+			}
+
+			palette[6] = 0;
+			palette[7] = 255;
+		}
+
+		uint64_t packed = 0;
+		for (int i = 0; i < 6; ++i)
+		{
+			packed |= (uint64_t)input[2 + i] << (i * 8);
+		}
+
+		for (int i = 0; i < 16; ++i)
+		{
+			pixels[i * 4 + channel] = (uint8_t)palette[(packed >> (i * 3)) & 7];
+		}
+	}
+
+	//BC7 mode 6 -----------------------------------------------------------------------------------------------------------------------
+
+	//7 bit RGBA endpoints and the bit below them each one shares across its channels
+	struct ModeSixEndpoints
+	{
+		int Values[2][4];
+		int PBits[2];
+	};
+
+	const int ModeSixWeights[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+	float FitModeSix(const BlockVectors& block, const ModeSixEndpoints& endpoints, uint8_t* indices)
+	{
+		XMFLOAT4 palette[16];
+		float* entries = &palette[0].x;
+
+		for (int c = 0; c < 4; ++c)
+		{
+			int value0 = (endpoints.Values[0][c] << 1) | endpoints.PBits[0];
+			int value1 = (endpoints.Values[1][c] << 1) | endpoints.PBits[1];
+
+			for (int entry = 0; entry < 16; ++entry)
+			{
+				entries[entry * 4 + c] = (float)(((64 - ModeSixWeights[entry]) * value0 + ModeSixWeights[entry] * value1 + 32) >> 6);
+			}
+		}
+
+		return FitPalette(block, 0, 4, palette, 16, indices);
+	}
+
+	//The closest 7 bit values for each choice of p-bits, keeping whichever fits best
+	float QuantiseModeSix(const BlockVectors& block, const float* endpoint0, const float* endpoint1, ModeSixEndpoints& endpoints)
+	{
+		const float* ends[2] = { endpoint0, endpoint1 };
+		float bestError = FLT_MAX;
+
+		for (int pbits = 0; pbits < 4; ++pbits)
+		{
+			ModeSixEndpoints candidate;
+
+			for (int endpoint = 0; endpoint < 2; ++endpoint)
+			{
+				int pbit = (pbits >> endpoint) & 1;
+				candidate.PBits[endpoint] = pbit;
+
+				for (int c = 0; c < 4; ++c)
+				{
+					int value = (int)std::floor((ends[endpoint][c] - pbit) / 2.0f + 0.5f);
+					candidate.Values[endpoint][c] = std::min(std::max(value, 0), 127);
+				}
+			}
+
+			float error = FitModeSix(block, candidate, nullptr);
+			if (error < bestError)
+			{
+				endpoints = candidate;
+				bestError = error;
+			}
+		}
+
+		return bestError;
+	}
+
+	void EncodeModeSix(const BlockPixels& pixels, const BlockVectors& block, uint8_t* output)
+	{
+		float endpoint0[4];
+		float endpoint1[4];
+		AxisEndpoints(pixels, 4, endpoint0, endpoint1);
+
+		ModeSixEndpoints best;
+		float bestError = QuantiseModeSix(block, endpoint0, endpoint1, best);
+
+		float weights[16];
+		for (int i = 0; i < 16; ++i)
+		{
+			weights[i] = ModeSixWeights[i] / 64.0f;
+		}
+
+		uint8_t indices[16];
+		FitModeSix(block, best, indices);
+
+		for (int iteration = 0; iteration < 2; ++iteration)
+		{
+			if (!RefitEndpoints(pixels, 4, indices, weights, endpoint0, endpoint1))
+			{
+				break;
+			}
+
+			ModeSixEndpoints refitted;
+			float error = QuantiseModeSix(block, endpoint0, endpoint1, refitted);
+			if (error >= bestError)
+			{
+				break;
+			}
+
+			best = refitted;
+			bestError = error;
+			FitModeSix(block, best, indices);
+		}
+
+		for (int pass = 0; pass < 3 && bestError > 0.0f; ++pass)
+		{
+			bool improved = false;
+
+			for (int component = 0; component < 8; ++component)
+			{
+				int endpoint = component / 4;
+				int channel = component % 4;
+
+				for (int step = -1; step <= 1; step += 2)
+				{
+					ModeSixEndpoints candidate = best;
+					int value = candidate.Values[endpoint][channel] + step;
+					if (value < 0 || value > 127)
+					{
+						continue;
+					}
+
+					candidate.Values[endpoint][channel] = value;
+					float error = FitModeSix(block, candidate, nullptr);
+
+					if (error < bestError)
+					{
+						best = candidate;
+						bestError = error;
+						improved = true;
+					}
+				}
+			}
+
+			if (!improved)
+			{
+				break;
+			}
+		}
+
+		FitModeSix(block, best, indices);
+
+		//The first pixel's index has only 3 bits, its top bit is taken to be 0. Swapping the endpoints flips every index.
+		if (indices[0] >= 8)
+		{
+			std::swap(best.Values[0], best.Values[1]);
+			std::swap(best.PBits[0], best.PBits[1]);
+
+			for (int i = 0; i < 16; ++i)
+			{
+				indices[i] = (uint8_t)(15 - indices[i]);
+			}
+		}
+
+		memset(output, 0, 16);
+		BitWriter bits(output);
+		bits.Write(1 << 6, 7);
+
+		for (int c = 0; c < 4; ++c)
+		{
+			bits.Write(best.Values[0][c], 7);
+			bits.Write(best.Values[1][c], 7);
+		}
+
+		bits.Write(best.PBits[0], 1);
+		bits.Write(best.PBits[1], 1);
+		bits.Write(indices[0], 3);
+
+		for (int i = 1; i < 16; ++i)
+		{
+			bits.Write(indices[i], 4);
+		}
+	}
+
+	bool DecodeModeSix(const uint8_t* input, uint8_t* pixels)
+	{
+		if ((input[0] & 0x7F) != 0x40)
+		{
+			return false;
+		}
+
+		unsigned int position = 7;
+		int values[2][4];
+
+		for (int c = 0; c < 4; ++c)
+		{
+			values[0][c] = (int)ReadBits(input, position, 7) << 1;
+			values[1][c] = (int)ReadBits(input, position, 7) << 1;
+		}
+
+		int pbit0 = (int)ReadBits(input, position, 1);
+		int pbit1 = (int)ReadBits(input, position, 1);
+
+		for (int c = 0; c < 4; ++c)
+		{
+			values[0][c] |= pbit0;
+			values[1][c] |= pbit1;
+		}
+
+		for (int i = 0; i < 16; ++i)
+		{
+			int weight = ModeSixWeights[ReadBits(input, position, i == 0 ? 3 : 4)];
+			for (int c = 0; c < 4; ++c)
+			{
+				pixels[i * 4 + c] = (uint8_t)(((64 - weight) * values[0][c] + weight * values[1][c] + 32) >> 6);
+			}
+		}
+
+		return true;
+	}
+
+	//Whole textures -------------------------------------------------------------------------------------------------------------------
+
+	//Sources are R8G8B8A8 or B8G8R8A8/X8, UNorm or sRGB. DDSLayout only names the formats legacy headers map to.
+	const uint32_t Format_R8G8B8A8_UNorm_SRGB = 29;
+	const uint32_t Format_B8G8R8A8_UNorm_SRGB = 91;
+	const uint32_t Format_B8G8R8X8_UNorm_SRGB = 93;
+
+	bool IsBGRA(uint32_t format)
+	{
+		return format == DDSLayout::Format_B8G8R8A8_UNorm || format == DDSLayout::Format_B8G8R8X8_UNorm || format == Format_B8G8R8A8_UNorm_SRGB ||
+			format == Format_B8G8R8X8_UNorm_SRGB;
+	}
+
+	bool HasNoAlpha(uint32_t format)
+	{
+		return format == DDSLayout::Format_B8G8R8X8_UNorm || format == Format_B8G8R8X8_UNorm_SRGB;
+	}
+
+	bool IsSRGB(uint32_t format)
+	{
+		return format == Format_R8G8B8A8_UNorm_SRGB || format == Format_B8G8R8A8_UNorm_SRGB || format == Format_B8G8R8X8_UNorm_SRGB;
+	}
+
+	//One mip of one array item, and where its blocks go
+	struct Surface
+	{
+		const uint8_t* Source;
+		size_t SourcePitch;
+		uint32_t Width;
+		uint32_t Height;
+		uint32_t BlocksWide;
+		uint32_t BlocksHigh;
+		uint8_t* Output;
+	};
+
+	//Edge pixels are repeated to fill the blocks of mips smaller than 4 pixels, the GPU never samples them
+	void GatherBlock(const Surface& surface, uint32_t blockX, uint32_t blockY, bool bgra, bool noAlpha, uint8_t* pixels)
+	{
+		for (uint32_t y = 0; y < 4; ++y)
+		{
+			uint32_t sourceY = std::min(blockY * 4 + y, surface.Height - 1);
+			const uint8_t* row = surface.Source + sourceY * surface.SourcePitch;
+
+			for (uint32_t x = 0; x < 4; ++x)
+			{
+				const uint8_t* source = row + std::min(blockX * 4 + x, surface.Width - 1) * 4;
+				uint8_t* pixel = pixels + (y * 4 + x) * 4;
+
+				pixel[0] = source[bgra ? 2 : 0];
+				pixel[1] = source[1];
+				pixel[2] = source[bgra ? 0 : 2];
+				pixel[3] = noAlpha ? 255 : source[3];
+			}
+		}
+	}
+
+	void Put32(std::vector<uint8_t>& output, size_t offset, uint32_t value)
+	{
+		memcpy(&output[offset], &value, 4);
+	}
+}
+
+size_t TextureCompressor::BlockBytes(Format format)
+{
+	return format == Format_BC1 || format == Format_BC4 ? 8 : 16;
+}
+
+uint32_t TextureCompressor::DXGIFormat(Format format, bool srgb)
+{
+	switch (format)
+	{
+	case Format_BC1:
+		return srgb ? DDSLayout::Format_BC1_UNorm_SRGB : DDSLayout::Format_BC1_UNorm;
+
+	case Format_BC3:
+		return srgb ? DDSLayout::Format_BC3_UNorm_SRGB : DDSLayout::Format_BC3_UNorm;
+
+	case Format_BC4:
+		return DDSLayout::Format_BC4_UNorm;
+
+	case Format_BC5:
+		return DDSLayout::Format_BC5_UNorm;
+
+	default:
+		return srgb ? DDSLayout::Format_BC7_UNorm_SRGB : DDSLayout::Format_BC7_UNorm;
+	}
+}
+
+bool TextureCompressor::SamplesLikeSource(Format format)
+{
+	return format != Format_BC4 && format != Format_BC5;
+}
+
+bool TextureCompressor::CanCompress(const DDSLayout::TextureLayout& layout)
+{
+	bool rgba = layout.Format == DDSLayout::Format_R8G8B8A8_UNorm || layout.Format == Format_R8G8B8A8_UNorm_SRGB || IsBGRA(layout.Format);
+
+	return rgba && layout.Dimension == DDSLayout::Dimension_Texture2D && layout.Depth == 1 && layout.Width % 4 == 0 && layout.Height % 4 == 0;
+}
+
+bool TextureCompressor::IsOpaque(const void* dds, const DDSLayout::TextureLayout& layout)
+{
+	if (HasNoAlpha(layout.Format))
+	{
+		return true;
+	}
+
+	for (size_t i = 0; i < layout.Subresources.size(); ++i)
+	{
+		const DDSLayout::Subresource& surface = layout.Subresources[i];
+		const uint8_t* data = (const uint8_t*)dds + surface.Offset;
+
+		for (uint32_t y = 0; y < surface.Height; ++y)
+		{
+			const uint8_t* row = data + y * surface.RowPitch;
+			for (uint32_t x = 0; x < surface.Width; ++x)
+			{
+				if (row[x * 4 + 3] != 255)
+				{
+					return false;
+				}
+			}
+		}
+	}
+
+	return true;
+}
+
+void TextureCompressor::EncodeBlock(Format format, const uint8_t* pixels, uint8_t* block)
+{
+	BlockPixels values;
+	BlockVectors vectors;
+	LoadBlock(pixels, values, vectors);
+
+	switch (format)
+	{
+	case Format_BC1:
+		EncodeColour(values, vectors, block);
+		break;
+
+	case Format_BC3:
+		EncodeSingleChannel(values, vectors, 3, block);
+		EncodeColour(values, vectors, block + 8);
+		break;
+
+	case Format_BC4:
+		EncodeSingleChannel(values, vectors, 0, block);
+		break;
+
+	case Format_BC5:
+		EncodeSingleChannel(values, vectors, 0, block);
+		EncodeSingleChannel(values, vectors, 1, block + 8);
+		break;
+
+	case Format_BC7:
+		EncodeModeSix(values, vectors, block);
+		break;
+	}
+}
+
+bool TextureCompressor::DecodeBlock(Format format, const uint8_t* block, uint8_t* pixels)
+{
+	switch (format)
+	{
+	case Format_BC1:
+		DecodeColour(block, pixels, false);
+		return true;
+
+	case Format_BC3:
+		DecodeColour(block + 8, pixels, true);
+		DecodeSingleChannel(block, pixels, 3);
+		return true;
+
+	case Format_BC4:
+	case Format_BC5:
+		for (int i = 0; i < 16; ++i)
+		{
+			pixels[i * 4 + 1] = 0;
+			pixels[i * 4 + 2] = 0;
+			pixels[i * 4 + 3] = 255;
+		}
+
+		DecodeSingleChannel(block, pixels, 0);
+		if (format == Format_BC5)
+		{
+			DecodeSingleChannel(block + 8, pixels, 1);
+		}
+
+		return true;
+
+	default:
+		return DecodeModeSix(block, pixels);
+	}
+}
+
+TextureCompressor::CompressResult TextureCompressor::Compress(const void* dds, size_t size, Format format, unsigned int threads,
+	uint64_t sourceHash, std::vector<uint8_t>& output, CompressStats& stats)
+{
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+	DDSLayout::TextureLayout layout;
+	if (DDSLayout::Parse(dds, size, layout) != DDSLayout::Parse_Ok)
+	{
+		return Compress_Invalid;
+	}
+
+	if (!CanCompress(layout))
+	{
+		return Compress_Unsupported;
+	}
+
+	//Same shape as the source, with a DX10 header for the BC format
+	output.assign(HeaderSize, 0);
+	Put32(output, 0, DDSLayout::Magic);
+	Put32(output, 4, 124);
+	Put32(output, 8, 0x1 | 0x2 | 0x4 | 0x1000 | 0x20000 | 0x80000);		//Caps, height, width, pixel format, mip count, linear size
+	Put32(output, 12, layout.Height);
+	Put32(output, 16, layout.Width);
+	Put32(output, 28, layout.MipCount);
+	Put32(output, 32, TagMagic);
+	Put32(output, 36, (uint32_t)sourceHash);
+	Put32(output, 40, (uint32_t)(sourceHash >> 32));
+	Put32(output, 76, 32);
+	Put32(output, 80, 0x4);		//Four CC
+	Put32(output, 84, 0x30315844);		//"DX10"
+	Put32(output, 108, 0x1000 | (layout.MipCount > 1 || layout.ArraySize > 1 ? 0x8 | (layout.MipCount > 1 ? 0x400000 : 0) : 0));
+	Put32(output, 112, layout.IsCubeMap ? 0xFE00 : 0);
+	Put32(output, 128, DXGIFormat(format, IsSRGB(layout.Format)));
+	Put32(output, 132, DDSLayout::Dimension_Texture2D);
+	Put32(output, 136, layout.IsCubeMap ? 0x4 : 0);
+	Put32(output, 140, layout.IsCubeMap ? layout.ArraySize / 6 : layout.ArraySize);
+	Put32(output, 144, layout.AlphaMode);
+
+	std::vector<Surface> surfaces(layout.Subresources.size());
+	size_t outputSize = HeaderSize;
+
+	for (size_t i = 0; i < surfaces.size(); ++i)
+	{
+		const DDSLayout::Subresource& source = layout.Subresources[i];
+		Surface& surface = surfaces[i];
+		surface.SourcePitch = source.RowPitch;
+		surface.Width = source.Width;
+		surface.Height = source.Height;
+		surface.BlocksWide = (source.Width + 3) / 4;
+		surface.BlocksHigh = (source.Height + 3) / 4;
+		outputSize += surface.BlocksWide * surface.BlocksHigh * BlockBytes(format);
+	}
+
+	output.resize(outputSize);
+
+	//Pointers once the output has stopped moving. Work goes out a few block rows at a time, so small mips don't each cost a handout.
+	const uint32_t rowsPerChunk = 4;
+	std::vector<std::pair<uint32_t, uint32_t> > chunks;		//Surface, first block row
+	size_t offset = HeaderSize;
+
+	for (size_t i = 0; i < surfaces.size(); ++i)
+	{
+		Surface& surface = surfaces[i];
+		surface.Source = (const uint8_t*)dds + layout.Subresources[i].Offset;
+		surface.Output = output.data() + offset;
+		offset += surface.BlocksWide * surface.BlocksHigh * BlockBytes(format);
+
+		for (uint32_t row = 0; row < surface.BlocksHigh; row += rowsPerChunk)
+		{
+			chunks.push_back(std::make_pair((uint32_t)i, row));
+		}
+	}
+
+	bool bgra = IsBGRA(layout.Format);
+	bool noAlpha = HasNoAlpha(layout.Format);
+	size_t blockBytes = BlockBytes(format);
+
+	//Channels the PSNR is measured over: the ones the format keeps
+	unsigned int firstChannel = 0;
+	unsigned int channelCount = format == Format_BC4 ? 1 : format == Format_BC5 ? 2 : format == Format_BC1 ? 3 : 4;
+
+	std::atomic<size_t> next(0);
+	std::mutex totalsMutex;
+	uint64_t squaredError = 0;
+	uint64_t pixelCount = 0;
+
+	//Each worker encodes whole chunks, then checks them by decoding, adding up its error locally
+	std::vector<std::thread> workers;
+	unsigned int numThreads = std::max(std::min(threads, (unsigned int)chunks.size()), 1u);
+
+	for (unsigned int t = 0; t < numThreads; ++t)
+	{
+		workers.push_back(std::thread([&]()
+		{
+			uint64_t localError = 0;
+			uint64_t localPixels = 0;
+
+			for (size_t c = next++; c < chunks.size(); c = next++)
+			{
+				const Surface& surface = surfaces[chunks[c].first];
+				uint32_t lastRow = std::min(chunks[c].second + rowsPerChunk, surface.BlocksHigh);
+
+				for (uint32_t blockY = chunks[c].second; blockY < lastRow; ++blockY)
+				{
+					for (uint32_t blockX = 0; blockX < surface.BlocksWide; ++blockX)
+					{
+						uint8_t pixels[64];
+						uint8_t decoded[64];
+						uint8_t* block = surface.Output + (blockY * surface.BlocksWide + blockX) * blockBytes;
+
+						GatherBlock(surface, blockX, blockY, bgra, noAlpha, pixels);
+						EncodeBlock(format, pixels, block);
+						DecodeBlock(format, block, decoded);
+
+						//Only the pixels that are really there
+						uint32_t width = std::min(surface.Width - blockX * 4, 4u);
+						uint32_t height = std::min(surface.Height - blockY * 4, 4u);
+
+						for (uint32_t y = 0; y < height; ++y)
+						{
+							for (uint32_t x = 0; x < width; ++x)
+							{
+								for (unsigned int channel = firstChannel; channel < firstChannel + channelCount; ++channel)
+								{
+									int difference = pixels[(y * 4 + x) * 4 + channel] - decoded[(y * 4 + x) * 4 + channel];
+									localError += (uint64_t)(difference * difference);
+								}
+							}
+						}
+
+						localPixels += width * height;
+					}
+				}
+			}
+
+			std::lock_guard<std::mutex> lock(totalsMutex);
+			squaredError += localError;
+			pixelCount += localPixels;
+		}));
+	}
+
+	for (size_t t = 0; t < workers.size(); ++t)
+	{
+		workers[t].join();
+	}
+
+	//Belt and braces: what was written has to be what the loader will read
+	DDSLayout::TextureLayout written;
+	if (DDSLayout::Parse(output.data(), output.size(), written) != DDSLayout::Parse_Ok || written.DataSize != output.size() - HeaderSize)
+	{
+		output.clear();
+		return Compress_Invalid;
+	}
+
+	double meanSquaredError = pixelCount > 0 ? (double)squaredError / ((double)pixelCount * channelCount) : 0.0;
+
+	stats.Pixels = pixelCount;
+	stats.PSNR = meanSquaredError > 0.0 ? 10.0 * std::log10(255.0 * 255.0 / meanSquaredError) : 0.0;
+	stats.Seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	return Compress_Ok;
+}
+
+bool TextureCompressor::ReadSourceHash(const void* dds, size_t size, uint64_t& sourceHash)
+{
+	const uint8_t* bytes = (const uint8_t*)dds;
+	uint32_t words[3];
+
+	if (size < HeaderSize)
+	{
+		return false;
+	}
+
+	memcpy(words, bytes + 32, sizeof(words));
+	if (words[0] != TagMagic)
+	{
+		return false;
+	}
+
+	sourceHash = words[1] | ((uint64_t)words[2] << 32);
+	return true;
+}
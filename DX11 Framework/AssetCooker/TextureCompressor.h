@@ -0,0 +1,75 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+#include "DDSLayout.h"
+
+//Block compression for the cooker. Turns 8 bit RGBA or BGRA DDS textures into BC1, BC3, BC4, BC5 or BC7, keeping their mips, array
+//items and cube faces, so they take a quarter to an eighth of the memory and bandwidth on the GPU.
+//
+//Each block's endpoints start from the line through its pixels' principal axis, are refitted by least squares to the indices that gives,
+//then searched one quantisation step at a time around that for the lowest error. Every candidate is scored by fitting the whole palette,
+//four pixels per DirectXMath vector. Error is plain squared difference over the channels the format keeps, which is what PSNR measures.
+//BC7 only uses mode 6 (one RGBA endpoint pair, 16 levels): it has most of the quality of a full mode search on photographic textures at a
+//small fraction of the time.
+namespace TextureCompressor
+{
+	//Bump whenever the encoders change, so the cooker rebuilds textures compressed by an older version
+	const uint32_t Version = 1;
+
+	enum Format
+	{
+		Format_BC1,		//RGB, for opaque colour
+		Format_BC3,		//RGB plus a separately coded alpha
+		Format_BC4,		//Red only, for single channel masks
+		Format_BC5,		//Red and green, for tangent space normal maps (the shader rebuilds z)
+		Format_BC7,		//RGBA at the best quality
+	};
+
+	enum CompressResult
+	{
+		Compress_Ok,
+		Compress_Invalid,		//Not a DDS file DDSLayout accepts
+		Compress_Unsupported,	//Not an 8 bit RGBA or BGRA 2D texture, or its size isn't a multiple of 4 as Direct3D requires for BC
+	};
+
+	struct CompressStats
+	{
+		uint64_t Pixels;		//Every mip of every array item
+		double PSNR;			//The output decoded against the source, over the channels the format keeps, in dB. 0 if it's lossless.
+		double Seconds;			//Encoding and decoding for the PSNR, wall clock
+	};
+
+	//Bytes per 4x4 block
+	size_t BlockBytes(Format format);
+
+	//The DXGI_FORMAT the output is stored as. BC4 and BC5 have no sRGB variants.
+	uint32_t DXGIFormat(Format format, bool srgb);
+
+	//Whether a shader sampling the output gets what it got from the source. Not for BC4 and BC5, which read 0 for blue (and green), so a
+	//normal map needs its z rebuilt from x and y and a single channel map has to be read from red.
+	bool SamplesLikeSource(Format format);
+
+	//Whether Compress can take a texture
+	bool CanCompress(const DDSLayout::TextureLayout& layout);
+
+	//Whether every pixel of every surface has an alpha of 255, so BC1 loses nothing BC3 would keep
+	bool IsOpaque(const void* dds, const DDSLayout::TextureLayout& layout);
+
+	//pixels is a 4x4 block of RGBA, row by row. BC4 encodes red and BC5 red and green. BC1 always uses four colours, so opaque blocks only.
+	void EncodeBlock(Format format, const uint8_t* pixels, uint8_t* block);
+
+	//Back to RGBA the way the GPU samples it, with 0 for the colour channels and 255 for the alpha a format doesn't store. BC7 only decodes
+	//mode 6, the one EncodeBlock writes, and returns false for anything else.
+	bool DecodeBlock(Format format, const uint8_t* block, uint8_t* pixels);
+
+	//Compresses a whole DDS file into output, a DDS file with a DX10 header, spreading the blocks over threads. sourceHash is kept in the
+	//header for ReadSourceHash, so a cooker can tell whether the output is still up to date.
+	CompressResult Compress(const void* dds, size_t size, Format format, unsigned int threads, uint64_t sourceHash, std::vector<uint8_t>& output,
+		CompressStats& stats);
+
+	//The sourceHash a file written by Compress was made with. False for DDS files it didn't write.
+	bool ReadSourceHash(const void* dds, size_t size, uint64_t& sourceHash);
+};
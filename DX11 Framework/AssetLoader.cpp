@@ -0,0 +1,714 @@
+#include "AssetLoader.h"
+#include "OBJLoader.h"
+#include "MeshCache.h"
+#include "DDSTextureLoader.h"
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+
+namespace
+{
+	//The absolute path, which is what gets loaded, so the same file reached through different relative paths is loaded once
+	std::string FullPath(const char* filename)
+	{
+		char path[MAX_PATH];
+		DWORD length = GetFullPathNameA(filename, MAX_PATH, path, nullptr);
+
+		return length > 0 && length < MAX_PATH ? std::string(path, length) : std::string(filename);
+	}
+
+	//Windows paths aren't case sensitive, so neither are the keys
+	std::string LowerCase(std::string text)
+	{
+		for (size_t i = 0; i < text.size(); ++i)
+		{
+			text[i] = (char)tolower((unsigned char)text[i]);
+		}
+
+		return text;
+	}
+
+	//Bytes of the surfaces from topMip down, in every array item
+	size_t MipBytes(const DDSLayout::TextureLayout& layout, unsigned int topMip)
+	{
+		size_t bytes = 0;
+		for (uint32_t item = 0; item < layout.ArraySize; ++item)
+		{
+			for (uint32_t mip = topMip; mip < layout.MipCount; ++mip)
+			{
+				const DDSLayout::Subresource& surface = layout.Subresources[item * layout.MipCount + mip];
+				bytes += surface.SlicePitch * surface.Depth;
+			}
+		}
+
+		return bytes;
+	}
+
+	//Reads a byte of every page of the surfaces from topMip down, so they're in memory before the main thread copies them to the GPU. The mips
+	//of an item are next to each other in the file, so it's one run per array item.
+	void TouchMips(const uint8_t* file, const DDSLayout::TextureLayout& layout, unsigned int topMip)
+	{
+		const size_t pageSize = 4096;
+		volatile uint8_t sink = 0;
+
+		for (uint32_t item = 0; item < layout.ArraySize; ++item)
+		{
+			const DDSLayout::Subresource& top = layout.Subresources[item * layout.MipCount + topMip];
+			const DDSLayout::Subresource& last = layout.Subresources[item * layout.MipCount + layout.MipCount - 1];
+			size_t end = last.Offset + last.SlicePitch * last.Depth;
+
+			for (size_t offset = top.Offset; offset < end; offset += pageSize)
+			{
+				sink = sink + file[offset];
+			}
+
+			sink = sink + file[end - 1];
+		}
+	}
+
+	//The maxsize that makes the texture loader leave out every mip above mip, which is mip's largest dimension. 0 for the whole texture.
+	size_t MaxSizeForMip(const DDSLayout::TextureLayout& layout, unsigned int mip)
+	{
+		if (mip == 0)
+		{
+			return 0;
+		}
+
+		const DDSLayout::Subresource& surface = layout.Subresources[mip];
+		return std::max(surface.Width, std::max(surface.Height, surface.Depth));
+	}
+}
+
+AssetLoader::Request::Request()
+{
+	Handle = 0;
+	Type = AssetType_Mesh;
+	InvertTexCoords = true;
+	CompressVertices = false;
+	Stream = false;
+	State = AssetState_Loading;
+	RefCount = 1;
+	GpuBytes = 0;
+	CpuBytes = 0;
+	PackData = nullptr;
+	PackSize = 0;
+	Loaded = false;
+	StreamMip = 0;
+	ResidentMip = 0;
+	MipBias = 0;
+	BudgetMip = 0;
+	Streaming = false;
+	ZeroMemory(&UploadedMesh, sizeof(UploadedMesh));
+	Texture = nullptr;
+	NextCompleted = nullptr;
+}
+
+AssetLoader::AssetLoader(unsigned int numWorkers)
+{
+	_pending = 0;
+	_stopping = false;
+	_completed.store(nullptr);
+
+	if (numWorkers == 0)
+	{
+		unsigned int hardwareThreads = std::thread::hardware_concurrency();
+		numWorkers = hardwareThreads > 1 ? hardwareThreads - 1 : 1;
+	}
+
+	if (numWorkers > MaxWorkers)
+	{
+		numWorkers = MaxWorkers;
+	}
+
+	for (unsigned int i = 0; i < numWorkers; ++i)
+	{
+		_workers.push_back(std::thread(&AssetLoader::WorkerLoop, this));
+	}
+}
+
+AssetLoader::~AssetLoader()
+{
+	{
+		std::lock_guard<std::mutex> lock(_jobsMutex);
+		_stopping = true;
+		_jobs.clear();
+	}
+
+	_jobsAvailable.notify_all();
+
+	for (size_t i = 0; i < _workers.size(); ++i)
+	{
+		_workers[i].join();
+	}
+
+	//Every request is in _requests whether it finished or not, so the completion queue can just be forgotten
+	_completed.store(nullptr);
+
+	for (size_t i = 0; i < _requests.size(); ++i)
+	{
+		if (_requests[i])
+		{
+			MeshUpload::Release(_requests[i]->UploadedMesh);
+			if (_requests[i]->Texture) _requests[i]->Texture->Release();
+			delete _requests[i];
+		}
+	}
+}
+
+bool AssetLoader::OpenPack(const char* filename)
+{
+	if (!_requests.empty() || !_pack.Open(filename))
+	{
+		return false;
+	}
+
+	std::string path = LowerCase(FullPath(filename));
+	size_t separator = path.find_last_of("\\/");
+	_packDirectory = separator == std::string::npos ? std::string() : path.substr(0, separator + 1);
+
+	return true;
+}
+
+const AssetPackEntry* AssetLoader::FindInPack(const std::string& path, const char* suffix, uint32_t type) const
+{
+	if (!_pack.IsOpen())
+	{
+		return nullptr;
+	}
+
+	std::string lowerPath = LowerCase(path);
+	if (lowerPath.compare(0, _packDirectory.size(), _packDirectory) != 0)
+	{
+		return nullptr;
+	}
+
+	const AssetPackEntry* entry = _pack.Find(lowerPath.substr(_packDirectory.size()) + suffix);
+	return entry && entry->Type == type ? entry : nullptr;
+}
+
+AssetHandle AssetLoader::LoadMesh(const char* filename, bool invertTexCoords, bool compressVertices)
+{
+	std::string path = FullPath(filename);
+	std::string key = LowerCase(std::string(invertTexCoords ? "mesh,invert," : "mesh,") + (compressVertices ? "compressed," : "") + path);
+
+	AssetHandle handle = FindLoaded(key);
+	if (handle)
+	{
+		return handle;
+	}
+
+	Request* request = new Request();
+	request->Type = AssetType_Mesh;
+	request->Filename = path;
+	request->Key = key;
+	request->InvertTexCoords = invertTexCoords;
+	request->CompressVertices = compressVertices;
+
+	//The pack can't tell whether its cook matches the source any more, but it can tell whether it was cooked with the same options
+	const AssetPackEntry* entry = FindInPack(path, MeshCache::CacheSuffix(invertTexCoords, compressVertices),
+		compressVertices ? AssetPack::Entry_CompressedMesh : AssetPack::Entry_Mesh);
+
+	if (entry && ((entry->Flags & AssetPack::Flag_InvertTexCoords) != 0) == invertTexCoords)
+	{
+		request->PackData = _pack.GetData(*entry);
+		request->PackSize = (size_t)entry->Size;
+	}
+
+	return Queue(request);
+}
+
+AssetHandle AssetLoader::LoadTexture(const char* filename, bool stream)
+{
+	std::string path = FullPath(filename);
+	std::string key = LowerCase(std::string(stream ? "texture,stream," : "texture,") + path);
+
+	AssetHandle handle = FindLoaded(key);
+	if (handle)
+	{
+		return handle;
+	}
+
+	Request* request = new Request();
+	request->Type = AssetType_Texture;
+	request->Filename = path;
+	request->Key = key;
+	request->Stream = stream;
+
+	const AssetPackEntry* entry = FindInPack(path, "", AssetPack::Entry_Texture);
+	if (entry)
+	{
+		request->PackData = _pack.GetData(*entry);
+		request->PackSize = (size_t)entry->Size;
+	}
+
+	return Queue(request);
+}
+
+AssetHandle AssetLoader::FindLoaded(const std::string& key)
+{
+	std::unordered_map<std::string, AssetHandle>::const_iterator found = _handles.find(key);
+	if (found == _handles.end())
+	{
+		return 0;
+	}
+
+	//Loaded or still loading, either way it's shared rather than read again
+	_requests[found->second - 1]->RefCount++;
+	return found->second;
+}
+
+AssetHandle AssetLoader::Queue(Request* request)
+{
+	_requests.push_back(request);
+	request->Handle = (AssetHandle)_requests.size();
+	_handles[request->Key] = request->Handle;
+	_pending++;
+
+	PushJob(request);
+
+	return request->Handle;
+}
+
+void AssetLoader::PushJob(Request* request)
+{
+	{
+		std::lock_guard<std::mutex> lock(_jobsMutex);
+		_jobs.push_back(request);
+	}
+
+	_jobsAvailable.notify_one();
+}
+
+void AssetLoader::WorkerLoop()
+{
+	for (;;)
+	{
+		Request* request;
+
+		{
+			std::unique_lock<std::mutex> lock(_jobsMutex);
+			while (!_stopping && _jobs.empty())
+			{
+				_jobsAvailable.wait(lock);
+			}
+
+			if (_stopping)
+			{
+				return;
+			}
+
+			request = _jobs.front();
+			_jobs.pop_front();
+		}
+
+		Load(*request);
+
+		//Publish the finished request. The release pairs with the acquire in ProcessCompleted, so everything Load wrote is visible there.
+		Request* head = _completed.load(std::memory_order_relaxed);
+		do
+		{
+			request->NextCompleted = head;
+		}
+		while (!_completed.compare_exchange_weak(head, request, std::memory_order_release, std::memory_order_relaxed));
+	}
+}
+
+void AssetLoader::Load(Request& request)
+{
+	if (request.Type == AssetType_Mesh)
+	{
+		//A bad cook in the pack isn't fatal, the loose files may still be there
+		request.Loaded = request.PackData && OBJLoader::LoadCooked(request.PackData, request.PackSize, request.Mesh, request.CompressVertices);
+
+		if (!request.Loaded)
+		{
+			request.Loaded = OBJLoader::Load(request.Filename.c_str(), request.Mesh, request.InvertTexCoords, request.CompressVertices);
+		}
+
+		return;
+	}
+
+	if (request.Stream)
+	{
+		//Loaded already, this is the next mip up, or down to the mip bias
+		if (request.Loaded)
+		{
+			const uint8_t* data = request.PackData ? (const uint8_t*)request.PackData : (const uint8_t*)request.TextureFile.GetData();
+			TouchMips(data, request.Layout, request.StreamMip);
+			return;
+		}
+
+		//Mapped rather than read, only the tail is wanted for now
+		if (!request.PackData && !request.TextureFile.Open(request.Filename.c_str()))
+		{
+			return;
+		}
+
+		const uint8_t* data = request.PackData ? (const uint8_t*)request.PackData : (const uint8_t*)request.TextureFile.GetData();
+		size_t size = request.PackData ? request.PackSize : request.TextureFile.GetSize();
+
+		if (DDSLayout::Parse(data, size, request.Layout) != DDSLayout::Parse_Ok)
+		{
+			request.TextureFile.Close();
+			return;
+		}
+
+		request.StreamMip = std::min(DDSLayout::MipsOverSize(request.Layout, StreamTailSize), request.Layout.MipCount - 1);
+		TouchMips(data, request.Layout, request.StreamMip);
+		request.Loaded = true;
+		return;
+	}
+
+	//Already in memory, CreateDDSTextureFromMemory reads it straight out of the pack. The texture loader rejects what Parse does.
+	if (request.PackData)
+	{
+		request.Loaded = DDSLayout::Parse(request.PackData, request.PackSize, request.Layout) == DDSLayout::Parse_Ok;
+		request.GpuBytes = request.Loaded ? request.Layout.DataSize : 0;
+		return;
+	}
+
+	//Mapped and paged in here, so the main thread doesn't wait on the disk when it creates the texture from the mapping
+	if (!request.TextureFile.Open(request.Filename.c_str()))
+	{
+		return;
+	}
+
+	const uint8_t* data = (const uint8_t*)request.TextureFile.GetData();
+	if (DDSLayout::Parse(data, request.TextureFile.GetSize(), request.Layout) != DDSLayout::Parse_Ok)
+	{
+		request.TextureFile.Close();
+		return;
+	}
+
+	TouchMips(data, request.Layout, 0);
+	request.Loaded = true;
+	request.GpuBytes = request.Layout.DataSize;
+}
+
+unsigned int AssetLoader::ProcessCompleted(ID3D11Device* device)
+{
+	D3D11MeshUploadDevice meshDevice(device);
+	return ProcessCompleted(meshDevice, device);
+}
+
+unsigned int AssetLoader::ProcessCompleted(MeshUploadDevice& meshDevice, ID3D11Device* textureDevice)
+{
+	Request* completed = _completed.exchange(nullptr, std::memory_order_acquire);
+
+	//The stack hands them back newest first, upload in the order they finished
+	Request* ordered = nullptr;
+	while (completed)
+	{
+		Request* next = completed->NextCompleted;
+		completed->NextCompleted = ordered;
+		ordered = completed;
+		completed = next;
+	}
+
+	unsigned int processed = 0;
+
+	while (ordered)
+	{
+		Request* request = ordered;
+		ordered = request->NextCompleted;
+
+		//A streamed texture that was already ready, not a load
+		bool streamed = request->Streaming;
+		request->Streaming = false;
+
+		//Nobody wants it any more, don't bother creating its GPU resources
+		if (request->RefCount == 0)
+		{
+			Free(request);
+		}
+		else if (streamed)
+		{
+			StreamIn(*request, textureDevice);
+		}
+		else
+		{
+			Upload(*request, meshDevice, textureDevice);
+		}
+
+		if (!streamed)
+		{
+			_pending--;
+			processed++;
+		}
+	}
+
+	_residency.Update(*this);
+
+	return processed;
+}
+
+void AssetLoader::Upload(Request& request, MeshUploadDevice& meshDevice, ID3D11Device* textureDevice)
+{
+	request.State = AssetState_Failed;
+
+	if (request.Loaded && request.Type == AssetType_Mesh)
+	{
+		request.UploadedMesh = MeshUpload::Upload(meshDevice, request.Mesh);
+		if (request.UploadedMesh.IndexBuffer)
+		{
+			request.State = AssetState_Ready;
+			request.GpuBytes = (size_t)request.Mesh.VertexStride * request.Mesh.VertexCount + (size_t)request.Mesh.IndexSize * request.Mesh.IndexCount;
+			request.CpuBytes = request.UploadedMesh.ClusterCount * sizeof(MeshCluster);
+		}
+	}
+	else if (request.Loaded && request.Stream)
+	{
+		//The bias may have been set while it was loading, the worker read at least the mips that leaves
+		request.StreamMip = std::max(request.StreamMip, std::min(request.MipBias, request.Layout.MipCount - 1));
+		request.ResidentMip = request.Layout.MipCount;
+		StreamIn(request, textureDevice);
+
+		if (request.Texture)
+		{
+			request.State = AssetState_Ready;
+		}
+	}
+	else if (request.Loaded && request.Type == AssetType_Texture)
+	{
+		const uint8_t* data = request.PackData ? (const uint8_t*)request.PackData : (const uint8_t*)request.TextureFile.GetData();
+		size_t size = request.PackData ? request.PackSize : request.TextureFile.GetSize();
+
+		if (SUCCEEDED(CreateDDSTextureFromMemory(textureDevice, data, size, nullptr, &request.Texture)))
+		{
+			request.State = AssetState_Ready;
+		}
+	}
+
+	if (request.State == AssetState_Ready && request.Type == AssetType_Texture)
+	{
+		const DDSLayout::TextureLayout& layout = request.Layout;
+		_residency.Track(request.Handle, layout.Format, layout.Width, layout.Height, layout.Depth, layout.MipCount, layout.ArraySize,
+			request.Stream);
+		_residency.SetMipBias(request.Handle, request.MipBias);
+	}
+
+	if (request.State != AssetState_Ready)
+	{
+		request.GpuBytes = 0;
+		request.ResidentMip = 0;
+		request.TextureFile.Close();
+	}
+
+	//The GPU has its own copy now. Streamed textures still need theirs for the mips to come.
+	request.Mesh.Clear();
+	if (!request.Stream)
+	{
+		request.TextureFile.Close();
+	}
+}
+
+//Replaces a streamed texture with one that starts at StreamMip, which the worker has just read in, then carries on towards the mip bias.
+//Each texture is created from the file again rather than copying the mips it shares with the last one on the GPU: the smaller mips are a third
+//of the size of the new one, and it needs neither a device context nor a texture the shader can't be reading.
+void AssetLoader::StreamIn(Request& request, ID3D11Device* textureDevice)
+{
+	const uint8_t* data = request.PackData ? (const uint8_t*)request.PackData : (const uint8_t*)request.TextureFile.GetData();
+	size_t size = request.PackData ? request.PackSize : request.TextureFile.GetSize();
+
+	ID3D11ShaderResourceView* texture = nullptr;
+	HRESULT hr = CreateDDSTextureFromMemoryEx(textureDevice, data, size, MaxSizeForMip(request.Layout, request.StreamMip), D3D11_USAGE_DEFAULT,
+		D3D11_BIND_SHADER_RESOURCE, 0, 0, false, nullptr, &texture);
+
+	if (FAILED(hr))
+	{
+		//Keep what's there and stop until the bias is set again, rather than trying again every frame
+		request.MipBias = request.ResidentMip;
+		_residency.SetMipBias(request.Handle, request.MipBias);
+		return;
+	}
+
+	if (request.Texture) request.Texture->Release();
+	request.Texture = texture;
+	request.ResidentMip = request.StreamMip;
+	request.GpuBytes = MipBytes(request.Layout, request.ResidentMip);
+
+	ContinueStream(request);
+}
+
+//Queues the next mip up, or the drop to the mip bias, unless it's already there or a worker has the texture
+void AssetLoader::ContinueStream(Request& request)
+{
+	unsigned int target = std::min(std::max(request.MipBias, request.BudgetMip), request.Layout.MipCount - 1);
+	if (request.Streaming || target == request.ResidentMip)
+	{
+		return;
+	}
+
+	//One mip at a time on the way up, so each frame has the best that's been read so far. Straight there on the way down.
+	request.StreamMip = target > request.ResidentMip ? target : request.ResidentMip - 1;
+	request.Streaming = true;
+	PushJob(&request);
+}
+
+void AssetLoader::SetTextureMipBias(AssetHandle handle, unsigned int bias)
+{
+	Request* request = Find(handle);
+	if (!request || !request->Stream || request->RefCount == 0)
+	{
+		return;
+	}
+
+	request->MipBias = bias;
+	_residency.SetMipBias(handle, bias);
+
+	//Still loading, Upload starts at the bias
+	if (request->State == AssetState_Ready)
+	{
+		ContinueStream(*request);
+	}
+}
+
+void AssetLoader::SetTextureBudget(size_t bytes)
+{
+	_residency.SetBudget(bytes);
+}
+
+void AssetLoader::MarkTextureBound(AssetHandle handle)
+{
+	_residency.MarkBound(handle);
+}
+
+//Only streamed textures are tracked as ones that can be downgraded, and they're only tracked once they're ready
+void AssetLoader::SetTopMip(uint32_t texture, unsigned int topMip)
+{
+	Request* request = Find(texture);
+	if (request)
+	{
+		request->BudgetMip = topMip;
+		ContinueStream(*request);
+	}
+}
+
+void AssetLoader::Flush(ID3D11Device* device)
+{
+	ProcessCompleted(device);
+
+	while (_pending > 0)
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		ProcessCompleted(device);
+	}
+}
+
+void AssetLoader::AddRef(AssetHandle handle)
+{
+	Request* request = Find(handle);
+	if (request)
+	{
+		request->RefCount++;
+	}
+}
+
+void AssetLoader::Release(AssetHandle handle)
+{
+	Request* request = Find(handle);
+	if (!request || request->RefCount == 0)
+	{
+		return;
+	}
+
+	//Still on a worker or in the completion queue, ProcessCompleted frees it when it comes back
+	if (--request->RefCount == 0 && request->State != AssetState_Loading && !request->Streaming)
+	{
+		Free(request);
+	}
+}
+
+void AssetLoader::Free(Request* request)
+{
+	MeshUpload::Release(request->UploadedMesh);
+	if (request->Texture) request->Texture->Release();
+
+	_residency.Untrack(request->Handle);
+	_handles.erase(request->Key);
+	_requests[request->Handle - 1] = nullptr;
+	delete request;
+}
+
+AssetLoader::Request* AssetLoader::Find(AssetHandle handle) const
+{
+	return handle > 0 && handle <= _requests.size() ? _requests[handle - 1] : nullptr;
+}
+
+AssetState AssetLoader::GetState(AssetHandle handle) const
+{
+	const Request* request = Find(handle);
+	return request ? request->State : AssetState_Failed;
+}
+
+const MeshData* AssetLoader::GetMesh(AssetHandle handle) const
+{
+	const Request* request = Find(handle);
+	return request && request->Type == AssetType_Mesh && request->State == AssetState_Ready ? &request->UploadedMesh : nullptr;
+}
+
+ID3D11ShaderResourceView* AssetLoader::GetTexture(AssetHandle handle) const
+{
+	const Request* request = Find(handle);
+	return request && request->Type == AssetType_Texture && request->State == AssetState_Ready ? request->Texture : nullptr;
+}
+
+void AssetLoader::GetMemoryReport(std::vector<AssetMemory>& report) const
+{
+	report.clear();
+
+	for (size_t i = 0; i < _requests.size(); ++i)
+	{
+		const Request* request = _requests[i];
+		if (!request)
+		{
+			continue;
+		}
+
+		AssetMemory entry;
+		entry.Handle = request->Handle;
+		entry.Type = request->Type;
+		entry.Filename = request->Filename;
+		entry.State = request->State;
+		entry.RefCount = request->RefCount;
+		entry.GpuBytes = request->GpuBytes;
+		entry.CpuBytes = request->CpuBytes;
+		entry.ResidentMip = request->ResidentMip;
+		report.push_back(entry);
+	}
+}
+
+void AssetLoader::LogMemoryReport() const
+{
+	static const char* const typeNames[] = { "mesh", "texture" };
+	static const char* const stateNames[] = { "loading", "ready", "failed" };
+
+	std::vector<AssetMemory> report;
+	GetMemoryReport(report);
+
+	char line[512];
+	size_t gpuTotal = 0;
+	size_t cpuTotal = 0;
+
+	for (size_t i = 0; i < report.size(); ++i)
+	{
+		const AssetMemory& entry = report[i];
+		sprintf_s(line, "  %-8s %-8s refs %-3u mip %-2u %10.1f KB GPU %8.1f KB CPU  %s\n", typeNames[entry.Type], stateNames[entry.State], entry.RefCount,
+			entry.ResidentMip, entry.GpuBytes / 1024.0, entry.CpuBytes / 1024.0, entry.Filename.c_str());
+		OutputDebugStringA(line);
+
+		gpuTotal += entry.GpuBytes;
+		cpuTotal += entry.CpuBytes;
+	}
+
+	sprintf_s(line, "Assets: %u, %.1f KB GPU, %.1f KB CPU\n", (unsigned int)report.size(), gpuTotal / 1024.0, cpuTotal / 1024.0);
+	OutputDebugStringA(line);
+
+	if (_residency.GetBudget() > 0)
+	{
+		sprintf_s(line, "Textures: %.1f KB of a %.1f KB budget\n", _residency.GetUsedBytes() / 1024.0, _residency.GetBudget() / 1024.0);
+		OutputDebugStringA(line);
+	}
+}
@@ -0,0 +1,213 @@
+#pragma once
+
+#include <windows.h>
+#include <d3d11_1.h>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "Structures.h"
+#include "MeshUpload.h"
+#include "AssetPack.h"
+#include "DDSLayout.h"
+#include "MappedFile.h"
+#include "TextureResidency.h"
+
+//Identifies an asset loaded through an AssetLoader. 0 is never handed out, and a handle isn't reused once its asset has been freed.
+typedef uint32_t AssetHandle;
+
+enum AssetType
+{
+	AssetType_Mesh,
+	AssetType_Texture,
+};
+
+enum AssetState
+{
+	AssetState_Loading,		//Queued, being read on a worker, or read and waiting for ProcessCompleted to upload it
+	AssetState_Ready,
+	AssetState_Failed,		//The file couldn't be read or the GPU resources couldn't be created, or the handle has been released
+};
+
+//One line of AssetLoader::GetMemoryReport
+struct AssetMemory
+{
+	AssetHandle Handle;
+	AssetType Type;
+	std::string Filename;		//Full path
+	AssetState State;
+	unsigned int RefCount;
+	size_t GpuBytes;			//Vertex and index buffers, or the texels as stored in the DDS file. Driver padding isn't counted.
+	size_t CpuBytes;			//Kept on the CPU after the upload, the mesh clusters
+	unsigned int ResidentMip;	//The largest mip on the GPU, 0 unless a streamed texture is still coming in or has a mip bias
+};
+
+//Loads meshes and DDS textures in the background. LoadMesh/LoadTexture hand back a handle straight away and a worker thread does the file I/O
+//and parsing (OBJ parse and cook, or the cache mapping). Finished loads come back to the main thread through a lock-free queue, and
+//ProcessCompleted creates their GPU resources, since that needs the device.
+//It's also the cache every asset is shared through. Loads are keyed by full path and load options, so loading a file that's already loaded or
+//still loading hands back the same handle with one more reference, and its GPU resources are freed when the last reference is released.
+//Assets found in an AssetPack opened with OpenPack are read straight out of its mapping, everything else comes from loose files.
+//Streamed textures are Ready as soon as their smallest mips are on the GPU, and a larger texture replaces the last one each time a worker has
+//read the next mip up, until they're full size or down to their mip bias.
+//With a texture budget set, a TextureResidency counts every texture and takes mips from the streamed ones that were bound least recently
+//when they don't fit.
+//Everything but the workers runs on the main thread: the handles, the load calls and ProcessCompleted aren't safe to call from elsewhere.
+class AssetLoader : private TextureMipAllocator
+{
+public:
+	//numWorkers = 0 leaves one hardware thread for the main thread, up to MaxWorkers
+	AssetLoader(unsigned int numWorkers = 0);
+
+	//Stops the workers, dropping anything not yet loaded, and releases every mesh and texture the loader created, referenced or not
+	~AssetLoader();
+
+	static const unsigned int MaxWorkers = 4;
+
+	//A streamed texture starts out with the mips that are this size or smaller in every dimension, or just its smallest mip if none are
+	static const unsigned int StreamTailSize = 64;
+
+	//Maps a pack built by the AssetCooker. Call before loading anything: the workers read from the pack without a lock, so it can't change under
+	//them. Loads of files in the pack's directory or below are looked up in it by their path relative to the pack, and cooked meshes and DDS
+	//files found there go to the GPU straight from the mapping. Returns false, and loads keep using loose files, if the pack can't be opened.
+	bool OpenPack(const char* filename);
+
+	//Each call holds a reference to the asset until it's passed to Release
+	AssetHandle LoadMesh(const char* filename, bool invertTexCoords = true, bool compressVertices = false);
+	//stream makes the texture drawable once the tail of the file is read, see StreamTailSize, and brings the larger mips in over the next frames
+	AssetHandle LoadTexture(const char* filename, bool stream = false);
+
+	//For a second owner of a handle that's already loaded
+	void AddRef(AssetHandle handle);
+
+	//Drops a reference. The last one frees the mesh or texture, straight away if it has finished loading, otherwise once it has.
+	void Release(AssetHandle handle);
+
+	//Uploads everything that has finished loading since the last call. Call once a frame. Returns how many loads became ready or failed.
+	unsigned int ProcessCompleted(ID3D11Device* device);
+
+	//Same as ProcessCompleted, but uploads meshes through the given device, for tools and benchmarks without a GPU
+	unsigned int ProcessCompleted(MeshUploadDevice& meshDevice, ID3D11Device* textureDevice);
+
+	//Blocks until every load queued so far is ready or has failed. Streamed textures are ready once their tail is up, the rest isn't waited for.
+	void Flush(ID3D11Device* device);
+
+	AssetState GetState(AssetHandle handle) const;
+
+	//Null until the load is ready. Owned by the loader, valid until it's destroyed.
+	const MeshData* GetMesh(AssetHandle handle) const;
+	//A streamed texture's view changes as its mips come in or are dropped, so look it up each frame rather than keeping it
+	ID3D11ShaderResourceView* GetTexture(AssetHandle handle) const;
+
+	//How many of a streamed texture's largest mips to leave off the GPU, for when memory is tight. Raising it swaps in a smaller texture and
+	//lowering it streams the mips back in, both through a worker and the next ProcessCompleted calls. The smallest mip always stays.
+	//Textures that weren't loaded with stream ignore it.
+	void SetTextureMipBias(AssetHandle handle, unsigned int bias);
+
+	//GPU bytes all the textures are kept within, as far as dropping the largest mips of streamed textures can, 0 for no limit.
+	//ProcessCompleted applies it.
+	void SetTextureBudget(size_t bytes);
+
+	//Call when binding a texture for drawing, the budget takes mips from the textures that haven't been bound for longest first
+	void MarkTextureBound(AssetHandle handle);
+
+	//Loads not yet ready or failed
+	unsigned int GetPendingCount() const { return _pending; };
+
+	//One entry per asset still held, in the order they were first loaded
+	void GetMemoryReport(std::vector<AssetMemory>& report) const;
+
+	//Writes the memory report and its totals to the debugger output
+	void LogMemoryReport() const;
+
+private:
+	struct Request
+	{
+		Request();
+
+		AssetHandle Handle;
+		AssetType Type;
+		std::string Filename;		//Full path
+		std::string Key;			//Type, options and full path, lower case
+		bool InvertTexCoords;
+		bool CompressVertices;
+		bool Stream;
+		AssetState State;
+		unsigned int RefCount;
+		size_t GpuBytes;
+		size_t CpuBytes;
+
+		//Set if the asset is in the pack, it's read from there and not from Filename
+		const void* PackData;
+		size_t PackSize;
+
+		//Filled in by the worker
+		bool Loaded;
+		MeshAsset Mesh;
+		MappedFile TextureFile;					//Textures not in the pack. Unmapped after the upload, but kept by streamed ones for the mips still to come.
+		DDSLayout::TextureLayout Layout;		//Every texture, parsed by the worker
+
+		//Streaming state, main thread only but for StreamMip, which is set before the request is queued and read by the worker
+		unsigned int StreamMip;		//The largest mip the texture is being recreated with, the smallest the worker has to read
+		unsigned int ResidentMip;	//The largest mip on the GPU
+		unsigned int MipBias;
+		unsigned int BudgetMip;		//The largest mip the texture budget leaves it
+		bool Streaming;				//On a worker or in the completion queue for StreamMip
+
+		//Filled in by ProcessCompleted
+		MeshData UploadedMesh;
+		ID3D11ShaderResourceView* Texture;
+
+		Request* NextCompleted;		//Link in the completion queue
+
+	private:
+		Request(const Request&);
+		Request& operator=(const Request&);
+	};
+
+	AssetHandle Queue(Request* request);
+	void WorkerLoop();
+	static void Load(Request& request);
+	void Upload(Request& request, MeshUploadDevice& meshDevice, ID3D11Device* textureDevice);
+	void StreamIn(Request& request, ID3D11Device* textureDevice);
+	void ContinueStream(Request& request);
+	void PushJob(Request* request);
+	void Free(Request* request);
+	AssetHandle FindLoaded(const std::string& key);
+	Request* Find(AssetHandle handle) const;
+	const AssetPackEntry* FindInPack(const std::string& path, const char* suffix, uint32_t type) const;
+
+	//TextureMipAllocator, for _residency
+	void SetTopMip(uint32_t texture, unsigned int topMip);
+
+	//Not copyable, the workers hold a pointer to the loader
+	AssetLoader(const AssetLoader&);
+	AssetLoader& operator=(const AssetLoader&);
+
+	std::vector<Request*> _requests;	//Indexed by handle - 1, null once freed. Main thread only.
+	std::unordered_map<std::string, AssetHandle> _handles;	//By Request::Key, for every request not yet freed. Main thread only.
+	unsigned int _pending;
+	TextureResidency _residency;	//Every texture that's ready, by handle
+
+	//Read only once loads have been queued, so the workers share it without a lock
+	AssetPackFile _pack;
+	std::string _packDirectory;		//Full path with a trailing separator, lower case
+
+	//Work for the workers, guarded by _jobsMutex
+	std::mutex _jobsMutex;
+	std::condition_variable _jobsAvailable;
+	std::deque<Request*> _jobs;
+	bool _stopping;
+
+	//Finished loads, pushed by any worker and taken all at once by the main thread. A Treiber stack: taking the whole list with one exchange
+	//rather than popping nodes one by one means there's no ABA problem to worry about.
+	std::atomic<Request*> _completed;
+
+	std::vector<std::thread> _workers;
+};
@@ -0,0 +1,297 @@
+#include "AssetPack.h"
+#include "MeshCache.h"
+#include <cctype>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+namespace
+{
+	inline uint64_t AlignUp(uint64_t value, uint64_t alignment)
+	{
+		return (value + alignment - 1) & ~(alignment - 1);
+	}
+
+	//Smallest power of two at least twice count, so probes stay short
+	uint32_t HashSlotsFor(size_t count)
+	{
+		uint32_t slots = 1;
+		while (slots < count * 2)
+		{
+			slots <<= 1;
+		}
+
+		return slots;
+	}
+
+	bool WritePadding(std::ofstream& out, uint64_t& written, uint64_t offset)
+	{
+		const char padding[AssetPack::Alignment] = {};
+
+		out.write(padding, offset - written);
+		written = offset;
+
+		return out.good();
+	}
+}
+
+std::string AssetPack::NormaliseName(const std::string& name)
+{
+	std::string normalised = name;
+
+	for (size_t i = 0; i < normalised.size(); ++i)
+	{
+		normalised[i] = normalised[i] == '\\' ? '/' : (char)tolower((unsigned char)normalised[i]);
+	}
+
+	return normalised;
+}
+
+uint64_t AssetPack::HashName(const char* name, size_t length)
+{
+	return MeshCache::HashBytes(name, length, Magic);
+}
+
+bool WriteAssetPack(const char* filename, const std::vector<AssetPackSource>& sources)
+{
+	size_t count = sources.size();
+
+	//Names and sizes first, everything's offset depends on them
+	std::vector<std::string> names(count);
+	std::vector<AssetPackEntry> entries(count);
+	std::string nameBlock;
+
+	for (size_t i = 0; i < count; ++i)
+	{
+		MappedFile file;
+		if (!file.Open(sources[i].Filename.c_str()))
+		{
+			return false;
+		}
+
+		names[i] = AssetPack::NormaliseName(sources[i].Name);
+
+		AssetPackEntry& entry = entries[i];
+		entry.NameHash = AssetPack::HashName(names[i].c_str(), names[i].size());
+		entry.NameOffset = (uint32_t)nameBlock.size();
+		entry.NameLength = (uint32_t)names[i].size();
+		entry.Type = sources[i].Type;
+		entry.Flags = sources[i].Flags;
+		entry.Offset = 0;
+		entry.Size = file.GetSize();
+
+		nameBlock += names[i];
+	}
+
+	//Build the hash table, turning away duplicate names rather than letting one shadow the other
+	uint32_t slotCount = HashSlotsFor(count);
+	std::vector<uint32_t> slots(slotCount, 0);
+
+	for (size_t i = 0; i < count; ++i)
+	{
+		uint32_t slot = (uint32_t)entries[i].NameHash & (slotCount - 1);
+
+		while (slots[slot] != 0)
+		{
+			if (names[slots[slot] - 1] == names[i])
+			{
+				return false;
+			}
+
+			slot = (slot + 1) & (slotCount - 1);
+		}
+
+		slots[slot] = (uint32_t)i + 1;
+	}
+
+	AssetPackHeader header;
+	memset(&header, 0, sizeof(header));
+	header.Magic = AssetPack::Magic;
+	header.Version = AssetPack::Version;
+	header.HeaderSize = sizeof(AssetPackHeader);
+	header.EntryCount = (uint32_t)count;
+	header.HashSlotCount = slotCount;
+	header.EntriesOffset = AlignUp(sizeof(AssetPackHeader), AssetPack::Alignment);
+	header.HashOffset = AlignUp(header.EntriesOffset + sizeof(AssetPackEntry) * count, AssetPack::Alignment);
+	header.NamesOffset = AlignUp(header.HashOffset + sizeof(uint32_t) * slotCount, AssetPack::Alignment);
+
+	uint64_t offset = header.NamesOffset + nameBlock.size();
+
+	for (size_t i = 0; i < count; ++i)
+	{
+		offset = AlignUp(offset, AssetPack::Alignment);
+		entries[i].Offset = offset;
+		offset += entries[i].Size;
+	}
+
+	header.FileSize = offset;
+
+	std::string tempFilename = filename;
+	tempFilename.append(".tmp");
+
+	std::ofstream outbin(tempFilename.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+
+	if (!outbin.good())
+	{
+		return false;
+	}
+
+	uint64_t written = 0;
+
+	outbin.write((const char*)&header, sizeof(header));
+	written += sizeof(header);
+
+	WritePadding(outbin, written, header.EntriesOffset);
+	if (count > 0)
+	{
+		outbin.write((const char*)entries.data(), sizeof(AssetPackEntry) * count);
+		written += sizeof(AssetPackEntry) * count;
+	}
+
+	WritePadding(outbin, written, header.HashOffset);
+	outbin.write((const char*)slots.data(), sizeof(uint32_t) * slotCount);
+	written += sizeof(uint32_t) * slotCount;
+
+	WritePadding(outbin, written, header.NamesOffset);
+	outbin.write(nameBlock.data(), nameBlock.size());
+	written += nameBlock.size();
+
+	bool good = outbin.good();
+
+	for (size_t i = 0; good && i < count; ++i)
+	{
+		//The file could have changed since its size was taken, in which case the pack would be wrong
+		MappedFile file;
+		good = file.Open(sources[i].Filename.c_str()) && file.GetSize() == entries[i].Size && WritePadding(outbin, written, entries[i].Offset);
+
+		if (good)
+		{
+			outbin.write(file.GetData(), file.GetSize());
+			written += file.GetSize();
+		}
+	}
+
+	outbin.close();
+
+	if (!good || outbin.fail())
+	{
+		remove(tempFilename.c_str());
+		return false;
+	}
+
+	//rename won't replace an existing file on Windows
+	remove(filename);
+	return rename(tempFilename.c_str(), filename) == 0;
+}
+
+AssetPackFile::AssetPackFile()
+{
+	_header = nullptr;
+	_entries = nullptr;
+	_slots = nullptr;
+	_names = nullptr;
+}
+
+void AssetPackFile::Close()
+{
+	_file.Close();
+	_header = nullptr;
+	_entries = nullptr;
+	_slots = nullptr;
+	_names = nullptr;
+}
+
+bool AssetPackFile::Open(const char* filename)
+{
+	Close();
+
+	if (!_file.Open(filename) || _file.GetSize() < sizeof(AssetPackHeader))
+	{
+		Close();
+		return false;
+	}
+
+	const AssetPackHeader* header = (const AssetPackHeader*)_file.GetData();
+	uint64_t fileSize = _file.GetSize();
+
+	bool valid = header->Magic == AssetPack::Magic
+		&& header->Version == AssetPack::Version
+		&& header->HeaderSize == sizeof(AssetPackHeader)
+		&& header->FileSize == fileSize
+		&& header->HashSlotCount != 0 && (header->HashSlotCount & (header->HashSlotCount - 1)) == 0
+		&& header->HashSlotCount >= (uint64_t)header->EntryCount * 2
+		&& header->EntriesOffset % AssetPack::Alignment == 0 && header->HashOffset % AssetPack::Alignment == 0
+		&& header->EntriesOffset <= fileSize && sizeof(AssetPackEntry) * (uint64_t)header->EntryCount <= fileSize - header->EntriesOffset
+		&& header->HashOffset <= fileSize && sizeof(uint32_t) * (uint64_t)header->HashSlotCount <= fileSize - header->HashOffset
+		&& header->NamesOffset <= fileSize;
+
+	if (!valid)
+	{
+		Close();
+		return false;
+	}
+
+	const AssetPackEntry* entries = (const AssetPackEntry*)(_file.GetData() + header->EntriesOffset);
+	const uint32_t* slots = (const uint32_t*)(_file.GetData() + header->HashOffset);
+	uint64_t namesSize = fileSize - header->NamesOffset;
+
+	for (uint32_t i = 0; i < header->EntryCount; ++i)
+	{
+		const AssetPackEntry& entry = entries[i];
+
+		if (entry.Offset % AssetPack::Alignment != 0 || entry.Offset > fileSize || entry.Size > fileSize - entry.Offset ||
+			entry.NameOffset > namesSize || entry.NameLength > namesSize - entry.NameOffset)
+		{
+			Close();
+			return false;
+		}
+	}
+
+	for (uint32_t i = 0; i < header->HashSlotCount; ++i)
+	{
+		if (slots[i] > header->EntryCount)
+		{
+			Close();
+			return false;
+		}
+	}
+
+	_header = header;
+	_entries = entries;
+	_slots = slots;
+	_names = _file.GetData() + header->NamesOffset;
+
+	return true;
+}
+
+const AssetPackEntry* AssetPackFile::Find(const std::string& name) const
+{
+	if (!_header)
+	{
+		return nullptr;
+	}
+
+	std::string normalised = AssetPack::NormaliseName(name);
+	uint64_t hash = AssetPack::HashName(normalised.c_str(), normalised.size());
+	uint32_t mask = _header->HashSlotCount - 1;
+
+	//A pack we wrote has at least half its slots empty, the probe limit is for one that's been tampered with
+	uint32_t slot = (uint32_t)hash & mask;
+
+	for (uint32_t probe = 0; probe < _header->HashSlotCount && _slots[slot] != 0; ++probe, slot = (slot + 1) & mask)
+	{
+		const AssetPackEntry& entry = _entries[_slots[slot] - 1];
+
+		if (entry.NameHash == hash && entry.NameLength == normalised.size() && memcmp(_names + entry.NameOffset, normalised.data(), normalised.size()) == 0)
+		{
+			return &entry;
+		}
+	}
+
+	return nullptr;
+}
+
+std::string AssetPackFile::GetName(const AssetPackEntry& entry) const
+{
+	return std::string(_names + entry.NameOffset, entry.NameLength);
+}
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "MappedFile.h"
+
+//A single file holding every cooked asset, so the game maps one file at startup rather than opening a mesh cache or DDS file per asset.
+//
+//Layout: a fixed AssetPackHeader, then the table of AssetPackEntry, then the hash table, then the entry names, then the assets themselves.
+//Every table and asset starts on an AssetPack::Alignment boundary. That's the mesh cache section alignment, so a mesh cache copied in whole
+//keeps its sections aligned, and vertices, indices and texels can be handed straight from the mapping to CreateBuffer/CreateTexture2D.
+//
+//Entries are named by their path relative to the pack, in lower case with '/' separators, e.g. "models/hercules.obj.qmesh" or "crate_color.dds".
+//The hash table is open addressed with linear probing: slot HashName(name) & (HashSlotCount - 1) onwards holds entry index + 1, 0 for empty.
+namespace AssetPack
+{
+	const uint32_t Magic = 0x4B434150; //"PACK"
+	const uint32_t Version = 1;
+	const uint32_t Alignment = 64;
+
+	enum EntryType
+	{
+		Entry_Mesh = 1,				//A mesh cache with SimpleVertex vertices, as written next to the OBJ as "<file>.mesh" (see MeshCache::CacheSuffix)
+		Entry_CompressedMesh = 2,	//A mesh cache with CompressedVertex vertices, "<file>.qmesh"
+		Entry_Texture = 3,			//A DDS file as-is
+	};
+
+	enum EntryFlags
+	{
+		Flag_InvertTexCoords = 1,	//Meshes only, cooked with OBJ texture coordinates flipped in V
+	};
+
+	//Lower case with '/' separators, the form entries are stored and looked up in
+	std::string NormaliseName(const std::string& name);
+
+	uint64_t HashName(const char* name, size_t length);
+};
+
+struct AssetPackHeader
+{
+	uint32_t Magic;
+	uint32_t Version;
+	uint32_t HeaderSize;		//sizeof(AssetPackHeader), catches a header written by a different build
+	uint32_t EntryCount;
+	uint64_t FileSize;			//Catches truncated files
+	uint64_t EntriesOffset;
+	uint64_t HashOffset;
+	uint64_t NamesOffset;
+	uint32_t HashSlotCount;		//A power of two, at least twice EntryCount
+	uint32_t Reserved;
+};
+
+struct AssetPackEntry
+{
+	uint64_t NameHash;
+	uint32_t NameOffset;		//From NamesOffset, the name isn't null terminated
+	uint32_t NameLength;
+	uint32_t Type;
+	uint32_t Flags;
+	uint64_t Offset;			//From the start of the pack
+	uint64_t Size;
+};
+
+//A file to be written into a pack, copied in as-is
+struct AssetPackSource
+{
+	std::string Name;			//Normalised by WriteAssetPack
+	std::string Filename;
+	uint32_t Type;
+	uint32_t Flags;
+};
+
+//Writes a pack. Fails if a file can't be read, two sources have the same name, or the pack can't be written.
+//The pack is written under a temporary name and renamed into place, so a crash never leaves a half written pack behind.
+bool WriteAssetPack(const char* filename, const std::vector<AssetPackSource>& sources);
+
+//A memory mapped, validated pack. Entries and their data stay valid until the AssetPackFile is closed or destroyed, and are safe to read from
+//any thread while it's open.
+class AssetPackFile
+{
+public:
+	AssetPackFile();
+
+	//Fails if the file is missing, truncated, from another version, or has a table, name or asset outside the file
+	bool Open(const char* filename);
+	void Close();
+
+	bool IsOpen() const { return _header != nullptr; };
+
+	//name doesn't have to be normalised. Returns nullptr if the pack has no such entry.
+	const AssetPackEntry* Find(const std::string& name) const;
+
+	unsigned int GetEntryCount() const { return _header ? _header->EntryCount : 0; };
+	const AssetPackEntry& GetEntry(unsigned int index) const { return _entries[index]; };
+	std::string GetName(const AssetPackEntry& entry) const;
+
+	//Points into the mapping, aligned to AssetPack::Alignment
+	const void* GetData(const AssetPackEntry& entry) const { return _file.GetData() + entry.Offset; };
+
+private:
+	MappedFile _file;
+	const AssetPackHeader* _header;
+	const AssetPackEntry* _entries;
+	const uint32_t* _slots;
+	const char* _names;
+};
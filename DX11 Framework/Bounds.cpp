@@ -0,0 +1,100 @@
+#include "Bounds.h"
+#include <cmath>
+#include <cstring>
+
+MeshBounds Bounds::Compute(const XMFLOAT3* firstPosition, size_t count, size_t stride)
+{
+	MeshBounds bounds;
+	memset(&bounds, 0, sizeof(bounds));
+
+	if (count == 0)
+	{
+		return bounds;
+	}
+
+	const char* positions = (const char*)firstPosition;
+
+	//Two sets of accumulators so each min/max doesn't have to wait for the one before it
+	XMVECTOR minimum0 = XMLoadFloat3(firstPosition);
+	XMVECTOR maximum0 = minimum0;
+	XMVECTOR minimum1 = minimum0;
+	XMVECTOR maximum1 = minimum0;
+
+	size_t i = 1;
+	for (; i + 2 <= count; i += 2)
+	{
+		XMVECTOR a = XMLoadFloat3((const XMFLOAT3*)(positions + i * stride));
+		XMVECTOR b = XMLoadFloat3((const XMFLOAT3*)(positions + (i + 1) * stride));
+
+		minimum0 = XMVectorMin(minimum0, a);
+		maximum0 = XMVectorMax(maximum0, a);
+		minimum1 = XMVectorMin(minimum1, b);
+		maximum1 = XMVectorMax(maximum1, b);
+	}
+
+	if (i < count)
+	{
+		XMVECTOR a = XMLoadFloat3((const XMFLOAT3*)(positions + i * stride));
+
+		minimum0 = XMVectorMin(minimum0, a);
+		maximum0 = XMVectorMax(maximum0, a);
+	}
+
+	XMVECTOR minimum = XMVectorMin(minimum0, minimum1);
+	XMVECTOR maximum = XMVectorMax(maximum0, maximum1);
+	XMVECTOR center = XMVectorScale(XMVectorAdd(minimum, maximum), 0.5f);
+
+	//Furthest position from the box centre, squared -- never bigger than the box's half diagonal, and usually a good bit smaller
+	XMVECTOR radiusSq0 = XMVectorZero();
+	XMVECTOR radiusSq1 = XMVectorZero();
+
+	i = 0;
+	for (; i + 2 <= count; i += 2)
+	{
+		XMVECTOR a = XMLoadFloat3((const XMFLOAT3*)(positions + i * stride));
+		XMVECTOR b = XMLoadFloat3((const XMFLOAT3*)(positions + (i + 1) * stride));
+
+		radiusSq0 = XMVectorMax(radiusSq0, XMVector3LengthSq(XMVectorSubtract(a, center)));
+		radiusSq1 = XMVectorMax(radiusSq1, XMVector3LengthSq(XMVectorSubtract(b, center)));
+	}
+
+	if (i < count)
+	{
+		XMVECTOR a = XMLoadFloat3((const XMFLOAT3*)(positions + i * stride));
+
+		radiusSq0 = XMVectorMax(radiusSq0, XMVector3LengthSq(XMVectorSubtract(a, center)));
+	}
+
+	XMStoreFloat3(&bounds.Min, minimum);
+	XMStoreFloat3(&bounds.Max, maximum);
+	XMStoreFloat3(&bounds.Center, center);
+	bounds.Radius = sqrtf(XMVectorGetX(XMVectorMax(radiusSq0, radiusSq1)));
+
+	return bounds;
+}
+
+MeshBounds Bounds::Transform(const MeshBounds& bounds, const XMFLOAT4X4& world)
+{
+	XMMATRIX matrix = XMLoadFloat4x4(&world);
+
+	XMVECTOR minimum = XMLoadFloat3(&bounds.Min);
+	XMVECTOR maximum = XMLoadFloat3(&bounds.Max);
+	XMVECTOR boxCenter = XMVectorScale(XMVectorAdd(minimum, maximum), 0.5f);
+	XMVECTOR boxExtent = XMVectorScale(XMVectorSubtract(maximum, minimum), 0.5f);
+
+	//Each world axis's half size is the box's extents projected through the absolute value of the rotation/scale part
+	XMVECTOR worldCenter = XMVector3Transform(boxCenter, matrix);
+	XMVECTOR worldExtent = XMVectorMultiply(XMVectorSplatX(boxExtent), XMVectorAbs(matrix.r[0]));
+	worldExtent = XMVectorMultiplyAdd(XMVectorSplatY(boxExtent), XMVectorAbs(matrix.r[1]), worldExtent);
+	worldExtent = XMVectorMultiplyAdd(XMVectorSplatZ(boxExtent), XMVectorAbs(matrix.r[2]), worldExtent);
+
+	XMVECTOR scaleSq = XMVectorMax(XMVector3LengthSq(matrix.r[0]), XMVectorMax(XMVector3LengthSq(matrix.r[1]), XMVector3LengthSq(matrix.r[2])));
+
+	MeshBounds result;
+	XMStoreFloat3(&result.Min, XMVectorSubtract(worldCenter, worldExtent));
+	XMStoreFloat3(&result.Max, XMVectorAdd(worldCenter, worldExtent));
+	XMStoreFloat3(&result.Center, XMVector3Transform(XMLoadFloat3(&bounds.Center), matrix));
+	result.Radius = bounds.Radius * sqrtf(XMVectorGetX(scaleSq));
+
+	return result;
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstddef>
+#include <directxmath.h>
+
+using namespace DirectX;
+
+//Axis aligned box plus a bounding sphere, both in the same space (mesh space for a mesh, world space once transformed)
+struct MeshBounds
+{
+	XMFLOAT3 Min;
+	XMFLOAT3 Max;
+	XMFLOAT3 Center;	//Sphere centre
+	float Radius;
+};
+
+namespace Bounds
+{
+	//Bounds of count positions, each stride bytes after the last (so it can read straight out of an interleaved vertex array).
+	//Min/max are reduced with DirectXMath vector ops. The sphere is centred on the box, with the radius of the furthest position.
+	MeshBounds Compute(const XMFLOAT3* firstPosition, size_t count, size_t stride);
+
+	//Bounds after transforming by world (a row-vector matrix, as GameObject builds them). The box is the tight box around the
+	//transformed box, the sphere's radius is scaled by the largest axis scale so it stays conservative under non-uniform scaling.
+	MeshBounds Transform(const MeshBounds& bounds, const XMFLOAT4X4& world);
+};
@@ -0,0 +1,512 @@
+#include "DDSLayout.h"
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+	//The DDS file structures, as laid out on disk after the magic number
+	struct DDSPixelFormat
+	{
+		uint32_t Size;
+		uint32_t Flags;
+		uint32_t FourCC;
+		uint32_t RGBBitCount;
+		uint32_t RBitMask;
+		uint32_t GBitMask;
+		uint32_t BBitMask;
+		uint32_t ABitMask;
+	};
+
+	struct DDSHeader
+	{
+		uint32_t Size;
+		uint32_t Flags;
+		uint32_t Height;
+		uint32_t Width;
+		uint32_t PitchOrLinearSize;
+		uint32_t Depth;
+		uint32_t MipMapCount;
+		uint32_t Reserved1[11];
+		DDSPixelFormat PixelFormat;
+		uint32_t Caps;
+		uint32_t Caps2;
+		uint32_t Caps3;
+		uint32_t Caps4;
+		uint32_t Reserved2;
+	};
+
+	struct DDSHeaderDXT10
+	{
+		uint32_t DXGIFormat;
+		uint32_t ResourceDimension;
+		uint32_t MiscFlag;
+		uint32_t ArraySize;
+		uint32_t MiscFlags2;
+	};
+
+	const uint32_t DDPF_Alpha = 0x2;
+	const uint32_t DDPF_FourCC = 0x4;
+	const uint32_t DDPF_RGB = 0x40;
+	const uint32_t DDPF_Luminance = 0x20000;
+	const uint32_t DDSD_Height = 0x2;
+	const uint32_t DDSD_Depth = 0x800000;
+	const uint32_t DDSCaps2_Cubemap = 0x200;
+	const uint32_t DDSCaps2_AllFaces = 0xFC00;
+	const uint32_t DXT10_TextureCube = 0x4;
+	const uint32_t DXT10_AlphaModeMask = 0x7;
+
+	//Bits per pixel of every DXGI_FORMAT up to B4G4R4A4_UNORM, indexed by format, 0 for unknown. Looked up rather than switched on since
+	//it's the one thing every surface needs.
+	const uint8_t FormatBits[] =
+	{
+		0,										//UNKNOWN
+		128, 128, 128, 128,						//R32G32B32A32
+		96, 96, 96, 96,							//R32G32B32
+		64, 64, 64, 64, 64, 64,					//R16G16B16A16
+		64, 64, 64, 64,							//R32G32
+		64, 64, 64, 64,							//R32G8X24, D32_FLOAT_S8X24_UINT, R32_FLOAT_X8X24, X32_G8X24
+		32, 32, 32,								//R10G10B10A2
+		32,										//R11G11B10_FLOAT
+		32, 32, 32, 32, 32, 32,					//R8G8B8A8
+		32, 32, 32, 32, 32, 32,					//R16G16
+		32, 32, 32, 32, 32,						//R32, D32_FLOAT
+		32, 32, 32, 32,							//R24G8, D24_UNORM_S8_UINT, R24_UNORM_X8, X24_G8
+		16, 16, 16, 16, 16,						//R8G8
+		16, 16, 16, 16, 16, 16, 16,				//R16, D16_UNORM
+		8, 8, 8, 8, 8,							//R8
+		8,										//A8_UNORM
+		1,										//R1_UNORM
+		32,										//R9G9B9E5_SHAREDEXP
+		32, 32,									//R8G8_B8G8, G8R8_G8B8
+		4, 4, 4,								//BC1
+		8, 8, 8,								//BC2
+		8, 8, 8,								//BC3
+		4, 4, 4,								//BC4
+		8, 8, 8,								//BC5
+		16, 16,									//B5G6R5, B5G5R5A1
+		32, 32, 32, 32, 32, 32, 32,				//B8G8R8A8, B8G8R8X8, R10G10B10_XR_BIAS_A2
+		8, 8, 8,								//BC6H
+		8, 8, 8,								//BC7
+		32, 32, 64,								//AYUV, Y410, Y416
+		12, 24, 24, 12,							//NV12, P010, P016, 420_OPAQUE
+		32, 64, 64,								//YUY2, Y210, Y216
+		12,										//NV11
+		8, 8, 8, 16,							//AI44, IA44, P8, A8P8
+		16,										//B4G4R4A4_UNORM
+	};
+
+	static_assert(sizeof(FormatBits) == DDSLayout::Format_B4G4R4A4_UNorm + 1, "FormatBits has to cover every format up to B4G4R4A4_UNORM");
+
+	uint32_t MakeFourCC(char a, char b, char c, char d)
+	{
+		return (uint32_t)(uint8_t)a | ((uint32_t)(uint8_t)b << 8) | ((uint32_t)(uint8_t)c << 16) | ((uint32_t)(uint8_t)d << 24);
+	}
+
+	bool HasBitMasks(const DDSPixelFormat& format, uint32_t r, uint32_t g, uint32_t b, uint32_t a)
+	{
+		return format.RBitMask == r && format.GBitMask == g && format.BBitMask == b && format.ABitMask == a;
+	}
+
+	//The DXGI_FORMAT a legacy (pre DX10 header) pixel format matches, or Format_Unknown if there isn't one. sRGB formats can only be
+	//written with the DX10 header.
+	uint32_t LegacyFormat(const DDSPixelFormat& format)
+	{
+		if (format.Flags & DDPF_RGB)
+		{
+			switch (format.RGBBitCount)
+			{
+			case 32:
+				if (HasBitMasks(format, 0x000000FF, 0x0000FF00, 0x00FF0000, 0xFF000000)) return DDSLayout::Format_R8G8B8A8_UNorm;
+				if (HasBitMasks(format, 0x00FF0000, 0x0000FF00, 0x000000FF, 0xFF000000)) return DDSLayout::Format_B8G8R8A8_UNorm;
+				if (HasBitMasks(format, 0x00FF0000, 0x0000FF00, 0x000000FF, 0x00000000)) return DDSLayout::Format_B8G8R8X8_UNorm;
+
+				//D3DX writes 10:10:10:2 with the red and blue masks the wrong way round, so that's the one taken to be R10G10B10A2
+				if (HasBitMasks(format, 0x3FF00000, 0x000FFC00, 0x000003FF, 0xC0000000)) return DDSLayout::Format_R10G10B10A2_UNorm;
+				if (HasBitMasks(format, 0x0000FFFF, 0xFFFF0000, 0x00000000, 0x00000000)) return DDSLayout::Format_R16G16_UNorm;
+
+				//The only 32 bit single channel format D3D9 had was R32F
+				if (HasBitMasks(format, 0xFFFFFFFF, 0x00000000, 0x00000000, 0x00000000)) return DDSLayout::Format_R32_Float;
+				break;
+
+			case 16:
+				if (HasBitMasks(format, 0x7C00, 0x03E0, 0x001F, 0x8000)) return DDSLayout::Format_B5G5R5A1_UNorm;
+				if (HasBitMasks(format, 0xF800, 0x07E0, 0x001F, 0x0000)) return DDSLayout::Format_B5G6R5_UNorm;
+				if (HasBitMasks(format, 0x0F00, 0x00F0, 0x000F, 0xF000)) return DDSLayout::Format_B4G4R4A4_UNorm;
+				break;
+			}
+		}
+		else if (format.Flags & DDPF_Luminance)
+		{
+			if (format.RGBBitCount == 8 && HasBitMasks(format, 0x000000FF, 0x00000000, 0x00000000, 0x00000000)) return DDSLayout::Format_R8_UNorm;
+
+			if (format.RGBBitCount == 16)
+			{
+				if (HasBitMasks(format, 0x0000FFFF, 0x00000000, 0x00000000, 0x00000000)) return DDSLayout::Format_R16_UNorm;
+				if (HasBitMasks(format, 0x000000FF, 0x00000000, 0x00000000, 0x0000FF00)) return DDSLayout::Format_R8G8_UNorm;
+			}
+		}
+		else if (format.Flags & DDPF_Alpha)
+		{
+			if (format.RGBBitCount == 8) return DDSLayout::Format_A8_UNorm;
+		}
+		else if (format.Flags & DDPF_FourCC)
+		{
+			uint32_t fourCC = format.FourCC;
+
+			//DXT2 and DXT4 are the premultiplied alpha versions of DXT3 and DXT5, which are the same blocks
+			if (fourCC == MakeFourCC('D', 'X', 'T', '1')) return DDSLayout::Format_BC1_UNorm;
+			if (fourCC == MakeFourCC('D', 'X', 'T', '2') || fourCC == MakeFourCC('D', 'X', 'T', '3')) return DDSLayout::Format_BC2_UNorm;
+			if (fourCC == MakeFourCC('D', 'X', 'T', '4') || fourCC == MakeFourCC('D', 'X', 'T', '5')) return DDSLayout::Format_BC3_UNorm;
+			if (fourCC == MakeFourCC('A', 'T', 'I', '1') || fourCC == MakeFourCC('B', 'C', '4', 'U')) return DDSLayout::Format_BC4_UNorm;
+			if (fourCC == MakeFourCC('B', 'C', '4', 'S')) return DDSLayout::Format_BC4_SNorm;
+			if (fourCC == MakeFourCC('A', 'T', 'I', '2') || fourCC == MakeFourCC('B', 'C', '5', 'U')) return DDSLayout::Format_BC5_UNorm;
+			if (fourCC == MakeFourCC('B', 'C', '5', 'S')) return DDSLayout::Format_BC5_SNorm;
+			if (fourCC == MakeFourCC('R', 'G', 'B', 'G')) return DDSLayout::Format_R8G8_B8G8_UNorm;
+			if (fourCC == MakeFourCC('G', 'R', 'G', 'B')) return DDSLayout::Format_G8R8_G8B8_UNorm;
+			if (fourCC == MakeFourCC('Y', 'U', 'Y', '2')) return DDSLayout::Format_YUY2;
+
+			//D3DFORMAT numbers in place of a FourCC
+			switch (fourCC)
+			{
+			case 36: return DDSLayout::Format_R16G16B16A16_UNorm;		//D3DFMT_A16B16G16R16
+			case 110: return DDSLayout::Format_R16G16B16A16_SNorm;		//D3DFMT_Q16W16V16U16
+			case 111: return DDSLayout::Format_R16_Float;				//D3DFMT_R16F
+			case 112: return DDSLayout::Format_R16G16_Float;			//D3DFMT_G16R16F
+			case 113: return DDSLayout::Format_R16G16B16A16_Float;		//D3DFMT_A16B16G16R16F
+			case 114: return DDSLayout::Format_R32_Float;				//D3DFMT_R32F
+			case 115: return DDSLayout::Format_R32G32_Float;			//D3DFMT_G32R32F
+			case 116: return DDSLayout::Format_R32G32B32A32_Float;		//D3DFMT_A32B32G32R32F
+			}
+		}
+
+		return DDSLayout::Format_Unknown;
+	}
+
+	bool IsBlockCompressed(uint32_t format)
+	{
+		return (format >= DDSLayout::Format_BC1_Typeless && format <= DDSLayout::Format_BC5_SNorm) ||
+			(format >= DDSLayout::Format_BC6H_Typeless && format <= DDSLayout::Format_BC7_UNorm_SRGB);
+	}
+
+	uint32_t Levels(uint32_t size)
+	{
+		uint32_t levels = 1;
+		while (size > 1)
+		{
+			size >>= 1;
+			levels++;
+		}
+
+		return levels;
+	}
+}
+
+size_t DDSLayout::BitsPerPixel(uint32_t format)
+{
+	return format < sizeof(FormatBits) ? FormatBits[format] : 0;
+}
+
+void DDSLayout::GetSurfaceInfo(uint32_t width, uint32_t height, uint32_t format, uint64_t* numBytes, uint64_t* rowBytes, uint64_t* numRows)
+{
+	uint64_t w = width;
+	uint64_t h = height;
+	uint64_t bytes;
+	uint64_t row;
+	uint64_t rows;
+
+	if (IsBlockCompressed(format))
+	{
+		//BC1 and BC4 are 8 bytes a block, the rest 16
+		uint64_t blockBytes = FormatBits[format] * 2;
+		row = w > 0 ? std::max<uint64_t>(1, (w + 3) / 4) * blockBytes : 0;
+		rows = h > 0 ? std::max<uint64_t>(1, (h + 3) / 4) : 0;
+		bytes = row * rows;
+	}
+	else if (format == Format_R8G8_B8G8_UNorm || format == Format_G8R8_G8B8_UNorm || format == Format_YUY2 ||
+		format == Format_Y210 || format == Format_Y216)
+	{
+		//Two pixels share each 4 (or 8) byte group
+		row = ((w + 1) >> 1) * (format == Format_Y210 || format == Format_Y216 ? 8 : 4);
+		rows = h;
+		bytes = row * h;
+	}
+	else if (format == Format_NV11)
+	{
+		//Direct3D takes it to be twice the height, although that's more than the 4:1:1 data needs
+		row = ((w + 3) >> 2) * 4;
+		rows = h * 2;
+		bytes = row * rows;
+	}
+	else if (format == Format_NV12 || format == Format_420_Opaque || format == Format_P010 || format == Format_P016)
+	{
+		//A full size luma plane, then chroma at half height
+		row = ((w + 1) >> 1) * (format == Format_P010 || format == Format_P016 ? 4 : 2);
+		bytes = row * h + ((row * h + 1) >> 1);
+		rows = h + ((h + 1) >> 1);
+	}
+	else
+	{
+		row = (w * BitsPerPixel(format) + 7) / 8;
+		rows = h;
+		bytes = row * h;
+	}
+
+	if (numBytes) *numBytes = bytes;
+	if (rowBytes) *rowBytes = row;
+	if (numRows) *numRows = rows;
+}
+
+DDSLayout::ParseResult DDSLayout::Parse(const void* data, size_t size, TextureLayout& layout)
+{
+	const uint8_t* bytes = (const uint8_t*)data;
+
+	uint32_t magic = 0;
+	if (size >= sizeof(magic)) memcpy(&magic, bytes, sizeof(magic));
+
+	if (size < sizeof(uint32_t) + sizeof(DDSHeader) || magic != Magic)
+	{
+		return Parse_NotDDS;
+	}
+
+	//Copied out rather than pointed at, the file may not be 4 byte aligned
+	DDSHeader header;
+	memcpy(&header, bytes + sizeof(uint32_t), sizeof(header));
+
+	if (header.Size != sizeof(DDSHeader) || header.PixelFormat.Size != sizeof(DDSPixelFormat))
+	{
+		return Parse_NotDDS;
+	}
+
+	layout.DataOffset = sizeof(uint32_t) + sizeof(DDSHeader);
+	layout.Width = header.Width;
+	layout.Height = header.Height;
+	layout.Depth = header.Depth;
+	layout.MipCount = std::max(header.MipMapCount, 1u);
+	layout.ArraySize = 1;
+	layout.IsCubeMap = false;
+	layout.AlphaMode = Alpha_Unknown;
+
+	if ((header.PixelFormat.Flags & DDPF_FourCC) && header.PixelFormat.FourCC == MakeFourCC('D', 'X', '1', '0'))
+	{
+		if (size < layout.DataOffset + sizeof(DDSHeaderDXT10))
+		{
+			return Parse_NotDDS;
+		}
+
+		DDSHeaderDXT10 dxt10;
+		memcpy(&dxt10, bytes + layout.DataOffset, sizeof(dxt10));
+		layout.DataOffset += sizeof(DDSHeaderDXT10);
+
+		if (dxt10.ArraySize == 0)
+		{
+			return Parse_Invalid;
+		}
+
+		//Paletted formats can't be created, and nor can ones this doesn't know the size of
+		if (dxt10.DXGIFormat == Format_AI44 || dxt10.DXGIFormat == Format_IA44 || dxt10.DXGIFormat == Format_P8 ||
+			dxt10.DXGIFormat == Format_A8P8 || BitsPerPixel(dxt10.DXGIFormat) == 0)
+		{
+			return Parse_Unsupported;
+		}
+
+		layout.Format = dxt10.DXGIFormat;
+		layout.Dimension = dxt10.ResourceDimension;
+		layout.ArraySize = dxt10.ArraySize;
+
+		switch (dxt10.ResourceDimension)
+		{
+		case Dimension_Texture1D:
+			//D3DX writes 1D textures with a height of 1
+			if ((header.Flags & DDSD_Height) && layout.Height != 1)
+			{
+				return Parse_Invalid;
+			}
+
+			layout.Height = 1;
+			layout.Depth = 1;
+			break;
+
+		case Dimension_Texture2D:
+			if (dxt10.MiscFlag & DXT10_TextureCube)
+			{
+				if (layout.ArraySize > UINT32_MAX / 6)
+				{
+					return Parse_Unsupported;
+				}
+
+				layout.ArraySize *= 6;
+				layout.IsCubeMap = true;
+			}
+
+			layout.Depth = 1;
+			break;
+
+		case Dimension_Texture3D:
+			if (!(header.Flags & DDSD_Depth))
+			{
+				return Parse_Invalid;
+			}
+
+			if (layout.ArraySize > 1)
+			{
+				return Parse_Unsupported;
+			}
+			break;
+
+		default:
+			return Parse_Unsupported;
+		}
+
+		uint32_t alphaMode = dxt10.MiscFlags2 & DXT10_AlphaModeMask;
+		if (alphaMode <= Alpha_Custom)
+		{
+			layout.AlphaMode = alphaMode;
+		}
+	}
+	else
+	{
+		layout.Format = LegacyFormat(header.PixelFormat);
+		if (layout.Format == Format_Unknown)
+		{
+			return Parse_Unsupported;
+		}
+
+		if (header.Flags & DDSD_Depth)
+		{
+			layout.Dimension = Dimension_Texture3D;
+		}
+		else
+		{
+			//There's no way for a legacy header to say it's a 1D texture
+			layout.Dimension = Dimension_Texture2D;
+			layout.Depth = 1;
+
+			if (header.Caps2 & DDSCaps2_Cubemap)
+			{
+				//Every face has to be there
+				if ((header.Caps2 & DDSCaps2_AllFaces) != DDSCaps2_AllFaces)
+				{
+					return Parse_Unsupported;
+				}
+
+				layout.ArraySize = 6;
+				layout.IsCubeMap = true;
+			}
+		}
+
+		if (header.PixelFormat.Flags & DDPF_FourCC)
+		{
+			if (header.PixelFormat.FourCC == MakeFourCC('D', 'X', 'T', '2') || header.PixelFormat.FourCC == MakeFourCC('D', 'X', 'T', '4'))
+			{
+				layout.AlphaMode = Alpha_Premultiplied;
+			}
+		}
+	}
+
+	if (layout.Width == 0 || layout.Height == 0 || layout.Depth == 0)
+	{
+		return Parse_Invalid;
+	}
+
+	if (layout.Width > MaxDimension || layout.Height > MaxDimension || layout.Depth > MaxDimension)
+	{
+		return Parse_Unsupported;
+	}
+
+	if (layout.MipCount > Levels(std::max(std::max(layout.Width, layout.Height), layout.Depth)))
+	{
+		return Parse_Invalid;
+	}
+
+	//Every array item has the same chain of mips, so the first one's is worked out and copied along. Below MaxDimension a mip chain is
+	//well under 2^64 bytes, so only the array size can make the total overflow.
+	size_t mipCount = layout.MipCount;
+
+	//Every item takes at least a byte, so this also keeps a made up array size from allocating more surfaces than the file could hold
+	if ((uint64_t)layout.ArraySize > size - layout.DataOffset)
+	{
+		return Parse_Truncated;
+	}
+
+	layout.Subresources.resize(mipCount * layout.ArraySize);
+
+	uint64_t available = size - layout.DataOffset;
+	uint64_t itemSize = 0;
+	uint32_t w = layout.Width;
+	uint32_t h = layout.Height;
+	uint32_t d = layout.Depth;
+
+	for (size_t mip = 0; mip < mipCount; ++mip)
+	{
+		uint64_t sliceBytes;
+		uint64_t rowBytes;
+		GetSurfaceInfo(w, h, layout.Format, &sliceBytes, &rowBytes, nullptr);
+
+		if (itemSize + sliceBytes * d > available)
+		{
+			return Parse_Truncated;
+		}
+
+		Subresource& surface = layout.Subresources[mip];
+		surface.Offset = (size_t)itemSize;
+		surface.RowPitch = (size_t)rowBytes;
+		surface.SlicePitch = (size_t)sliceBytes;
+		surface.Width = w;
+		surface.Height = h;
+		surface.Depth = d;
+
+		itemSize += sliceBytes * d;
+
+		w = std::max(w >> 1, 1u);
+		h = std::max(h >> 1, 1u);
+		d = std::max(d >> 1, 1u);
+	}
+
+	if (itemSize > available / layout.ArraySize)
+	{
+		return Parse_Truncated;
+	}
+
+	layout.DataSize = (size_t)(itemSize * layout.ArraySize);
+
+	for (size_t mip = 0; mip < mipCount; ++mip)
+	{
+		layout.Subresources[mip].Offset += layout.DataOffset;
+	}
+
+	for (size_t item = 1; item < layout.ArraySize; ++item)
+	{
+		size_t itemOffset = item * (size_t)itemSize;
+		Subresource* surfaces = &layout.Subresources[item * mipCount];
+
+		for (size_t mip = 0; mip < mipCount; ++mip)
+		{
+			surfaces[mip] = layout.Subresources[mip];
+			surfaces[mip].Offset += itemOffset;
+		}
+	}
+
+	return Parse_Ok;
+}
+
+uint32_t DDSLayout::MipsOverSize(const TextureLayout& layout, size_t maxSize)
+{
+	if (layout.MipCount <= 1 || maxSize == 0)
+	{
+		return 0;
+	}
+
+	uint32_t skip = 0;
+	while (skip < layout.MipCount)
+	{
+		const Subresource& mip = layout.Subresources[skip];
+		if (mip.Width <= maxSize && mip.Height <= maxSize && mip.Depth <= maxSize)
+		{
+			break;
+		}
+
+		skip++;
+	}
+
+	return skip;
+}
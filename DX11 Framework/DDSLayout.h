@@ -0,0 +1,146 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+//Reads the headers of a DDS file in memory and works out where every surface in it is, without a device or any Direct3D headers, so the
+//texture loader, the cooker and anything that wants individual mips share one idea of what a DDS file holds and which ones are accepted.
+//
+//Formats are DXGI_FORMAT numbers, which is what DX10 headers store, so they cast straight to DXGI_FORMAT. Legacy headers are mapped to
+//the DXGI_FORMAT that matches their pixel format, when there is one. Dimensions are D3D11_RESOURCE_DIMENSION numbers.
+namespace DDSLayout
+{
+	const uint32_t Magic = 0x20534444;		//"DDS "
+
+	//Larger than any Direct3D 11 or 12 device takes in any dimension, so sizes can be worked out without overflowing
+	const uint32_t MaxDimension = 65536;
+
+	//The DXGI_FORMAT values legacy pixel formats map to, and those that are laid out differently from plain rows of pixels
+	enum Format
+	{
+		Format_Unknown = 0,
+		Format_R32G32B32A32_Float = 2,
+		Format_R16G16B16A16_Float = 10,
+		Format_R16G16B16A16_UNorm = 11,
+		Format_R16G16B16A16_SNorm = 13,
+		Format_R32G32_Float = 16,
+		Format_R10G10B10A2_UNorm = 24,
+		Format_R8G8B8A8_UNorm = 28,
+		Format_R16G16_Float = 34,
+		Format_R16G16_UNorm = 35,
+		Format_R32_Float = 41,
+		Format_R8G8_UNorm = 49,
+		Format_R16_Float = 54,
+		Format_R16_UNorm = 56,
+		Format_R8_UNorm = 61,
+		Format_A8_UNorm = 65,
+		Format_R8G8_B8G8_UNorm = 68,
+		Format_G8R8_G8B8_UNorm = 69,
+		Format_BC1_Typeless = 70,
+		Format_BC1_UNorm = 71,
+		Format_BC1_UNorm_SRGB = 72,
+		Format_BC2_UNorm = 74,
+		Format_BC3_Typeless = 76,
+		Format_BC3_UNorm = 77,
+		Format_BC3_UNorm_SRGB = 78,
+		Format_BC4_Typeless = 79,
+		Format_BC4_UNorm = 80,
+		Format_BC4_SNorm = 81,
+		Format_BC5_Typeless = 82,
+		Format_BC5_UNorm = 83,
+		Format_BC5_SNorm = 84,
+		Format_B5G6R5_UNorm = 85,
+		Format_B5G5R5A1_UNorm = 86,
+		Format_B8G8R8A8_UNorm = 87,
+		Format_B8G8R8X8_UNorm = 88,
+		Format_BC6H_Typeless = 94,
+		Format_BC7_Typeless = 97,
+		Format_BC7_UNorm = 98,
+		Format_BC7_UNorm_SRGB = 99,
+		Format_NV12 = 103,
+		Format_P010 = 104,
+		Format_P016 = 105,
+		Format_420_Opaque = 106,
+		Format_YUY2 = 107,
+		Format_Y210 = 108,
+		Format_Y216 = 109,
+		Format_NV11 = 110,
+		Format_AI44 = 111,
+		Format_IA44 = 112,
+		Format_P8 = 113,
+		Format_A8P8 = 114,
+		Format_B4G4R4A4_UNorm = 115,
+	};
+
+	enum Dimension
+	{
+		Dimension_Texture1D = 2,
+		Dimension_Texture2D = 3,
+		Dimension_Texture3D = 4,
+	};
+
+	//Same values as DDS_ALPHA_MODE
+	enum AlphaMode
+	{
+		Alpha_Unknown = 0,
+		Alpha_Straight = 1,
+		Alpha_Premultiplied = 2,
+		Alpha_Opaque = 3,
+		Alpha_Custom = 4,
+	};
+
+	enum ParseResult
+	{
+		Parse_Ok,
+		Parse_NotDDS,			//Too short for its headers, no magic number, or header sizes that are wrong
+		Parse_Invalid,			//Headers that contradict themselves, a zero size or array size, or more mips than the texture has levels
+		Parse_Unsupported,		//A format with no DXGI equivalent or that's paletted, a partial cube map, a volume array, or over MaxDimension
+		Parse_Truncated,		//The file ends before the last surface the headers describe
+	};
+
+	//One mip of one array item (or cube face)
+	struct Subresource
+	{
+		size_t Offset;			//From the start of the file
+		size_t RowPitch;		//Bytes per row of pixels, or of 4x4 blocks for block compressed formats
+		size_t SlicePitch;		//Bytes per depth slice, which is the whole surface unless it's a volume texture
+		uint32_t Width;
+		uint32_t Height;
+		uint32_t Depth;
+	};
+
+	struct TextureLayout
+	{
+		uint32_t Format;		//DXGI_FORMAT
+		uint32_t Dimension;
+		uint32_t Width;
+		uint32_t Height;
+		uint32_t Depth;			//1 unless it's a volume texture
+		uint32_t MipCount;
+		uint32_t ArraySize;		//Six per cube for cube maps
+		bool IsCubeMap;
+		uint32_t AlphaMode;
+		size_t DataOffset;		//Bytes of headers before the first surface
+		size_t DataSize;		//Bytes from DataOffset to the end of the last surface, anything after that is ignored
+
+		//MipCount surfaces for the first array item, largest first, then the next item's ... which is D3D11CalcSubresource's order.
+		//Every one of them is inside the file.
+		std::vector<Subresource> Subresources;
+	};
+
+	//Checks data is a DDS file this can describe and fills in layout. Nothing is kept pointing into data. On failure layout is left
+	//half filled in, so don't use it. Reusing a layout reuses its Subresources' memory.
+	ParseResult Parse(const void* data, size_t size, TextureLayout& layout);
+
+	//Bits per pixel of a DXGI_FORMAT, or 0 for one that isn't known. Block compressed formats give the average, 4 or 8.
+	size_t BitsPerPixel(uint32_t format);
+
+	//The size of a surface of width x height in format. Rows are rows of blocks for block compressed formats, and include the chroma rows
+	//for planar video formats. Any of the outputs can be null.
+	void GetSurfaceInfo(uint32_t width, uint32_t height, uint32_t format, uint64_t* numBytes, uint64_t* rowBytes, uint64_t* numRows);
+
+	//How many of the largest mips have to be left out so none of the rest are over maxSize in any dimension. 0 when maxSize is 0 or there's
+	//only the one mip, MipCount when even the smallest is too big.
+	uint32_t MipsOverSize(const TextureLayout& layout, size_t maxSize);
+};
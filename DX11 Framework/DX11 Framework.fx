@@ -25,6 +25,8 @@ cbuffer ConstantBuffer : register( b0 )
 	float4 SpecularLight;
 	float SpecularPower;
 	float3 EyePosW;
+	float4 PositionScale;
+	float4 PositionOffset;
 
 }
 
@@ -70,6 +72,28 @@ VS_OUTPUT VS(float4 Pos : POSITION, float3 NormalL : NORMAL, float2 Tex : TEXCOO
 
 
 
+//------------------------------------------------------------------------------------
+// Vertex Shader for compressed vertices - unpacks them, then does the same as VS
+//------------------------------------------------------------------------------------
+float3 DecodeOctahedral(float2 e)
+{
+	// Must match VertexCompression::DecodeOctahedral
+	float3 n = float3(e.x, e.y, 1.0f - abs(e.x) - abs(e.y));
+	float t = saturate(-n.z);
+	n.xy += n.xy >= 0.0f ? -t : t;
+	return normalize(n);
+}
+
+VS_OUTPUT VSCompressed(float4 PosQ : POSITION, float2 NormalOct : NORMAL, float2 Tex : TEXCOORD)
+{
+	// Positions are UNORM within the mesh's bounds, w is always 1
+	float4 Pos = float4(PosQ.xyz * PositionScale.xyz + PositionOffset.xyz, 1.0f);
+
+	return VS(Pos, DecodeOctahedral(NormalOct), Tex);
+}
+
+
+
 //--------------------------------------------------------------------------------------
 // Pixel Shader
 //--------------------------------------------------------------------------------------
@@ -1,7 +1,15 @@
 #include "GameObject.h"
 
+namespace
+{
+	//Used until SetLodPixelError says otherwise
+	const float DefaultLodPixelError = 1.0f;
+}
+
 GameObject::GameObject(void)
 {
+	_lod = 0;
+	_lodPixelError = DefaultLodPixelError;
 }
 
 GameObject::~GameObject(void)
@@ -10,12 +18,33 @@ GameObject::~GameObject(void)
 
 void GameObject::Initialise(MeshData meshData)
 {
-	_meshData = meshData;
-
 	XMStoreFloat4x4(&_world, XMMatrixIdentity());
 	XMStoreFloat4x4(&_scale, XMMatrixIdentity());
 	XMStoreFloat4x4(&_rotate, XMMatrixIdentity());
 	XMStoreFloat4x4(&_translate, XMMatrixIdentity());
+
+	SetMeshData(meshData);
+}
+
+void GameObject::SetMeshData(const MeshData& meshData)
+{
+	_meshData = meshData;
+	_worldBounds = Bounds::Transform(_meshData.Bounds, _world);
+
+	_visibleRanges.clear();
+	_culled = false;
+
+	//A mesh that didn't come with levels of detail is its own only level
+	if (_meshData.LodCount == 0)
+	{
+		_meshData.Lods[0].IndexStart = 0;
+		_meshData.Lods[0].IndexCount = _meshData.IndexCount;
+		_meshData.Lods[0].Error = 0.0f;
+		_meshData.Lods[0].Reserved = 0;
+		_meshData.LodCount = 1;
+	}
+
+	_lod = 0;
 }
 
 void GameObject::SetScale(float x, float y, float z)
@@ -40,6 +69,8 @@ void GameObject::UpdateWorld()
 	XMMATRIX translate = XMLoadFloat4x4(&_translate);
 
 	XMStoreFloat4x4(&_world, scale * rotate * translate);
+
+	_worldBounds = Bounds::Transform(_meshData.Bounds, _world);
 }
 
 void GameObject::Update(float elapsedTime)
@@ -47,13 +78,104 @@ void GameObject::Update(float elapsedTime)
 	UpdateWorld();
 }
 
+UINT GameObject::SelectLod(const XMFLOAT4X4& view, const XMFLOAT4X4& projection, float viewportHeight)
+{
+	if (_meshData.LodCount <= 1 || _lodPixelError <= 0.0f)
+	{
+		_lod = 0;
+		return _lod;
+	}
+
+	//The eye is the view space origin, which is the last row of the inverse
+	XMVECTOR determinant;
+	XMMATRIX viewToWorld = XMMatrixInverse(&determinant, XMLoadFloat4x4(&view));
+	XMVECTOR toCenter = XMVectorSubtract(XMLoadFloat3(&_worldBounds.Center), viewToWorld.r[3]);
+	float distance = XMVectorGetX(XMVector3Length(toCenter)) - _worldBounds.Radius;
+
+	//The errors are in mesh space. The world bounds' radius is the mesh's scaled by the largest axis scale, so the same ratio scales the errors
+	//conservatively. A length at this distance covers length * m[1][1] / distance of clip space's height of 2.
+	float worldScale = _meshData.Bounds.Radius > 0.0f ? _worldBounds.Radius / _meshData.Bounds.Radius : 1.0f;
+	float unitsToPixels = worldScale * projection.m[1][1] * viewportHeight * 0.5f;
+
+	_lod = MeshSimplifier::SelectLod(_meshData.Lods, _meshData.LodCount, _lod, distance, unitsToPixels, _lodPixelError);
+	return _lod;
+}
+
+UINT GameObject::Cull(const XMFLOAT4X4& view, const XMFLOAT4X4& projection, bool backfaceCull)
+{
+	if (!HasMesh())
+	{
+		_culled = false;
+		return 0;
+	}
+
+	const MeshLod& lod = _meshData.Lods[_lod];
+	const MeshCluster* clusters = _meshData.Clusters;
+	UINT numClusters = _meshData.ClusterCount;
+
+	//One cluster the size of the whole mesh, with a cone that never backface culls
+	MeshCluster wholeLod;
+
+	if (_lod > 0)
+	{
+		wholeLod.IndexStart = lod.IndexStart;
+		wholeLod.IndexCount = lod.IndexCount;
+		wholeLod.Center = _meshData.Bounds.Center;
+		wholeLod.Radius = _meshData.Bounds.Radius;
+		wholeLod.ConeAxis = XMFLOAT3(0.0f, 0.0f, 0.0f);
+		wholeLod.ConeCutoff = 0.0f;
+
+		clusters = &wholeLod;
+		numClusters = 1;
+	}
+
+	if (numClusters == 0)
+	{
+		_culled = false;
+		return lod.IndexCount / 3;
+	}
+
+	XMMATRIX world = XMLoadFloat4x4(&_world);
+	XMMATRIX worldView = world * XMLoadFloat4x4(&view);
+
+	XMFLOAT4X4 worldViewProjection;
+	XMStoreFloat4x4(&worldViewProjection, worldView * XMLoadFloat4x4(&projection));
+
+	//The clusters are in mesh space, so the camera is brought into mesh space rather than every cluster into world space.
+	//The eye is the view space origin, which is the last row of the inverse.
+	XMVECTOR determinant;
+	XMMATRIX viewToMesh = XMMatrixInverse(&determinant, worldView);
+	XMFLOAT3 cameraPosition;
+	XMStoreFloat3(&cameraPosition, viewToMesh.r[3]);
+
+	//A mirroring world matrix turns the mesh inside out as far as the rasterizer's culling goes
+	bool mirrored = XMVectorGetX(XMVector3Dot(XMVector3Cross(world.r[0], world.r[1]), world.r[2])) < 0.0f;
+
+	_culled = true;
+	return MeshClusters::Cull(clusters, numClusters, worldViewProjection, cameraPosition, backfaceCull && !mirrored, _visibleRanges) / 3;
+}
+
 void GameObject::Draw(ID3D11Device * pd3dDevice, ID3D11DeviceContext * pImmediateContext)
 {
 	// NOTE: We are assuming that the constant buffers and all other draw setup has already taken place
 
+	if (!HasMesh())
+	{
+		return;
+	}
+
 	// Set vertex and index buffers
 	pImmediateContext->IASetVertexBuffers(0, 1, &_meshData.VertexBuffer, &_meshData.VBStride, &_meshData.VBOffset);
-	pImmediateContext->IASetIndexBuffer(_meshData.IndexBuffer, DXGI_FORMAT_R16_UINT, 0);
+	pImmediateContext->IASetIndexBuffer(_meshData.IndexBuffer, _meshData.IndexFormat, 0);
 
-	pImmediateContext->DrawIndexed(_meshData.IndexCount, 0, 0);   
-}
\ No newline at end of file
+	if (!_culled)
+	{
+		pImmediateContext->DrawIndexed(_meshData.Lods[_lod].IndexCount, _meshData.Lods[_lod].IndexStart, 0);
+		return;
+	}
+
+	for (size_t i = 0; i < _visibleRanges.size(); ++i)
+	{
+		pImmediateContext->DrawIndexed(_visibleRanges[i].IndexCount, _visibleRanges[i].IndexStart, 0);
+	}
+}
@@ -5,6 +5,7 @@
 #include <d3dcompiler.h>
 #include <directxmath.h>
 #include <directxcolors.h>
+#include <vector>
 #include "Structures.h"
 
 class GameObject
@@ -13,6 +14,13 @@ private:
 	MeshData _meshData;
 
 	XMFLOAT4X4 _world;
+	MeshBounds _worldBounds;
+
+	std::vector<IndexRange> _visibleRanges;	//What survived the last Cull
+	bool _culled;							//Draw only draws _visibleRanges once Cull has run
+
+	UINT _lod;								//Which of _meshData.Lods Cull and Draw use, as picked by the last SelectLod
+	float _lodPixelError;
 
 	XMFLOAT4X4 _scale;
 	XMFLOAT4X4 _rotate;
@@ -23,6 +31,13 @@ public:
 	~GameObject(void);
 
 	XMFLOAT4X4 GetWorld() const { return _world; };
+	const MeshData& GetMeshData() const { return _meshData; };
+
+	//False until the object has been given a mesh, Cull and Draw do nothing until then
+	bool HasMesh() const { return _meshData.IndexBuffer != nullptr; };
+
+	//The mesh's bounds moved by the world matrix, as of the last UpdateWorld
+	const MeshBounds& GetWorldBounds() const { return _worldBounds; };
 
 	void UpdateWorld();
 
@@ -32,6 +47,25 @@ public:
 
 	void Initialise(MeshData meshData);
 	void Update(float elapsedTime);
+
+	//For a mesh that's still loading: Initialise with an empty MeshData, then SetMeshData once it's ready. Keeps the world transform.
+	void SetMeshData(const MeshData& meshData);
+
+	//Largest error, in pixels, a simplified level of detail is allowed to show. 0 always draws the full mesh.
+	void SetLodPixelError(float pixels) { _lodPixelError = pixels; };
+	UINT GetLod() const { return _lod; };
+
+	//Picks the coarsest level of detail whose error, projected from the nearest point of the world bounds, is within the pixel error.
+	//Levels only change once the error is a margin past that, so an object sitting at a switch distance doesn't flicker between two.
+	//Call it once a frame, after UpdateWorld and before Cull, with the frame's view and projection. Returns the level picked.
+	UINT SelectLod(const XMFLOAT4X4& view, const XMFLOAT4X4& projection, float viewportHeight);
+
+	//Culls the mesh's clusters against the camera, after which Draw only draws the clusters left. Call it once a frame, after UpdateWorld,
+	//with the same view and projection the frame is drawn with. Returns the number of triangles left to draw.
+	//Clusters only cover the full mesh, so a simplified level of detail is frustum culled as a whole on the mesh's bounds.
+	//backfaceCull says whether the rasterizer state it's drawn with culls back faces. Clusters facing away are only skipped when it does.
+	UINT Cull(const XMFLOAT4X4& view, const XMFLOAT4X4& projection, bool backfaceCull);
+
 	void Draw(ID3D11Device * pd3dDevice, ID3D11DeviceContext * pImmediateContext);
 };
 
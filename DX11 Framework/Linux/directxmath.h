@@ -0,0 +1,109 @@
+#pragma once
+
+//Just enough of DirectXMath for the headless sources (the mesh pipeline, DDSLayout and the asset cooker) to build where the real one isn't
+//installed. Plain C++ on four floats, which the compiler vectorises well enough for the cooker. The game itself always builds against the
+//Windows SDK's DirectXMath.
+
+#include <cmath>
+
+namespace DirectX
+{
+	const float XM_PI = 3.141592654f;
+	const float XM_PIDIV2 = 1.570796327f;
+
+	struct XMFLOAT2
+	{
+		float x, y;
+
+		XMFLOAT2() = default;
+		XMFLOAT2(float _x, float _y) : x(_x), y(_y) {}
+	};
+
+	struct XMFLOAT3
+	{
+		float x, y, z;
+
+		XMFLOAT3() = default;
+		XMFLOAT3(float _x, float _y, float _z) : x(_x), y(_y), z(_z) {}
+	};
+
+	struct XMFLOAT4
+	{
+		float x, y, z, w;
+
+		XMFLOAT4() = default;
+		XMFLOAT4(float _x, float _y, float _z, float _w) : x(_x), y(_y), z(_z), w(_w) {}
+	};
+
+	struct XMFLOAT4X4
+	{
+		float m[4][4];
+	};
+
+	struct alignas(16) XMVECTOR
+	{
+		float v[4];
+	};
+
+	struct XMMATRIX
+	{
+		XMVECTOR r[4];
+	};
+
+	inline XMVECTOR XMVectorSet(float x, float y, float z, float w) { XMVECTOR r = { { x, y, z, w } }; return r; }
+	inline XMVECTOR XMVectorReplicate(float s) { return XMVectorSet(s, s, s, s); }
+	inline XMVECTOR XMVectorZero() { return XMVectorReplicate(0.0f); }
+	inline XMVECTOR XMVectorSplatX(XMVECTOR a) { return XMVectorReplicate(a.v[0]); }
+	inline XMVECTOR XMVectorSplatY(XMVECTOR a) { return XMVectorReplicate(a.v[1]); }
+	inline XMVECTOR XMVectorSplatZ(XMVECTOR a) { return XMVectorReplicate(a.v[2]); }
+	inline float XMVectorGetX(XMVECTOR a) { return a.v[0]; }
+	inline float XMVectorGetY(XMVECTOR a) { return a.v[1]; }
+	inline float XMVectorGetZ(XMVECTOR a) { return a.v[2]; }
+
+	inline XMVECTOR XMVectorAdd(XMVECTOR a, XMVECTOR b) { XMVECTOR r; for (int i = 0; i < 4; ++i) r.v[i] = a.v[i] + b.v[i]; return r; }
+	inline XMVECTOR XMVectorSubtract(XMVECTOR a, XMVECTOR b) { XMVECTOR r; for (int i = 0; i < 4; ++i) r.v[i] = a.v[i] - b.v[i]; return r; }
+	inline XMVECTOR XMVectorMultiply(XMVECTOR a, XMVECTOR b) { XMVECTOR r; for (int i = 0; i < 4; ++i) r.v[i] = a.v[i] * b.v[i]; return r; }
+	inline XMVECTOR XMVectorMultiplyAdd(XMVECTOR a, XMVECTOR b, XMVECTOR c) { XMVECTOR r; for (int i = 0; i < 4; ++i) r.v[i] = a.v[i] * b.v[i] + c.v[i]; return r; }
+	inline XMVECTOR XMVectorScale(XMVECTOR a, float s) { XMVECTOR r; for (int i = 0; i < 4; ++i) r.v[i] = a.v[i] * s; return r; }
+	inline XMVECTOR XMVectorMin(XMVECTOR a, XMVECTOR b) { XMVECTOR r; for (int i = 0; i < 4; ++i) r.v[i] = a.v[i] < b.v[i] ? a.v[i] : b.v[i]; return r; }
+	inline XMVECTOR XMVectorMax(XMVECTOR a, XMVECTOR b) { XMVECTOR r; for (int i = 0; i < 4; ++i) r.v[i] = a.v[i] > b.v[i] ? a.v[i] : b.v[i]; return r; }
+	inline XMVECTOR XMVectorAbs(XMVECTOR a) { XMVECTOR r; for (int i = 0; i < 4; ++i) r.v[i] = std::fabs(a.v[i]); return r; }
+
+	//Comparisons give an all ones or all zeros lane, like the real ones, but kept as a float so Select can test it without bit casts.
+	inline XMVECTOR XMVectorLess(XMVECTOR a, XMVECTOR b) { XMVECTOR r; for (int i = 0; i < 4; ++i) r.v[i] = a.v[i] < b.v[i] ? 1.0f : 0.0f; return r; }
+	inline XMVECTOR XMVectorSelect(XMVECTOR a, XMVECTOR b, XMVECTOR control) { XMVECTOR r; for (int i = 0; i < 4; ++i) r.v[i] = control.v[i] != 0.0f ? b.v[i] : a.v[i]; return r; }
+
+	inline XMVECTOR XMVector3Dot(XMVECTOR a, XMVECTOR b) { return XMVectorReplicate(a.v[0] * b.v[0] + a.v[1] * b.v[1] + a.v[2] * b.v[2]); }
+	inline XMVECTOR XMVector3LengthSq(XMVECTOR a) { return XMVector3Dot(a, a); }
+	inline XMVECTOR XMVector3Length(XMVECTOR a) { return XMVectorReplicate(std::sqrt(XMVector3Dot(a, a).v[0])); }
+
+	inline XMVECTOR XMVector3Cross(XMVECTOR a, XMVECTOR b)
+	{
+		return XMVectorSet(a.v[1] * b.v[2] - a.v[2] * b.v[1], a.v[2] * b.v[0] - a.v[0] * b.v[2], a.v[0] * b.v[1] - a.v[1] * b.v[0], 0.0f);
+	}
+
+	inline XMVECTOR XMVector3Normalize(XMVECTOR a)
+	{
+		float length = XMVector3Length(a).v[0];
+		return length > 0.0f ? XMVectorScale(a, 1.0f / length) : XMVectorZero();
+	}
+
+	inline XMVECTOR XMVector3Transform(XMVECTOR a, XMMATRIX m)
+	{
+		XMVECTOR r;
+		for (int i = 0; i < 4; ++i) r.v[i] = a.v[0] * m.r[0].v[i] + a.v[1] * m.r[1].v[i] + a.v[2] * m.r[2].v[i] + m.r[3].v[i];
+		return r;
+	}
+
+	inline XMVECTOR XMLoadFloat3(const XMFLOAT3* p) { return XMVectorSet(p->x, p->y, p->z, 0.0f); }
+	inline XMVECTOR XMLoadFloat4(const XMFLOAT4* p) { return XMVectorSet(p->x, p->y, p->z, p->w); }
+	inline void XMStoreFloat3(XMFLOAT3* p, XMVECTOR a) { p->x = a.v[0]; p->y = a.v[1]; p->z = a.v[2]; }
+	inline void XMStoreFloat4(XMFLOAT4* p, XMVECTOR a) { p->x = a.v[0]; p->y = a.v[1]; p->z = a.v[2]; p->w = a.v[3]; }
+
+	inline XMMATRIX XMLoadFloat4x4(const XMFLOAT4X4* p)
+	{
+		XMMATRIX m;
+		for (int i = 0; i < 4; ++i) m.r[i] = XMVectorSet(p->m[i][0], p->m[i][1], p->m[i][2], p->m[i][3]);
+		return m;
+	}
+}
@@ -0,0 +1,180 @@
+#include "MappedFile.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <cstdlib>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile()
+{
+	_data = nullptr;
+	_size = 0;
+	_open = false;
+
+#ifdef _WIN32
+	_file = INVALID_HANDLE_VALUE;
+	_mapping = nullptr;
+#else
+	_file = -1;
+#endif
+}
+
+MappedFile::~MappedFile()
+{
+	Close();
+}
+
+#ifdef _WIN32
+
+bool MappedFile::Open(const char* filename)
+{
+	Close();
+
+	_file = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+
+	return Map();
+}
+
+bool MappedFile::Open(const wchar_t* filename)
+{
+	Close();
+
+	_file = CreateFileW(filename, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+
+	return Map();
+}
+
+bool MappedFile::Map()
+{
+	if (_file == INVALID_HANDLE_VALUE)
+	{
+		return false;
+	}
+
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(_file, &fileSize))
+	{
+		Close();
+		return false;
+	}
+
+	_size = (size_t)fileSize.QuadPart;
+	_open = true;
+
+	//Windows refuses to map an empty file, but an empty file is still a successfully opened one
+	if (_size == 0)
+	{
+		return true;
+	}
+
+	_mapping = CreateFileMappingA(_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+
+	if (!_mapping)
+	{
+		Close();
+		return false;
+	}
+
+	_data = (const char*)MapViewOfFile(_mapping, FILE_MAP_READ, 0, 0, 0);
+
+	if (!_data)
+	{
+		Close();
+		return false;
+	}
+
+	return true;
+}
+
+void MappedFile::Close()
+{
+	if (_data) UnmapViewOfFile(_data);
+	if (_mapping) CloseHandle(_mapping);
+	if (_file != INVALID_HANDLE_VALUE) CloseHandle(_file);
+
+	_data = nullptr;
+	_mapping = nullptr;
+	_file = INVALID_HANDLE_VALUE;
+	_size = 0;
+	_open = false;
+}
+
+#else
+
+bool MappedFile::Open(const char* filename)
+{
+	Close();
+
+	_file = open(filename, O_RDONLY);
+
+	if (_file < 0)
+	{
+		return false;
+	}
+
+	struct stat fileStat;
+	if (fstat(_file, &fileStat) != 0)
+	{
+		Close();
+		return false;
+	}
+
+	_size = (size_t)fileStat.st_size;
+	_open = true;
+
+	if (_size == 0)
+	{
+		return true;
+	}
+
+	void* mapping = mmap(nullptr, _size, PROT_READ, MAP_PRIVATE, _file, 0);
+
+	if (mapping == MAP_FAILED)
+	{
+		Close();
+		return false;
+	}
+
+	//We always read these front to back, so let the kernel read ahead aggressively
+	madvise(mapping, _size, MADV_SEQUENTIAL);
+
+	_data = (const char*)mapping;
+
+	return true;
+}
+
+bool MappedFile::Open(const wchar_t* filename)
+{
+	Close();
+
+	size_t length = wcstombs(nullptr, filename, 0);
+
+	if (length == (size_t)-1)
+	{
+		return false;
+	}
+
+	std::vector<char> narrow(length + 1);
+	wcstombs(narrow.data(), filename, narrow.size());
+
+	return Open(narrow.data());
+}
+
+void MappedFile::Close()
+{
+	if (_data) munmap((void*)_data, _size);
+	if (_file >= 0) close(_file);
+
+	_data = nullptr;
+	_file = -1;
+	_size = 0;
+	_open = false;
+}
+
+#endif
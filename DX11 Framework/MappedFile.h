@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstddef>
+
+//Read-only memory mapping of a whole file. Uses CreateFileMapping on Windows and mmap everywhere else,
+//so the loaders can parse straight out of the page cache without copying the file into a heap buffer first.
+class MappedFile
+{
+public:
+	MappedFile();
+	~MappedFile();
+
+	bool Open(const char* filename);
+	//Wide names go straight to the Windows API, elsewhere they're converted to the locale's multibyte encoding first
+	bool Open(const wchar_t* filename);
+	void Close();
+
+	const char* GetData() const { return _data; };
+	size_t GetSize() const { return _size; };
+	bool IsOpen() const { return _open; };
+
+private:
+	//Not copyable, the mapping is released in the destructor
+	MappedFile(const MappedFile&);
+	MappedFile& operator=(const MappedFile&);
+
+#ifdef _WIN32
+	//Sizes and maps _file once one of the Opens has opened it
+	bool Map();
+#endif
+
+	const char* _data;
+	size_t _size;
+	bool _open;
+
+#ifdef _WIN32
+	void* _file;
+	void* _mapping;
+#else
+	int _file;
+#endif
+};
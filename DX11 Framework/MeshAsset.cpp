@@ -0,0 +1,28 @@
+#include "MeshAsset.h"
+#include <cstring>
+
+MeshAsset::MeshAsset()
+{
+	Clear();
+}
+
+void MeshAsset::Clear()
+{
+	Format = VertexFormat_Full;
+	VertexStride = 0;
+	VertexCount = 0;
+	Vertices = nullptr;
+	IndexSize = 2;
+	IndexCount = 0;
+	Indices = nullptr;
+
+	memset(&Quantization, 0, sizeof(Quantization));
+	memset(&Bounds, 0, sizeof(Bounds));
+	Submeshes.clear();
+	Clusters.clear();
+	Lods.clear();
+
+	std::vector<char>().swap(VertexStorage);
+	std::vector<char>().swap(IndexStorage);
+	Cache.Close();
+}
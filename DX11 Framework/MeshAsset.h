@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "VertexFormats.h"
+#include "VertexCompression.h"
+#include "MeshCache.h"
+#include "Bounds.h"
+#include "MeshClusters.h"
+#include "MeshSimplifier.h"
+
+//A range of the index buffer that's drawn on its own
+struct MeshSubmesh
+{
+	uint32_t IndexStart;
+	uint32_t IndexCount;
+};
+
+//The CPU side result of loading a mesh -- everything needed to create its GPU buffers, and nothing that needs a device.
+//Vertices/Indices point either at VertexStorage/IndexStorage (freshly cooked) or into the mapped cache file (loaded from the cache),
+//so uploading a cached mesh still doesn't copy it. Keep the asset alive until it has been uploaded.
+struct MeshAsset
+{
+	MeshAsset();
+
+	//Frees the data and unmaps the cache, leaving an empty mesh
+	void Clear();
+
+	VertexFormat Format;
+	uint32_t VertexStride;
+	uint32_t VertexCount;
+	const void* Vertices;
+
+	uint32_t IndexSize;			//2 or 4 bytes
+	uint32_t IndexCount;		//Every level of detail, one after the other
+	const void* Indices;
+
+	VertexCompression::PositionQuantization Quantization;	//Only used by VertexFormat_Compressed
+	MeshBounds Bounds;			//Mesh space
+	std::vector<MeshSubmesh> Submeshes;
+	std::vector<MeshCluster> Clusters;	//Cover LOD 0 between them
+	std::vector<MeshLod> Lods;			//LOD 0 is the full mesh, at the start of the index buffer
+
+	std::vector<char> VertexStorage;
+	std::vector<char> IndexStorage;
+	MeshCacheFile Cache;
+
+private:
+	//Not copyable, Vertices/Indices may point into this object's own storage or mapping
+	MeshAsset(const MeshAsset&);
+	MeshAsset& operator=(const MeshAsset&);
+};
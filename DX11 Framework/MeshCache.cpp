@@ -0,0 +1,302 @@
+#include "MeshCache.h"
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <string>
+
+namespace
+{
+	inline uint64_t RotateLeft(uint64_t value, int shift)
+	{
+		return (value << shift) | (value >> (64 - shift));
+	}
+
+	inline uint64_t Mix(uint64_t value)
+	{
+		value ^= value >> 33;
+		value *= 0xFF51AFD7ED558CCDULL;
+		value ^= value >> 33;
+		value *= 0xC4CEB9FE1A85EC53ULL;
+		value ^= value >> 33;
+		return value;
+	}
+
+	inline uint64_t AlignUp(uint64_t value, uint64_t alignment)
+	{
+		return (value + alignment - 1) & ~(alignment - 1);
+	}
+
+	//Aggregates of constants, so they're written into the binary already initialised rather than built on first use. VS2013 doesn't make
+	//function local statics thread safe, and these are looked up from every loader thread.
+	const MeshCache::VertexLayout SimpleLayout =
+	{
+		32, 3,
+		{
+			{ MeshCache::Semantic_Position, MeshCache::Format_Float3, 0 },
+			{ MeshCache::Semantic_Normal, MeshCache::Format_Float3, 12 },
+			{ MeshCache::Semantic_TexCoord, MeshCache::Format_Float2, 24 },
+		}
+	};
+
+	const MeshCache::VertexLayout CompressedLayout =
+	{
+		16, 3,
+		{
+			{ MeshCache::Semantic_Position, MeshCache::Format_UNorm16x4, 0 },
+			{ MeshCache::Semantic_Normal, MeshCache::Format_OctSNorm16x2, 8 },
+			{ MeshCache::Semantic_TexCoord, MeshCache::Format_Half2, 12 },
+		}
+	};
+}
+
+const MeshCache::VertexLayout& MeshCache::SimpleVertexLayout()
+{
+	return SimpleLayout;
+}
+
+const MeshCache::VertexLayout& MeshCache::CompressedVertexLayout()
+{
+	return CompressedLayout;
+}
+
+bool MeshCache::LayoutsMatch(const VertexLayout& a, const VertexLayout& b)
+{
+	if (a.Stride != b.Stride || a.NumAttributes != b.NumAttributes || a.NumAttributes > MaxAttributes)
+	{
+		return false;
+	}
+
+	return memcmp(a.Attributes, b.Attributes, sizeof(VertexAttribute) * a.NumAttributes) == 0;
+}
+
+uint64_t MeshCache::HashBytes(const void* data, size_t size, uint64_t seed)
+{
+	//Four independent lanes of 8 bytes each so the multiplies can overlap, then folded together at the end
+	const unsigned char* bytes = (const unsigned char*)data;
+	const uint64_t prime1 = 0x9E3779B185EBCA87ULL;
+	const uint64_t prime2 = 0xC2B2AE3D27D4EB4FULL;
+
+	uint64_t lanes[4] = { seed + prime1, seed ^ prime2, seed + 0x165667B19E3779F9ULL, seed - prime1 };
+
+	size_t offset = 0;
+	for (; offset + 32 <= size; offset += 32)
+	{
+		for (int lane = 0; lane < 4; ++lane)
+		{
+			uint64_t word;
+			memcpy(&word, bytes + offset + lane * 8, sizeof(word));
+			lanes[lane] = RotateLeft(lanes[lane] + word * prime2, 31) * prime1;
+		}
+	}
+
+	uint64_t hash = RotateLeft(lanes[0], 1) + RotateLeft(lanes[1], 7) + RotateLeft(lanes[2], 12) + RotateLeft(lanes[3], 18);
+	hash ^= (uint64_t)size * prime1;
+
+	for (; offset < size; ++offset)
+	{
+		hash = RotateLeft(hash ^ (bytes[offset] * prime1), 11) * prime2;
+	}
+
+	return Mix(hash);
+}
+
+uint64_t MeshCache::HashSource(const void* data, size_t size, bool invertTexCoords, bool compressVertices)
+{
+	//Bump this whenever the cooking steps change, so old caches get rebuilt even though the source didn't change
+	const uint64_t cookVersion = 8;
+
+	return HashBytes(data, size, cookVersion * 4 + (invertTexCoords ? 1 : 0) + (compressVertices ? 2 : 0));
+}
+
+const char* MeshCache::CacheSuffix(bool invertTexCoords, bool compressVertices)
+{
+	if (invertTexCoords)
+	{
+		return compressVertices ? ".qmesh" : ".mesh";
+	}
+
+	return compressVertices ? ".noinvert.qmesh" : ".noinvert.mesh";
+}
+
+bool WriteMeshCache(const char* filename, const MeshCacheHeader& header, const std::vector<MeshCacheSection>& sections)
+{
+	MeshCacheHeader fileHeader = header;
+	fileHeader.Magic = MeshCache::Magic;
+	fileHeader.Version = MeshCache::Version;
+	fileHeader.HeaderSize = sizeof(MeshCacheHeader);
+	fileHeader.NumSections = (uint32_t)sections.size();
+
+	//Lay the sections out after the header and section table, each one aligned
+	std::vector<MeshCacheSectionEntry> entries(sections.size());
+	uint64_t offset = sizeof(MeshCacheHeader) + sizeof(MeshCacheSectionEntry) * sections.size();
+
+	for (size_t i = 0; i < sections.size(); ++i)
+	{
+		offset = AlignUp(offset, MeshCache::SectionAlignment);
+
+		entries[i].Type = sections[i].Type;
+		entries[i].Reserved = 0;
+		entries[i].Offset = offset;
+		entries[i].Size = sections[i].Size;
+
+		offset += sections[i].Size;
+	}
+
+	fileHeader.FileSize = offset;
+
+	std::string tempFilename = filename;
+	tempFilename.append(".tmp");
+
+	std::ofstream outbin(tempFilename.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+
+	if (!outbin.good())
+	{
+		return false;
+	}
+
+	outbin.write((const char*)&fileHeader, sizeof(fileHeader));
+	if (!entries.empty())
+	{
+		outbin.write((const char*)entries.data(), sizeof(MeshCacheSectionEntry) * entries.size());
+	}
+
+	const char padding[MeshCache::SectionAlignment] = {};
+	uint64_t written = sizeof(MeshCacheHeader) + sizeof(MeshCacheSectionEntry) * sections.size();
+
+	for (size_t i = 0; i < sections.size(); ++i)
+	{
+		outbin.write(padding, entries[i].Offset - written);
+		outbin.write((const char*)sections[i].Data, sections[i].Size);
+		written = entries[i].Offset + sections[i].Size;
+	}
+
+	outbin.close();
+
+	if (outbin.fail())
+	{
+		remove(tempFilename.c_str());
+		return false;
+	}
+
+	//rename won't replace an existing file on Windows
+	remove(filename);
+	return rename(tempFilename.c_str(), filename) == 0;
+}
+
+MeshCacheFile::MeshCacheFile()
+{
+	_data = nullptr;
+	_header = nullptr;
+	_sections = nullptr;
+}
+
+void MeshCacheFile::Close()
+{
+	_file.Close();
+	_data = nullptr;
+	_header = nullptr;
+	_sections = nullptr;
+}
+
+bool MeshCacheFile::Open(const char* filename, const MeshCache::VertexLayout& expectedLayout, bool checkSource, uint64_t expectedSourceHash)
+{
+	Close();
+
+	if (!_file.Open(filename))
+	{
+		return false;
+	}
+
+	return Validate(_file.GetData(), _file.GetSize(), expectedLayout, checkSource, expectedSourceHash);
+}
+
+bool MeshCacheFile::OpenMemory(const void* data, size_t size, const MeshCache::VertexLayout& expectedLayout)
+{
+	Close();
+
+	//Nothing to check the source hash against, whoever put the cache in memory vouches for it
+	return Validate((const char*)data, size, expectedLayout, false, 0);
+}
+
+bool MeshCacheFile::Validate(const char* data, size_t size, const MeshCache::VertexLayout& expectedLayout, bool checkSource, uint64_t expectedSourceHash)
+{
+	//The sections are only aligned if the cache itself is
+	if (!data || size < sizeof(MeshCacheHeader) || (uintptr_t)data % MeshCache::SectionAlignment != 0)
+	{
+		Close();
+		return false;
+	}
+
+	const MeshCacheHeader* header = (const MeshCacheHeader*)data;
+	uint64_t fileSize = size;
+
+	bool valid = header->Magic == MeshCache::Magic
+		&& header->Version == MeshCache::Version
+		&& header->HeaderSize == sizeof(MeshCacheHeader)
+		&& header->FileSize == fileSize
+		&& (header->IndexSize == 2 || header->IndexSize == 4)
+		&& MeshCache::LayoutsMatch(header->Layout, expectedLayout)
+		&& (!checkSource || header->SourceHash == expectedSourceHash)
+		&& sizeof(MeshCacheHeader) + sizeof(MeshCacheSectionEntry) * (uint64_t)header->NumSections <= fileSize;
+
+	if (!valid)
+	{
+		Close();
+		return false;
+	}
+
+	const MeshCacheSectionEntry* sections = (const MeshCacheSectionEntry*)(data + sizeof(MeshCacheHeader));
+
+	for (uint32_t i = 0; i < header->NumSections; ++i)
+	{
+		const MeshCacheSectionEntry& section = sections[i];
+
+		if (section.Offset % MeshCache::SectionAlignment != 0 || section.Offset > fileSize || section.Size > fileSize - section.Offset)
+		{
+			Close();
+			return false;
+		}
+	}
+
+	_data = data;
+	_header = header;
+	_sections = sections;
+
+	//Vertices and indices are required, either raw and agreeing with the counts in the header or encoded. Encoded streams are checked as
+	//they're decoded, since their size says nothing about what they hold.
+	uint64_t vertexBytes = 0;
+	uint64_t indexBytes = 0;
+	uint64_t encodedBytes = 0;
+
+	bool vertices = GetSection(MeshCache::Section_Vertices, &vertexBytes) ? vertexBytes == (uint64_t)header->VertexCount * header->Layout.Stride :
+		GetSection(MeshCache::Section_EncodedVertices, &encodedBytes) && encodedBytes != 0;
+	bool indices = GetSection(MeshCache::Section_Indices, &indexBytes) ? indexBytes == (uint64_t)header->IndexCount * header->IndexSize :
+		GetSection(MeshCache::Section_EncodedIndices, &encodedBytes) && encodedBytes != 0;
+
+	if (!vertices || !indices)
+	{
+		Close();
+		return false;
+	}
+
+	return true;
+}
+
+const void* MeshCacheFile::GetSection(uint32_t type, uint64_t* size) const
+{
+	if (!_header)
+	{
+		return nullptr;
+	}
+
+	for (uint32_t i = 0; i < _header->NumSections; ++i)
+	{
+		if (_sections[i].Type == type)
+		{
+			if (size) *size = _sections[i].Size;
+			return _data + _sections[i].Offset;
+		}
+	}
+
+	return nullptr;
+}
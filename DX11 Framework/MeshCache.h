@@ -0,0 +1,155 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+#include "MappedFile.h"
+
+//On-disk container for a cooked mesh, written next to the source file as "<file>.mesh" (or "<file>.qmesh" for compressed vertices, and with
+//".noinvert" before either for texture coordinates left as the OBJ has them, see CacheSuffix).
+//
+//Layout: a fixed MeshCacheHeader, then a table of MeshCacheSectionEntry, then the sections themselves.
+//Every section starts on a MeshCache::SectionAlignment boundary, so once the file is memory mapped
+//the vertex and index sections can be handed straight to CreateBuffer without copying.
+//The vertices and indices may instead be stored MeshCodec encoded, which costs a decode on load for a much smaller file. Caches are raw
+//unless the cook asks for encoding: decoding takes longer than reading the raw streams from a warm file cache, so it only pays off when
+//the disk or the download is the bottleneck.
+namespace MeshCache
+{
+	const uint32_t Magic = 0x4853454D; //"MESH"
+	const uint32_t Version = 1;
+	const uint32_t SectionAlignment = 64;
+	const uint32_t MaxAttributes = 8;
+
+	enum SectionType
+	{
+		Section_Vertices = 1,
+		Section_Indices = 2,
+		Section_Quantization = 3,	//VertexCompression::PositionQuantization, only present for compressed vertices
+		Section_Bounds = 4,			//MeshBounds, in mesh space
+		Section_Clusters = 5,		//Array of MeshCluster, in index buffer order, covering LOD 0
+		Section_Lods = 6,			//Array of MeshLod, the full mesh first
+		Section_EncodedVertices = 7,	//MeshCodec::EncodeVertices output, in place of Section_Vertices
+		Section_EncodedIndices = 8,		//MeshCodec::EncodeIndices output, in place of Section_Indices
+	};
+
+	enum HeaderFlags
+	{
+		Flag_EncodedStreams = 1,	//Cooked asking for encoded streams. Each stream is only encoded if that makes it smaller, so check the sections.
+	};
+
+	enum AttributeSemantic
+	{
+		Semantic_Position = 1,
+		Semantic_Normal = 2,
+		Semantic_TexCoord = 3,
+	};
+
+	enum AttributeFormat
+	{
+		Format_Float2 = 1,
+		Format_Float3 = 2,
+		Format_UNorm16x4 = 3,
+		Format_OctSNorm16x2 = 4,	//Octahedral encoded unit vector
+		Format_Half2 = 5,
+	};
+
+	struct VertexAttribute
+	{
+		uint32_t Semantic;
+		uint32_t Format;
+		uint32_t Offset;
+	};
+
+	//Describes how the vertices in Section_Vertices are laid out, so a cache written for a different vertex struct gets rejected
+	struct VertexLayout
+	{
+		uint32_t Stride;
+		uint32_t NumAttributes;
+		VertexAttribute Attributes[MaxAttributes];
+	};
+
+	//Layout of SimpleVertex as the loader writes it
+	const VertexLayout& SimpleVertexLayout();
+
+	//Layout of CompressedVertex
+	const VertexLayout& CompressedVertexLayout();
+
+	bool LayoutsMatch(const VertexLayout& a, const VertexLayout& b);
+
+	//64 bit content hash, used to tell whether a cache is stale
+	uint64_t HashBytes(const void* data, size_t size, uint64_t seed = 0);
+
+	//Hash of the source file plus anything about how it was loaded that changes the cooked result
+	uint64_t HashSource(const void* data, size_t size, bool invertTexCoords, bool compressVertices);
+
+	//What's appended to the source's name for its cache, and its name in a pack. Every combination of options gets its own, so loading a mesh
+	//with different options keeps both cooks rather than each one rewriting the other's.
+	const char* CacheSuffix(bool invertTexCoords, bool compressVertices);
+};
+
+struct MeshCacheHeader
+{
+	uint32_t Magic;
+	uint32_t Version;
+	uint32_t HeaderSize;		//sizeof(MeshCacheHeader), catches a header written by a different build
+	uint32_t NumSections;
+	uint64_t FileSize;			//Catches truncated files
+	uint64_t SourceHash;
+	uint64_t SourceSize;
+	uint32_t VertexCount;
+	uint32_t IndexCount;
+	uint32_t IndexSize;			//2 or 4 bytes
+	uint32_t Flags;				//MeshCache::HeaderFlags
+	MeshCache::VertexLayout Layout;
+};
+
+struct MeshCacheSectionEntry
+{
+	uint32_t Type;
+	uint32_t Reserved;
+	uint64_t Offset;
+	uint64_t Size;
+};
+
+//A section to be written, the data is copied into the file as-is
+struct MeshCacheSection
+{
+	uint32_t Type;
+	const void* Data;
+	uint64_t Size;
+};
+
+//Writes a cache file. Header.Magic/Version/HeaderSize/NumSections/FileSize are filled in here.
+//The file is written under a temporary name and renamed into place, so a crash never leaves a half written cache behind.
+bool WriteMeshCache(const char* filename, const MeshCacheHeader& header, const std::vector<MeshCacheSection>& sections);
+
+//A memory mapped, validated cache file. Section pointers stay valid until the MeshCacheFile is closed or destroyed.
+class MeshCacheFile
+{
+public:
+	MeshCacheFile();
+
+	//Fails if the file is missing, truncated, from another version, has a different vertex layout, or (when checkSource is set)
+	//was cooked from a source with a different hash
+	bool Open(const char* filename, const MeshCache::VertexLayout& expectedLayout, bool checkSource, uint64_t expectedSourceHash);
+
+	//Uses a cache that's already in memory, such as one inside an AssetPack, without copying it. data has to be SectionAlignment aligned
+	//and stay valid until the MeshCacheFile is closed. The same checks as Open apply apart from the source hash.
+	bool OpenMemory(const void* data, size_t size, const MeshCache::VertexLayout& expectedLayout);
+	void Close();
+
+	const MeshCacheHeader& GetHeader() const { return *_header; };
+
+	//Returns nullptr if the section isn't in the file
+	const void* GetSection(uint32_t type, uint64_t* size = nullptr) const;
+
+private:
+	bool Validate(const char* data, size_t size, const MeshCache::VertexLayout& expectedLayout, bool checkSource, uint64_t expectedSourceHash);
+
+	MappedFile _file;			//Only open when the cache came from Open
+	const char* _data;
+	const MeshCacheHeader* _header;
+	const MeshCacheSectionEntry* _sections;
+};
@@ -0,0 +1,155 @@
+#include "MeshClusters.h"
+#include "Bounds.h"
+#include <cmath>
+
+MeshCluster MeshClusters::ComputeCluster(const unsigned int* indices, uint32_t indexStart, uint32_t indexCount, const XMFLOAT3* firstPosition, size_t stride)
+{
+	const char* positions = (const char*)firstPosition;
+	const unsigned int* clusterIndices = indices + indexStart;
+
+	//Shared corners get gathered more than once, which makes no difference to the bounds
+	std::vector<XMFLOAT3> corners(indexCount);
+	for (uint32_t i = 0; i < indexCount; ++i)
+	{
+		corners[i] = *(const XMFLOAT3*)(positions + clusterIndices[i] * stride);
+	}
+
+	MeshBounds bounds = Bounds::Compute(indexCount > 0 ? &corners[0] : nullptr, indexCount, sizeof(XMFLOAT3));
+
+	MeshCluster cluster;
+	cluster.IndexStart = indexStart;
+	cluster.IndexCount = indexCount;
+	cluster.Center = bounds.Center;
+	cluster.Radius = bounds.Radius;
+
+	//Every triangle gets the same say in the axis however big it is, the cone has to cover the small ones just the same
+	std::vector<XMVECTOR> normals;
+	normals.reserve(indexCount / 3);
+	XMVECTOR axis = XMVectorZero();
+
+	for (uint32_t i = 0; i + 3 <= indexCount; i += 3)
+	{
+		XMVECTOR p0 = XMLoadFloat3(&corners[i]);
+		XMVECTOR p1 = XMLoadFloat3(&corners[i + 1]);
+		XMVECTOR p2 = XMLoadFloat3(&corners[i + 2]);
+		XMVECTOR normal = XMVector3Cross(XMVectorSubtract(p1, p0), XMVectorSubtract(p2, p0));
+
+		//Zero area triangles never get drawn, so they don't get a say in the cone
+		float length = XMVectorGetX(XMVector3Length(normal));
+		if (length <= 0.0f)
+		{
+			continue;
+		}
+
+		normal = XMVectorScale(normal, 1.0f / length);
+		normals.push_back(normal);
+		axis = XMVectorAdd(axis, normal);
+	}
+
+	float axisLength = XMVectorGetX(XMVector3Length(axis));
+	float cutoff = 0.0f;
+
+	if (axisLength > 0.0f)
+	{
+		axis = XMVectorScale(axis, 1.0f / axisLength);
+		cutoff = 1.0f;
+
+		for (size_t i = 0; i < normals.size(); ++i)
+		{
+			cutoff = fminf(cutoff, XMVectorGetX(XMVector3Dot(axis, normals[i])));
+		}
+	}
+
+	XMStoreFloat3(&cluster.ConeAxis, axis);
+	cluster.ConeCutoff = cutoff;
+
+	return cluster;
+}
+
+uint32_t MeshClusters::Cull(const MeshCluster* clusters, size_t numClusters, const XMFLOAT4X4& worldViewProjection, const XMFLOAT3& cameraPosition,
+	bool backfaceCull, std::vector<IndexRange>& visibleRanges)
+{
+	visibleRanges.clear();
+
+	//Frustum planes straight out of the combined matrix (Gribb and Hartmann), in mesh space, facing inwards.
+	//With row vectors clip.x is the dot of the position with column 0 and so on, and D3D clips z to 0..w.
+	const float (&m)[4][4] = worldViewProjection.m;
+	float planes[6][4];
+
+	for (int j = 0; j < 4; ++j)
+	{
+		planes[0][j] = m[j][3] + m[j][0];	//Left
+		planes[1][j] = m[j][3] - m[j][0];	//Right
+		planes[2][j] = m[j][3] + m[j][1];	//Bottom
+		planes[3][j] = m[j][3] - m[j][1];	//Top
+		planes[4][j] = m[j][2];				//Near
+		planes[5][j] = m[j][3] - m[j][2];	//Far
+	}
+
+	//Normalize so the plane equation gives a distance to compare the radius against
+	for (int p = 0; p < 6; ++p)
+	{
+		float length = sqrtf(planes[p][0] * planes[p][0] + planes[p][1] * planes[p][1] + planes[p][2] * planes[p][2]);
+		float scale = length > 0.0f ? 1.0f / length : 0.0f;
+
+		for (int j = 0; j < 4; ++j)
+		{
+			planes[p][j] *= scale;
+		}
+	}
+
+	uint32_t visibleIndices = 0;
+
+	for (size_t c = 0; c < numClusters; ++c)
+	{
+		const MeshCluster& cluster = clusters[c];
+		const XMFLOAT3& center = cluster.Center;
+
+		bool outside = false;
+
+		for (int p = 0; p < 6 && !outside; ++p)
+		{
+			outside = planes[p][0] * center.x + planes[p][1] * center.y + planes[p][2] * center.z + planes[p][3] < -cluster.Radius;
+		}
+
+		if (outside)
+		{
+			continue;
+		}
+
+		//Backfacing if the whole sphere sits inside the cone of view directions that hit every triangle from behind.
+		//That cone opens around the axis by 90 degrees minus the normal cone's angle, and the sphere is inside it when its centre
+		//is at least a radius from the cone's surface.
+		if (backfaceCull && cluster.ConeCutoff > 0.0f)
+		{
+			float dx = center.x - cameraPosition.x;
+			float dy = center.y - cameraPosition.y;
+			float dz = center.z - cameraPosition.z;
+
+			float along = dx * cluster.ConeAxis.x + dy * cluster.ConeAxis.y + dz * cluster.ConeAxis.z;
+			float across = sqrtf(fmaxf(dx * dx + dy * dy + dz * dz - along * along, 0.0f));
+			float cutoffSin = sqrtf(fmaxf(1.0f - cluster.ConeCutoff * cluster.ConeCutoff, 0.0f));
+
+			if (along > 0.0f && cluster.ConeCutoff * along - cutoffSin * across > cluster.Radius)
+			{
+				continue;
+			}
+		}
+
+		uint32_t previousEnd = visibleRanges.empty() ? 0 : visibleRanges.back().IndexStart + visibleRanges.back().IndexCount;
+
+		if (!visibleRanges.empty() && cluster.IndexStart - previousEnd <= MergeGapIndices)
+		{
+			visibleIndices += cluster.IndexStart + cluster.IndexCount - previousEnd;
+			visibleRanges.back().IndexCount = cluster.IndexStart + cluster.IndexCount - visibleRanges.back().IndexStart;
+		}
+		else
+		{
+			IndexRange range = { cluster.IndexStart, cluster.IndexCount };
+			visibleRanges.push_back(range);
+			visibleIndices += cluster.IndexCount;
+		}
+	}
+
+	return visibleIndices;
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <directxmath.h>
+
+using namespace DirectX;
+
+//A small patch of neighbouring triangles, contiguous in the index buffer, with just enough bounds to cull it on its own.
+//Everything is in mesh space.
+struct MeshCluster
+{
+	uint32_t IndexStart;
+	uint32_t IndexCount;
+
+	XMFLOAT3 Center;		//Bounding sphere of the cluster's vertices
+	float Radius;
+
+	XMFLOAT3 ConeAxis;		//Normal cone: the average facing of the triangles...
+	float ConeCutoff;		//...and the cosine of the widest angle between it and any one triangle's facing. <= 0 means the cone is too wide to ever backface cull.
+};
+
+//A run of the index buffer to draw
+struct IndexRange
+{
+	uint32_t IndexStart;
+	uint32_t IndexCount;
+};
+
+namespace MeshClusters
+{
+	//Culled runs of the index buffer up to this long get drawn anyway rather than splitting the draw in two -- a few dozen
+	//triangles the rasterizer throws away cost less than another DrawIndexed does on the CPU
+	const uint32_t MergeGapIndices = 96;
+
+	//Sphere and normal cone of the triangles in indices[indexStart .. indexStart + indexCount), reading positions the same way Bounds::Compute does.
+	//Triangle facing is cross(p1 - p0, p2 - p0), which points at the camera for the triangles D3D draws with the default clockwise front face.
+	MeshCluster ComputeCluster(const unsigned int* indices, uint32_t indexStart, uint32_t indexCount, const XMFLOAT3* firstPosition, size_t stride);
+
+	//Frustum and backface cone test for each cluster. worldViewProjection takes mesh space to clip space (row vectors, as the shaders get them),
+	//cameraPosition is the eye in mesh space. Pass backfaceCull = false if the world matrix mirrors the mesh, as that flips which side is the back,
+	//or if the rasterizer state doesn't cull back faces, as they're drawn then.
+	//Visible clusters that follow each other in the index buffer, or are only MergeGapIndices or fewer apart, are merged into one range.
+	//Returns the number of indices left to draw.
+	uint32_t Cull(const MeshCluster* clusters, size_t numClusters, const XMFLOAT4X4& worldViewProjection, const XMFLOAT3& cameraPosition,
+		bool backfaceCull, std::vector<IndexRange>& visibleRanges);
+};
@@ -0,0 +1,638 @@
+#include "MeshCodec.h"
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+	const size_t MinMatch = 4;
+	const size_t MaxOffset = 65535;
+	const unsigned int HashBits = 16;
+
+	const size_t MaxStride = 64;
+
+	//A 16 entry ring, but edge 15 in a triangle code means no shared edge, so only the 15 most recent are ever referred to
+	const unsigned int EdgeFifoMask = 15;
+	const uint8_t NoEdge = 15;
+	const uint8_t ThirdIsNext = 0x80;
+
+	const unsigned int Next3[3] = { 1, 2, 0 };
+	const unsigned int Prev3[3] = { 2, 0, 1 };
+
+	inline uint32_t Read32(const uint8_t* data)
+	{
+		uint32_t value;
+		memcpy(&value, data, sizeof(value));
+		return value;
+	}
+
+	inline uint32_t HashSequence(uint32_t sequence)
+	{
+		return (sequence * 2654435761u) >> (32 - HashBits);
+	}
+
+	//Lengths that don't fit in a token nibble carry on in bytes of 255 and a final byte below 255
+	void WriteLength(std::vector<uint8_t>& out, size_t length)
+	{
+		while (length >= 255)
+		{
+			out.push_back(255);
+			length -= 255;
+		}
+
+		out.push_back((uint8_t)length);
+	}
+
+	bool ReadLength(const uint8_t*& in, const uint8_t* end, size_t& length)
+	{
+		for (;;)
+		{
+			if (in == end)
+			{
+				return false;
+			}
+
+			uint8_t byte = *in++;
+			length += byte;
+
+			if (byte != 255)
+			{
+				return true;
+			}
+		}
+	}
+
+	//matchLength 0 is the last sequence, literals only
+	void WriteSequence(std::vector<uint8_t>& out, const uint8_t* literals, size_t literalCount, size_t offset, size_t matchLength)
+	{
+		size_t matchCode = matchLength ? matchLength - MinMatch : 0;
+		out.push_back((uint8_t)((std::min(literalCount, (size_t)15) << 4) | std::min(matchCode, (size_t)15)));
+
+		if (literalCount >= 15)
+		{
+			WriteLength(out, literalCount - 15);
+		}
+
+		out.insert(out.end(), literals, literals + literalCount);
+
+		if (matchLength)
+		{
+			out.push_back((uint8_t)(offset & 0xFF));
+			out.push_back((uint8_t)(offset >> 8));
+
+			if (matchCode >= 15)
+			{
+				WriteLength(out, matchCode - 15);
+			}
+		}
+	}
+
+	inline uint32_t ZigZag(int32_t delta)
+	{
+		return ((uint32_t)delta << 1) ^ (uint32_t)(delta >> 31);
+	}
+
+	inline int32_t UnZigZag(uint32_t value)
+	{
+		return (int32_t)(value >> 1) ^ -(int32_t)(value & 1);
+	}
+
+	void WriteVarint(std::vector<uint8_t>& out, uint64_t value)
+	{
+		while (value >= 0x80)
+		{
+			out.push_back((uint8_t)(value | 0x80));
+			value >>= 7;
+		}
+
+		out.push_back((uint8_t)value);
+	}
+
+	//Codes are at most 33 bits, so at most 5 bytes
+	bool ReadVarint(const uint8_t*& in, const uint8_t* end, uint64_t& value)
+	{
+		value = 0;
+
+		for (unsigned int shift = 0; shift < 35; shift += 7)
+		{
+			if (in == end)
+			{
+				return false;
+			}
+
+			uint8_t byte = *in++;
+			value |= (uint64_t)(byte & 0x7F) << shift;
+
+			if (!(byte & 0x80))
+			{
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+	struct EdgeFifo
+	{
+		uint32_t A[EdgeFifoMask + 1];
+		uint32_t B[EdgeFifoMask + 1];
+		unsigned int Head;
+
+		EdgeFifo()
+		{
+			memset(A, 0xFF, sizeof(A));
+			memset(B, 0xFF, sizeof(B));
+			Head = 0;
+		}
+
+		void Push(uint32_t a, uint32_t b)
+		{
+			A[Head] = a;
+			B[Head] = b;
+			Head = (Head + 1) & EdgeFifoMask;
+		}
+
+		//Position 0 is the last edge pushed
+		unsigned int Slot(unsigned int position) const
+		{
+			return (Head - 1 - position) & EdgeFifoMask;
+		}
+	};
+
+	//The neighbours of a triangle see its edges the other way round. (x, y, z) is the triangle starting from its shared edge, if it has one.
+	inline void PushEdges(EdgeFifo& fifo, uint32_t x, uint32_t y, uint32_t z, bool sharedEdge)
+	{
+		if (!sharedEdge)
+		{
+			fifo.Push(y, x);
+		}
+
+		fifo.Push(z, y);
+		fifo.Push(x, z);
+	}
+
+	inline uint32_t ReadIndex(const void* indices, size_t indexSize, size_t i)
+	{
+		return indexSize == 2 ? ((const uint16_t*)indices)[i] : ((const uint32_t*)indices)[i];
+	}
+
+	inline void WriteIndex(void* indices, size_t indexSize, size_t i, uint32_t index)
+	{
+		if (indexSize == 2)
+		{
+			((uint16_t*)indices)[i] = (uint16_t)index;
+		}
+		else
+		{
+			((uint32_t*)indices)[i] = index;
+		}
+	}
+
+	//A vertex on its own: 0 for the next unused vertex, otherwise 1 + the zigzagged delta from the last vertex, mod 2^32 so any pair works
+	void EncodeVertex(std::vector<uint8_t>& out, uint32_t index, uint32_t& next, uint32_t& last)
+	{
+		if (index == next)
+		{
+			out.push_back(0);
+		}
+		else
+		{
+			WriteVarint(out, (uint64_t)ZigZag((int32_t)(index - last)) + 1);
+		}
+
+		next = std::max(next, index + 1);
+		last = index;
+	}
+
+	bool DecodeVertex(const uint8_t*& in, const uint8_t* end, uint32_t& index, uint32_t& next, uint32_t& last)
+	{
+		uint64_t code;
+
+		//Nearly every code fits in one byte
+		if (in < end && *in < 0x80)
+		{
+			code = *in++;
+		}
+		else if (!ReadVarint(in, end, code) || code > 0x100000000ULL)
+		{
+			return false;
+		}
+
+		index = code == 0 ? next : last + (uint32_t)UnZigZag((uint32_t)(code - 1));
+		next = std::max(next, index + 1);
+		last = index;
+
+		return true;
+	}
+}
+
+void MeshCodec::Compress(const uint8_t* data, size_t size, std::vector<uint8_t>& compressed)
+{
+	compressed.clear();
+	compressed.reserve(size / 2 + 16);
+
+	std::vector<uint32_t> table((size_t)1 << HashBits, 0);
+	size_t anchor = 0;
+	size_t position = 0;
+
+	while (position + MinMatch <= size)
+	{
+		uint32_t sequence = Read32(data + position);
+		uint32_t& slot = table[HashSequence(sequence)];
+		size_t candidate = slot;
+		slot = (uint32_t)position;
+
+		if (candidate < position && position - candidate <= MaxOffset && Read32(data + candidate) == sequence)
+		{
+			size_t length = MinMatch;
+			while (position + length < size && data[candidate + length] == data[position + length])
+			{
+				length++;
+			}
+
+			WriteSequence(compressed, data + anchor, position - anchor, position - candidate, length);
+			position += length;
+			anchor = position;
+		}
+		else
+		{
+			//Step further the longer it's been since a match, so incompressible stretches don't cost a hash lookup per byte
+			position += 1 + ((position - anchor) >> 6);
+		}
+	}
+
+	WriteSequence(compressed, data + anchor, size - anchor, 0, 0);
+}
+
+bool MeshCodec::Decompress(const uint8_t* compressed, size_t compressedSize, uint8_t* data, size_t size)
+{
+	//An empty stream (a section with no vertices or indices) is the one empty literal run Compress writes, and data may well be null
+	if (size == 0)
+	{
+		return compressedSize == 1 && compressed[0] == 0;
+	}
+
+	const uint8_t* in = compressed;
+	const uint8_t* inEnd = compressed + compressedSize;
+	uint8_t* out = data;
+	uint8_t* outEnd = data + size;
+
+	while (in < inEnd)
+	{
+		uint8_t token = *in++;
+		size_t literals = token >> 4;
+
+		//Short literal runs are copied 16 bytes at a time when there's room on both sides, the extra bytes get overwritten
+		if (literals < 15 && inEnd - in >= 16 && outEnd - out >= 16)
+		{
+			memcpy(out, in, 16);
+		}
+		else
+		{
+			if (literals == 15 && !ReadLength(in, inEnd, literals))
+			{
+				return false;
+			}
+
+			if (literals > (size_t)(inEnd - in) || literals > (size_t)(outEnd - out))
+			{
+				return false;
+			}
+
+			memcpy(out, in, literals);
+		}
+
+		in += literals;
+		out += literals;
+
+		//The last sequence has no match
+		if (in == inEnd)
+		{
+			break;
+		}
+
+		if (inEnd - in < 2)
+		{
+			return false;
+		}
+
+		size_t offset = in[0] | ((size_t)in[1] << 8);
+		in += 2;
+
+		size_t length = token & 15;
+		if (length == 15 && !ReadLength(in, inEnd, length))
+		{
+			return false;
+		}
+
+		length += MinMatch;
+
+		if (offset == 0 || offset > (size_t)(out - data) || length > (size_t)(outEnd - out))
+		{
+			return false;
+		}
+
+		const uint8_t* match = out - offset;
+
+		//Chunks no bigger than the offset never read bytes this match is still writing. They can overshoot the match by up to a chunk,
+		//which is fine with room to spare, the next sequence overwrites it.
+		if (offset >= 16 && (size_t)(outEnd - out) >= length + 16)
+		{
+			for (size_t copied = 0; copied < length; copied += 16)
+			{
+				memcpy(out + copied, match + copied, 16);
+			}
+		}
+		else if (offset >= 8 && (size_t)(outEnd - out) >= length + 8)
+		{
+			for (size_t copied = 0; copied < length; copied += 8)
+			{
+				memcpy(out + copied, match + copied, 8);
+			}
+		}
+		else if (offset == 1)
+		{
+			//Runs of one byte, mostly the zeros in the delta planes
+			memset(out, *match, length);
+		}
+		else
+		{
+			for (size_t i = 0; i < length; ++i)
+			{
+				out[i] = match[i];
+			}
+		}
+
+		out += length;
+	}
+
+	return out == outEnd;
+}
+
+void MeshCodec::EncodeVertices(const void* vertices, size_t vertexCount, size_t vertexStride, std::vector<uint8_t>& encoded)
+{
+	const uint8_t* in = (const uint8_t*)vertices;
+	std::vector<uint8_t> planes(vertexCount * vertexStride);
+	uint8_t previous[MaxStride] = {};
+
+	for (size_t blockStart = 0; blockStart < vertexCount; blockStart += BlockVertices)
+	{
+		size_t blockCount = std::min(BlockVertices, vertexCount - blockStart);
+		uint8_t* block = planes.data() + blockStart * vertexStride;
+
+		for (size_t b = 0; b < vertexStride; ++b)
+		{
+			for (size_t v = 0; v < blockCount; ++v)
+			{
+				uint8_t byte = in[(blockStart + v) * vertexStride + b];
+				block[b * blockCount + v] = (uint8_t)(byte - previous[b]);
+				previous[b] = byte;
+			}
+		}
+	}
+
+	Compress(planes.data(), planes.size(), encoded);
+}
+
+bool MeshCodec::CanHoldVertices(size_t encodedSize, uint64_t vertexCount, size_t vertexStride)
+{
+	return vertexStride > 0 && vertexStride <= MaxStride && vertexCount * vertexStride <= (uint64_t)encodedSize * MaxExpansion;
+}
+
+bool MeshCodec::CanHoldIndices(size_t encodedSize, uint64_t indexCount)
+{
+	//Every triangle, and every index after the last whole one, takes at least a byte of codes
+	return encodedSize >= sizeof(uint32_t) && indexCount <= (uint64_t)(encodedSize - sizeof(uint32_t)) * MaxExpansion * 3;
+}
+
+bool MeshCodec::DecodeVertices(const void* encoded, size_t encodedSize, void* vertices, size_t vertexCount, size_t vertexStride)
+{
+	if (vertexStride == 0 || vertexStride > MaxStride)
+	{
+		return false;
+	}
+
+	//The planes are the same size as the vertices, so they're decompressed in place and each block is put back together from a copy
+	uint8_t* out = (uint8_t*)vertices;
+	if (!Decompress((const uint8_t*)encoded, encodedSize, out, vertexCount * vertexStride))
+	{
+		return false;
+	}
+
+	std::vector<uint8_t> planes(std::min(vertexCount, BlockVertices) * vertexStride);
+	uint8_t previous[MaxStride] = {};
+
+	for (size_t blockStart = 0; blockStart < vertexCount; blockStart += BlockVertices)
+	{
+		size_t blockCount = std::min(BlockVertices, vertexCount - blockStart);
+		uint8_t* block = out + blockStart * vertexStride;
+		memcpy(planes.data(), block, blockCount * vertexStride);
+
+		for (size_t b = 0; b < vertexStride; ++b)
+		{
+			const uint8_t* plane = planes.data() + b * blockCount;
+			uint8_t value = previous[b];
+
+			for (size_t v = 0; v < blockCount; ++v)
+			{
+				value = (uint8_t)(value + plane[v]);
+				block[v * vertexStride + b] = value;
+			}
+
+			previous[b] = value;
+		}
+	}
+
+	return true;
+}
+
+void MeshCodec::EncodeIndices(const void* indices, size_t indexCount, size_t indexSize, std::vector<uint8_t>& encoded)
+{
+	std::vector<uint8_t> codes;
+	codes.reserve(indexCount / 2);
+
+	EdgeFifo fifo;
+	uint32_t next = 0;
+	uint32_t last = 0;
+	size_t triangleIndices = indexCount - indexCount % 3;
+
+	for (size_t i = 0; i < triangleIndices; i += 3)
+	{
+		uint32_t triangle[3] = { ReadIndex(indices, indexSize, i), ReadIndex(indices, indexSize, i + 1), ReadIndex(indices, indexSize, i + 2) };
+
+		unsigned int edge = NoEdge;
+		unsigned int rotation = 0;
+
+		for (unsigned int p = 0; p < NoEdge && edge == NoEdge; ++p)
+		{
+			unsigned int slot = fifo.Slot(p);
+
+			for (unsigned int r = 0; r < 3; ++r)
+			{
+				if (fifo.A[slot] == triangle[r] && fifo.B[slot] == triangle[Next3[r]])
+				{
+					edge = p;
+					rotation = r;
+					break;
+				}
+			}
+		}
+
+		uint32_t x = triangle[rotation];
+		uint32_t y = triangle[Next3[rotation]];
+		uint32_t z = triangle[Prev3[rotation]];
+
+		if (edge == NoEdge && x == next && y == next + 1 && z == next + 2)
+		{
+			//A triangle of three new vertices, all a mesh with unwelded faces has
+			codes.push_back(NoEdge | ThirdIsNext);
+			next += 3;
+			last = z;
+		}
+		else if (edge == NoEdge)
+		{
+			codes.push_back(NoEdge);
+			EncodeVertex(codes, x, next, last);
+			EncodeVertex(codes, y, next, last);
+			EncodeVertex(codes, z, next, last);
+		}
+		else if (z == next)
+		{
+			codes.push_back((uint8_t)(edge | (rotation << 4) | ThirdIsNext));
+			next++;
+			last = z;
+		}
+		else
+		{
+			codes.push_back((uint8_t)(edge | (rotation << 4)));
+			EncodeVertex(codes, z, next, last);
+		}
+
+		PushEdges(fifo, x, y, z, edge != NoEdge);
+	}
+
+	for (size_t i = triangleIndices; i < indexCount; ++i)
+	{
+		EncodeVertex(codes, ReadIndex(indices, indexSize, i), next, last);
+	}
+
+	//The decoder needs the size of the triangle codes before it can decompress them
+	std::vector<uint8_t> compressed;
+	Compress(codes.data(), codes.size(), compressed);
+
+	uint32_t codesSize = (uint32_t)codes.size();
+	encoded.resize(sizeof(codesSize));
+	memcpy(encoded.data(), &codesSize, sizeof(codesSize));
+	encoded.insert(encoded.end(), compressed.begin(), compressed.end());
+}
+
+bool MeshCodec::DecodeIndices(const void* encoded, size_t encodedSize, void* indices, size_t indexCount, size_t indexSize)
+{
+	uint32_t codesSize;
+	if ((indexSize != 2 && indexSize != 4) || encodedSize < sizeof(codesSize))
+	{
+		return false;
+	}
+
+	memcpy(&codesSize, encoded, sizeof(codesSize));
+
+	//No index takes more than 6 bytes, anything bigger is a corrupt size rather than a big mesh
+	if (codesSize > (uint64_t)indexCount * 6)
+	{
+		return false;
+	}
+
+	std::vector<uint8_t> codes(codesSize);
+	if (!Decompress((const uint8_t*)encoded + sizeof(codesSize), encodedSize - sizeof(codesSize), codes.data(), codes.size()))
+	{
+		return false;
+	}
+
+	const uint8_t* in = codes.data();
+	const uint8_t* end = codes.data() + codes.size();
+	uint32_t largest = indexSize == 2 ? 0xFFFF : 0xFFFFFFFF;
+
+	EdgeFifo fifo;
+	uint32_t next = 0;
+	uint32_t last = 0;
+	size_t triangleIndices = indexCount - indexCount % 3;
+
+	for (size_t i = 0; i < triangleIndices; i += 3)
+	{
+		if (in == end)
+		{
+			return false;
+		}
+
+		uint8_t code = *in++;
+		unsigned int edge = code & 15;
+		unsigned int rotation = (code >> 4) & 7;
+		uint32_t x, y, z;
+
+		if (code == (NoEdge | ThirdIsNext))
+		{
+			x = next;
+			y = next + 1;
+			z = next + 2;
+			next += 3;
+			last = z;
+		}
+		else if (edge == NoEdge)
+		{
+			if (code != NoEdge || !DecodeVertex(in, end, x, next, last) || !DecodeVertex(in, end, y, next, last) || !DecodeVertex(in, end, z, next, last))
+			{
+				return false;
+			}
+		}
+		else
+		{
+			if (rotation > 2)
+			{
+				return false;
+			}
+
+			unsigned int slot = fifo.Slot(edge);
+			x = fifo.A[slot];
+			y = fifo.B[slot];
+
+			if (code & ThirdIsNext)
+			{
+				z = next++;
+				last = z;
+			}
+			else if (!DecodeVertex(in, end, z, next, last))
+			{
+				return false;
+			}
+		}
+
+		if (x > largest || y > largest || z > largest)
+		{
+			return false;
+		}
+
+		PushEdges(fifo, x, y, z, edge != NoEdge);
+
+		//Undo the rotation, so the triangle starts where it did
+		uint32_t triangle[3];
+		triangle[rotation] = x;
+		triangle[Next3[rotation]] = y;
+		triangle[Prev3[rotation]] = z;
+
+		WriteIndex(indices, indexSize, i, triangle[0]);
+		WriteIndex(indices, indexSize, i + 1, triangle[1]);
+		WriteIndex(indices, indexSize, i + 2, triangle[2]);
+	}
+
+	for (size_t i = triangleIndices; i < indexCount; ++i)
+	{
+		uint32_t index;
+		if (!DecodeVertex(in, end, index, next, last) || index > largest)
+		{
+			return false;
+		}
+
+		WriteIndex(indices, indexSize, i, index);
+	}
+
+	return in == end;
+}
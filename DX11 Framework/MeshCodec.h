@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+//Lossless compression for the vertex and index streams in the mesh caches, so a cache is roughly half the size on disk and decoding it
+//costs less than reading the raw bytes from a hard disk or SATA SSD would have.
+//
+//Each stream is first filtered into something more repetitive, then packed with a small LZ77 coder in LZ4's block layout (a token of
+//literal and match length nibbles, the literals, a 16 bit offset), which decodes as little more than a series of copies.
+//
+//Vertices: each block of BlockVertices is split into byte planes (byte 0 of every vertex in the block, then byte 1 ...) and every byte is
+//delta coded against the same byte of the previous vertex. Neighbouring vertices are close after the vertex cache reorder, so the sign,
+//exponent and high mantissa planes turn into long runs of zeros. Blocks keep the planes short enough to be put back together in the L1 cache.
+//
+//Indices: triangle by triangle. Most triangles share an edge with one of the last few, so a triangle is usually one byte: which edge in a
+//FIFO of recent edges, which way round the triangle starts from it, and whether the third vertex is the next one not yet used (most are,
+//once the vertices are in first use order) or follows as a varint delta. A triangle of three new vertices is one byte too. Every triangle
+//keeps its original rotation, so the decoded buffer is byte for byte what was encoded. The LZ stage then picks up whole runs of triangles
+//that repeat, like the levels of detail.
+//
+//The decoders check their input as they go and fail rather than write out of bounds, since the data comes from a file.
+namespace MeshCodec
+{
+	const size_t BlockVertices = 256;
+
+	//Decompress never writes more than this many bytes for each byte it reads (each 255 in a length adds 255 more), so the counts a cache
+	//claims can be checked against the size of its encoded sections before anything is allocated for them
+	const size_t MaxExpansion = 256;
+
+	//False if encodedSize bytes can't possibly decode to that many vertices or indices, which means the counts are corrupt
+	bool CanHoldVertices(size_t encodedSize, uint64_t vertexCount, size_t vertexStride);
+	bool CanHoldIndices(size_t encodedSize, uint64_t indexCount);
+
+	void EncodeVertices(const void* vertices, size_t vertexCount, size_t vertexStride, std::vector<uint8_t>& encoded);
+	bool DecodeVertices(const void* encoded, size_t encodedSize, void* vertices, size_t vertexCount, size_t vertexStride);
+
+	//indexSize is 2 or 4 bytes. Any count works, indices after the last whole triangle are stored on their own.
+	void EncodeIndices(const void* indices, size_t indexCount, size_t indexSize, std::vector<uint8_t>& encoded);
+	bool DecodeIndices(const void* encoded, size_t encodedSize, void* indices, size_t indexCount, size_t indexSize);
+
+	//The LZ stage on its own. Decompress fails unless the data decompresses to exactly size bytes.
+	void Compress(const uint8_t* data, size_t size, std::vector<uint8_t>& compressed);
+	bool Decompress(const uint8_t* compressed, size_t compressedSize, uint8_t* data, size_t size);
+};
@@ -0,0 +1,522 @@
+#include "MeshOptimizer.h"
+#include <cstring>
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+	//Triangle lists per vertex, stored flat (compressed sparse row) so building it is two passes and no per-vertex allocations
+	struct VertexAdjacency
+	{
+		std::vector<unsigned int> Offsets;		//Triangles of vertex v are Triangles[Offsets[v]] .. Triangles[Offsets[v + 1] - 1]
+		std::vector<unsigned int> Triangles;
+	};
+
+	void BuildAdjacency(const std::vector<unsigned int>& indices, unsigned int numVertices, VertexAdjacency& adjacency)
+	{
+		adjacency.Offsets.assign(numVertices + 1, 0);
+
+		for (size_t i = 0; i < indices.size(); ++i)
+		{
+			adjacency.Offsets[indices[i] + 1]++;
+		}
+
+		for (unsigned int v = 0; v < numVertices; ++v)
+		{
+			adjacency.Offsets[v + 1] += adjacency.Offsets[v];
+		}
+
+		adjacency.Triangles.resize(indices.size());
+		std::vector<unsigned int> fill(adjacency.Offsets.begin(), adjacency.Offsets.end() - 1);
+
+		for (size_t i = 0; i < indices.size(); ++i)
+		{
+			adjacency.Triangles[fill[indices[i]]++] = (unsigned int)(i / 3);
+		}
+	}
+
+	//Maps every vertex to the first vertex with exactly the same position, and gives back the index buffer rewritten to use those.
+	//Sorting a list of vertex numbers by position keeps it to one allocation, no hash table needed.
+	void WeldPositions(const std::vector<unsigned int>& indices, unsigned int numVertices, const char* positions, size_t stride, std::vector<unsigned int>& positionIndices)
+	{
+		std::vector<unsigned int> order(numVertices);
+		for (unsigned int v = 0; v < numVertices; ++v)
+		{
+			order[v] = v;
+		}
+
+		//Comparing the bytes rather than the floats keeps the order strict even with NaNs about
+		std::sort(order.begin(), order.end(), [positions, stride](unsigned int a, unsigned int b)
+		{
+			int compare = memcmp(positions + a * stride, positions + b * stride, sizeof(XMFLOAT3));
+			return compare < 0 || (compare == 0 && a < b);
+		});
+
+		std::vector<unsigned int> canonical(numVertices);
+		for (unsigned int i = 0; i < numVertices; ++i)
+		{
+			bool samePosition = i > 0 && memcmp(positions + order[i] * stride, positions + order[i - 1] * stride, sizeof(XMFLOAT3)) == 0;
+			canonical[order[i]] = samePosition ? canonical[order[i - 1]] : order[i];
+		}
+
+		positionIndices.resize(indices.size());
+		for (size_t i = 0; i < indices.size(); ++i)
+		{
+			positionIndices[i] = canonical[indices[i]];
+		}
+	}
+
+	//Sort key for a cluster's facing: which cube face its cone axis points through, then a 4x4 grid cell on that face in Z order, so clusters
+	//facing nearly the same way get nearby keys. Clusters whose cone is too wide to ever be backface culled all go at the end.
+	unsigned int FacingKey(const MeshCluster& cluster)
+	{
+		if (cluster.ConeCutoff <= 0.0f)
+		{
+			return 6 * 16;
+		}
+
+		const XMFLOAT3& axis = cluster.ConeAxis;
+		float x = fabsf(axis.x), y = fabsf(axis.y), z = fabsf(axis.z);
+		unsigned int face;
+		float u, v;
+
+		if (x >= y && x >= z)
+		{
+			face = axis.x >= 0.0f ? 0 : 1;
+			u = axis.y / x;
+			v = axis.z / x;
+		}
+		else if (y >= z)
+		{
+			face = axis.y >= 0.0f ? 2 : 3;
+			u = axis.x / y;
+			v = axis.z / y;
+		}
+		else
+		{
+			face = axis.z >= 0.0f ? 4 : 5;
+			u = axis.x / z;
+			v = axis.y / z;
+		}
+
+		//-1..1 on the face to a 0..3 cell, then interleave the bits
+		unsigned int cellU = std::min((unsigned int)((u + 1.0f) * 2.0f), 3u);
+		unsigned int cellV = std::min((unsigned int)((v + 1.0f) * 2.0f), 3u);
+		unsigned int cell = (cellU & 1) | ((cellV & 1) << 1) | ((cellU & 2) << 1) | ((cellV & 2) << 2);
+
+		return face * 16 + cell;
+	}
+}
+
+void MeshOptimizer::OptimizeVertexCache(std::vector<unsigned int>& indices, unsigned int numVertices, unsigned int cacheSize)
+{
+	unsigned int numTriangles = indices.size() / 3;
+
+	if (numTriangles == 0 || numVertices == 0)
+	{
+		return;
+	}
+
+	VertexAdjacency adjacency;
+	BuildAdjacency(indices, numVertices, adjacency);
+
+	//Number of triangles each vertex is in that haven't been emitted yet
+	std::vector<unsigned int> liveTriangles(numVertices);
+	for (unsigned int v = 0; v < numVertices; ++v)
+	{
+		liveTriangles[v] = adjacency.Offsets[v + 1] - adjacency.Offsets[v];
+	}
+
+	std::vector<unsigned int> cacheTime(numVertices, 0);	//When each vertex last entered the (simulated) cache
+	std::vector<bool> emitted(numTriangles, false);
+	std::vector<unsigned int> deadEnds;						//Recently used vertices, to restart from when we get stuck
+	std::vector<unsigned int> candidates;
+
+	std::vector<unsigned int> output;
+	output.reserve(indices.size());
+
+	unsigned int timeStamp = cacheSize + 1;
+	unsigned int cursor = 0;
+	int fanVertex = 0;
+
+	while (fanVertex >= 0)
+	{
+		candidates.clear();
+
+		//Emit every remaining triangle around the current fanning vertex
+		for (unsigned int a = adjacency.Offsets[fanVertex]; a < adjacency.Offsets[fanVertex + 1]; ++a)
+		{
+			unsigned int triangle = adjacency.Triangles[a];
+
+			if (emitted[triangle])
+			{
+				continue;
+			}
+
+			for (int corner = 0; corner < 3; ++corner)
+			{
+				unsigned int v = indices[triangle * 3 + corner];
+
+				output.push_back(v);
+				deadEnds.push_back(v);
+				candidates.push_back(v);
+				liveTriangles[v]--;
+
+				if (timeStamp - cacheTime[v] > cacheSize)
+				{
+					cacheTime[v] = timeStamp++;
+				}
+			}
+
+			emitted[triangle] = true;
+		}
+
+		//Next fanning vertex: the candidate that will still be in the cache after its remaining triangles are emitted, preferring the oldest
+		int bestVertex = -1;
+		int bestPriority = -1;
+
+		for (size_t c = 0; c < candidates.size(); ++c)
+		{
+			unsigned int v = candidates[c];
+
+			if (liveTriangles[v] > 0)
+			{
+				int priority = 0;
+
+				if (timeStamp - cacheTime[v] + 2 * liveTriangles[v] <= cacheSize)
+				{
+					priority = timeStamp - cacheTime[v];
+				}
+
+				if (priority > bestPriority)
+				{
+					bestPriority = priority;
+					bestVertex = v;
+				}
+			}
+		}
+
+		//Dead end -- go back through recently used vertices, then fall back to scanning for anything with triangles left
+		while (bestVertex < 0 && !deadEnds.empty())
+		{
+			unsigned int v = deadEnds.back();
+			deadEnds.pop_back();
+
+			if (liveTriangles[v] > 0)
+			{
+				bestVertex = v;
+			}
+		}
+
+		while (bestVertex < 0 && cursor < numVertices)
+		{
+			if (liveTriangles[cursor] > 0)
+			{
+				bestVertex = cursor;
+			}
+
+			++cursor;
+		}
+
+		fanVertex = bestVertex;
+	}
+
+	indices.swap(output);
+}
+
+unsigned int MeshOptimizer::OptimizeVertexFetch(void* vertices, unsigned int numVertices, unsigned int vertexStride, std::vector<unsigned int>& indices)
+{
+	const unsigned int Unused = 0xFFFFFFFF;
+
+	std::vector<unsigned int> remap(numVertices, Unused);
+	unsigned int nextVertex = 0;
+
+	for (size_t i = 0; i < indices.size(); ++i)
+	{
+		unsigned int& newIndex = remap[indices[i]];
+
+		if (newIndex == Unused)
+		{
+			newIndex = nextVertex++;
+		}
+
+		indices[i] = newIndex;
+	}
+
+	std::vector<char> reordered((size_t)nextVertex * vertexStride);
+	const char* source = (const char*)vertices;
+
+	for (unsigned int v = 0; v < numVertices; ++v)
+	{
+		if (remap[v] != Unused)
+		{
+			memcpy(&reordered[(size_t)remap[v] * vertexStride], source + (size_t)v * vertexStride, vertexStride);
+		}
+	}
+
+	if (nextVertex > 0)
+	{
+		memcpy(vertices, reordered.data(), reordered.size());
+	}
+
+	return nextVertex;
+}
+
+void MeshOptimizer::BuildClusters(std::vector<unsigned int>& indices, unsigned int numVertices, const XMFLOAT3* firstPosition, size_t stride, std::vector<MeshCluster>& clusters,
+	unsigned int maxVertices, unsigned int maxTriangles)
+{
+	clusters.clear();
+
+	unsigned int numTriangles = indices.size() / 3;
+
+	if (numTriangles == 0 || numVertices == 0)
+	{
+		return;
+	}
+
+	const unsigned int None = 0xFFFFFFFF;
+	const float MinFacing = 0.7f;		//About 45 degrees
+	const char* positions = (const char*)firstPosition;
+
+	//Neighbours are found through shared positions rather than shared vertices, otherwise a faceted mesh
+	//(where every corner has its own normal) has no neighbours at all and every triangle ends up a cluster of its own
+	std::vector<unsigned int> positionIndices;
+	WeldPositions(indices, numVertices, positions, stride, positionIndices);
+
+	VertexAdjacency adjacency;
+	BuildAdjacency(positionIndices, numVertices, adjacency);
+
+	std::vector<XMFLOAT3> centroids(numTriangles);
+	std::vector<XMFLOAT3> normals(numTriangles);
+
+	for (unsigned int t = 0; t < numTriangles; ++t)
+	{
+		XMVECTOR p0 = XMLoadFloat3((const XMFLOAT3*)(positions + indices[t * 3] * stride));
+		XMVECTOR p1 = XMLoadFloat3((const XMFLOAT3*)(positions + indices[t * 3 + 1] * stride));
+		XMVECTOR p2 = XMLoadFloat3((const XMFLOAT3*)(positions + indices[t * 3 + 2] * stride));
+
+		XMStoreFloat3(&centroids[t], XMVectorScale(XMVectorAdd(XMVectorAdd(p0, p1), p2), 1.0f / 3.0f));
+		XMStoreFloat3(&normals[t], XMVector3Normalize(XMVector3Cross(XMVectorSubtract(p1, p0), XMVectorSubtract(p2, p0))));
+	}
+
+	//Stamped with the number of the cluster being built, so nothing needs clearing between clusters
+	std::vector<unsigned int> vertexCluster(numVertices, None);			//Position is already in the cluster
+	std::vector<unsigned int> candidateCluster(numTriangles, None);		//Triangle is next to the cluster, and newPositions is up to date for it
+	std::vector<unsigned char> newPositions(numTriangles, 0);			//Corners of a candidate that aren't in the cluster yet
+	std::vector<bool> emitted(numTriangles, false);
+
+	//Candidates bucketed by how many new positions they'd add. Every triangle next to the cluster shares at least one position with it, so 0-2.
+	//Entries go stale when a triangle is emitted or moves to a lower bucket, and get dropped the next time the bucket is scanned.
+	std::vector<unsigned int> buckets[3];
+
+	std::vector<unsigned int> clusterTriangles;
+	std::vector<IndexRange> ranges;
+
+	std::vector<unsigned int> output;
+	output.reserve(indices.size());
+
+	//Seeding in the existing triangle order means each cluster starts about where the last one finished
+	for (unsigned int seed = 0; seed < numTriangles; ++seed)
+	{
+		if (emitted[seed])
+		{
+			continue;
+		}
+
+		unsigned int clusterId = ranges.size();
+		unsigned int clusterVertices = 0;
+		XMVECTOR centroidSum = XMVectorZero();
+		XMVECTOR normalSum = XMVectorZero();
+
+		clusterTriangles.clear();
+		for (int b = 0; b < 3; ++b)
+		{
+			buckets[b].clear();
+		}
+
+		unsigned int triangle = seed;
+
+		while (true)
+		{
+			emitted[triangle] = true;
+			clusterTriangles.push_back(triangle);
+			centroidSum = XMVectorAdd(centroidSum, XMLoadFloat3(&centroids[triangle]));
+			normalSum = XMVectorAdd(normalSum, XMLoadFloat3(&normals[triangle]));
+
+			for (int corner = 0; corner < 3; ++corner)
+			{
+				unsigned int v = positionIndices[triangle * 3 + corner];
+
+				if (vertexCluster[v] == clusterId)
+				{
+					continue;
+				}
+
+				vertexCluster[v] = clusterId;
+				clusterVertices++;
+
+				//Everything around the new position either just became a candidate or needs one fewer new position than it did
+				for (unsigned int a = adjacency.Offsets[v]; a < adjacency.Offsets[v + 1]; ++a)
+				{
+					unsigned int neighbour = adjacency.Triangles[a];
+
+					if (emitted[neighbour])
+					{
+						continue;
+					}
+
+					unsigned int count = 0;
+					for (int c = 0; c < 3; ++c)
+					{
+						count += vertexCluster[positionIndices[neighbour * 3 + c]] != clusterId ? 1 : 0;
+					}
+
+					if (candidateCluster[neighbour] != clusterId || newPositions[neighbour] != count)
+					{
+						candidateCluster[neighbour] = clusterId;
+						newPositions[neighbour] = (unsigned char)count;
+						buckets[count].push_back(neighbour);
+					}
+				}
+			}
+
+			if (clusterTriangles.size() >= maxTriangles)
+			{
+				break;
+			}
+
+			//Fewest new positions wins, then whichever is nearest the middle of the cluster so far
+			XMVECTOR center = XMVectorScale(centroidSum, 1.0f / clusterTriangles.size());
+			XMVECTOR axis = XMVector3Normalize(normalSum);
+			bool checkFacing = XMVectorGetX(XMVector3LengthSq(normalSum)) > 0.0f;
+			unsigned int best = None;
+
+			for (unsigned int b = 0; b < 3 && best == None && clusterVertices + b <= maxVertices; ++b)
+			{
+				std::vector<unsigned int>& bucket = buckets[b];
+				float bestDistance = 0.0f;
+				size_t kept = 0;
+
+				for (size_t c = 0; c < bucket.size(); ++c)
+				{
+					unsigned int candidate = bucket[c];
+
+					if (emitted[candidate] || newPositions[candidate] != b)
+					{
+						continue;
+					}
+
+					bucket[kept++] = candidate;
+
+					//Triangles facing well away from the rest would widen the normal cone until the cluster can never be backface culled.
+					//This is also what stops thin parts (wings, fins) clustering their top and bottom together through the shared edge.
+					//Zero area triangles have no facing, so they can go anywhere.
+					XMVECTOR normal = XMLoadFloat3(&normals[candidate]);
+					if (checkFacing && XMVectorGetX(XMVector3LengthSq(normal)) > 0.0f && XMVectorGetX(XMVector3Dot(normal, axis)) < MinFacing)
+					{
+						continue;
+					}
+
+					float distance = XMVectorGetX(XMVector3LengthSq(XMVectorSubtract(XMLoadFloat3(&centroids[candidate]), center)));
+
+					if (best == None || distance < bestDistance)
+					{
+						best = candidate;
+						bestDistance = distance;
+					}
+				}
+
+				bucket.resize(kept);
+			}
+
+			//Full, or nothing connected is left
+			if (best == None)
+			{
+				break;
+			}
+
+			triangle = best;
+		}
+
+		std::sort(clusterTriangles.begin(), clusterTriangles.end());
+
+		IndexRange range = { (uint32_t)output.size(), (uint32_t)clusterTriangles.size() * 3 };
+		ranges.push_back(range);
+
+		for (size_t t = 0; t < clusterTriangles.size(); ++t)
+		{
+			output.push_back(indices[clusterTriangles[t] * 3]);
+			output.push_back(indices[clusterTriangles[t] * 3 + 1]);
+			output.push_back(indices[clusterTriangles[t] * 3 + 2]);
+		}
+	}
+
+	std::vector<MeshCluster> built(ranges.size());
+	std::vector<unsigned int> order(ranges.size());
+
+	for (size_t c = 0; c < ranges.size(); ++c)
+	{
+		built[c] = MeshClusters::ComputeCluster(output.data(), ranges[c].IndexStart, ranges[c].IndexCount, firstPosition, stride);
+		order[c] = c;
+	}
+
+	//Clusters facing the same way get backface culled together, so grouping them by facing keeps what's left after culling in a few long runs
+	//of the index buffer (and so a few draws) rather than hundreds of short ones. Within a group they stay in the order they were built.
+	std::stable_sort(order.begin(), order.end(), [&built](unsigned int a, unsigned int b)
+	{
+		return FacingKey(built[a]) < FacingKey(built[b]);
+	});
+
+	indices.clear();
+	clusters.resize(built.size());
+
+	for (size_t c = 0; c < order.size(); ++c)
+	{
+		MeshCluster cluster = built[order[c]];
+		uint32_t start = indices.size();
+
+		indices.insert(indices.end(), output.begin() + cluster.IndexStart, output.begin() + cluster.IndexStart + cluster.IndexCount);
+		cluster.IndexStart = start;
+		clusters[c] = cluster;
+	}
+}
+
+MeshOptimizer::VertexCacheStats MeshOptimizer::AnalyzeVertexCache(const std::vector<unsigned int>& indices, unsigned int numVertices, unsigned int cacheSize)
+{
+	VertexCacheStats stats;
+	stats.ACMR = 0.0f;
+	stats.ATVR = 0.0f;
+
+	if (indices.empty() || numVertices == 0)
+	{
+		return stats;
+	}
+
+	//FIFO cache -- a vertex is in the cache if it was added within the last cacheSize misses
+	std::vector<unsigned int> insertedAt(numVertices, 0);
+	std::vector<bool> used(numVertices, false);
+	unsigned int misses = 0;
+	unsigned int uniqueVertices = 0;
+
+	for (size_t i = 0; i < indices.size(); ++i)
+	{
+		unsigned int v = indices[i];
+
+		if (!used[v])
+		{
+			used[v] = true;
+			uniqueVertices++;
+		}
+
+		if (insertedAt[v] == 0 || misses + 1 - insertedAt[v] > cacheSize)
+		{
+			misses++;
+			insertedAt[v] = misses;
+		}
+	}
+
+	stats.ACMR = (float)misses / (float)(indices.size() / 3);
+	stats.ATVR = (float)misses / (float)uniqueVertices;
+
+	return stats;
+}
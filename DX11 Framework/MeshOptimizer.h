@@ -0,0 +1,41 @@
+#pragma once
+
+#include <vector>
+
+#include "MeshClusters.h"
+
+//Index and vertex reordering passes run on a mesh after welding. Nothing in here depends on D3D or on the vertex format.
+namespace MeshOptimizer
+{
+	//Post-transform cache size we optimize for. Most GPUs since DX10 behave like a FIFO of somewhere around 16-32 entries.
+	const unsigned int DefaultCacheSize = 16;
+
+	//Cluster size limits. Small enough that culling one is worth it, big enough that a mesh doesn't turn into thousands of draws.
+	const unsigned int DefaultClusterVertices = 64;
+	const unsigned int DefaultClusterTriangles = 124;
+
+	struct VertexCacheStats
+	{
+		float ACMR;		//Average cache miss ratio -- vertex shader invocations per triangle. 0.5 is the best possible on a big regular mesh, 3 is the worst.
+		float ATVR;		//Average transformed vertex ratio -- vertex shader invocations per unique vertex. 1 is perfect.
+	};
+
+	//Reorders the triangles (not the vertices) for better post-transform vertex cache reuse, using Tipsify
+	//(Sander, Nehab and Barczak, "Fast Triangle Reordering for Vertex Locality and Reduced Overdraw", 2007)
+	void OptimizeVertexCache(std::vector<unsigned int>& indices, unsigned int numVertices, unsigned int cacheSize = DefaultCacheSize);
+
+	//Reorders the vertices into the order the index buffer first uses them, so vertex fetch walks memory linearly,
+	//and rewrites the indices to match. Vertices nothing references are dropped. Returns the new vertex count.
+	unsigned int OptimizeVertexFetch(void* vertices, unsigned int numVertices, unsigned int vertexStride, std::vector<unsigned int>& indices);
+
+	//Splits the triangles into clusters of neighbours, each with at most maxVertices distinct positions and maxTriangles triangles, and reorders
+	//the index buffer so each cluster is one contiguous range. Clusters grow from a seed triangle by taking whichever neighbouring triangle adds the
+	//fewest new positions, nearest the cluster's middle on a tie, skipping triangles that face more than about 45 degrees away from the cluster.
+	//Triangles keep their relative order inside a cluster, so run this after OptimizeVertexCache and most of its cache reuse survives.
+	//The clusters themselves are ordered by which way they face. Positions are read like Bounds::Compute reads them.
+	void BuildClusters(std::vector<unsigned int>& indices, unsigned int numVertices, const XMFLOAT3* firstPosition, size_t stride, std::vector<MeshCluster>& clusters,
+		unsigned int maxVertices = DefaultClusterVertices, unsigned int maxTriangles = DefaultClusterTriangles);
+
+	//Runs the index buffer through a simulated FIFO vertex cache
+	VertexCacheStats AnalyzeVertexCache(const std::vector<unsigned int>& indices, unsigned int numVertices, unsigned int cacheSize = DefaultCacheSize);
+};
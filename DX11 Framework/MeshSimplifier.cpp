@@ -0,0 +1,980 @@
+#include "MeshSimplifier.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+
+namespace
+{
+	//Each vertex is a point in 8 dimensions: position, normal, texture coordinate
+	const int AttributeCount = 8;
+	const int QuadricTerms = AttributeCount * (AttributeCount + 1) / 2;
+
+	//Open border edges get a plane at right angles to their triangle so the border can't creep inwards, weighted this many times the edge's length squared
+	const float BorderWeight = 4.0f;
+
+	//Each pass collapses edges cheapest first, up to this many times the cost of the edge that would just about reach the target on its own.
+	//Lower keeps the order closer to a strict one-at-a-time greedy collapse, at the cost of more passes.
+	const float PassCostBound = 1.5f;
+
+	//A pass that removes less than 1 / this of the triangles it set out to means nearly everything left is locked in place, so simplification
+	//stops there rather than rebuilding the topology over and over to creep a little further
+	const size_t MinPassProgress = 16;
+
+	//Generalized quadric: the summed squared distance from a point to a set of triangle planes in attribute space, as x.A.x + 2 B.x + C.
+	//A is symmetric, so only its upper triangle is kept, row by row.
+	struct AttributeQuadric
+	{
+		float A[QuadricTerms];
+		float B[AttributeCount];
+		float C;
+	};
+
+	//The same over position alone, in mesh space units and double precision, to measure how far the surface has moved
+	struct PositionQuadric
+	{
+		double A[6];		//xx, xy, xz, yy, yz, zz
+		double B[3];
+		double C;
+		double Weight;		//Total weight of the planes, to turn the summed squared distance into an average
+	};
+
+	enum VertexKind
+	{
+		Kind_Manifold,		//Surrounded by triangles, can move onto any neighbour
+		Kind_Border,		//On an open border, can only slide along it
+		Kind_Locked,		//On a non-manifold edge or where borders meet, never moves
+	};
+
+	struct Collapse
+	{
+		unsigned int From;	//Positions, not vertices
+		unsigned int To;
+		float Cost;
+	};
+
+	//Where row i, column j (i <= j) of the matrix is in AttributeQuadric::A
+	inline int Term(int i, int j)
+	{
+		return i * AttributeCount - i * (i - 1) / 2 + j - i;
+	}
+
+	void AddTrianglePlane(AttributeQuadric& quadric, const float* p0, const float* p1, const float* p2, float weight)
+	{
+		//Orthonormal basis for the triangle's plane in attribute space
+		float e1[AttributeCount];
+		float e2[AttributeCount];
+		float length1 = 0.0f;
+
+		for (int i = 0; i < AttributeCount; ++i)
+		{
+			e1[i] = p1[i] - p0[i];
+			length1 += e1[i] * e1[i];
+		}
+
+		if (length1 <= 0.0f)
+		{
+			return;
+		}
+
+		length1 = 1.0f / sqrtf(length1);
+		float along = 0.0f;
+
+		for (int i = 0; i < AttributeCount; ++i)
+		{
+			e1[i] *= length1;
+			e2[i] = p2[i] - p0[i];
+			along += e2[i] * e1[i];
+		}
+
+		float length2 = 0.0f;
+		for (int i = 0; i < AttributeCount; ++i)
+		{
+			e2[i] -= along * e1[i];
+			length2 += e2[i] * e2[i];
+		}
+
+		if (length2 <= 0.0f)
+		{
+			return;
+		}
+
+		length2 = 1.0f / sqrtf(length2);
+		float p0e1 = 0.0f, p0e2 = 0.0f, p0p0 = 0.0f;
+
+		for (int i = 0; i < AttributeCount; ++i)
+		{
+			e2[i] *= length2;
+			p0e1 += p0[i] * e1[i];
+			p0e2 += p0[i] * e2[i];
+			p0p0 += p0[i] * p0[i];
+		}
+
+		//A = I - e1.e1 - e2.e2, B = (p0.e1)e1 + (p0.e2)e2 - p0, C = p0.p0 - (p0.e1)^2 - (p0.e2)^2
+		int term = 0;
+		for (int i = 0; i < AttributeCount; ++i)
+		{
+			for (int j = i; j < AttributeCount; ++j)
+			{
+				quadric.A[term++] += weight * ((i == j ? 1.0f : 0.0f) - e1[i] * e1[j] - e2[i] * e2[j]);
+			}
+
+			quadric.B[i] += weight * (p0e1 * e1[i] + p0e2 * e2[i] - p0[i]);
+		}
+
+		quadric.C += weight * (p0p0 - p0e1 * p0e1 - p0e2 * p0e2);
+	}
+
+	//A plane through point with unit normal, affecting only the position part of the quadric
+	void AddPositionPlane(AttributeQuadric& quadric, const float normal[3], const float point[3], float weight)
+	{
+		float d = -(normal[0] * point[0] + normal[1] * point[1] + normal[2] * point[2]);
+
+		for (int i = 0; i < 3; ++i)
+		{
+			for (int j = i; j < 3; ++j)
+			{
+				quadric.A[Term(i, j)] += weight * normal[i] * normal[j];
+			}
+
+			quadric.B[i] += weight * d * normal[i];
+		}
+
+		quadric.C += weight * d * d;
+	}
+
+	void AddPositionPlane(PositionQuadric& quadric, const double normal[3], const double point[3], double weight)
+	{
+		double d = -(normal[0] * point[0] + normal[1] * point[1] + normal[2] * point[2]);
+
+		quadric.A[0] += weight * normal[0] * normal[0];
+		quadric.A[1] += weight * normal[0] * normal[1];
+		quadric.A[2] += weight * normal[0] * normal[2];
+		quadric.A[3] += weight * normal[1] * normal[1];
+		quadric.A[4] += weight * normal[1] * normal[2];
+		quadric.A[5] += weight * normal[2] * normal[2];
+		quadric.B[0] += weight * d * normal[0];
+		quadric.B[1] += weight * d * normal[1];
+		quadric.B[2] += weight * d * normal[2];
+		quadric.C += weight * d * d;
+		quadric.Weight += weight;
+	}
+
+	void AddQuadric(AttributeQuadric& quadric, const AttributeQuadric& other)
+	{
+		for (int i = 0; i < QuadricTerms; ++i) quadric.A[i] += other.A[i];
+		for (int i = 0; i < AttributeCount; ++i) quadric.B[i] += other.B[i];
+		quadric.C += other.C;
+	}
+
+	void AddQuadric(PositionQuadric& quadric, const PositionQuadric& other)
+	{
+		for (int i = 0; i < 6; ++i) quadric.A[i] += other.A[i];
+		for (int i = 0; i < 3; ++i) quadric.B[i] += other.B[i];
+		quadric.C += other.C;
+		quadric.Weight += other.Weight;
+	}
+
+	double Evaluate(const PositionQuadric& quadric, const XMFLOAT3& position)
+	{
+		double x = position.x, y = position.y, z = position.z;
+
+		double result = quadric.A[0] * x * x + quadric.A[3] * y * y + quadric.A[5] * z * z
+			+ 2.0 * (quadric.A[1] * x * y + quadric.A[2] * x * z + quadric.A[4] * y * z)
+			+ 2.0 * (quadric.B[0] * x + quadric.B[1] * y + quadric.B[2] * z)
+			+ quadric.C;
+
+		return std::max(result, 0.0);
+	}
+
+	//Unnormalized, this runs for every triangle around both ends of every edge each pass
+	XMFLOAT3 TriangleNormal(const XMFLOAT3& p0, const XMFLOAT3& p1, const XMFLOAT3& p2)
+	{
+		float ax = p1.x - p0.x, ay = p1.y - p0.y, az = p1.z - p0.z;
+		float bx = p2.x - p0.x, by = p2.y - p0.y, bz = p2.z - p0.z;
+
+		return XMFLOAT3(ay * bz - az * by, az * bx - ax * bz, ax * by - ay * bx);
+	}
+
+	//Runs the collapses for one mesh, keeping its quadrics between calls so each level carries on from the last
+	class Simplifier
+	{
+	public:
+		Simplifier(const std::vector<unsigned int>& indices, const SimpleVertex* vertices, unsigned int numVertices);
+
+		//Collapses edges until there are at most targetTriangles triangles left or none can be collapsed
+		void Simplify(size_t targetTriangles);
+
+		const std::vector<unsigned int>& GetIndices() const { return _indices; };
+
+		//Largest positional error of any collapse so far, in mesh space units
+		float GetError() const { return _error; };
+
+	private:
+		void WeldPositions();
+		void ComputeQuadrics();
+		void BuildTopology();
+
+		unsigned int EdgeTriangles(unsigned int from, unsigned int to) const;
+		bool CanMove(unsigned int from, unsigned int edgeTriangles) const;
+		float BestTarget(unsigned int vertex, unsigned int to, unsigned int& target) const;
+		float CollapseCost(unsigned int from, unsigned int to) const;
+		bool IsCollapseValid(unsigned int from, unsigned int to);
+		void PerformCollapse(unsigned int from, unsigned int to);
+
+		bool CurrentTriangle(unsigned int triangle, unsigned int positions[3]) const;
+		void GatherNeighbours(unsigned int position, std::vector<unsigned int>& neighbours, std::vector<unsigned int>& edgeTriangles) const;
+
+		const SimpleVertex* _vertices;
+		unsigned int _numVertices;
+		std::vector<unsigned int> _indices;
+		float _error;
+
+		//Vertices welded by position. Collapses work on positions, then every vertex at the position that moves goes to a vertex where it lands.
+		unsigned int _numPositions;
+		std::vector<unsigned int> _positionOf;
+		std::vector<XMFLOAT3> _positions;
+		std::vector<unsigned int> _positionVertexOffsets;	//Vertices at position p are _positionVertices[_positionVertexOffsets[p] .. _positionVertexOffsets[p + 1] - 1]
+		std::vector<unsigned int> _positionVertices;
+
+		std::vector<float> _attributes;					//AttributeCount per vertex
+		std::vector<AttributeQuadric> _vertexQuadrics;
+		std::vector<PositionQuadric> _positionQuadrics;
+		std::vector<unsigned int> _remap;				//Where each vertex has been collapsed to, itself if it hasn't
+
+		//Rebuilt every pass from the current triangles
+		std::vector<unsigned int> _triangleOffsets;		//Triangles around position p are _triangles[_triangleOffsets[p] .. _triangleOffsets[p + 1] - 1]
+		std::vector<unsigned int> _triangles;
+		std::vector<unsigned int> _neighbourOffsets;	//Positions next to position p are _neighbours[_neighbourOffsets[p] .. _neighbourOffsets[p + 1] - 1], sorted
+		std::vector<unsigned int> _neighbours;
+		std::vector<unsigned int> _edgeTriangles;		//How many triangles the edge to each of those neighbours is in
+		std::vector<unsigned char> _kinds;
+		std::vector<bool> _referenced;
+
+		//Changed as collapses are taken during a pass
+		std::vector<unsigned int> _collapsedTo;			//Where each position has gone, itself if it hasn't moved
+		std::vector<bool> _locked;						//Moved or been moved onto, can't be either end of another collapse
+		std::vector<bool> _touched;						//Next to a collapse, so the tables above are out of date around it
+
+		std::vector<unsigned int> _fromNeighbours;
+		std::vector<unsigned int> _fromEdgeTriangles;
+		std::vector<unsigned int> _toNeighbours;
+		std::vector<unsigned int> _toEdgeTriangles;
+	};
+
+	Simplifier::Simplifier(const std::vector<unsigned int>& indices, const SimpleVertex* vertices, unsigned int numVertices)
+	{
+		_vertices = vertices;
+		_numVertices = numVertices;
+		_error = 0.0f;
+
+		_remap.resize(numVertices);
+		for (unsigned int v = 0; v < numVertices; ++v)
+		{
+			_remap[v] = v;
+		}
+
+		WeldPositions();
+
+		//Triangles already degenerate by position have nothing to give the quadrics and would only confuse the topology
+		_indices.reserve(indices.size());
+		for (size_t i = 0; i + 3 <= indices.size(); i += 3)
+		{
+			unsigned int p0 = _positionOf[indices[i]], p1 = _positionOf[indices[i + 1]], p2 = _positionOf[indices[i + 2]];
+
+			if (p0 != p1 && p1 != p2 && p2 != p0)
+			{
+				_indices.insert(_indices.end(), indices.begin() + i, indices.begin() + i + 3);
+			}
+		}
+
+		ComputeQuadrics();
+	}
+
+	void Simplifier::WeldPositions()
+	{
+		std::vector<unsigned int> order(_numVertices);
+		for (unsigned int v = 0; v < _numVertices; ++v)
+		{
+			order[v] = v;
+		}
+
+		const SimpleVertex* vertices = _vertices;
+		std::sort(order.begin(), order.end(), [vertices](unsigned int a, unsigned int b)
+		{
+			int compare = memcmp(&vertices[a].Pos, &vertices[b].Pos, sizeof(XMFLOAT3));
+			return compare < 0 || (compare == 0 && a < b);
+		});
+
+		//Sorted by position, so each position's vertices are already together for the offsets table
+		_positionOf.resize(_numVertices);
+		_positionVertices = order;
+		_positionVertexOffsets.clear();
+		_positions.clear();
+
+		for (unsigned int i = 0; i < _numVertices; ++i)
+		{
+			if (i == 0 || memcmp(&vertices[order[i]].Pos, &vertices[order[i - 1]].Pos, sizeof(XMFLOAT3)) != 0)
+			{
+				_positionVertexOffsets.push_back(i);
+				_positions.push_back(vertices[order[i]].Pos);
+			}
+
+			_positionOf[order[i]] = _positions.size() - 1;
+		}
+
+		_numPositions = _positions.size();
+		_positionVertexOffsets.push_back(_numVertices);
+	}
+
+	void Simplifier::ComputeQuadrics()
+	{
+		//Positions are scaled to about 0..1 for the attribute quadrics, so the attribute weights mean the same for every mesh
+		XMVECTOR minimum = XMVectorReplicate(FLT_MAX);
+		XMVECTOR maximum = XMVectorReplicate(-FLT_MAX);
+		for (unsigned int p = 0; p < _numPositions; ++p)
+		{
+			minimum = XMVectorMin(minimum, XMLoadFloat3(&_positions[p]));
+			maximum = XMVectorMax(maximum, XMLoadFloat3(&_positions[p]));
+		}
+
+		XMFLOAT3 origin, extent;
+		XMStoreFloat3(&origin, minimum);
+		XMStoreFloat3(&extent, XMVectorSubtract(maximum, minimum));
+		float largest = std::max(extent.x, std::max(extent.y, extent.z));
+		float scale = largest > 0.0f ? 1.0f / largest : 1.0f;
+
+		_attributes.resize((size_t)_numVertices * AttributeCount);
+		for (unsigned int v = 0; v < _numVertices; ++v)
+		{
+			const SimpleVertex& vertex = _vertices[v];
+			float* attributes = &_attributes[(size_t)v * AttributeCount];
+
+			attributes[0] = (vertex.Pos.x - origin.x) * scale;
+			attributes[1] = (vertex.Pos.y - origin.y) * scale;
+			attributes[2] = (vertex.Pos.z - origin.z) * scale;
+			attributes[3] = vertex.Normal.x * MeshSimplifier::NormalWeight;
+			attributes[4] = vertex.Normal.y * MeshSimplifier::NormalWeight;
+			attributes[5] = vertex.Normal.z * MeshSimplifier::NormalWeight;
+			attributes[6] = vertex.TexC.x * MeshSimplifier::TexCoordWeight;
+			attributes[7] = vertex.TexC.y * MeshSimplifier::TexCoordWeight;
+		}
+
+		AttributeQuadric zeroAttribute;
+		memset(&zeroAttribute, 0, sizeof(zeroAttribute));
+		_vertexQuadrics.assign(_numVertices, zeroAttribute);
+
+		PositionQuadric zeroPosition;
+		memset(&zeroPosition, 0, sizeof(zeroPosition));
+		_positionQuadrics.assign(_numPositions, zeroPosition);
+
+		//Every triangle's plane goes to its corners, weighted by area so a patch of small triangles counts the same as one big one
+		for (size_t i = 0; i < _indices.size(); i += 3)
+		{
+			const unsigned int* corners = &_indices[i];
+			XMFLOAT3 normal = TriangleNormal(_vertices[corners[0]].Pos, _vertices[corners[1]].Pos, _vertices[corners[2]].Pos);
+
+			double length = sqrt((double)normal.x * normal.x + (double)normal.y * normal.y + (double)normal.z * normal.z);
+			if (length <= 0.0)
+			{
+				continue;
+			}
+
+			double unitNormal[3] = { normal.x / length, normal.y / length, normal.z / length };
+			float area = (float)(length * 0.5) * scale * scale;
+
+			//The plane through the three corners is the same whichever corner it goes to
+			AttributeQuadric triangleQuadric = zeroAttribute;
+			AddTrianglePlane(triangleQuadric, &_attributes[(size_t)corners[0] * AttributeCount],
+				&_attributes[(size_t)corners[1] * AttributeCount], &_attributes[(size_t)corners[2] * AttributeCount], area);
+
+			for (int k = 0; k < 3; ++k)
+			{
+				AddQuadric(_vertexQuadrics[corners[k]], triangleQuadric);
+
+				const XMFLOAT3& p = _vertices[corners[k]].Pos;
+				double point[3] = { p.x, p.y, p.z };
+				AddPositionPlane(_positionQuadrics[_positionOf[corners[k]]], unitNormal, point, length * 0.5);
+			}
+		}
+
+		//Open border edges also get a plane along the edge, standing up off the triangle
+		BuildTopology();
+
+		for (size_t i = 0; i < _indices.size(); i += 3)
+		{
+			const unsigned int* corners = &_indices[i];
+			XMFLOAT3 triangleNormal = TriangleNormal(_vertices[corners[0]].Pos, _vertices[corners[1]].Pos, _vertices[corners[2]].Pos);
+			XMVECTOR faceNormal = XMLoadFloat3(&triangleNormal);
+
+			for (int k = 0; k < 3; ++k)
+			{
+				unsigned int a = corners[k], b = corners[(k + 1) % 3];
+
+				//Nothing has collapsed yet, so the neighbour table has the triangle count of every edge
+				const unsigned int* first = &_neighbours[0] + _neighbourOffsets[_positionOf[a]];
+				const unsigned int* last = &_neighbours[0] + _neighbourOffsets[_positionOf[a] + 1];
+				const unsigned int* neighbour = std::lower_bound(first, last, _positionOf[b]);
+
+				if (neighbour == last || *neighbour != _positionOf[b] || _edgeTriangles[neighbour - &_neighbours[0]] != 1)
+				{
+					continue;
+				}
+
+				XMVECTOR edge = XMVectorSubtract(XMLoadFloat3(&_vertices[b].Pos), XMLoadFloat3(&_vertices[a].Pos));
+				XMFLOAT3 borderNormal;
+				XMStoreFloat3(&borderNormal, XMVector3Normalize(XMVector3Cross(edge, faceNormal)));
+				float edgeLength = XMVectorGetX(XMVector3Length(edge));
+
+				if (!(edgeLength > 0.0f) || XMVectorGetX(XMVector3LengthSq(faceNormal)) <= 0.0f)
+				{
+					continue;
+				}
+
+				float normal[3] = { borderNormal.x, borderNormal.y, borderNormal.z };
+				double doubleNormal[3] = { borderNormal.x, borderNormal.y, borderNormal.z };
+				float weight = BorderWeight * edgeLength * edgeLength;
+
+				unsigned int ends[2] = { a, b };
+				for (int e = 0; e < 2; ++e)
+				{
+					AddPositionPlane(_vertexQuadrics[ends[e]], normal, &_attributes[(size_t)ends[e] * AttributeCount], weight * scale * scale);
+
+					const XMFLOAT3& p = _vertices[ends[e]].Pos;
+					double point[3] = { p.x, p.y, p.z };
+					AddPositionPlane(_positionQuadrics[_positionOf[ends[e]]], doubleNormal, point, weight);
+				}
+			}
+		}
+	}
+
+	void Simplifier::BuildTopology()
+	{
+		_collapsedTo.resize(_numPositions);
+		for (unsigned int p = 0; p < _numPositions; ++p)
+		{
+			_collapsedTo[p] = p;
+		}
+
+		_triangleOffsets.assign(_numPositions + 1, 0);
+
+		for (size_t i = 0; i < _indices.size(); ++i)
+		{
+			_triangleOffsets[_positionOf[_indices[i]] + 1]++;
+		}
+
+		for (unsigned int p = 0; p < _numPositions; ++p)
+		{
+			_triangleOffsets[p + 1] += _triangleOffsets[p];
+		}
+
+		_triangles.resize(_indices.size());
+		std::vector<unsigned int> fill(_triangleOffsets.begin(), _triangleOffsets.end() - 1);
+
+		for (size_t i = 0; i < _indices.size(); ++i)
+		{
+			_triangles[fill[_positionOf[_indices[i]]]++] = (unsigned int)(i / 3);
+		}
+
+		_referenced.assign(_numVertices, false);
+		for (size_t i = 0; i < _indices.size(); ++i)
+		{
+			_referenced[_indices[i]] = true;
+		}
+
+		_neighbourOffsets.assign(1, 0);
+		_neighbours.clear();
+		_edgeTriangles.clear();
+		_kinds.assign(_numPositions, Kind_Manifold);
+
+		for (unsigned int p = 0; p < _numPositions; ++p)
+		{
+			GatherNeighbours(p, _fromNeighbours, _fromEdgeTriangles);
+			_neighbours.insert(_neighbours.end(), _fromNeighbours.begin(), _fromNeighbours.end());
+			_edgeTriangles.insert(_edgeTriangles.end(), _fromEdgeTriangles.begin(), _fromEdgeTriangles.end());
+			_neighbourOffsets.push_back(_neighbours.size());
+
+			unsigned int borderEdges = 0;
+			bool nonManifold = false;
+
+			for (size_t i = 0; i < _fromEdgeTriangles.size(); ++i)
+			{
+				borderEdges += _fromEdgeTriangles[i] == 1 ? 1 : 0;
+				nonManifold = nonManifold || _fromEdgeTriangles[i] > 2;
+			}
+
+			if (nonManifold || (borderEdges != 0 && borderEdges != 2))
+			{
+				_kinds[p] = Kind_Locked;
+			}
+			else if (borderEdges == 2)
+			{
+				_kinds[p] = Kind_Border;
+			}
+		}
+
+		_locked.assign(_numPositions, false);
+		_touched.assign(_numPositions, false);
+	}
+
+	//Positions of a triangle's corners with this pass's collapses so far applied. False if those have collapsed it.
+	bool Simplifier::CurrentTriangle(unsigned int triangle, unsigned int positions[3]) const
+	{
+		const unsigned int* corners = &_indices[(size_t)triangle * 3];
+
+		for (int k = 0; k < 3; ++k)
+		{
+			positions[k] = _collapsedTo[_positionOf[corners[k]]];
+		}
+
+		return positions[0] != positions[1] && positions[1] != positions[2] && positions[2] != positions[0];
+	}
+
+	//Positions sharing a triangle with position, sorted, and how many triangles each of those edges is in, with this pass's collapses so far applied
+	void Simplifier::GatherNeighbours(unsigned int position, std::vector<unsigned int>& neighbours, std::vector<unsigned int>& edgeTriangles) const
+	{
+		neighbours.clear();
+		edgeTriangles.clear();
+
+		for (unsigned int t = _triangleOffsets[position]; t < _triangleOffsets[position + 1]; ++t)
+		{
+			unsigned int corners[3];
+			if (!CurrentTriangle(_triangles[t], corners))
+			{
+				continue;
+			}
+
+			for (int k = 0; k < 3; ++k)
+			{
+				if (corners[k] != position)
+				{
+					neighbours.push_back(corners[k]);
+				}
+			}
+		}
+
+		//Each neighbour turns up once per triangle on the edge to it, so the run lengths are the triangle counts
+		std::sort(neighbours.begin(), neighbours.end());
+		size_t write = 0;
+
+		for (size_t i = 0; i < neighbours.size();)
+		{
+			size_t run = i + 1;
+			while (run < neighbours.size() && neighbours[run] == neighbours[i])
+			{
+				++run;
+			}
+
+			neighbours[write++] = neighbours[i];
+			edgeTriangles.push_back(run - i);
+			i = run;
+		}
+
+		neighbours.resize(write);
+	}
+
+	unsigned int Simplifier::EdgeTriangles(unsigned int from, unsigned int to) const
+	{
+		unsigned int count = 0;
+
+		for (unsigned int t = _triangleOffsets[from]; t < _triangleOffsets[from + 1]; ++t)
+		{
+			unsigned int corners[3];
+			if (CurrentTriangle(_triangles[t], corners))
+			{
+				count += (corners[0] == to || corners[1] == to || corners[2] == to) ? 1 : 0;
+			}
+		}
+
+		return count;
+	}
+
+	bool Simplifier::CanMove(unsigned int from, unsigned int edgeTriangles) const
+	{
+		switch (_kinds[from])
+		{
+		case Kind_Manifold:
+			return true;
+		case Kind_Border:
+			return edgeTriangles == 1;
+		default:
+			return false;
+		}
+	}
+
+	//The cheapest vertex at position to for vertex to land on, judged by vertex's own quadric
+	float Simplifier::BestTarget(unsigned int vertex, unsigned int to, unsigned int& target) const
+	{
+		const AttributeQuadric& quadric = _vertexQuadrics[vertex];
+		float best = FLT_MAX;
+		target = _positionVertices[_positionVertexOffsets[to]];
+
+		//x.A.x + 2 B.x + C, but every candidate is at the same position, so the position terms fold into a constant and a linear term
+		//up front, leaving only the normal and texture coordinate terms per candidate
+		const float* position = &_attributes[(size_t)target * AttributeCount];
+		float constant = quadric.C;
+		float linear[AttributeCount];
+
+		for (int i = 0; i < 3; ++i)
+		{
+			float row = 0.0f;
+			for (int j = 0; j < 3; ++j)
+			{
+				row += quadric.A[i <= j ? Term(i, j) : Term(j, i)] * position[j];
+			}
+
+			constant += position[i] * (row + 2.0f * quadric.B[i]);
+		}
+
+		for (int j = 3; j < AttributeCount; ++j)
+		{
+			linear[j] = 2.0f * quadric.B[j];
+			for (int i = 0; i < 3; ++i)
+			{
+				linear[j] += 2.0f * quadric.A[Term(i, j)] * position[i];
+			}
+		}
+
+		for (unsigned int v = _positionVertexOffsets[to]; v < _positionVertexOffsets[to + 1]; ++v)
+		{
+			unsigned int candidate = _positionVertices[v];
+			if (!_referenced[candidate])
+			{
+				continue;
+			}
+
+			const float* attributes = &_attributes[(size_t)candidate * AttributeCount];
+			float cost = constant;
+
+			for (int i = 3; i < AttributeCount; ++i)
+			{
+				float row = quadric.A[Term(i, i)] * attributes[i];
+				for (int j = i + 1; j < AttributeCount; ++j)
+				{
+					row += 2.0f * quadric.A[Term(i, j)] * attributes[j];
+				}
+
+				cost += attributes[i] * (row + linear[i]);
+			}
+
+			//Rounding can take a point right on the planes a little below zero
+			cost = std::max(cost, 0.0f);
+
+			if (cost < best)
+			{
+				best = cost;
+				target = candidate;
+			}
+		}
+
+		return best;
+	}
+
+	float Simplifier::CollapseCost(unsigned int from, unsigned int to) const
+	{
+		float cost = 0.0f;
+
+		for (unsigned int i = _positionVertexOffsets[from]; i < _positionVertexOffsets[from + 1]; ++i)
+		{
+			unsigned int vertex = _positionVertices[i];
+			unsigned int target;
+
+			if (_referenced[vertex])
+			{
+				cost += BestTarget(vertex, to, target);
+			}
+		}
+
+		return cost;
+	}
+
+	bool Simplifier::IsCollapseValid(unsigned int from, unsigned int to)
+	{
+		//Around positions no collapse has touched yet this pass, the tables from the start of the pass still hold
+		if (_touched[from])
+		{
+			GatherNeighbours(from, _fromNeighbours, _fromEdgeTriangles);
+		}
+		else
+		{
+			_fromNeighbours.assign(_neighbours.begin() + _neighbourOffsets[from], _neighbours.begin() + _neighbourOffsets[from + 1]);
+			_fromEdgeTriangles.assign(_edgeTriangles.begin() + _neighbourOffsets[from], _edgeTriangles.begin() + _neighbourOffsets[from + 1]);
+		}
+
+		if (_touched[to])
+		{
+			GatherNeighbours(to, _toNeighbours, _toEdgeTriangles);
+		}
+		else
+		{
+			_toNeighbours.assign(_neighbours.begin() + _neighbourOffsets[to], _neighbours.begin() + _neighbourOffsets[to + 1]);
+		}
+
+		//Link condition: the only positions next to both ends can be the far corners of the triangles on the edge,
+		//anything else and the collapse pinches the surface into a non-manifold edge
+		unsigned int shared = 0;
+		unsigned int edgeTriangles = 0;
+
+		for (size_t i = 0, j = 0; i < _fromNeighbours.size() && j < _toNeighbours.size();)
+		{
+			if (_fromNeighbours[i] < _toNeighbours[j]) ++i;
+			else if (_toNeighbours[j] < _fromNeighbours[i]) ++j;
+			else { ++shared; ++i; ++j; }
+		}
+
+		for (size_t i = 0; i < _fromNeighbours.size(); ++i)
+		{
+			if (_fromNeighbours[i] == to)
+			{
+				edgeTriangles = _fromEdgeTriangles[i];
+			}
+		}
+
+		if (edgeTriangles == 0 || shared != edgeTriangles)
+		{
+			return false;
+		}
+
+		//None of the triangles that stay can turn over
+		const XMFLOAT3& destination = _positions[to];
+
+		for (unsigned int t = _triangleOffsets[from]; t < _triangleOffsets[from + 1]; ++t)
+		{
+			unsigned int p[3];
+			if (!CurrentTriangle(_triangles[t], p) || p[0] == to || p[1] == to || p[2] == to)
+			{
+				continue;
+			}
+
+			XMFLOAT3 before = TriangleNormal(_positions[p[0]], _positions[p[1]], _positions[p[2]]);
+			XMFLOAT3 after = TriangleNormal(p[0] == from ? destination : _positions[p[0]], p[1] == from ? destination : _positions[p[1]],
+				p[2] == from ? destination : _positions[p[2]]);
+
+			if (before.x * after.x + before.y * after.y + before.z * after.z <= 0.0f)
+			{
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	void Simplifier::PerformCollapse(unsigned int from, unsigned int to)
+	{
+		for (unsigned int i = _positionVertexOffsets[from]; i < _positionVertexOffsets[from + 1]; ++i)
+		{
+			unsigned int vertex = _positionVertices[i];
+			unsigned int target;
+
+			if (_referenced[vertex])
+			{
+				BestTarget(vertex, to, target);
+				_remap[vertex] = target;
+				AddQuadric(_vertexQuadrics[target], _vertexQuadrics[vertex]);
+			}
+		}
+
+		const PositionQuadric& quadric = _positionQuadrics[from];
+		if (quadric.Weight > 0.0)
+		{
+			_error = std::max(_error, (float)sqrt(Evaluate(quadric, _positions[to]) / quadric.Weight));
+		}
+
+		AddQuadric(_positionQuadrics[to], quadric);
+
+		//Neither end can take part in another collapse this pass. Collapses next to this one can still go ahead, but get checked again
+		//with this one applied before they're taken.
+		for (unsigned int t = _triangleOffsets[from]; t < _triangleOffsets[from + 1]; ++t)
+		{
+			unsigned int corners[3];
+			if (CurrentTriangle(_triangles[t], corners))
+			{
+				_touched[corners[0]] = _touched[corners[1]] = _touched[corners[2]] = true;
+			}
+		}
+
+		_collapsedTo[from] = to;
+		_locked[from] = true;
+		_locked[to] = true;
+	}
+
+	void Simplifier::Simplify(size_t targetTriangles)
+	{
+		std::vector<Collapse> collapses;
+
+		//Collapses run in passes: cost every edge, then take the cheapest that don't share an end, so no cost goes stale mid pass
+		while (_indices.size() / 3 > targetTriangles)
+		{
+			BuildTopology();
+			collapses.clear();
+
+			for (unsigned int a = 0; a < _numPositions; ++a)
+			for (unsigned int n = _neighbourOffsets[a]; n < _neighbourOffsets[a + 1]; ++n)
+			{
+				unsigned int b = _neighbours[n];
+				unsigned int edgeTriangles = _edgeTriangles[n];
+
+				//Both ends list the edge, only take it from one
+				if (b < a || edgeTriangles > 2)
+				{
+					continue;
+				}
+
+				float forward = CanMove(a, edgeTriangles) ? CollapseCost(a, b) : FLT_MAX;
+				float backward = CanMove(b, edgeTriangles) ? CollapseCost(b, a) : FLT_MAX;
+
+				Collapse collapse = { a, b, forward };
+				Collapse reverse = { b, a, backward };
+				if (backward < forward)
+				{
+					std::swap(collapse, reverse);
+				}
+
+				//Validity is checked up front as well as when a collapse is taken, so cheap collapses that could never happen don't set the pass's cost bound
+				if (collapse.Cost < FLT_MAX && IsCollapseValid(collapse.From, collapse.To))
+				{
+					collapses.push_back(collapse);
+				}
+				else if (reverse.Cost < FLT_MAX && IsCollapseValid(reverse.From, reverse.To))
+				{
+					collapses.push_back(reverse);
+				}
+			}
+
+			if (collapses.empty())
+			{
+				break;
+			}
+
+			std::sort(collapses.begin(), collapses.end(), [](const Collapse& a, const Collapse& b) { return a.Cost < b.Cost; });
+
+			//Most collapses take two triangles with them
+			size_t triangleGoal = _indices.size() / 3 - targetTriangles;
+			float costBound = collapses[std::min(collapses.size() - 1, triangleGoal / 2)].Cost * PassCostBound;
+
+			size_t removed = 0;
+			size_t performed = 0;
+
+			for (size_t i = 0; i < collapses.size() && removed < triangleGoal; ++i)
+			{
+				const Collapse& collapse = collapses[i];
+
+				if (collapse.Cost > costBound)
+				{
+					break;
+				}
+
+				if (_locked[collapse.From] || _locked[collapse.To] || !IsCollapseValid(collapse.From, collapse.To))
+				{
+					continue;
+				}
+
+				removed += EdgeTriangles(collapse.From, collapse.To);
+				PerformCollapse(collapse.From, collapse.To);
+				performed++;
+			}
+
+			if (performed == 0)
+			{
+				break;
+			}
+
+			//Move the collapsed corners and drop the triangles that were on the collapsed edges
+			size_t write = 0;
+			for (size_t i = 0; i < _indices.size(); i += 3)
+			{
+				unsigned int a = _remap[_indices[i]], b = _remap[_indices[i + 1]], c = _remap[_indices[i + 2]];
+				unsigned int pa = _positionOf[a], pb = _positionOf[b], pc = _positionOf[c];
+
+				if (pa != pb && pb != pc && pc != pa)
+				{
+					_indices[write++] = a;
+					_indices[write++] = b;
+					_indices[write++] = c;
+				}
+			}
+
+			_indices.resize(write);
+
+			if (removed < triangleGoal / MinPassProgress)
+			{
+				break;
+			}
+		}
+	}
+}
+
+void MeshSimplifier::BuildLods(const std::vector<unsigned int>& indices, const SimpleVertex* vertices, unsigned int numVertices,
+	std::vector<std::vector<unsigned int> >& lodIndices, std::vector<float>& lodErrors, unsigned int maxLods)
+{
+	lodIndices.clear();
+	lodErrors.clear();
+
+	if (indices.size() < 3 || numVertices == 0 || maxLods < 2)
+	{
+		return;
+	}
+
+	Simplifier simplifier(indices, vertices, numVertices);
+	size_t previousTriangles = indices.size() / 3;
+
+	for (unsigned int level = 1; level < maxLods; ++level)
+	{
+		simplifier.Simplify((size_t)(previousTriangles * LodTriangleRatio));
+
+		size_t triangles = simplifier.GetIndices().size() / 3;
+		if (triangles == 0 || triangles > previousTriangles * MinLodReduction)
+		{
+			break;
+		}
+
+		lodIndices.push_back(simplifier.GetIndices());
+		lodErrors.push_back(simplifier.GetError());
+		previousTriangles = triangles;
+	}
+}
+
+void MeshSimplifier::LodSwitchDistances(float error, float unitsToPixels, float pixelError, float& coarserAt, float& finerAt)
+{
+	//error * unitsToPixels / distance is the error in pixels
+	coarserAt = error * unitsToPixels / (pixelError * (1.0f - LodHysteresis));
+	finerAt = error * unitsToPixels / (pixelError * (1.0f + LodHysteresis));
+}
+
+unsigned int MeshSimplifier::SelectLod(const MeshLod* lods, unsigned int lodCount, unsigned int currentLod, float distance, float unitsToPixels,
+	float pixelError)
+{
+	//With the camera inside the bounds some of the mesh could be right in front of it
+	if (lodCount <= 1 || pixelError <= 0.0f || distance <= 0.0f)
+	{
+		return 0;
+	}
+
+	unsigned int lod = currentLod < lodCount ? currentLod : lodCount - 1;
+	float coarserAt, finerAt;
+
+	//The errors only grow down the chain, so each loop can stop at the first level that doesn't qualify
+	while (lod > 0)
+	{
+		LodSwitchDistances(lods[lod].Error, unitsToPixels, pixelError, coarserAt, finerAt);
+		if (distance >= finerAt)
+		{
+			break;
+		}
+
+		--lod;
+	}
+
+	while (lod + 1 < lodCount)
+	{
+		LodSwitchDistances(lods[lod + 1].Error, unitsToPixels, pixelError, coarserAt, finerAt);
+		if (distance < coarserAt)
+		{
+			break;
+		}
+
+		++lod;
+	}
+
+	return lod;
+}
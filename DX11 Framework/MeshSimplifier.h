@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "VertexFormats.h"
+
+//One level of detail: a range of the mesh's index buffer. Every level draws from the same vertex buffer.
+struct MeshLod
+{
+	uint32_t IndexStart;
+	uint32_t IndexCount;
+	float Error;		//Roughly how far, in mesh space units, this level's surface strays from the full mesh. 0 for the full mesh.
+	uint32_t Reserved;
+};
+
+//Quadric error edge collapse simplification (Garland and Heckbert, "Simplifying Surfaces with Color and Texture using Quadric Error Metrics", 1998).
+//Vertices are points in position + normal + texture coordinate space, so collapses that would smear a hard edge or stretch a UV seam cost more.
+namespace MeshSimplifier
+{
+	//The full mesh plus up to three simplified levels
+	const unsigned int MaxLods = 4;
+
+	//Each level aims for this fraction of the triangles of the level before it, so 50%, 25% and 12.5% of the full mesh
+	const float LodTriangleRatio = 0.5f;
+
+	//A level that can't get below this fraction of the triangles of the level before it isn't worth its index buffer space, and ends the chain
+	const float MinLodReduction = 0.8f;
+
+	//How much a difference in normal or texture coordinate counts against a difference in position, with positions scaled so the mesh is 1 unit across
+	const float NormalWeight = 0.5f;
+	const float TexCoordWeight = 0.5f;
+
+	//Builds the simplified levels of a welded triangle list. Each level is collapsed further from the one before, only ever moving a vertex onto
+	//another existing vertex, so the levels index the same vertices as the full mesh. Vertices are welded by position first, which lets faceted
+	//meshes (every corner its own vertex) simplify as well as smooth ones. Open borders only move along themselves.
+	//lodIndices/lodErrors get one entry per simplified level, not counting the full mesh; there may be fewer than maxLods - 1.
+	void BuildLods(const std::vector<unsigned int>& indices, const SimpleVertex* vertices, unsigned int numVertices,
+		std::vector<std::vector<unsigned int> >& lodIndices, std::vector<float>& lodErrors, unsigned int maxLods = MaxLods);
+
+	//How far past the pixel error, as a fraction of it, the projected error has to go before SelectLod changes level, so a mesh sitting at
+	//a switch distance doesn't flicker between two levels
+	const float LodHysteresis = 0.25f;
+
+	//The distances from the eye to the mesh's bounds at which SelectLod moves down to a level with this error (at or beyond coarserAt) and back
+	//up from it (closer than finerAt). unitsToPixels is how many pixels a mesh space unit covers at a distance of 1: the world scale, times the
+	//projection's m[1][1], times half the viewport height.
+	void LodSwitchDistances(float error, float unitsToPixels, float pixelError, float& coarserAt, float& finerAt);
+
+	//Picks the level to draw from the one drawn last time, so it only changes once the projected error is LodHysteresis past pixelError.
+	//distance is from the eye to the mesh's bounds, 0 or less with the eye inside them. Gives the full mesh for pixelError <= 0.
+	//Nothing here knows about the device, so tools can run the same selection the game does.
+	unsigned int SelectLod(const MeshLod* lods, unsigned int lodCount, unsigned int currentLod, float distance, float unitsToPixels,
+		float pixelError);
+};
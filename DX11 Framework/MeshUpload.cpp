@@ -0,0 +1,105 @@
+#include "MeshUpload.h"
+#include <algorithm>
+#include <cstring>
+
+D3D11MeshUploadDevice::D3D11MeshUploadDevice(ID3D11Device* device)
+{
+	_device = device;
+}
+
+HRESULT D3D11MeshUploadDevice::CreateBuffer(const D3D11_BUFFER_DESC* desc, const D3D11_SUBRESOURCE_DATA* initialData, ID3D11Buffer** buffer)
+{
+	return _device->CreateBuffer(desc, initialData, buffer);
+}
+
+MeshData MeshUpload::Upload(MeshUploadDevice& device, const MeshAsset& asset)
+{
+	MeshData meshData;
+	ZeroMemory(&meshData, sizeof(meshData));
+
+	//Put data into vertex and index buffers, then pass the relevant data to the MeshData object.
+	//The rest of the code will hopefully look familiar to you, as it's similar to whats in your InitVertexBuffer and InitIndexBuffer methods
+	ID3D11Buffer* vertexBuffer;
+
+	D3D11_BUFFER_DESC bd;
+	ZeroMemory(&bd, sizeof(bd));
+	bd.Usage = D3D11_USAGE_DEFAULT;
+	bd.ByteWidth = asset.VertexStride * asset.VertexCount;
+	bd.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+	bd.CPUAccessFlags = 0;
+
+	D3D11_SUBRESOURCE_DATA InitData;
+	ZeroMemory(&InitData, sizeof(InitData));
+	InitData.pSysMem = asset.Vertices;
+
+	if (FAILED(device.CreateBuffer(&bd, &InitData, &vertexBuffer)))
+	{
+		return meshData;
+	}
+
+	ID3D11Buffer* indexBuffer;
+
+	ZeroMemory(&bd, sizeof(bd));
+	bd.Usage = D3D11_USAGE_DEFAULT;
+	bd.ByteWidth = asset.IndexSize * asset.IndexCount;
+	bd.BindFlags = D3D11_BIND_INDEX_BUFFER;
+	bd.CPUAccessFlags = 0;
+
+	ZeroMemory(&InitData, sizeof(InitData));
+	InitData.pSysMem = asset.Indices;
+
+	if (FAILED(device.CreateBuffer(&bd, &InitData, &indexBuffer)))
+	{
+		vertexBuffer->Release();
+		return meshData;
+	}
+
+	meshData.VertexBuffer = vertexBuffer;
+	meshData.VBOffset = 0;
+	meshData.VBStride = asset.VertexStride;
+	meshData.IndexBuffer = indexBuffer;
+	meshData.IndexCount = asset.Lods.empty() ? asset.IndexCount : asset.Lods[0].IndexCount;
+	meshData.IndexFormat = asset.IndexSize == 4 ? DXGI_FORMAT_R32_UINT : DXGI_FORMAT_R16_UINT;
+	meshData.Format = asset.Format;
+	meshData.Bounds = asset.Bounds;
+	meshData.PositionScale = XMFLOAT3(1.0f, 1.0f, 1.0f);
+	meshData.PositionOffset = XMFLOAT3(0.0f, 0.0f, 0.0f);
+
+	if (asset.Format == VertexFormat_Compressed)
+	{
+		meshData.PositionScale = XMFLOAT3(asset.Quantization.Scale[0], asset.Quantization.Scale[1], asset.Quantization.Scale[2]);
+		meshData.PositionOffset = XMFLOAT3(asset.Quantization.Offset[0], asset.Quantization.Offset[1], asset.Quantization.Offset[2]);
+	}
+
+	//An asset without levels of detail is drawn whole
+	meshData.LodCount = 1;
+	meshData.Lods[0].IndexStart = 0;
+	meshData.Lods[0].IndexCount = meshData.IndexCount;
+	meshData.Lods[0].Error = 0.0f;
+	meshData.Lods[0].Reserved = 0;
+
+	if (!asset.Lods.empty())
+	{
+		meshData.LodCount = (UINT)std::min(asset.Lods.size(), (size_t)MeshSimplifier::MaxLods);
+		memcpy(meshData.Lods, asset.Lods.data(), sizeof(MeshLod) * meshData.LodCount);
+	}
+
+	//The clusters are only read on the CPU, for culling, so they get their own copy rather than keeping the asset alive
+	if (!asset.Clusters.empty())
+	{
+		meshData.ClusterCount = asset.Clusters.size();
+		meshData.Clusters = new MeshCluster[meshData.ClusterCount];
+		memcpy(meshData.Clusters, asset.Clusters.data(), sizeof(MeshCluster) * meshData.ClusterCount);
+	}
+
+	return meshData;
+}
+
+void MeshUpload::Release(MeshData& meshData)
+{
+	if (meshData.VertexBuffer) meshData.VertexBuffer->Release();
+	if (meshData.IndexBuffer) meshData.IndexBuffer->Release();
+	delete[] meshData.Clusters;
+
+	ZeroMemory(&meshData, sizeof(meshData));
+}
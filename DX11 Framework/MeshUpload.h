@@ -0,0 +1,40 @@
+#pragma once
+
+#include <windows.h>
+#include <d3d11_1.h>
+
+#include "Structures.h"
+#include "MeshAsset.h"
+
+//Everything the mesh upload needs from a device. Tools and benchmarks on machines without a GPU can pass their own
+//implementation (e.g. one that just counts bytes) instead of a real ID3D11Device.
+class MeshUploadDevice
+{
+public:
+	virtual ~MeshUploadDevice() {};
+
+	//Same contract as ID3D11Device::CreateBuffer
+	virtual HRESULT CreateBuffer(const D3D11_BUFFER_DESC* desc, const D3D11_SUBRESOURCE_DATA* initialData, ID3D11Buffer** buffer) = 0;
+};
+
+//Forwards to a real ID3D11Device
+class D3D11MeshUploadDevice : public MeshUploadDevice
+{
+public:
+	D3D11MeshUploadDevice(ID3D11Device* device);
+
+	HRESULT CreateBuffer(const D3D11_BUFFER_DESC* desc, const D3D11_SUBRESOURCE_DATA* initialData, ID3D11Buffer** buffer);
+
+private:
+	ID3D11Device* _device;
+};
+
+namespace MeshUpload
+{
+	//Creates the GPU vertex and index buffers for a loaded mesh. The asset only needs to stay alive until this returns.
+	//Returns a zeroed MeshData if either buffer couldn't be created.
+	MeshData Upload(MeshUploadDevice& device, const MeshAsset& asset);
+
+	//Releases the buffers and frees the clusters, leaving the MeshData zeroed. Safe to call on a zeroed MeshData.
+	void Release(MeshData& meshData);
+};
@@ -0,0 +1,486 @@
+#include "NumberParser.h"
+#include <climits>
+#include <cmath>
+#include <cstring>
+
+namespace
+{
+	//Every power of 10 in these is exactly representable, which is what makes the fast paths in ParseFloat exact
+	const float ExactFloatPowersOf10[] = { 1e0f, 1e1f, 1e2f, 1e3f, 1e4f, 1e5f, 1e6f, 1e7f, 1e8f, 1e9f, 1e10f };
+	const double ExactDoublePowersOf10[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11, 1e12, 1e13, 1e14, 1e15, 1e16,
+		1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+	const uint32_t PowersOf10[] = { 1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000, 1000000000 };
+
+	//Relative error allowed for in a double worked out from a 19 digit mantissa, comfortably more than the few double ulps it can be out by
+	const double DoubleRoundingSlack = 1e-15;
+
+	//Digits stop going into the mantissa once it reaches this, keeping it below 10^19 (19 significant digits)
+	const uint64_t MaxMantissa = 1000000000000000000ull;
+
+	const uint32_t FloatInfinityBits = 0x7F800000;
+	const int FloatMantissaBits = 23;
+	const int FloatExponentBias = 150;
+
+	//A float is below 1e39 and anything below 1e-47 rounds to 0, so only decimal magnitudes in between need working out
+	const int MaxDecimalMagnitude = 39;
+	const int MinDecimalMagnitude = -46;
+
+	//Every halfway point between two floats has fewer significant digits than this, so any digits past it only matter for whether they're
+	//all zero. It also bounds how big the numbers in the exact comparison can get.
+	const int MaxExactDigits = 128;
+
+	inline bool IsDigit(char c)
+	{
+		return (unsigned char)(c - '0') < 10;
+	}
+
+	inline uint32_t FloatBits(float value)
+	{
+		uint32_t bits;
+		memcpy(&bits, &value, sizeof(bits));
+		return bits;
+	}
+
+	inline float BitsToFloat(uint32_t bits)
+	{
+		float value;
+		memcpy(&value, &bits, sizeof(value));
+		return value;
+	}
+
+	//Adds the run of digits at ptr onto mantissa for as long as it stays below 10^19, and moves ptr past the whole run. Returns how many
+	//digits there were, with how many made it into the mantissa in taken, and sets droppedNonZero if any that didn't weren't 0.
+	size_t ReadMantissaDigits(const char*& ptr, const char* end, uint64_t& mantissa, size_t& taken, bool& droppedNonZero)
+	{
+		const char* start = ptr;
+		taken = 0;
+
+		while (ptr < end && IsDigit(*ptr))
+		{
+			if (mantissa < MaxMantissa)
+			{
+				mantissa = mantissa * 10 + (*ptr - '0');
+				++taken;
+			}
+			else if (*ptr != '0')
+			{
+				droppedNonZero = true;
+			}
+
+			++ptr;
+		}
+
+		return ptr - start;
+	}
+
+	//Reads an exponent's digits, stopping the value somewhere past any exponent that could make a difference so it can't overflow
+	int ReadExponentDigits(const char*& ptr, const char* end)
+	{
+		int value = 0;
+
+		while (ptr < end && IsDigit(*ptr))
+		{
+			if (value < 100000)
+			{
+				value = value * 10 + (*ptr - '0');
+			}
+
+			++ptr;
+		}
+
+		return value;
+	}
+
+	//Just enough of an arbitrary precision unsigned integer to compare a decimal number with the halfway point between two floats exactly
+	class BigInt
+	{
+	public:
+		BigInt(const char* digits, int count)
+		{
+			_size = 0;
+
+			//9 digits at a time fit in a 32 bit multiply
+			for (int i = 0; i < count; i += 9)
+			{
+				int chunk = count - i < 9 ? count - i : 9;
+				uint32_t value = 0;
+
+				for (int d = 0; d < chunk; ++d)
+				{
+					value = value * 10 + (digits[i + d] - '0');
+				}
+
+				MultiplyAdd(PowersOf10[chunk], value);
+			}
+		}
+
+		explicit BigInt(uint32_t value)
+		{
+			_size = 0;
+			MultiplyAdd(1, value);
+		}
+
+		void MultiplyByPowerOf10(int power)
+		{
+			for (; power >= 9; power -= 9)
+			{
+				MultiplyAdd(PowersOf10[9], 0);
+			}
+
+			MultiplyAdd(PowersOf10[power], 0);
+		}
+
+		void ShiftLeft(int bits)
+		{
+			int limbs = bits / 32;
+			bits %= 32;
+
+			if (bits != 0)
+			{
+				uint32_t carry = 0;
+				for (int i = 0; i < _size; ++i)
+				{
+					uint32_t limb = _limbs[i];
+					_limbs[i] = (limb << bits) | carry;
+					carry = limb >> (32 - bits);
+				}
+
+				if (carry != 0)
+				{
+					_limbs[_size++] = carry;
+				}
+			}
+
+			if (limbs != 0 && _size != 0)
+			{
+				memmove(_limbs + limbs, _limbs, sizeof(uint32_t) * _size);
+				memset(_limbs, 0, sizeof(uint32_t) * limbs);
+				_size += limbs;
+			}
+		}
+
+		int Compare(const BigInt& other) const
+		{
+			if (_size != other._size)
+			{
+				return _size < other._size ? -1 : 1;
+			}
+
+			for (int i = _size - 1; i >= 0; --i)
+			{
+				if (_limbs[i] != other._limbs[i])
+				{
+					return _limbs[i] < other._limbs[i] ? -1 : 1;
+				}
+			}
+
+			return 0;
+		}
+
+	private:
+		//MaxExactDigits digits times 10^175, or a 25 bit float mantissa times 2^104 and 10^175, with room to spare
+		static const int MaxLimbs = 40;
+
+		void MultiplyAdd(uint32_t multiplier, uint32_t addend)
+		{
+			uint64_t carry = addend;
+
+			for (int i = 0; i < _size; ++i)
+			{
+				uint64_t product = (uint64_t)_limbs[i] * multiplier + carry;
+				_limbs[i] = (uint32_t)product;
+				carry = product >> 32;
+			}
+
+			if (carry != 0)
+			{
+				_limbs[_size++] = (uint32_t)carry;
+			}
+		}
+
+		uint32_t _limbs[MaxLimbs];
+		int _size;
+	};
+
+	//A decimal number as up to MaxExactDigits significant digits times 10^Exponent
+	struct ExactDecimal
+	{
+		char Digits[MaxExactDigits];
+		int DigitCount;
+		int Exponent;
+		bool NonZeroDropped;	//Digits past MaxExactDigits that weren't all 0, making the number a touch bigger than its digits
+	};
+
+	void AddExactDigits(const char* ptr, const char* end, bool fraction, ExactDecimal& decimal)
+	{
+		for (; ptr < end; ++ptr)
+		{
+			if (decimal.DigitCount == MaxExactDigits)
+			{
+				decimal.NonZeroDropped |= *ptr != '0';
+				decimal.Exponent += fraction ? 0 : 1;
+			}
+			else
+			{
+				//Leading zeros aren't significant, but the ones after the decimal point still move it along
+				if (decimal.DigitCount != 0 || *ptr != '0')
+				{
+					decimal.Digits[decimal.DigitCount++] = *ptr;
+				}
+
+				decimal.Exponent -= fraction ? 1 : 0;
+			}
+		}
+	}
+
+	//Compares the decimal with the point halfway between the positive float with these bits and the next one up
+	int CompareWithHalfway(const ExactDecimal& decimal, uint32_t bits)
+	{
+		uint32_t exponentBits = bits >> FloatMantissaBits;
+		uint32_t mantissa = bits & ((1u << FloatMantissaBits) - 1);
+		int binaryExponent = 1 - FloatExponentBias;
+
+		if (exponentBits != 0)
+		{
+			mantissa |= 1u << FloatMantissaBits;
+			binaryExponent = (int)exponentBits - FloatExponentBias;
+		}
+
+		//digits * 10^Exponent against (2 * mantissa + 1) * 2^(binaryExponent - 1), with both sides scaled up to integers
+		BigInt decimalSide(decimal.Digits, decimal.DigitCount);
+		BigInt halfwaySide(2 * mantissa + 1);
+
+		if (decimal.Exponent >= 0)
+		{
+			decimalSide.MultiplyByPowerOf10(decimal.Exponent);
+		}
+		else
+		{
+			halfwaySide.MultiplyByPowerOf10(-decimal.Exponent);
+		}
+
+		if (binaryExponent - 1 >= 0)
+		{
+			halfwaySide.ShiftLeft(binaryExponent - 1);
+		}
+		else
+		{
+			decimalSide.ShiftLeft(1 - binaryExponent);
+		}
+
+		int comparison = decimalSide.Compare(halfwaySide);
+		return comparison == 0 && decimal.NonZeroDropped ? 1 : comparison;
+	}
+
+	//The slow path, for numbers with large exponents or that come out too close to halfway between two floats in double precision. A close
+	//guess is nudged a float at a time until it's the nearest, using exact comparisons.
+	float ParseExact(const char* integerStart, const char* integerEnd, const char* fractionStart, const char* fractionEnd, int exponent,
+		uint64_t mantissa, int mantissaExponent)
+	{
+		ExactDecimal decimal;
+		decimal.DigitCount = 0;
+		decimal.Exponent = 0;
+		decimal.NonZeroDropped = false;
+		AddExactDigits(integerStart, integerEnd, false, decimal);
+		AddExactDigits(fractionStart, fractionEnd, true, decimal);
+
+		if (decimal.DigitCount == 0)
+		{
+			return 0.0f;
+		}
+
+		//Anything out of a float's range is settled here, which also keeps the exponents below small
+		int magnitude = decimal.DigitCount + decimal.Exponent;
+		if (exponent > MaxDecimalMagnitude - magnitude)
+		{
+			return BitsToFloat(FloatInfinityBits);
+		}
+		else if (exponent < MinDecimalMagnitude - magnitude)
+		{
+			return 0.0f;
+		}
+
+		decimal.Exponent += exponent;
+		mantissaExponent += exponent;
+
+		//The first 19 digits in double precision are within a float or two of the answer
+		double guess = (double)mantissa;
+		for (; mantissaExponent > 22; mantissaExponent -= 22)
+		{
+			guess *= ExactDoublePowersOf10[22];
+		}
+		for (; mantissaExponent < -22; mantissaExponent += 22)
+		{
+			guess /= ExactDoublePowersOf10[22];
+		}
+		guess = mantissaExponent < 0 ? guess / ExactDoublePowersOf10[-mantissaExponent] : guess * ExactDoublePowersOf10[mantissaExponent];
+
+		uint32_t bits = guess >= 3.5e38 ? FloatInfinityBits : FloatBits((float)guess);
+
+		//Ties go to the float with an even mantissa
+		for (;;)
+		{
+			int above = bits < FloatInfinityBits ? CompareWithHalfway(decimal, bits) : -1;
+			if (above > 0 || (above == 0 && (bits & 1) != 0))
+			{
+				++bits;
+				continue;
+			}
+
+			int below = bits > 0 ? CompareWithHalfway(decimal, bits - 1) : 1;
+			if (below < 0 || (below == 0 && ((bits - 1) & 1) == 0))
+			{
+				--bits;
+				continue;
+			}
+
+			return BitsToFloat(bits);
+		}
+	}
+}
+
+bool NumberParser::ParseFloat(const char*& ptr, const char* end, float& value)
+{
+	const char* p = ptr;
+
+	bool negative = false;
+	if (p < end && (*p == '-' || *p == '+'))
+	{
+		negative = *p == '-';
+		++p;
+	}
+
+	//Collect the first 19 significant digits into an integer and keep track of where the decimal point goes
+	uint64_t mantissa = 0;
+	int mantissaExponent = 0;
+	bool truncated = false;
+	size_t taken = 0;
+
+	const char* integerStart = p;
+	size_t integerDigits = ReadMantissaDigits(p, end, mantissa, taken, truncated);
+	const char* integerEnd = p;
+	mantissaExponent += (int)(integerDigits - taken);
+
+	const char* fractionStart = p;
+	const char* fractionEnd = p;
+	size_t fractionDigits = 0;
+
+	if (p < end && *p == '.')
+	{
+		fractionStart = ++p;
+		fractionDigits = ReadMantissaDigits(p, end, mantissa, taken, truncated);
+		fractionEnd = p;
+		mantissaExponent -= (int)taken;
+	}
+
+	if (integerDigits == 0 && fractionDigits == 0)
+	{
+		return false;
+	}
+
+	int exponent = 0;
+
+	if (p < end && (*p == 'e' || *p == 'E'))
+	{
+		//Only an exponent if there are digits, otherwise the 'e' is left for whoever comes next
+		const char* exponentStart = p + 1;
+		bool negativeExponent = exponentStart < end && *exponentStart == '-';
+
+		if (exponentStart < end && (*exponentStart == '-' || *exponentStart == '+'))
+		{
+			++exponentStart;
+		}
+
+		if (exponentStart < end && IsDigit(*exponentStart))
+		{
+			p = exponentStart;
+			exponent = ReadExponentDigits(p, end);
+			exponent = negativeExponent ? -exponent : exponent;
+		}
+	}
+
+	ptr = p;
+
+	float result = 0.0f;
+	int totalExponent = mantissaExponent + exponent;
+
+	if (mantissa == 0)
+	{
+		result = 0.0f;
+	}
+	else if (!truncated && mantissa <= (1 << 24) && totalExponent >= -10 && totalExponent <= 10)
+	{
+		//When both the digits and the power of 10 are exact floats, one multiply or divide rounds correctly
+		result = (float)mantissa;
+		result = totalExponent < 0 ? result / ExactFloatPowersOf10[-totalExponent] : result * ExactFloatPowersOf10[totalExponent];
+	}
+	else
+	{
+		bool exact = false;
+
+		if (totalExponent >= -22 && totalExponent <= 22)
+		{
+			//The same again in double precision is within a couple of double ulps of the true value, from rounding the mantissa, any digits
+			//past the 19th and the multiply or divide. Rounding that to a float can only go wrong if it's that close to halfway between two
+			//floats, in which case the digits have to decide.
+			double wide = (double)mantissa;
+			wide = totalExponent < 0 ? wide / ExactDoublePowersOf10[-totalExponent] : wide * ExactDoublePowersOf10[totalExponent];
+			result = (float)wide;
+
+			uint32_t bits = FloatBits(result);
+			float neighbour = BitsToFloat(wide > (double)result ? bits + 1 : bits - 1);
+			double halfway = ((double)result + (double)neighbour) * 0.5;
+			exact = fabs(wide - halfway) > wide * DoubleRoundingSlack;
+		}
+
+		if (!exact)
+		{
+			result = ParseExact(integerStart, integerEnd, fractionStart, fractionEnd, exponent, mantissa, mantissaExponent);
+		}
+	}
+
+	value = negative ? -result : result;
+	return true;
+}
+
+bool NumberParser::ParseInt(const char*& ptr, const char* end, int& value)
+{
+	const char* p = ptr;
+
+	bool negative = false;
+	if (p < end && (*p == '-' || *p == '+'))
+	{
+		negative = *p == '-';
+		++p;
+	}
+
+	//The magnitude stops growing once it's out of range, but the digits are still read past
+	const uint64_t limit = negative ? (uint64_t)INT_MAX + 1 : (uint64_t)INT_MAX;
+	uint64_t magnitude = 0;
+	const char* start = p;
+
+	while (p < end && IsDigit(*p))
+	{
+		if (magnitude <= limit)
+		{
+			magnitude = magnitude * 10 + (*p - '0');
+		}
+
+		++p;
+	}
+
+	if (p == start)
+	{
+		return false;
+	}
+
+	ptr = p;
+
+	if (magnitude > limit)
+	{
+		return false;
+	}
+
+	value = negative ? (int)(-(int64_t)magnitude) : (int)magnitude;
+	return true;
+}
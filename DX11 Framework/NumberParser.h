@@ -0,0 +1,24 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+//Locale independent number parsing for text asset formats, in the style of std::from_chars: a number has to start exactly at ptr (no
+//whitespace is skipped), ptr is moved past the characters that make it up, and nothing at or past end is ever read, so a memory mapped
+//file that isn't null terminated can be parsed in place.
+//
+//Digits go into a 64 bit integer one at a time (taking 8 at a time as a word was tried, and was slower on every OBJ file here since their
+//numbers are short). The value is then worked out with one float or double multiply or divide, and only numbers with large exponents or
+//that come out too close to halfway between two floats fall back to exact big integer arithmetic, so there's no strtof and no locale
+//involved.
+namespace NumberParser
+{
+	//Parses [+|-]digits[.digits][(e|E)[+|-]digits], or a number starting or ending with the decimal point, to the nearest float (ties to
+	//even), exactly as a correctly rounded strtof in the "C" locale would. Values too large for a float become infinity, too small zero.
+	//Fails without moving ptr if there are no digits.
+	bool ParseFloat(const char*& ptr, const char* end, float& value);
+
+	//Parses [+|-]digits. Fails without moving ptr if there are no digits, or after moving past them if the value doesn't fit in an int,
+	//leaving value alone either way.
+	bool ParseInt(const char*& ptr, const char* end, int& value);
+};
@@ -1,322 +1,549 @@
 #include "OBJLoader.h"
+#include "OBJTokenizer.h"
+#include "MappedFile.h"
+#include "MeshCache.h"
+#include "MeshCodec.h"
+#include "MeshOptimizer.h"
+#include "MeshSimplifier.h"
+#include <cstring>
 #include <string>
 
-bool OBJLoader::FindSimilarVertex(const SimpleVertex& vertex, std::map<SimpleVertex, unsigned short>& vertToIndexMap, unsigned short& index)
+OBJLoader::VertexHashMap::VertexHashMap(unsigned int expectedVertices)
 {
-	auto it = vertToIndexMap.find(vertex);
-	
-	if (it == vertToIndexMap.end())
+	//Keep the table at most half full so probe sequences stay short
+	unsigned int capacity = 16;
+	while (capacity < expectedVertices * 2)
 	{
-		return false;
+		capacity <<= 1;
+	}
+
+	Slot empty;
+	memset(&empty, 0, sizeof(empty));
+	empty.Index = EmptySlot;
+
+	_slots.assign(capacity, empty);
+	_mask = capacity - 1;
+	_count = 0;
+}
+
+void OBJLoader::VertexHashMap::PackKey(const SimpleVertex& vertex, unsigned int key[8])
+{
+	memcpy(&key[0], &vertex.Pos, sizeof(XMFLOAT3));
+	memcpy(&key[3], &vertex.Normal, sizeof(XMFLOAT3));
+	memcpy(&key[6], &vertex.TexC, sizeof(XMFLOAT2));
+}
+
+unsigned int OBJLoader::VertexHashMap::HashKey(const unsigned int key[8])
+{
+	//Multiply-rotate over each 32 bit word, then a final avalanche so nearby floats don't land in neighbouring slots
+	unsigned int hash = 0x9E3779B9;
+	for (int i = 0; i < 8; ++i)
+	{
+		hash ^= key[i] * 0xCC9E2D51;
+		hash = (hash << 13) | (hash >> 19);
+		hash = hash * 5 + 0xE6546B64;
+	}
+
+	hash ^= hash >> 16;
+	hash *= 0x85EBCA6B;
+	hash ^= hash >> 13;
+	hash *= 0xC2B2AE35;
+	hash ^= hash >> 16;
+
+	return hash;
+}
+
+bool OBJLoader::VertexHashMap::Find(const SimpleVertex& vertex, unsigned int& index) const
+{
+	unsigned int key[8];
+	PackKey(vertex, key);
+
+	//Linear probing -- walk forwards until we either hit the vertex or an empty slot
+	for (unsigned int slot = HashKey(key) & _mask;; slot = (slot + 1) & _mask)
+	{
+		const Slot& s = _slots[slot];
+
+		if (s.Index == EmptySlot)
+		{
+			return false;
+		}
+
+		if (memcmp(s.Key, key, sizeof(key)) == 0)
+		{
+			index = s.Index;
+			return true;
+		}
+	}
+}
+
+void OBJLoader::VertexHashMap::Insert(const SimpleVertex& vertex, unsigned int index)
+{
+	//Same half full limit as the constructor
+	if ((_count + 1) * 2 > _slots.size())
+	{
+		Grow();
+	}
+
+	unsigned int key[8];
+	PackKey(vertex, key);
+	InsertKey(key, index);
+	_count++;
+}
+
+void OBJLoader::VertexHashMap::InsertKey(const unsigned int key[8], unsigned int index)
+{
+	unsigned int slot = HashKey(key) & _mask;
+	while (_slots[slot].Index != EmptySlot)
+	{
+		slot = (slot + 1) & _mask;
+	}
+
+	memcpy(_slots[slot].Key, key, sizeof(_slots[slot].Key));
+	_slots[slot].Index = index;
+}
+
+void OBJLoader::VertexHashMap::Grow()
+{
+	std::vector<Slot> oldSlots;
+	oldSlots.swap(_slots);
+
+	Slot empty;
+	memset(&empty, 0, sizeof(empty));
+	empty.Index = EmptySlot;
+
+	_slots.assign(oldSlots.size() * 2, empty);
+	_mask = _slots.size() - 1;
+
+	for (size_t i = 0; i < oldSlots.size(); ++i)
+	{
+		if (oldSlots[i].Index != EmptySlot)
+		{
+			InsertKey(oldSlots[i].Key, oldSlots[i].Index);
+		}
+	}
+}
+
+bool OBJLoader::FindSimilarVertex(const SimpleVertex& vertex, const VertexHashMap& vertToIndexMap, unsigned int& index)
+{
+	return vertToIndexMap.Find(vertex, index);
+}
+
+unsigned int OBJLoader::ChooseIndexSize(unsigned int numVertices)
+{
+	return numVertices <= 0xFFFF ? sizeof(unsigned short) : sizeof(unsigned int);
+}
+
+void OBJLoader::PackIndices(const std::vector<unsigned int>& indices, unsigned int indexSize, std::vector<char>& packed)
+{
+	unsigned int numIndices = indices.size();
+	packed.resize((size_t)indexSize * numIndices);
+
+	if (numIndices == 0)
+	{
+		return;
+	}
+
+	if (indexSize == sizeof(unsigned int))
+	{
+		memcpy(packed.data(), indices.data(), sizeof(unsigned int) * numIndices);
 	}
 	else
 	{
-		index = it->second;
-		return true;
+		unsigned short* shortIndices = (unsigned short*)packed.data();
+		for (unsigned int i = 0; i < numIndices; ++i)
+		{
+			shortIndices[i] = (unsigned short)indices[i];
+		}
 	}
 }
 
-void OBJLoader::CreateIndices(const std::vector<XMFLOAT3>& inVertices, 
-							  const std::vector<XMFLOAT2>& inTexCoords, 
-							  const std::vector<XMFLOAT3>& inNormals, 
-							  std::vector<unsigned short>& outIndices, 
-							  std::vector<XMFLOAT3>& outVertices, 
-							  std::vector<XMFLOAT2>& outTexCoords, 
-							  std::vector<XMFLOAT3>& outNormals)
+void OBJLoader::CreateIndices(const OBJTokenizer::OBJFileData& objData, std::vector<unsigned int>& outIndices, std::vector<SimpleVertex>& outVertices)
 {
+	const std::vector<XMFLOAT3>& positions = objData.Positions;
+	const std::vector<XMFLOAT2>& texCoords = objData.TexCoords;
+	const std::vector<XMFLOAT3>& normals = objData.Normals;
+	const std::vector<unsigned int>& positionIndices = objData.PositionIndices;
+	const std::vector<unsigned int>& texCoordIndices = objData.TexCoordIndices;
+	const std::vector<unsigned int>& normalIndices = objData.NormalIndices;
+
+	unsigned int numCorners = positionIndices.size();
+
+	//Welded meshes usually end up with about as many vertices as the OBJ has of its most common attribute, the map grows if not
+	size_t expectedVertices = positions.size();
+	if (texCoords.size() > expectedVertices) expectedVertices = texCoords.size();
+	if (normals.size() > expectedVertices) expectedVertices = normals.size();
+	if (numCorners < expectedVertices) expectedVertices = numCorners;
+
 	// Mapping from an already-existing SimpleVertex to its corresponding index
-	std::map<SimpleVertex, unsigned short> vertToIndexMap;
+	VertexHashMap vertToIndexMap(expectedVertices);
 
-	std::pair<SimpleVertex, unsigned short> pair;
+	outIndices.resize(numCorners);
+	outVertices.reserve(expectedVertices);
 
-	int numVertices = inVertices.size();
-	
-	for(int i = 0; i < numVertices; ++i) //For each vertex
+	XMFLOAT3 zero3(0.0f, 0.0f, 0.0f);
+	XMFLOAT2 zero2(0.0f, 0.0f);
+
+	for(unsigned int i = 0; i < numCorners; ++i) //For each face corner
 	{
-		SimpleVertex vertex = {inVertices[i], inNormals[i],  inTexCoords[i]}; 
+		//Corners without a texture coordinate or normal (or with a bad index) just get zeroes
+		SimpleVertex vertex;
+		vertex.Pos = positionIndices[i] < positions.size() ? positions[positionIndices[i]] : zero3;
+		vertex.Normal = normalIndices[i] < normals.size() ? normals[normalIndices[i]] : zero3;
+		vertex.TexC = texCoordIndices[i] < texCoords.size() ? texCoords[texCoordIndices[i]] : zero2;
 
-		unsigned short index;
+		unsigned int index;
 		// See if a vertex already exists in the buffer that has the same attributes as this one
-		bool found = FindSimilarVertex(vertex, vertToIndexMap, index); 
-		
-		if(found) //if found, re-use it's index for the index buffer
-		{
-			outIndices.push_back(index);
-		}
-		else //if not found, add it to the buffer
+		bool found = FindSimilarVertex(vertex, vertToIndexMap, index);
+
+		if(!found) //if not found, add it to the buffer
 		{
-			outVertices.push_back(vertex.Pos);
-			outTexCoords.push_back(vertex.TexC);
-			outNormals.push_back(vertex.Normal);
-			
-			unsigned short newIndex = (unsigned short)outVertices.size() - 1;
-			
-			outIndices.push_back(newIndex);
-			
+			index = outVertices.size();
+			outVertices.push_back(vertex);
+
 			//Add it to the map
-			pair.first = vertex;
-			pair.second = newIndex;
-			
-			//vertToIndexMap.insert(pair);
+			vertToIndexMap.Insert(vertex, index);
 		}
+
+		outIndices[i] = index;
 	}
 }
 
-//WARNING: This code makes a big assumption -- that your models have texture coordinates AND normals which they should have anyway (else you can't do texturing and lighting!)
+//WARNING: Models without texture coordinates or normals will still load, but those corners get zeroes, so texturing and lighting won't work on them.
 //If your .obj file has no lines beginning with "vt" or "vn", then you'll need to change the Export settings in your modelling software so that it exports the texture coordinates 
 //and normals. If you still have no "vt" lines, you'll need to do some texture unwrapping, also known as UV unwrapping.
-MeshData OBJLoader::Load(char* filename, ID3D11Device* _pd3dDevice, bool invertTexCoords)
+bool OBJLoader::Load(const char* filename, MeshAsset& asset, bool invertTexCoords, bool compressVertices)
+{
+	CookResult result;
+	return LoadOrCook(filename, asset, invertTexCoords, compressVertices, false, false, result);
+}
+
+OBJLoader::CookResult OBJLoader::Cook(const char* filename, bool invertTexCoords, bool compressVertices, bool force, bool encodeStreams,
+	VertexCompression::CompressionError* compressionError)
+{
+	MeshAsset asset;
+	CookResult result;
+	LoadOrCook(filename, asset, invertTexCoords, compressVertices, encodeStreams, force, result, compressionError);
+
+	//Current, but not stored the way it was asked for
+	if (result == Cook_UpToDate && ((asset.Cache.GetHeader().Flags & MeshCache::Flag_EncodedStreams) != 0) != encodeStreams)
+	{
+		LoadOrCook(filename, asset, invertTexCoords, compressVertices, encodeStreams, true, result, compressionError);
+	}
+
+	return result;
+}
+
+bool OBJLoader::LoadCooked(const void* data, size_t size, MeshAsset& asset, bool compressVertices)
+{
+	asset.Clear();
+	asset.Format = compressVertices ? VertexFormat_Compressed : VertexFormat_Full;
+
+	if (asset.Cache.OpenMemory(data, size, compressVertices ? MeshCache::CompressedVertexLayout() : MeshCache::SimpleVertexLayout()) &&
+		ReadCache(asset, compressVertices))
+	{
+		return true;
+	}
+
+	asset.Clear();
+	return false;
+}
+
+bool OBJLoader::ReadCache(MeshAsset& asset, bool compressVertices)
 {
-	std::string binaryFilename = filename;
-	binaryFilename.append("Binary");
-	std::ifstream binaryInFile;
-	binaryInFile.open(binaryFilename, std::ios::in | std::ios::binary);
+	//Raw sections are pointed at straight in the cache's memory, so they go to CreateBuffer without being copied first
+	const MeshCacheHeader& header = asset.Cache.GetHeader();
+
+	uint64_t quantizationSize = 0;
+	const void* quantization = asset.Cache.GetSection(MeshCache::Section_Quantization, &quantizationSize);
+	uint64_t boundsSize = 0;
+	const void* bounds = asset.Cache.GetSection(MeshCache::Section_Bounds, &boundsSize);
+	uint64_t clustersSize = 0;
+	const MeshCluster* clusters = (const MeshCluster*)asset.Cache.GetSection(MeshCache::Section_Clusters, &clustersSize);
+	size_t numClusters = (size_t)(clustersSize / sizeof(MeshCluster));
+	uint64_t lodsSize = 0;
+	const MeshLod* lods = (const MeshLod*)asset.Cache.GetSection(MeshCache::Section_Lods, &lodsSize);
+	size_t numLods = (size_t)(lodsSize / sizeof(MeshLod));
+
+	//Levels of detail get drawn as index ranges too, and LOD 0 has to be the full mesh at the start of the buffer
+	bool lodsValid = lods && lodsSize % sizeof(MeshLod) == 0 && numLods >= 1 && numLods <= MeshSimplifier::MaxLods && lods[0].IndexStart == 0;
+	for (size_t l = 0; lodsValid && l < numLods; ++l)
+	{
+		lodsValid = lods[l].IndexCount <= header.IndexCount && lods[l].IndexStart <= header.IndexCount - lods[l].IndexCount;
+	}
 
-	if(!binaryInFile.good())
+	//Clusters get drawn as index ranges, so one pointing outside LOD 0 can't be let through
+	uint32_t lod0IndexCount = lodsValid ? lods[0].IndexCount : 0;
+	bool clustersValid = clusters && clustersSize % sizeof(MeshCluster) == 0;
+	for (size_t c = 0; clustersValid && c < numClusters; ++c)
 	{
-		std::ifstream inFile;
-		inFile.open(filename);
+		clustersValid = clusters[c].IndexCount <= lod0IndexCount && clusters[c].IndexStart <= lod0IndexCount - clusters[c].IndexCount;
+	}
 
-		if(!inFile.good())
+	//Compressed positions are meaningless without their quantization, so a cache missing it (or the bounds, clusters or levels of detail) is rebuilt
+	//like any other bad cache
+	if ((!compressVertices || (quantization && quantizationSize == sizeof(VertexCompression::PositionQuantization))) &&
+		bounds && boundsSize == sizeof(MeshBounds) && lodsValid && clustersValid)
+	{
+		if (compressVertices)
 		{
-			return MeshData();
+			memcpy(&asset.Quantization, quantization, sizeof(asset.Quantization));
 		}
-		else
+
+		memcpy(&asset.Bounds, bounds, sizeof(asset.Bounds));
+		asset.Clusters.assign(clusters, clusters + numClusters);
+		asset.Lods.assign(lods, lods + numLods);
+
+		asset.VertexStride = header.Layout.Stride;
+		asset.VertexCount = header.VertexCount;
+		asset.Vertices = asset.Cache.GetSection(MeshCache::Section_Vertices);
+		asset.IndexSize = header.IndexSize;
+		asset.IndexCount = header.IndexCount;
+		asset.Indices = asset.Cache.GetSection(MeshCache::Section_Indices);
+
+		//Encoded streams are decoded into the asset's own storage, raw ones stay in the cache's memory
+		uint64_t encodedSize = 0;
+		const void* encoded = nullptr;
+
+		if (!asset.Vertices)
 		{
-			//Vectors to store the vertex positions, normals and texture coordinates. Need to use vectors since they're resizeable and we have
-			//no way of knowing ahead of time how large these meshes will be
-			std::vector<XMFLOAT3> verts;
-			std::vector<XMFLOAT3> normals;
-			std::vector<XMFLOAT2> texCoords;
-
-			//DirectX uses 1 index buffer, OBJ is optimized for storage and not rendering and so uses 3 smaller index buffers.....great...
-			//We'll have to merge this into 1 index buffer which we'll do after loading in all of the required data.
-			std::vector<unsigned short> vertIndices;
-			std::vector<unsigned short> normalIndices;
-			std::vector<unsigned short> textureIndices;
-
-			std::string input;
-
-			XMFLOAT3 vert;
-			XMFLOAT2 texCoord;
-			XMFLOAT3 normal;
-			unsigned short vInd[3]; //indices for the vertex position
-			unsigned short tInd[3]; //indices for the texture coordinate
-			unsigned short nInd[3]; //indices for the normal
-			std::string beforeFirstSlash;
-			std::string afterFirstSlash;
-			std::string afterSecondSlash;
-
-			while(!inFile.eof()) //While we have yet to reach the end of the file...
+			//The counts come from the header, so they're checked against what the section could hold before they're allocated
+			encoded = asset.Cache.GetSection(MeshCache::Section_EncodedVertices, &encodedSize);
+			if (!encoded || !MeshCodec::CanHoldVertices((size_t)encodedSize, asset.VertexCount, asset.VertexStride))
 			{
-				inFile >> input; //Get the next input from the file
-
-				//Check what type of input it was, we are only interested in vertex positions, texture coordinates, normals and indices, nothing else
-				if(input.compare("v") == 0) //Vertex position
-				{
-					inFile >> vert.x;
-					inFile >> vert.y;
-					inFile >> vert.z;
-
-					verts.push_back(vert);
-				}
-				else if(input.compare("vt") == 0) //Texture coordinate
-				{
-					inFile >> texCoord.x;
-					inFile >> texCoord.y;
-
-					if(invertTexCoords) texCoord.y = 1.0f - texCoord.y;
-
-					texCoords.push_back(texCoord);
-				}
-				else if(input.compare("vn") == 0) //Normal
-				{
-					inFile >> normal.x;
-					inFile >> normal.y;
-					inFile >> normal.z;
-
-					normals.push_back(normal);
-				}
-				else if(input.compare("f") == 0) //Face
-				{
-					for(int i = 0; i < 3; ++i)
-					{
-						inFile >> input;
-						int slash = input.find("/"); //Find first forward slash
-						int secondSlash = input.find("/", slash + 1); //Find second forward slash
-
-						//Extract from string
-						beforeFirstSlash = input.substr(0, slash); //The vertex position index
-						afterFirstSlash = input.substr(slash + 1, secondSlash - slash - 1); //The texture coordinate index
-						afterSecondSlash = input.substr(secondSlash + 1); //The normal index
-
-						//Parse into int
-						vInd[i] = (unsigned short)atoi(beforeFirstSlash.c_str()); //atoi = "ASCII to int"
-						tInd[i] = (unsigned short)atoi(afterFirstSlash.c_str());
-						nInd[i] = (unsigned short)atoi(afterSecondSlash.c_str());
-					}
-
-					//Place into vectors
-					for(int i = 0; i < 3; ++i)
-					{
-						vertIndices.push_back(vInd[i] - 1);		//Minus 1 from each as these as OBJ indexes start from 1 whereas C++ arrays start from 0
-						textureIndices.push_back(tInd[i] - 1);	//which is really annoying. Apart from Lua and SQL, there's not much else that has indexing 
-						normalIndices.push_back(nInd[i] - 1);	//starting at 1. So many more languages index from 0, the .OBJ people screwed up there.
-					}
-				}
+				return false;
 			}
-			inFile.close(); //Finished with input file now, all the data we need has now been loaded in
-
-			//Get vectors to be of same size, ready for singular indexing
-			std::vector<XMFLOAT3> expandedVertices;
-			std::vector<XMFLOAT3> expandedNormals;
-			std::vector<XMFLOAT2> expandedTexCoords;
-			unsigned int numIndices = vertIndices.size();
-			for(unsigned int i = 0; i < numIndices; i++)
+
+			asset.VertexStorage.resize((size_t)asset.VertexStride * asset.VertexCount);
+
+			if (!MeshCodec::DecodeVertices(encoded, (size_t)encodedSize, asset.VertexStorage.data(), asset.VertexCount, asset.VertexStride))
 			{
-				expandedVertices.push_back(verts[vertIndices[i]]);
-				expandedTexCoords.push_back(texCoords[textureIndices[i]]);
-				expandedNormals.push_back(normals[normalIndices[i]]);
+				return false;
 			}
 
-			//Now to (finally) form the final vertex, texture coord, normal list and single index buffer using the above expanded vectors
-			std::vector<unsigned short> meshIndices;
-			meshIndices.reserve(numIndices);
-			std::vector<XMFLOAT3> meshVertices;
-			meshVertices.reserve(expandedVertices.size());
-			std::vector<XMFLOAT3> meshNormals;
-			meshNormals.reserve(expandedNormals.size());
-			std::vector<XMFLOAT2> meshTexCoords;
-			meshTexCoords.reserve(expandedTexCoords.size());
+			asset.Vertices = asset.VertexStorage.data();
+		}
 
-			CreateIndices(expandedVertices, expandedTexCoords, expandedNormals, meshIndices, meshVertices, meshTexCoords, meshNormals);
+		if (!asset.Indices)
+		{
+			encoded = asset.Cache.GetSection(MeshCache::Section_EncodedIndices, &encodedSize);
+			if (!encoded || !MeshCodec::CanHoldIndices((size_t)encodedSize, asset.IndexCount))
+			{
+				return false;
+			}
 
-			MeshData meshData;
+			asset.IndexStorage.resize((size_t)asset.IndexSize * asset.IndexCount);
 
-			//Turn data from vector form to arrays
-			SimpleVertex* finalVerts = new SimpleVertex[meshVertices.size()];
-			unsigned int numMeshVertices = meshVertices.size();
-			for(unsigned int i = 0; i < numMeshVertices; ++i)
+			if (!MeshCodec::DecodeIndices(encoded, (size_t)encodedSize, asset.IndexStorage.data(), asset.IndexCount, asset.IndexSize))
 			{
-				finalVerts[i].Pos = meshVertices[i];
-				finalVerts[i].Normal = meshNormals[i];
-				finalVerts[i].TexC = meshTexCoords[i];
+				return false;
 			}
 
-			//Put data into vertex and index buffers, then pass the relevant data to the MeshData object.
-			//The rest of the code will hopefully look familiar to you, as it's similar to whats in your InitVertexBuffer and InitIndexBuffer methods
-			ID3D11Buffer* vertexBuffer;
+			asset.Indices = asset.IndexStorage.data();
+		}
 
-			D3D11_BUFFER_DESC bd;
-			ZeroMemory(&bd, sizeof(bd));
-			bd.Usage = D3D11_USAGE_DEFAULT;
-			bd.ByteWidth = sizeof(SimpleVertex) * meshVertices.size();
-			bd.BindFlags = D3D11_BIND_VERTEX_BUFFER;
-			bd.CPUAccessFlags = 0;
+		MeshSubmesh submesh = { 0, asset.Lods[0].IndexCount };
+		asset.Submeshes.push_back(submesh);
 
-			D3D11_SUBRESOURCE_DATA InitData;
-			ZeroMemory(&InitData, sizeof(InitData));
-			InitData.pSysMem = finalVerts;
+		return true;
+	}
 
-			_pd3dDevice->CreateBuffer(&bd, &InitData, &vertexBuffer);
+	return false;
+}
 
-			meshData.VertexBuffer = vertexBuffer;
-			meshData.VBOffset = 0;
-			meshData.VBStride = sizeof(SimpleVertex);
+bool OBJLoader::LoadOrCook(const char* filename, MeshAsset& asset, bool invertTexCoords, bool compressVertices, bool encodeStreams, bool forceCook,
+	CookResult& result, VertexCompression::CompressionError* compressionError)
+{
+	asset.Clear();
+	result = Cook_Failed;
 
-			unsigned short* indicesArray = new unsigned short[meshIndices.size()];
-			unsigned int numMeshIndices = meshIndices.size();
-			for(unsigned int i = 0; i < numMeshIndices; ++i)
-			{
-				indicesArray[i] = meshIndices[i];
-			}
+	//Cooks of the same file with different options live side by side, so switching a mesh between them doesn't rebuild the cache every run
+	std::string cacheFilename = filename;
+	cacheFilename.append(MeshCache::CacheSuffix(invertTexCoords, compressVertices));
 
-			//Output data into binary file, the next time you run this function, the binary file will exist and will load that instead which is much quicker than parsing into vectors
-			std::ofstream outbin(binaryFilename.c_str(), std::ios::out | std::ios::binary);
-			outbin.write((char*)&numMeshVertices, sizeof(unsigned int));
-			outbin.write((char*)&numMeshIndices, sizeof(unsigned int));
-			outbin.write((char*)finalVerts, sizeof(SimpleVertex) * numMeshVertices);
-			outbin.write((char*)indicesArray, sizeof(unsigned short) * numMeshIndices);
-			outbin.close();
+	asset.Format = compressVertices ? VertexFormat_Compressed : VertexFormat_Full;
+	const MeshCache::VertexLayout& vertexLayout = compressVertices ? MeshCache::CompressedVertexLayout() : MeshCache::SimpleVertexLayout();
 
-			ID3D11Buffer* indexBuffer;
+	//Map the whole source file -- we need it to check the cache is up to date, and to rebuild the cache if it isn't.
+	//If only the cache was shipped there's nothing to compare against, so the cache is trusted as long as it's well formed.
+	MappedFile inFile;
+	bool haveSource = inFile.Open(filename);
+	uint64_t sourceHash = haveSource ? MeshCache::HashSource(inFile.GetData(), inFile.GetSize(), invertTexCoords, compressVertices) : 0;
 
-			ZeroMemory(&bd, sizeof(bd));
-			bd.Usage = D3D11_USAGE_DEFAULT;
-			bd.ByteWidth = sizeof(WORD) * meshIndices.size();     
-			bd.BindFlags = D3D11_BIND_INDEX_BUFFER;
-			bd.CPUAccessFlags = 0;
+	if (!forceCook && asset.Cache.Open(cacheFilename.c_str(), vertexLayout, haveSource, sourceHash))
+	{
+		if (ReadCache(asset, compressVertices))
+		{
+			result = Cook_UpToDate;
+			return true;
+		}
 
-			ZeroMemory(&InitData, sizeof(InitData));
-			InitData.pSysMem = indicesArray;
-			_pd3dDevice->CreateBuffer(&bd, &InitData, &indexBuffer);
+		//A stream that failed to decode may have left the asset half filled in
+		asset.Clear();
+	}
 
-			meshData.IndexCount = meshIndices.size();
-			meshData.IndexBuffer = indexBuffer;
+	if (!haveSource)
+	{
+		return false;
+	}
+
+	//DirectX uses 1 index buffer, OBJ is optimized for storage and not rendering and so uses 3 smaller index buffers.....great...
+	//We'll have to merge this into 1 index buffer, which CreateIndices does as it welds.
+	//Big files get split across every hardware thread, small ones are parsed serially either way
+	OBJTokenizer::OBJFileData objData;
+	OBJTokenizer::ParseParallel(inFile.GetData(), inFile.GetSize(), invertTexCoords, 0, objData);
+	uint64_t sourceSize = inFile.GetSize();
+	inFile.Close(); //Finished with input file now, all the data we need has now been loaded in
+
+	//Weld the face corners straight into the final interleaved vertices, then the parsed arrays aren't needed any more
+	std::vector<unsigned int> meshIndices;
+	std::vector<SimpleVertex> finalVerts;
+	CreateIndices(objData, meshIndices, finalVerts);
+	objData = OBJTokenizer::OBJFileData();
+
+	//Simplify before anything reorders the triangles, the levels only pick out vertices of the full mesh so they can all share its vertex buffer.
+	//This works on the exact vertices, even for compressed meshes.
+	std::vector<std::vector<unsigned int> > lodIndices;
+	std::vector<float> lodErrors;
+	MeshSimplifier::BuildLods(meshIndices, finalVerts.data(), finalVerts.size(), lodIndices, lodErrors);
+
+	//Reorder the triangles so neighbouring ones share vertices while they're still in the post-transform cache
+	MeshOptimizer::OptimizeVertexCache(meshIndices, finalVerts.size());
+	for (size_t l = 0; l < lodIndices.size(); ++l)
+	{
+		MeshOptimizer::OptimizeVertexCache(lodIndices[l], finalVerts.size());
+	}
+
+	//Group the triangles into clusters that can be culled on their own. This only moves whole clusters around in the index buffer,
+	//so the cache order above mostly survives, and the vertex reorder below doesn't touch the cluster bounds.
+	//The clusters have to describe what the GPU draws, so compressed meshes are clustered on their quantized positions -- otherwise a sliver
+	//whose facing flips when it's snapped to the grid can get culled while it's on screen.
+	std::vector<SimpleVertex> quantizedVerts;
+	const SimpleVertex* clusterVerts = finalVerts.data();
 
-			//This data has now been sent over to the GPU so we can delete this CPU-side stuff
-			delete [] indicesArray;
-			delete [] finalVerts;
+	if (compressVertices && !finalVerts.empty())
+	{
+		asset.Quantization = VertexCompression::ComputeQuantization(finalVerts.data(), finalVerts.size());
 
-			return meshData;
-		}	
+		std::vector<CompressedVertex> compressed(finalVerts.size());
+		quantizedVerts.resize(finalVerts.size());
+		VertexCompression::Compress(finalVerts.data(), finalVerts.size(), asset.Quantization, compressed.data());
+		VertexCompression::Decompress(compressed.data(), compressed.size(), asset.Quantization, quantizedVerts.data());
+		clusterVerts = quantizedVerts.data();
 	}
-	else
+
+	//Only the full mesh is clustered, the simplified levels are for meshes far enough away that culling them piecemeal isn't worth the draw calls
+	MeshOptimizer::BuildClusters(meshIndices, finalVerts.size(), finalVerts.empty() ? nullptr : &clusterVerts[0].Pos, sizeof(SimpleVertex), asset.Clusters);
+	std::vector<SimpleVertex>().swap(quantizedVerts);
+
+	//The levels go one after the other in the one index buffer, the full mesh first
+	MeshLod lod0 = { 0, (uint32_t)meshIndices.size(), 0.0f, 0 };
+	asset.Lods.push_back(lod0);
+
+	for (size_t l = 0; l < lodIndices.size(); ++l)
 	{
-		MeshData meshData;
-		unsigned int numVertices;
-		unsigned int numIndices;
-
-		//Read in array sizes
-		binaryInFile.read((char*)&numVertices, sizeof(unsigned int));
-		binaryInFile.read((char*)&numIndices, sizeof(unsigned int));
-		
-		//Read in data from binary file
-		SimpleVertex* finalVerts = new SimpleVertex[numVertices];
-		unsigned short* indices = new unsigned short[numIndices];
-		binaryInFile.read((char*)finalVerts, sizeof(SimpleVertex) * numVertices);
-		binaryInFile.read((char*)indices, sizeof(unsigned short) * numIndices);
-
-		//Put data into vertex and index buffers, then pass the relevant data to the MeshData object.
-		//The rest of the code will hopefully look familiar to you, as it's similar to whats in your InitVertexBuffer and InitIndexBuffer methods
-		ID3D11Buffer* vertexBuffer;
-
-		D3D11_BUFFER_DESC bd;
-		ZeroMemory(&bd, sizeof(bd));
-		bd.Usage = D3D11_USAGE_DEFAULT;
-		bd.ByteWidth = sizeof(SimpleVertex) * numVertices;
-		bd.BindFlags = D3D11_BIND_VERTEX_BUFFER;
-		bd.CPUAccessFlags = 0;
-
-		D3D11_SUBRESOURCE_DATA InitData;
-		ZeroMemory(&InitData, sizeof(InitData));
-		InitData.pSysMem = finalVerts;
-
-		_pd3dDevice->CreateBuffer(&bd, &InitData, &vertexBuffer);
-
-		meshData.VertexBuffer = vertexBuffer;
-		meshData.VBOffset = 0;
-		meshData.VBStride = sizeof(SimpleVertex);
-
-		ID3D11Buffer* indexBuffer;
-
-		ZeroMemory(&bd, sizeof(bd));
-		bd.Usage = D3D11_USAGE_DEFAULT;
-		bd.ByteWidth = sizeof(WORD) * numIndices;     
-		bd.BindFlags = D3D11_BIND_INDEX_BUFFER;
-		bd.CPUAccessFlags = 0;
-
-		ZeroMemory(&InitData, sizeof(InitData));
-		InitData.pSysMem = indices;
-		_pd3dDevice->CreateBuffer(&bd, &InitData, &indexBuffer);
-
-		meshData.IndexCount = numIndices;
-		meshData.IndexBuffer = indexBuffer;
-
-		//This data has now been sent over to the GPU so we can delete this CPU-side stuff
-		delete [] indices;
-		delete [] finalVerts;
-
-		return meshData;
+		MeshLod lod = { (uint32_t)meshIndices.size(), (uint32_t)lodIndices[l].size(), lodErrors[l], 0 };
+		asset.Lods.push_back(lod);
+		meshIndices.insert(meshIndices.end(), lodIndices[l].begin(), lodIndices[l].end());
+	}
+
+	lodIndices.clear();
+
+	//...then put the vertices in the order the new index buffer uses them, so vertex fetch reads memory front to back.
+	//LOD 0 comes first in the index buffer, so it decides the order, and the levels after it use a subset of the same vertices.
+	unsigned int numMeshVertices = MeshOptimizer::OptimizeVertexFetch(finalVerts.data(), finalVerts.size(), sizeof(SimpleVertex), meshIndices);
+	finalVerts.resize(numMeshVertices);
+
+	//Bounds come from the exact positions, before any quantization
+	asset.Bounds = Bounds::Compute(numMeshVertices > 0 ? &finalVerts[0].Pos : nullptr, numMeshVertices, sizeof(SimpleVertex));
+
+	asset.VertexStride = vertexLayout.Stride;
+	asset.VertexCount = numMeshVertices;
+	asset.VertexStorage.resize((size_t)asset.VertexStride * numMeshVertices);
+
+	//Quantize last, so the welding and reordering above work on the exact vertices either way
+	if (compressVertices)
+	{
+		//Quantization was worked out for the clusters above. Every welded vertex is referenced, so the vertex reorder didn't change the bounds it came from.
+		VertexCompression::Compress(finalVerts.data(), numMeshVertices, asset.Quantization, (CompressedVertex*)asset.VertexStorage.data());
+
+		if (compressionError)
+		{
+			*compressionError = VertexCompression::MeasureError(finalVerts.data(), (const CompressedVertex*)asset.VertexStorage.data(), numMeshVertices,
+				asset.Quantization);
+		}
 	}
-}
\ No newline at end of file
+	else if (numMeshVertices > 0)
+	{
+		memcpy(asset.VertexStorage.data(), finalVerts.data(), sizeof(SimpleVertex) * numMeshVertices);
+	}
+
+	//Only go to 32 bit indices if this mesh actually needs them
+	asset.IndexSize = ChooseIndexSize(numMeshVertices);
+	asset.IndexCount = meshIndices.size();
+	PackIndices(meshIndices, asset.IndexSize, asset.IndexStorage);
+
+	asset.Vertices = asset.VertexStorage.data();
+	asset.Indices = asset.IndexStorage.data();
+
+	//The OBJ's groups aren't kept by the tokenizer, so the whole mesh is one submesh
+	MeshSubmesh submesh = { 0, asset.Lods[0].IndexCount };
+	asset.Submeshes.push_back(submesh);
+
+	//Output the cooked mesh into the cache file, the next time you run this function the cache will be up to date and will be loaded instead,
+	//which is much quicker than parsing into vectors
+	MeshCacheHeader header;
+	memset(&header, 0, sizeof(header));
+	header.SourceHash = sourceHash;
+	header.SourceSize = sourceSize;
+	header.VertexCount = asset.VertexCount;
+	header.IndexCount = asset.IndexCount;
+	header.IndexSize = asset.IndexSize;
+	header.Flags = encodeStreams ? MeshCache::Flag_EncodedStreams : 0;
+	header.Layout = vertexLayout;
+
+	//When asked for, each stream is stored encoded only if that's at most 7/8 of its raw size, otherwise saving under an eighth isn't worth
+	//a decode on every load and it stays raw. The vertices and indices are tested separately, so a cache can have one of each.
+	std::vector<uint8_t> encodedVertices;
+	std::vector<uint8_t> encodedIndices;
+	if (encodeStreams)
+	{
+		MeshCodec::EncodeVertices(asset.Vertices, asset.VertexCount, asset.VertexStride, encodedVertices);
+		MeshCodec::EncodeIndices(asset.Indices, asset.IndexCount, asset.IndexSize, encodedIndices);
+	}
+
+	std::vector<MeshCacheSection> sections;
+	MeshCacheSection vertexSection = { MeshCache::Section_Vertices, asset.Vertices, (uint64_t)asset.VertexStorage.size() };
+	MeshCacheSection indexSection = { MeshCache::Section_Indices, asset.Indices, (uint64_t)asset.IndexStorage.size() };
+
+	if (encodeStreams && encodedVertices.size() <= asset.VertexStorage.size() / 8 * 7)
+	{
+		MeshCacheSection encodedSection = { MeshCache::Section_EncodedVertices, encodedVertices.data(), (uint64_t)encodedVertices.size() };
+		vertexSection = encodedSection;
+	}
+
+	if (encodeStreams && encodedIndices.size() <= asset.IndexStorage.size() / 8 * 7)
+	{
+		MeshCacheSection encodedSection = { MeshCache::Section_EncodedIndices, encodedIndices.data(), (uint64_t)encodedIndices.size() };
+		indexSection = encodedSection;
+	}
+
+	MeshCacheSection boundsSection = { MeshCache::Section_Bounds, &asset.Bounds, (uint64_t)sizeof(asset.Bounds) };
+	MeshCacheSection clustersSection = { MeshCache::Section_Clusters, asset.Clusters.data(), (uint64_t)(asset.Clusters.size() * sizeof(MeshCluster)) };
+	MeshCacheSection lodsSection = { MeshCache::Section_Lods, asset.Lods.data(), (uint64_t)(asset.Lods.size() * sizeof(MeshLod)) };
+	sections.push_back(vertexSection);
+	sections.push_back(indexSection);
+	sections.push_back(boundsSection);
+	sections.push_back(clustersSection);
+	sections.push_back(lodsSection);
+
+	if (compressVertices)
+	{
+		MeshCacheSection quantizationSection = { MeshCache::Section_Quantization, &asset.Quantization, (uint64_t)sizeof(asset.Quantization) };
+		sections.push_back(quantizationSection);
+	}
+
+	//A cache that can't be written only costs the next load a re-parse, the mesh itself is fine
+	result = WriteMeshCache(cacheFilename.c_str(), header, sections) ? Cook_Cooked : Cook_Failed;
+
+	return true;
+}
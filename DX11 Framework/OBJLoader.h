@@ -1,25 +1,89 @@
 #pragma once
-#include <windows.h>
-#include <d3d11_1.h>
 #include <directxmath.h>
-#include <fstream>		//For loading in an external file
 #include <vector>		//For storing the XMFLOAT3/2 variables
-#include <map>			//For fast searching when re-creating the index buffer
 
-#include "Structures.h"
+#include "VertexFormats.h"
+#include "VertexCompression.h"
+#include "MeshAsset.h"
+#include "OBJTokenizer.h"
 
 using namespace DirectX;
 
 
 namespace OBJLoader
 {
-	//The only method you'll need to call
-	MeshData Load(char* filename, ID3D11Device* _pd3dDevice, bool invertTexCoords = true);
+	//Open-addressing hash table from a vertex's packed position/normal/texcoord bits to its index in the welded vertex buffer.
+	//Two vertices are only welded if every bit matches, so this never changes what ends up on screen.
+	class VertexHashMap
+	{
+	public:
+		//The table grows as needed, expectedVertices just sizes it up front
+		VertexHashMap(unsigned int expectedVertices);
+
+		bool Find(const SimpleVertex& vertex, unsigned int& index) const;
+		void Insert(const SimpleVertex& vertex, unsigned int index);
+
+	private:
+		static const unsigned int EmptySlot = 0xFFFFFFFF;
+
+		struct Slot
+		{
+			unsigned int Key[8];	//The raw bits of Pos, Normal and TexC
+			unsigned int Index;		//EmptySlot if nothing has been stored here yet
+		};
+
+		static void PackKey(const SimpleVertex& vertex, unsigned int key[8]);
+		static unsigned int HashKey(const unsigned int key[8]);
+
+		void InsertKey(const unsigned int key[8], unsigned int index);
+		void Grow();
+
+		std::vector<Slot> _slots;
+		unsigned int _mask;
+		unsigned int _count;
+	};
+
+	//The only method you'll need to call. Loads (from the cache if it's up to date, otherwise by parsing and cooking the OBJ) into
+	//a CPU side MeshAsset -- no device is involved, pass the result to MeshUpload::Upload to get GPU buffers. Returns false on failure.
+	//compressVertices stores the mesh as 16 byte CompressedVertex instead of 32 byte SimpleVertex -- draw those with VSCompressed and its input layout.
+	bool Load(const char* filename, MeshAsset& asset, bool invertTexCoords = true, bool compressVertices = false);
+
+	enum CookResult
+	{
+		Cook_UpToDate,		//The cache was already current for this source and these options
+		Cook_Cooked,		//The cache was (re)written
+		Cook_Failed,		//The source couldn't be read, or the cache couldn't be written
+	};
+
+	//For the offline cooker: brings the cache for filename up to date without keeping the mesh, so the runtime only ever has to map it.
+	//force rebuilds the cache even when it's current. encodeStreams stores the vertices and indices MeshCodec encoded, for a smaller file
+	//that costs a decode on every load. A cache cooked the other way is rebuilt. Load keeps raw or encoded caches as they are.
+	//When a compressed mesh is cooked, compressionError (if given) gets how far its vertices ended up from the exact ones.
+	CookResult Cook(const char* filename, bool invertTexCoords = true, bool compressVertices = false, bool force = false, bool encodeStreams = false,
+		VertexCompression::CompressionError* compressionError = nullptr);
+
+	//Loads a mesh that was already cooked into memory, such as a cache inside an AssetPack. Nothing is copied: the asset points into data,
+	//so it has to stay valid until the asset has been uploaded. Fails if the cache isn't a well formed cook with compressVertices' vertex layout.
+	bool LoadCooked(const void* data, size_t size, MeshAsset& asset, bool compressVertices);
 
 	//Helper methods for the above method
+	//Load and Cook are both this: takes the cache if it's current and forceCook isn't set, otherwise parses the OBJ and rewrites the cache
+	bool LoadOrCook(const char* filename, MeshAsset& asset, bool invertTexCoords, bool compressVertices, bool encodeStreams, bool forceCook,
+		CookResult& result, VertexCompression::CompressionError* compressionError = nullptr);
+
+	//Fills in asset from the cache it has open, checking every section the renderer will index with. Returns false if anything is missing or out of range.
+	bool ReadCache(MeshAsset& asset, bool compressVertices);
+
 	//Searhes to see if a similar vertex already exists in the buffer -- if true, we re-use that index
-	bool FindSimilarVertex(const SimpleVertex& vertex, std::map<SimpleVertex, unsigned short>& vertToIndexMap, unsigned short& index);
+	bool FindSimilarVertex(const SimpleVertex& vertex, const VertexHashMap& vertToIndexMap, unsigned int& index);
+
+	//Re-creates a single index buffer from the 3 given in the OBJ file, welding each face corner's (v, vt, vn) straight into outVertices in one pass
+	void CreateIndices(const OBJTokenizer::OBJFileData& objData, std::vector<unsigned int>& outIndices, std::vector<SimpleVertex>& outVertices);
+
+	//16 bit indices halve the index bandwidth, so we only fall back to 32 bit when a mesh has too many vertices to address with them.
+	//Returns the index size in bytes, 2 or 4.
+	unsigned int ChooseIndexSize(unsigned int numVertices);
 
-	//Re-creates a single index buffer from the 3 given in the OBJ file
-	void CreateIndices(const std::vector<XMFLOAT3>& inVertices, const std::vector<XMFLOAT2>& inTexCoords, const std::vector<XMFLOAT3>& inNormals, std::vector<unsigned short>& outIndices, std::vector<XMFLOAT3>& outVertices, std::vector<XMFLOAT2>& outTexCoords, std::vector<XMFLOAT3>& outNormals);
+	//Packs 32 bit indices down into indexSize (2 or 4) byte indices
+	void PackIndices(const std::vector<unsigned int>& indices, unsigned int indexSize, std::vector<char>& packed);
 };
\ No newline at end of file
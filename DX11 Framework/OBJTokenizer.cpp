@@ -0,0 +1,356 @@
+#include "OBJTokenizer.h"
+#include "NumberParser.h"
+#include <cstdint>
+#include <cstring>
+#include <thread>
+
+namespace
+{
+	inline bool IsDigit(char c)
+	{
+		return (unsigned char)(c - '0') < 10;
+	}
+
+	inline bool IsSpace(char c)
+	{
+		return c == ' ' || c == '\t';
+	}
+
+	inline void SkipSpaces(const char*& ptr, const char* end)
+	{
+		while (ptr < end && IsSpace(*ptr))
+		{
+			++ptr;
+		}
+	}
+
+	inline void SkipLine(const char*& ptr, const char* end)
+	{
+		const char* newLine = (const char*)memchr(ptr, '\n', end - ptr);
+		ptr = newLine ? newLine + 1 : end;
+	}
+
+	//True if the keyword at ptr is exactly "keyword" followed by whitespace
+	inline bool MatchKeyword(const char* ptr, const char* end, const char* keyword, size_t length)
+	{
+		return (size_t)(end - ptr) > length && memcmp(ptr, keyword, length) == 0 && IsSpace(ptr[length]);
+	}
+
+	//When a chunk is parsed on its own it doesn't know how many elements came before it, so negative (relative) indices
+	//are resolved against the chunk's own arrays, biased (they can point back into an earlier chunk) and tagged with this bit.
+	//The merge step then adds the chunk's starting offset.
+	const unsigned int ChunkRelativeFlag = 0x80000000;
+	const int ChunkRelativeBias = 0x40000000;
+
+	//OBJ indices start at 1, and negative ones count backwards from the most recent element
+	inline unsigned int ResolveIndex(int index, size_t count, unsigned int relativeFlag)
+	{
+		//In 64 bits, so an index of INT_MIN (which has no positive int) from a hostile file can't overflow
+		int64_t fromEnd = (int64_t)count + index;
+
+		if (index > 0)
+		{
+			return (unsigned int)(index - 1);
+		}
+		else if (index < 0 && relativeFlag && fromEnd >= -ChunkRelativeBias)
+		{
+			return (unsigned int)(fromEnd + ChunkRelativeBias) | relativeFlag;
+		}
+		else if (index < 0 && !relativeFlag && fromEnd >= 0)
+		{
+			return (unsigned int)fromEnd;
+		}
+
+		return OBJTokenizer::MissingIndex;
+	}
+
+	//A missing or malformed number reads as 0, which for an index means there isn't one
+	inline float ReadFloat(const char*& ptr, const char* end)
+	{
+		SkipSpaces(ptr, end);
+
+		float value = 0.0f;
+		NumberParser::ParseFloat(ptr, end, value);
+		return value;
+	}
+
+	inline int ReadInt(const char*& ptr, const char* end)
+	{
+		int value = 0;
+		NumberParser::ParseInt(ptr, end, value);
+		return value;
+	}
+
+	//Reads a face index. Fails if there were no digits, ptr is left where it was then, so a caller that carried on would never get past it.
+	inline bool ReadIndex(const char*& ptr, const char* end, size_t count, unsigned int relativeFlag, unsigned int& index)
+	{
+		const char* start = ptr;
+		index = ResolveIndex(ReadInt(ptr, end), count, relativeFlag);
+		return ptr != start;
+	}
+
+	//Where a texture coordinate or normal index would go but there's none, as in "1//2" or "1/2/", which reads as missing
+	inline bool IsEmptyField(const char* ptr, const char* end)
+	{
+		return ptr >= end || *ptr == '/' || IsSpace(*ptr) || *ptr == '\r' || *ptr == '\n';
+	}
+
+	struct Corner
+	{
+		unsigned int Position;
+		unsigned int TexCoord;
+		unsigned int Normal;
+	};
+
+	//Reads one "v", "v/t", "v//n" or "v/t/n" face corner. Fails on anything else where a number should be, such as a sign with no digits
+	//after it, which ends the face there.
+	bool ParseCorner(const char*& ptr, const char* end, const OBJTokenizer::OBJFileData& data, unsigned int relativeFlag, Corner& corner)
+	{
+		SkipSpaces(ptr, end);
+
+		if (ptr >= end || !(IsDigit(*ptr) || *ptr == '-'))
+		{
+			return false;
+		}
+
+		if (!ReadIndex(ptr, end, data.Positions.size(), relativeFlag, corner.Position))
+		{
+			return false;
+		}
+
+		corner.TexCoord = OBJTokenizer::MissingIndex;
+		corner.Normal = OBJTokenizer::MissingIndex;
+
+		if (ptr < end && *ptr == '/')
+		{
+			++ptr;
+
+			if (!IsEmptyField(ptr, end) && !ReadIndex(ptr, end, data.TexCoords.size(), relativeFlag, corner.TexCoord))
+			{
+				return false;
+			}
+
+			if (ptr < end && *ptr == '/')
+			{
+				++ptr;
+
+				if (!IsEmptyField(ptr, end) && !ReadIndex(ptr, end, data.Normals.size(), relativeFlag, corner.Normal))
+				{
+					return false;
+				}
+			}
+		}
+
+		return true;
+	}
+
+	inline void PushCorner(OBJTokenizer::OBJFileData& out, const Corner& corner)
+	{
+		out.PositionIndices.push_back(corner.Position);
+		out.TexCoordIndices.push_back(corner.TexCoord);
+		out.NormalIndices.push_back(corner.Normal);
+	}
+}
+
+void OBJTokenizer::Parse(const char* data, size_t size, bool invertTexCoords, OBJFileData& out)
+{
+	ParseRange(data, data + size, invertTexCoords, 0, out);
+}
+
+void OBJTokenizer::ParseRange(const char* begin, const char* end, bool invertTexCoords, unsigned int relativeFlag, OBJFileData& out)
+{
+	const char* ptr = begin;
+
+	while (ptr < end)
+	{
+		SkipSpaces(ptr, end);
+
+		if (ptr >= end)
+		{
+			break;
+		}
+
+		if (MatchKeyword(ptr, end, "v", 1)) //Vertex position
+		{
+			ptr += 1;
+
+			XMFLOAT3 position;
+			position.x = ReadFloat(ptr, end);
+			position.y = ReadFloat(ptr, end);
+			position.z = ReadFloat(ptr, end);
+
+			out.Positions.push_back(position);
+		}
+		else if (MatchKeyword(ptr, end, "vt", 2)) //Texture coordinate
+		{
+			ptr += 2;
+
+			XMFLOAT2 texCoord;
+			texCoord.x = ReadFloat(ptr, end);
+			texCoord.y = ReadFloat(ptr, end);
+
+			if (invertTexCoords) texCoord.y = 1.0f - texCoord.y;
+
+			out.TexCoords.push_back(texCoord);
+		}
+		else if (MatchKeyword(ptr, end, "vn", 2)) //Normal
+		{
+			ptr += 2;
+
+			XMFLOAT3 normal;
+			normal.x = ReadFloat(ptr, end);
+			normal.y = ReadFloat(ptr, end);
+			normal.z = ReadFloat(ptr, end);
+
+			out.Normals.push_back(normal);
+		}
+		else if (MatchKeyword(ptr, end, "f", 1)) //Face -- anything bigger than a triangle gets fanned out from its first corner
+		{
+			ptr += 1;
+
+			Corner first, previous, current;
+
+			if (ParseCorner(ptr, end, out, relativeFlag, first) && ParseCorner(ptr, end, out, relativeFlag, previous))
+			{
+				while (ParseCorner(ptr, end, out, relativeFlag, current))
+				{
+					PushCorner(out, first);
+					PushCorner(out, previous);
+					PushCorner(out, current);
+
+					previous = current;
+				}
+			}
+		}
+
+		SkipLine(ptr, end);
+	}
+}
+
+namespace
+{
+	template<typename T>
+	void CopyElements(const std::vector<T>& source, std::vector<T>& destination, size_t offset)
+	{
+		if (!source.empty())
+		{
+			memcpy(&destination[offset], source.data(), sizeof(T) * source.size());
+		}
+	}
+
+	//Copies one chunk's indices into the merged array, turning chunk-relative indices into file-wide ones
+	void CopyIndices(const std::vector<unsigned int>& source, std::vector<unsigned int>& destination, size_t offset, unsigned int elementOffset)
+	{
+		for (size_t i = 0; i < source.size(); ++i)
+		{
+			unsigned int index = source[i];
+
+			if (index != OBJTokenizer::MissingIndex && (index & ChunkRelativeFlag))
+			{
+				int fileIndex = (int)(index & ~ChunkRelativeFlag) - ChunkRelativeBias + (int)elementOffset;
+				index = fileIndex >= 0 ? (unsigned int)fileIndex : OBJTokenizer::MissingIndex;
+			}
+
+			destination[offset + i] = index;
+		}
+	}
+}
+
+void OBJTokenizer::ParseParallel(const char* data, size_t size, bool invertTexCoords, unsigned int numThreads, OBJFileData& out)
+{
+	if (numThreads == 0)
+	{
+		numThreads = std::thread::hardware_concurrency();
+	}
+
+	//Not worth spinning threads up for small files, and each chunk should have a decent amount of work in it
+	const size_t minChunkSize = 256 * 1024;
+	if (numThreads > size / minChunkSize)
+	{
+		numThreads = (unsigned int)(size / minChunkSize);
+	}
+
+	if (numThreads <= 1)
+	{
+		Parse(data, size, invertTexCoords, out);
+		return;
+	}
+
+	//Split the file into roughly equal chunks, pushing each split point forward to the start of the next line
+	std::vector<const char*> splits(numThreads + 1);
+	splits[0] = data;
+	splits[numThreads] = data + size;
+
+	for (unsigned int i = 1; i < numThreads; ++i)
+	{
+		const char* split = data + (size * i) / numThreads;
+		if (split < splits[i - 1]) split = splits[i - 1];
+
+		SkipLine(split, data + size);
+		splits[i] = split;
+	}
+
+	//Parse every chunk on its own thread into its own arrays
+	std::vector<OBJFileData> chunks(numThreads);
+	std::vector<std::thread> workers;
+
+	for (unsigned int i = 0; i < numThreads; ++i)
+	{
+		workers.push_back(std::thread(ParseRange, splits[i], splits[i + 1], invertTexCoords, ChunkRelativeFlag, std::ref(chunks[i])));
+	}
+
+	for (unsigned int i = 0; i < numThreads; ++i)
+	{
+		workers[i].join();
+	}
+
+	//Prefix sum the chunk sizes so every chunk knows where its elements start in the merged arrays
+	struct ChunkOffsets
+	{
+		size_t Positions, TexCoords, Normals, Indices;
+	};
+
+	std::vector<ChunkOffsets> offsets(numThreads + 1);
+	offsets[0].Positions = offsets[0].TexCoords = offsets[0].Normals = offsets[0].Indices = 0;
+
+	for (unsigned int i = 0; i < numThreads; ++i)
+	{
+		offsets[i + 1].Positions = offsets[i].Positions + chunks[i].Positions.size();
+		offsets[i + 1].TexCoords = offsets[i].TexCoords + chunks[i].TexCoords.size();
+		offsets[i + 1].Normals = offsets[i].Normals + chunks[i].Normals.size();
+		offsets[i + 1].Indices = offsets[i].Indices + chunks[i].PositionIndices.size();
+	}
+
+	const ChunkOffsets& totals = offsets[numThreads];
+	out.Positions.resize(totals.Positions);
+	out.TexCoords.resize(totals.TexCoords);
+	out.Normals.resize(totals.Normals);
+	out.PositionIndices.resize(totals.Indices);
+	out.TexCoordIndices.resize(totals.Indices);
+	out.NormalIndices.resize(totals.Indices);
+
+	//Merge in parallel too -- every chunk writes to its own disjoint range of the output
+	workers.clear();
+
+	for (unsigned int i = 0; i < numThreads; ++i)
+	{
+		workers.push_back(std::thread([&chunks, &offsets, &out, i]()
+		{
+			const OBJFileData& chunk = chunks[i];
+			const ChunkOffsets& offset = offsets[i];
+
+			CopyElements(chunk.Positions, out.Positions, offset.Positions);
+			CopyElements(chunk.TexCoords, out.TexCoords, offset.TexCoords);
+			CopyElements(chunk.Normals, out.Normals, offset.Normals);
+
+			CopyIndices(chunk.PositionIndices, out.PositionIndices, offset.Indices, (unsigned int)offset.Positions);
+			CopyIndices(chunk.TexCoordIndices, out.TexCoordIndices, offset.Indices, (unsigned int)offset.TexCoords);
+			CopyIndices(chunk.NormalIndices, out.NormalIndices, offset.Indices, (unsigned int)offset.Normals);
+		}));
+	}
+
+	for (unsigned int i = 0; i < numThreads; ++i)
+	{
+		workers[i].join();
+	}
+}
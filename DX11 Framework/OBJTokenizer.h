@@ -0,0 +1,37 @@
+#pragma once
+
+#include <directxmath.h>
+#include <vector>
+
+using namespace DirectX;
+
+//Turns the text of an .obj file into flat arrays by scanning it with a pointer. Nothing in here allocates per token --
+//the only heap traffic is the output vectors growing -- and nothing depends on D3D, so it can run anywhere.
+namespace OBJTokenizer
+{
+	//Used for a face corner that didn't give a texture coordinate or normal (e.g. "f 1 2 3" or "f 1//1 2//2 3//3")
+	const unsigned int MissingIndex = 0xFFFFFFFF;
+
+	//Everything we need out of an OBJ file. The indices still follow OBJ's separate position/texcoord/normal
+	//numbering, but have been converted to start from 0 and any faces with more than 3 corners have been fanned into triangles.
+	struct OBJFileData
+	{
+		std::vector<XMFLOAT3> Positions;
+		std::vector<XMFLOAT2> TexCoords;
+		std::vector<XMFLOAT3> Normals;
+
+		std::vector<unsigned int> PositionIndices;
+		std::vector<unsigned int> TexCoordIndices;
+		std::vector<unsigned int> NormalIndices;
+	};
+
+	//Parses an OBJ file that is already in memory (normally a MappedFile). Only v, vt, vn and f lines are used, everything else is skipped.
+	void Parse(const char* data, size_t size, bool invertTexCoords, OBJFileData& out);
+
+	//Same result as Parse, but the file is split at line boundaries and the chunks are parsed on numThreads worker threads
+	//(0 = one per hardware thread). Small files fall back to the serial parser.
+	void ParseParallel(const char* data, size_t size, bool invertTexCoords, unsigned int numThreads, OBJFileData& out);
+
+	//Parses the lines between begin and end. Negative indices are resolved against out's current contents and have relativeFlag or'd in.
+	void ParseRange(const char* begin, const char* end, bool invertTexCoords, unsigned int relativeFlag, OBJFileData& out);
+};
@@ -4,19 +4,12 @@
 #include <d3d11_1.h>
 #include <DirectXMath.h>
 
-using namespace DirectX;
-
-struct SimpleVertex
-{
-	XMFLOAT3 Pos;
-	XMFLOAT3 Normal;
-	XMFLOAT2 TexC;
+#include "VertexFormats.h"
+#include "Bounds.h"
+#include "MeshClusters.h"
+#include "MeshSimplifier.h"
 
-	bool operator<(const SimpleVertex other) const
-	{
-		return memcmp((void*)this, (void*)&other, sizeof(SimpleVertex)) > 0;
-	};
-};
+using namespace DirectX;
 
 struct ConstantBuffer
 {
@@ -33,6 +26,8 @@ struct ConstantBuffer
 	XMFLOAT4 SpecularLight;
 	float SpecularPower;
 	XMFLOAT3 EyePosW;
+	XMFLOAT4 PositionScale;		//Dequantizes compressed positions, only read by VSCompressed
+	XMFLOAT4 PositionOffset;
 };
 
 struct MeshData
@@ -41,5 +36,14 @@ struct MeshData
 	ID3D11Buffer * IndexBuffer;
 	UINT VBStride;
 	UINT VBOffset;
-	UINT IndexCount;
+	UINT IndexCount;			//LOD 0, the full mesh
+	DXGI_FORMAT IndexFormat;	//DXGI_FORMAT_R16_UINT, or DXGI_FORMAT_R32_UINT for meshes with more than 65535 vertices
+	VertexFormat Format;		//Which vertex struct is in VertexBuffer, and so which input layout and vertex shader to draw it with
+	XMFLOAT3 PositionScale;		//For VertexFormat_Compressed: position = unorm * PositionScale + PositionOffset
+	XMFLOAT3 PositionOffset;
+	MeshBounds Bounds;			//Mesh space, see GameObject::GetWorldBounds for world space
+	MeshCluster* Clusters;		//Owned by the MeshData, freed by MeshUpload::Release. Only cover LOD 0.
+	UINT ClusterCount;
+	MeshLod Lods[MeshSimplifier::MaxLods];	//Ranges of IndexBuffer, LOD 0 first
+	UINT LodCount;
 };
\ No newline at end of file
@@ -0,0 +1,268 @@
+#include "TaskGraph.h"
+#include <cstdio>
+#include <thread>
+
+namespace
+{
+	LONGLONG Now()
+	{
+		LARGE_INTEGER counter;
+		QueryPerformanceCounter(&counter);
+		return counter.QuadPart;
+	}
+}
+
+TaskGraph::TaskGraph()
+{
+	_finished = 0;
+	_result = S_OK;
+	_threadCount = 0;
+	_runStart = 0;
+	_runEnd = 0;
+
+	LARGE_INTEGER frequency;
+	QueryPerformanceFrequency(&frequency);
+	_ticksPerSecond = frequency.QuadPart;
+}
+
+TaskId TaskGraph::Add(const char* name, const std::function<HRESULT()>& work, bool mainThread)
+{
+	Task task;
+	task.Name = name;
+	task.Work = work;
+	task.MainThread = mainThread;
+	task.Waiting = 0;
+	task.Skip = false;
+	task.Result = S_OK;
+	task.Start = 0;
+	task.End = 0;
+	task.Thread = 0;
+
+	_tasks.push_back(task);
+
+	return (TaskId)(_tasks.size() - 1);
+}
+
+void TaskGraph::AddDependency(TaskId task, TaskId dependency)
+{
+	if (dependency >= task || task >= _tasks.size())
+	{
+		return;
+	}
+
+	_tasks[task].Dependencies.push_back(dependency);
+	_tasks[dependency].Dependants.push_back(task);
+}
+
+HRESULT TaskGraph::Run(unsigned int numWorkers)
+{
+	_runStart = Now();
+	_finished = 0;
+	_result = S_OK;
+
+	size_t workerTasks = 0;
+
+	for (size_t i = 0; i < _tasks.size(); ++i)
+	{
+		_tasks[i].Waiting = _tasks[i].Dependencies.size();
+		workerTasks += _tasks[i].MainThread ? 0 : 1;
+	}
+
+	//No threads yet, so no need for the lock
+	for (size_t i = 0; i < _tasks.size(); ++i)
+	{
+		if (_tasks[i].Waiting == 0)
+		{
+			MakeReady((TaskId)i);
+		}
+	}
+
+	if (numWorkers == 0)
+	{
+		unsigned int hardwareThreads = std::thread::hardware_concurrency();
+		numWorkers = hardwareThreads > 1 ? hardwareThreads - 1 : 0;
+	}
+
+	if (numWorkers > MaxWorkers)
+	{
+		numWorkers = MaxWorkers;
+	}
+
+	//The calling thread takes worker tasks too, so there's no point starting a worker for every one of them
+	if (numWorkers + 1 > workerTasks)
+	{
+		numWorkers = workerTasks > 1 ? (unsigned int)workerTasks - 1 : 0;
+	}
+
+	_threadCount = numWorkers + 1;
+
+	std::vector<std::thread> workers;
+	for (unsigned int i = 0; i < numWorkers; ++i)
+	{
+		workers.push_back(std::thread(&TaskGraph::WorkerLoop, this, i + 1));
+	}
+
+	WorkerLoop(0);
+
+	for (size_t i = 0; i < workers.size(); ++i)
+	{
+		workers[i].join();
+	}
+
+	_runEnd = Now();
+
+	return _result;
+}
+
+void TaskGraph::WorkerLoop(unsigned int thread)
+{
+	bool mainThread = thread == 0;
+	std::unique_lock<std::mutex> lock(_mutex);
+
+	for (;;)
+	{
+		while (_finished < _tasks.size() && _ready.empty() && !(mainThread && !_readyMainThread.empty()))
+		{
+			_changed.wait(lock);
+		}
+
+		if (_finished == _tasks.size())
+		{
+			return;
+		}
+
+		//Tasks only this thread can run come first, nobody else is going to pick them up
+		std::deque<TaskId>& queue = mainThread && !_readyMainThread.empty() ? _readyMainThread : _ready;
+		TaskId id = queue.front();
+		queue.pop_front();
+
+		lock.unlock();
+
+		Task& task = _tasks[id];
+		task.Thread = thread;
+		task.Start = Now();
+		task.Result = task.Work();
+		task.End = Now();
+
+		lock.lock();
+
+		Finish(id);
+		_changed.notify_all();
+	}
+}
+
+void TaskGraph::MakeReady(TaskId id)
+{
+	Task& task = _tasks[id];
+
+	if (task.Skip)
+	{
+		task.Result = E_ABORT;
+		task.Start = task.End = Now();
+		Finish(id);
+		return;
+	}
+
+	(task.MainThread ? _readyMainThread : _ready).push_back(id);
+}
+
+void TaskGraph::Finish(TaskId id)
+{
+	Task& task = _tasks[id];
+	_finished++;
+
+	if (FAILED(task.Result) && SUCCEEDED(_result))
+	{
+		_result = task.Result;
+	}
+
+	for (size_t i = 0; i < task.Dependants.size(); ++i)
+	{
+		Task& dependant = _tasks[task.Dependants[i]];
+		dependant.Skip |= FAILED(task.Result);
+
+		if (--dependant.Waiting == 0)
+		{
+			MakeReady(task.Dependants[i]);
+		}
+	}
+}
+
+HRESULT TaskGraph::GetResult(TaskId task) const
+{
+	return task < _tasks.size() ? _tasks[task].Result : E_INVALIDARG;
+}
+
+double TaskGraph::ToMilliseconds(LONGLONG ticks) const
+{
+	return (double)(ticks - _runStart) * 1000.0 / (double)_ticksPerSecond;
+}
+
+void TaskGraph::LogTimings(const char* title) const
+{
+	char line[256];
+	double work = 0.0;
+
+	for (size_t i = 0; i < _tasks.size(); ++i)
+	{
+		work += ToMilliseconds(_tasks[i].End) - ToMilliseconds(_tasks[i].Start);
+	}
+
+	sprintf_s(line, "%s: %.1f ms on %u threads, %.1f ms of work\n", title, ToMilliseconds(_runEnd), _threadCount, work);
+	OutputDebugStringA(line);
+
+	for (size_t i = 0; i < _tasks.size(); ++i)
+	{
+		const Task& task = _tasks[i];
+		double start = ToMilliseconds(task.Start);
+		double end = ToMilliseconds(task.End);
+
+		if (task.Result == E_ABORT && task.Skip)
+		{
+			sprintf_s(line, "  %-24s skipped\n", task.Name.c_str());
+		}
+		else
+		{
+			sprintf_s(line, "  %-24s %8.1f -> %8.1f ms %8.1f ms  thread %u%s\n", task.Name.c_str(), start, end, end - start, task.Thread,
+				FAILED(task.Result) ? "  FAILED" : "");
+		}
+
+		OutputDebugStringA(line);
+	}
+
+	if (_tasks.empty())
+	{
+		return;
+	}
+
+	//Walk back from whatever finished last through whichever dependency finished last, that's the chain the run was waiting on
+	TaskId last = 0;
+	for (size_t i = 1; i < _tasks.size(); ++i)
+	{
+		if (_tasks[i].End > _tasks[last].End)
+		{
+			last = (TaskId)i;
+		}
+	}
+
+	std::string path = _tasks[last].Name;
+
+	while (!_tasks[last].Dependencies.empty())
+	{
+		const std::vector<TaskId>& dependencies = _tasks[last].Dependencies;
+		TaskId latest = dependencies[0];
+
+		for (size_t i = 1; i < dependencies.size(); ++i)
+		{
+			if (_tasks[dependencies[i]].End > _tasks[latest].End)
+			{
+				latest = dependencies[i];
+			}
+		}
+
+		path = _tasks[latest].Name + " -> " + path;
+		last = latest;
+	}
+
+	OutputDebugStringA(("  Critical path: " + path + "\n").c_str());
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <windows.h>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+
+//Identifies a task in a TaskGraph, numbered from 0 in the order they were added
+typedef unsigned int TaskId;
+
+//Runs a set of tasks with dependencies between them on a few threads, each task starting as soon as everything it depends on has finished.
+//Tasks report failure through their HRESULT, and anything depending on a failed task is skipped. Every task's start and end is timed, so
+//LogTimings can show where the time went and which chain of tasks the whole run waited on.
+//Build the graph and Run it from the same thread. A graph runs once.
+class TaskGraph
+{
+public:
+	TaskGraph();
+
+	static const unsigned int MaxWorkers = 8;
+
+	//mainThread tasks only ever run on the thread that calls Run, for work tied to that thread like creating a window or using the immediate context
+	TaskId Add(const char* name, const std::function<HRESULT()>& work, bool mainThread = false);
+
+	//task won't start until dependency has finished. The dependency has to have been added first, which keeps the graph acyclic.
+	void AddDependency(TaskId task, TaskId dependency);
+
+	//Runs every task and returns once they've all finished, with the calling thread taking part. numWorkers = 0 starts one worker per
+	//remaining hardware thread, up to MaxWorkers. Returns S_OK if every task succeeded, otherwise what the first task to fail returned.
+	HRESULT Run(unsigned int numWorkers = 0);
+
+	//What the task returned, or E_ABORT if it was skipped because something it depended on failed
+	HRESULT GetResult(TaskId task) const;
+
+	//Writes each task's start, end and thread, the total time and the critical path to the debugger output
+	void LogTimings(const char* title) const;
+
+private:
+	struct Task
+	{
+		std::string Name;
+		std::function<HRESULT()> Work;
+		bool MainThread;
+		std::vector<TaskId> Dependencies;
+		std::vector<TaskId> Dependants;
+
+		//Set up by Run
+		size_t Waiting;			//Dependencies not yet finished
+		bool Skip;				//A dependency failed
+		HRESULT Result;
+		LONGLONG Start;
+		LONGLONG End;
+		unsigned int Thread;	//0 for the thread that called Run
+	};
+
+	void WorkerLoop(unsigned int thread);
+	void MakeReady(TaskId id);
+	void Finish(TaskId id);
+	double ToMilliseconds(LONGLONG ticks) const;
+
+	//Not copyable, the workers hold a pointer to the graph
+	TaskGraph(const TaskGraph&);
+	TaskGraph& operator=(const TaskGraph&);
+
+	std::vector<Task> _tasks;
+
+	//Guards everything below while Run is going
+	std::mutex _mutex;
+	std::condition_variable _changed;
+	std::deque<TaskId> _ready;
+	std::deque<TaskId> _readyMainThread;
+	size_t _finished;
+	HRESULT _result;
+
+	unsigned int _threadCount;
+	LONGLONG _runStart;
+	LONGLONG _runEnd;
+	LONGLONG _ticksPerSecond;
+};
@@ -0,0 +1,309 @@
+//Runs DDSLayout::Parse over the shipped crate textures and over headers built here to be wrong in every way it guards against, then times
+//how long parsing takes. Takes the directory the crate textures are in. Exits 1 if any check fails.
+
+#include "DDSLayout.h"
+#include "MappedFile.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace
+{
+	int failures = 0;
+
+	void Check(bool passed, const char* what, int line)
+	{
+		if (!passed)
+		{
+			printf("FAILED line %d: %s\n", line, what);
+			failures++;
+		}
+	}
+
+#define CHECK(condition) Check((condition), #condition, __LINE__)
+
+	const uint32_t DDSD_Depth = 0x800000;
+	const uint32_t DDPF_FourCC = 0x4;
+	const uint32_t DDPF_RGB = 0x40;
+	const uint32_t DDSCaps2_Cubemap = 0x200;
+	const uint32_t DDSCaps2_PositiveX = 0x400;
+	const uint32_t DDSCaps2_AllFaces = 0xFC00;
+	const uint32_t DXT10_TextureCube = 0x4;
+
+	//Field offsets into the file, counting the magic number
+	enum
+	{
+		Offset_Size = 4,
+		Offset_Flags = 8,
+		Offset_Height = 12,
+		Offset_Width = 16,
+		Offset_Depth = 24,
+		Offset_MipCount = 28,
+		Offset_PixelFormatSize = 76,
+		Offset_PixelFormatFlags = 80,
+		Offset_FourCC = 84,
+		Offset_RGBBitCount = 88,
+		Offset_RBitMask = 92,
+		Offset_Caps2 = 112,
+		Offset_DXGIFormat = 128,
+		Offset_ResourceDimension = 132,
+		Offset_MiscFlag = 136,
+		Offset_ArraySize = 140,
+	};
+
+	void Write32(std::vector<uint8_t>& file, size_t offset, uint32_t value)
+	{
+		memcpy(&file[offset], &value, sizeof(value));
+	}
+
+	//A legacy header for a B8G8R8A8 texture, followed by dataSize bytes
+	std::vector<uint8_t> LegacyFile(uint32_t width, uint32_t height, uint32_t mips, size_t dataSize)
+	{
+		std::vector<uint8_t> file(128 + dataSize, 0);
+		Write32(file, 0, DDSLayout::Magic);
+		Write32(file, Offset_Size, 124);
+		Write32(file, Offset_Flags, 0x1007);
+		Write32(file, Offset_Height, height);
+		Write32(file, Offset_Width, width);
+		Write32(file, Offset_MipCount, mips);
+		Write32(file, Offset_PixelFormatSize, 32);
+		Write32(file, Offset_PixelFormatFlags, DDPF_RGB | 0x1);
+		Write32(file, Offset_RGBBitCount, 32);
+		Write32(file, Offset_RBitMask, 0x00FF0000);
+		Write32(file, Offset_RBitMask + 4, 0x0000FF00);
+		Write32(file, Offset_RBitMask + 8, 0x000000FF);
+		Write32(file, Offset_RBitMask + 12, 0xFF000000);
+		return file;
+	}
+
+	//A DX10 header for a 2D texture, or array of them, followed by dataSize bytes
+	std::vector<uint8_t> DX10File(uint32_t format, uint32_t width, uint32_t height, uint32_t mips, uint32_t arraySize, size_t dataSize)
+	{
+		std::vector<uint8_t> file(148 + dataSize, 0);
+		Write32(file, 0, DDSLayout::Magic);
+		Write32(file, Offset_Size, 124);
+		Write32(file, Offset_Flags, 0x1007);
+		Write32(file, Offset_Height, height);
+		Write32(file, Offset_Width, width);
+		Write32(file, Offset_MipCount, mips);
+		Write32(file, Offset_PixelFormatSize, 32);
+		Write32(file, Offset_PixelFormatFlags, DDPF_FourCC);
+		Write32(file, Offset_FourCC, 0x30315844);		//"DX10"
+		Write32(file, Offset_DXGIFormat, format);
+		Write32(file, Offset_ResourceDimension, DDSLayout::Dimension_Texture2D);
+		Write32(file, Offset_ArraySize, arraySize);
+		return file;
+	}
+
+	DDSLayout::ParseResult Parse(const std::vector<uint8_t>& file, DDSLayout::TextureLayout& layout)
+	{
+		return DDSLayout::Parse(file.data(), file.size(), layout);
+	}
+
+	DDSLayout::ParseResult Parse(const std::vector<uint8_t>& file)
+	{
+		DDSLayout::TextureLayout layout;
+		return Parse(file, layout);
+	}
+
+	//Every surface has to be inside the file and follow on from the one before
+	bool SurfacesInside(const DDSLayout::TextureLayout& layout, size_t fileSize)
+	{
+		size_t end = layout.DataOffset;
+		for (size_t i = 0; i < layout.Subresources.size(); ++i)
+		{
+			const DDSLayout::Subresource& surface = layout.Subresources[i];
+			if (surface.Offset != end || surface.Offset + surface.SlicePitch * surface.Depth > fileSize)
+			{
+				return false;
+			}
+
+			end = surface.Offset + surface.SlicePitch * surface.Depth;
+		}
+
+		return end == layout.DataOffset + layout.DataSize;
+	}
+
+	void TestCrates(const std::string& directory)
+	{
+		static const char* const names[] = { "Crate_COLOR.dds", "Crate_NRM.dds", "Crate_SPEC.dds" };
+
+		for (size_t i = 0; i < sizeof(names) / sizeof(names[0]); ++i)
+		{
+			MappedFile file;
+			bool opened = file.Open((directory + "/" + names[i]).c_str());
+			CHECK(opened);
+			if (!opened)
+			{
+				continue;
+			}
+
+			DDSLayout::TextureLayout layout;
+			CHECK(DDSLayout::Parse(file.GetData(), file.GetSize(), layout) == DDSLayout::Parse_Ok);
+			CHECK(layout.Format == DDSLayout::Format_B8G8R8A8_UNorm);
+			CHECK(layout.Dimension == DDSLayout::Dimension_Texture2D);
+			CHECK(layout.Width == 512 && layout.Height == 512 && layout.Depth == 1);
+			CHECK(layout.MipCount == 10 && layout.ArraySize == 1 && !layout.IsCubeMap);
+			CHECK(layout.DataOffset == 128);
+			CHECK(layout.DataOffset + layout.DataSize == file.GetSize());
+			CHECK(layout.Subresources.size() == 10);
+			CHECK(layout.Subresources[0].RowPitch == 2048 && layout.Subresources[0].SlicePitch == 512 * 2048);
+			CHECK(layout.Subresources[9].Width == 1 && layout.Subresources[9].Height == 1);
+			CHECK(SurfacesInside(layout, file.GetSize()));
+			CHECK(DDSLayout::MipsOverSize(layout, 128) == 2);
+
+			//Cut short anywhere, it has to say so rather than read past the end
+			const uint8_t* data = (const uint8_t*)file.GetData();
+			CHECK(DDSLayout::Parse(data, file.GetSize() - 1, layout) == DDSLayout::Parse_Truncated);
+			CHECK(DDSLayout::Parse(data, 129, layout) == DDSLayout::Parse_Truncated);
+			CHECK(DDSLayout::Parse(data, 128, layout) == DDSLayout::Parse_Truncated);
+			CHECK(DDSLayout::Parse(data, 127, layout) == DDSLayout::Parse_NotDDS);
+			CHECK(DDSLayout::Parse(data, 3, layout) == DDSLayout::Parse_NotDDS);
+			CHECK(DDSLayout::Parse(data, 0, layout) == DDSLayout::Parse_NotDDS);
+		}
+	}
+
+	void TestHeaders()
+	{
+		//Sizes and the bits every DDS file starts with
+		std::vector<uint8_t> file = LegacyFile(4, 4, 1, 64);
+		CHECK(Parse(file) == DDSLayout::Parse_Ok);
+
+		file = LegacyFile(4, 4, 1, 64);
+		file[0] = 'X';
+		CHECK(Parse(file) == DDSLayout::Parse_NotDDS);
+
+		file = LegacyFile(4, 4, 1, 64);
+		Write32(file, Offset_Size, 128);
+		CHECK(Parse(file) == DDSLayout::Parse_NotDDS);
+
+		file = LegacyFile(4, 4, 1, 64);
+		Write32(file, Offset_PixelFormatSize, 0);
+		CHECK(Parse(file) == DDSLayout::Parse_NotDDS);
+
+		//A DX10 FourCC with no room for the DX10 header
+		file = DX10File(DDSLayout::Format_BC1_UNorm, 4, 4, 1, 1, 0);
+		file.resize(140);
+		CHECK(Parse(file) == DDSLayout::Parse_NotDDS);
+
+		//Sizes that make no sense
+		CHECK(Parse(LegacyFile(0, 4, 1, 64)) == DDSLayout::Parse_Invalid);
+		CHECK(Parse(LegacyFile(4, 0, 1, 64)) == DDSLayout::Parse_Invalid);
+		CHECK(Parse(DX10File(DDSLayout::Format_BC1_UNorm, 4, 4, 1, 0, 8)) == DDSLayout::Parse_Invalid);
+
+		//A 4x4 texture has three levels, not four
+		CHECK(Parse(LegacyFile(4, 4, 3, 64 + 16 + 4)) == DDSLayout::Parse_Ok);
+		CHECK(Parse(LegacyFile(4, 4, 4, 1024)) == DDSLayout::Parse_Invalid);
+		CHECK(Parse(LegacyFile(65536, 1, 18, 1024)) == DDSLayout::Parse_Invalid);
+
+		//Formats that can't be created
+		CHECK(Parse(DX10File(DDSLayout::Format_P8, 4, 4, 1, 1, 16)) == DDSLayout::Parse_Unsupported);
+		CHECK(Parse(DX10File(200, 4, 4, 1, 1, 1024)) == DDSLayout::Parse_Unsupported);
+
+		file = LegacyFile(4, 4, 1, 64);
+		Write32(file, Offset_RBitMask, 0x000000FF);
+		Write32(file, Offset_RBitMask + 8, 0x000000FF);
+		CHECK(Parse(file) == DDSLayout::Parse_Unsupported);
+
+		//Cube maps need all six faces, and DX10 ones can't multiply the array size past 32 bits
+		file = LegacyFile(4, 4, 1, 6 * 64);
+		Write32(file, Offset_Caps2, DDSCaps2_Cubemap | DDSCaps2_PositiveX);
+		CHECK(Parse(file) == DDSLayout::Parse_Unsupported);
+
+		DDSLayout::TextureLayout layout;
+		Write32(file, Offset_Caps2, DDSCaps2_Cubemap | DDSCaps2_AllFaces);
+		CHECK(Parse(file, layout) == DDSLayout::Parse_Ok);
+		CHECK(layout.IsCubeMap && layout.ArraySize == 6 && SurfacesInside(layout, file.size()));
+
+		file = DX10File(DDSLayout::Format_BC1_UNorm, 4, 4, 1, 0x2AAAAAAB, 1024);
+		Write32(file, Offset_MiscFlag, DXT10_TextureCube);
+		CHECK(Parse(file) == DDSLayout::Parse_Unsupported);
+
+		//Volume textures can't be arrays
+		file = DX10File(DDSLayout::Format_R8G8B8A8_UNorm, 4, 4, 1, 2, 1024);
+		Write32(file, Offset_Flags, 0x1007 | DDSD_Depth);
+		Write32(file, Offset_Depth, 4);
+		Write32(file, Offset_ResourceDimension, DDSLayout::Dimension_Texture3D);
+		CHECK(Parse(file) == DDSLayout::Parse_Unsupported);
+
+		Write32(file, Offset_ArraySize, 1);
+		file.resize(148 + 4 * 4 * 4 * 4);
+		CHECK(Parse(file, layout) == DDSLayout::Parse_Ok);
+		CHECK(layout.Depth == 4 && layout.Subresources[0].SlicePitch == 64 && SurfacesInside(layout, file.size()));
+	}
+
+	void TestOverflow()
+	{
+		//Past the largest size any device takes
+		CHECK(Parse(LegacyFile(65537, 1, 1, 1024)) == DDSLayout::Parse_Unsupported);
+		CHECK(Parse(LegacyFile(1, 65537, 1, 1024)) == DDSLayout::Parse_Unsupported);
+
+		//The largest size, with a full mip chain, in a file that holds a fraction of it
+		CHECK(Parse(DX10File(DDSLayout::Format_R32G32B32A32_Float, 65536, 65536, 17, 1, 1024)) == DDSLayout::Parse_Truncated);
+
+		//Array sizes that would overflow the total, or allocate far more surfaces than the file could hold, if they were believed
+		CHECK(Parse(DX10File(DDSLayout::Format_BC1_UNorm, 4, 4, 1, 0xFFFFFFFF, 1024)) == DDSLayout::Parse_Truncated);
+		CHECK(Parse(DX10File(DDSLayout::Format_R32G32B32A32_Float, 65536, 65536, 1, 0x10000000, 1 << 20)) == DDSLayout::Parse_Truncated);
+		CHECK(Parse(DX10File(DDSLayout::Format_BC1_UNorm, 4, 4, 1, 129, 1024)) == DDSLayout::Parse_Truncated);
+
+		//Exactly enough for every item
+		DDSLayout::TextureLayout layout;
+		std::vector<uint8_t> file = DX10File(DDSLayout::Format_BC1_UNorm, 8, 8, 4, 128, 128 * (32 + 8 + 8 + 8));
+		CHECK(Parse(file, layout) == DDSLayout::Parse_Ok);
+		CHECK(layout.Subresources.size() == 4 * 128 && SurfacesInside(layout, file.size()));
+		CHECK(layout.Subresources[4].Offset == 148 + 56 && layout.Subresources[3].RowPitch == 8);
+
+		//Nothing in the header has to be aligned
+		std::vector<uint8_t> unaligned(file.size() + 1);
+		memcpy(&unaligned[1], file.data(), file.size());
+		CHECK(DDSLayout::Parse(&unaligned[1], file.size(), layout) == DDSLayout::Parse_Ok);
+	}
+
+	void TimeParse(const char* name, const void* data, size_t size)
+	{
+		DDSLayout::TextureLayout layout;
+		const int iterations = 200000;
+
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		for (int i = 0; i < iterations; ++i)
+		{
+			DDSLayout::Parse(data, size, layout);
+		}
+
+		double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		printf("%-28s %8.1f ns a parse (%u surfaces)\n", name, seconds / iterations * 1e9, (unsigned int)layout.Subresources.size());
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	if (argc < 2)
+	{
+		printf("Usage: DDSLayoutTest <directory with Crate_*.dds>\n");
+		return 2;
+	}
+
+	std::string directory = argv[1];
+
+	TestCrates(directory);
+	TestHeaders();
+	TestOverflow();
+
+	MappedFile crate;
+	if (crate.Open((directory + "/Crate_COLOR.dds").c_str()))
+	{
+		TimeParse("Crate_COLOR.dds", crate.GetData(), crate.GetSize());
+	}
+
+	std::vector<uint8_t> array = DX10File(DDSLayout::Format_BC7_UNorm, 256, 256, 9, 64, 64 * 87424);
+	TimeParse("BC7 256x256 array of 64", array.data(), array.size());
+
+	std::vector<uint8_t> corrupt = DX10File(DDSLayout::Format_BC1_UNorm, 4, 4, 1, 0xFFFFFFFF, 1024);
+	TimeParse("Corrupt array size", corrupt.data(), corrupt.size());
+
+	printf("%s\n", failures == 0 ? "All DDSLayout checks passed" : "DDSLayout checks FAILED");
+	return failures == 0 ? 0 : 1;
+}
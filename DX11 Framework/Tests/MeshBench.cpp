@@ -0,0 +1,736 @@
+//Times the mesh pipeline's stages on the shipped OBJ files and prints what they produce, so a change to any of them can be measured the
+//same way each time. Takes the directory the OBJ files are in, then optionally the names of the sections to run (all of them otherwise).
+//Times are the fastest of several runs, with the file already mapped, so they measure the code rather than the disk.
+
+#include "OBJLoader.h"
+#include "OBJTokenizer.h"
+#include "MappedFile.h"
+#include "MeshOptimizer.h"
+#include "MeshSimplifier.h"
+#include "Bounds.h"
+#include "MeshCodec.h"
+#include "MeshClusters.h"
+#include "NumberParser.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <locale>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+	const char* const MeshNames[] = { "cube.obj", "cylinder.obj", "desert.obj", "donut.obj", "Hercules.obj", "sphere.obj", "star.obj",
+		"terrain.obj", "torusKnot.obj" };
+	const size_t NumMeshes = sizeof(MeshNames) / sizeof(MeshNames[0]);
+
+	//Set by a section whose results don't check out, so the run fails
+	bool resultsWrong = false;
+
+	struct Mesh
+	{
+		std::string Name;
+		std::string Path;
+		MappedFile File;
+		OBJTokenizer::OBJFileData Data;
+	};
+
+	//Runs work until it has had at least minRuns runs and a quarter of a second, and gives the fastest in milliseconds
+	template<typename Work> double FastestMs(Work work, int minRuns = 5)
+	{
+		double fastest = 1e30;
+		double total = 0.0;
+
+		for (int run = 0; run < minRuns || total < 250.0; ++run)
+		{
+			std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+			work();
+			double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+			fastest = ms < fastest ? ms : fastest;
+			total += ms;
+		}
+
+		return fastest;
+	}
+
+	//Welding every face corner's (v, vt, vn) into one vertex buffer, on its own and as part of a whole load from the file: mapping it,
+	//ParseParallel on every hardware thread, CreateIndices and packing the indices, as OBJLoader::LoadOrCook does before it starts cooking
+	void BenchWeld(std::vector<Mesh*>& meshes)
+	{
+		printf("\nweld: CreateIndices, and the load it's part of\n%-16s %10s %10s %8s %10s %12s %10s %10s\n", "mesh", "corners", "vertices",
+			"shared", "ms", "Mcorners/s", "load ms", "weld part");
+
+		for (size_t i = 0; i < meshes.size(); ++i)
+		{
+			const OBJTokenizer::OBJFileData& data = meshes[i]->Data;
+			std::vector<unsigned int> indices;
+			std::vector<SimpleVertex> vertices;
+
+			double ms = FastestMs([&]()
+			{
+				indices.clear();
+				vertices.clear();
+				OBJLoader::CreateIndices(data, indices, vertices);
+			});
+
+			bool loaded = true;
+			double loadMs = FastestMs([&]()
+			{
+				MappedFile file;
+				loaded = file.Open(meshes[i]->Path.c_str()) && loaded;
+
+				OBJTokenizer::OBJFileData loadData;
+				OBJTokenizer::ParseParallel(file.GetData(), file.GetSize(), true, 0, loadData);
+				file.Close();
+
+				std::vector<unsigned int> loadIndices;
+				std::vector<SimpleVertex> loadVertices;
+				OBJLoader::CreateIndices(loadData, loadIndices, loadVertices);
+
+				std::vector<char> packed;
+				OBJLoader::PackIndices(loadIndices, OBJLoader::ChooseIndexSize((unsigned int)loadVertices.size()), packed);
+			});
+
+			resultsWrong = resultsWrong || !loaded;
+
+			size_t corners = indices.size();
+			printf("%-16s %10u %10u %7.1f%% %10.3f %12.1f %10.3f %9.1f%%\n", meshes[i]->Name.c_str(), (unsigned int)corners,
+				(unsigned int)vertices.size(), corners > 0 ? 100.0 * (1.0 - (double)vertices.size() / corners) : 0.0, ms, corners / ms / 1000.0,
+				loadMs, loadMs > 0.0 ? 100.0 * ms / loadMs : 0.0);
+		}
+	}
+
+	//Parsing the text into arrays on one thread, against just splitting it into tokens with a stream as the loader used to (before it even
+	//converted them, so the real gap was wider)
+	void BenchParse(std::vector<Mesh*>& meshes)
+	{
+		printf("\nparse: OBJTokenizer::Parse against istream >> std::string\n%-16s %10s %10s %10s %12s %12s\n", "mesh", "KB", "ms",
+			"MB/s", "stream ms", "stream MB/s");
+
+		for (size_t i = 0; i < meshes.size(); ++i)
+		{
+			const MappedFile& file = meshes[i]->File;
+			double megabytes = file.GetSize() / 1000000.0;
+
+			double ms = FastestMs([&]()
+			{
+				OBJTokenizer::OBJFileData data;
+				OBJTokenizer::Parse(file.GetData(), file.GetSize(), true, data);
+			});
+
+			double streamMs = FastestMs([&]()
+			{
+				std::istringstream stream(std::string(file.GetData(), file.GetSize()));
+				std::string token;
+				while (stream >> token)
+				{
+				}
+			}, 2);
+
+			printf("%-16s %10.1f %10.3f %10.1f %12.3f %12.1f\n", meshes[i]->Name.c_str(), file.GetSize() / 1000.0, ms, megabytes / ms * 1000.0,
+				streamMs, megabytes / streamMs * 1000.0);
+		}
+	}
+
+	template<typename T> bool SameArray(const std::vector<T>& a, const std::vector<T>& b)
+	{
+		return a.size() == b.size() && (a.empty() || memcmp(a.data(), b.data(), a.size() * sizeof(T)) == 0);
+	}
+
+	bool SameData(const OBJTokenizer::OBJFileData& a, const OBJTokenizer::OBJFileData& b)
+	{
+		return SameArray(a.Positions, b.Positions) && SameArray(a.TexCoords, b.TexCoords) && SameArray(a.Normals, b.Normals) &&
+			SameArray(a.PositionIndices, b.PositionIndices) && SameArray(a.TexCoordIndices, b.TexCoordIndices) &&
+			SameArray(a.NormalIndices, b.NormalIndices);
+	}
+
+	//The number tokens of an OBJ file, one to a line: the floats of its v, vt and vn lines, and the position index of every face corner
+	void NumberTokens(const MappedFile& file, std::string& floats, std::string& ints)
+	{
+		std::istringstream lines(std::string(file.GetData(), file.GetSize()));
+		std::string line;
+		while (std::getline(lines, line))
+		{
+			std::istringstream tokens(line);
+			std::string keyword, token;
+			tokens >> keyword;
+
+			bool isFloat = keyword == "v" || keyword == "vt" || keyword == "vn";
+			if (!isFloat && keyword != "f")
+			{
+				continue;
+			}
+
+			while (tokens >> token)
+			{
+				(isFloat ? floats : ints) += (isFloat ? token : token.substr(0, token.find('/'))) + "\n";
+			}
+		}
+	}
+
+	//Reads every number in text with NumberParser, skipping the whitespace between them itself as the tokenizer does
+	template<typename T, typename Parse> void ParseNumbers(const std::string& text, Parse parse, std::vector<T>& values)
+	{
+		values.clear();
+		const char* ptr = text.data();
+		const char* end = text.data() + text.size();
+
+		while (ptr < end)
+		{
+			T value;
+			if (parse(ptr, end, value))
+			{
+				values.push_back(value);
+			}
+
+			//Past anything that isn't a number too, so it can't stall here
+			while (ptr < end && *ptr != ' ' && *ptr != '\n')
+			{
+				++ptr;
+			}
+
+			while (ptr < end && (*ptr == ' ' || *ptr == '\n'))
+			{
+				++ptr;
+			}
+		}
+	}
+
+	template<typename T> void StreamNumbers(const std::string& text, std::vector<T>& values)
+	{
+		values.clear();
+		std::istringstream stream(text);
+		stream.imbue(std::locale::classic());
+
+		T value;
+		while (stream >> value)
+		{
+			values.push_back(value);
+		}
+	}
+
+	//NumberParser against istream >> float and >> int on the same numbers, taken out of the meshes so only the number parsing is timed
+	void BenchNumbers(std::vector<Mesh*>& meshes)
+	{
+		printf("\nnumbers: NumberParser against istream >> float and >> int\n%-16s %9s %9s %10s %8s %9s %9s %10s %8s %6s\n", "mesh", "floats",
+			"ms", "stream ms", "faster", "ints", "ms", "stream ms", "faster", "same");
+
+		for (size_t i = 0; i < meshes.size(); ++i)
+		{
+			std::string floatText, intText;
+			NumberTokens(meshes[i]->File, floatText, intText);
+
+			std::vector<float> floats, streamFloats;
+			std::vector<int> ints, streamInts;
+
+			double floatMs = FastestMs([&]() { ParseNumbers(floatText, NumberParser::ParseFloat, floats); });
+			double streamFloatMs = FastestMs([&]() { StreamNumbers(floatText, streamFloats); }, 2);
+			double intMs = FastestMs([&]() { ParseNumbers(intText, NumberParser::ParseInt, ints); });
+			double streamIntMs = FastestMs([&]() { StreamNumbers(intText, streamInts); }, 2);
+
+			bool same = SameArray(floats, streamFloats) && ints == streamInts;
+			resultsWrong = resultsWrong || !same;
+
+			printf("%-16s %9u %9.3f %10.3f %7.1fx %9u %9.3f %10.3f %7.1fx %6s\n", meshes[i]->Name.c_str(), (unsigned int)floats.size(), floatMs,
+				streamFloatMs, floatMs > 0.0 ? streamFloatMs / floatMs : 0.0, (unsigned int)ints.size(), intMs, streamIntMs,
+				intMs > 0.0 ? streamIntMs / intMs : 0.0, same ? "yes" : "NO");
+		}
+	}
+
+	//ParseParallel at a range of thread counts. Every shipped file is small enough to fall back to the serial parser, so this parses the
+	//largest one repeated until it's big enough to split. Later copies' indices point into the first, which is still a valid OBJ.
+	void BenchThreads(std::vector<Mesh*>& meshes)
+	{
+		const Mesh* largest = nullptr;
+		for (size_t i = 0; i < meshes.size(); ++i)
+		{
+			if (!largest || meshes[i]->File.GetSize() > largest->File.GetSize()) largest = meshes[i];
+		}
+
+		if (!largest)
+		{
+			return;
+		}
+
+		std::string text;
+		for (int copy = 0; copy < 16; ++copy)
+		{
+			text.append(largest->File.GetData(), largest->File.GetSize());
+		}
+
+		double megabytes = text.size() / 1000000.0;
+		printf("\nthreads: OBJTokenizer::ParseParallel on %s x16 (%.1f MB), %u hardware threads\n%-10s %10s %10s %10s %10s\n",
+			largest->Name.c_str(), megabytes, std::thread::hardware_concurrency(), "threads", "ms", "MB/s", "speedup", "same");
+
+		OBJTokenizer::OBJFileData serial;
+		double serialMs = FastestMs([&]()
+		{
+			serial = OBJTokenizer::OBJFileData();
+			OBJTokenizer::Parse(text.data(), text.size(), true, serial);
+		});
+
+		printf("%-10s %10.2f %10.1f %10.2f %10s\n", "serial", serialMs, megabytes / serialMs * 1000.0, 1.0, "-");
+
+		static const unsigned int threadCounts[] = { 1, 2, 4, 8, 16 };
+		for (size_t t = 0; t < sizeof(threadCounts) / sizeof(threadCounts[0]); ++t)
+		{
+			OBJTokenizer::OBJFileData parallel;
+			double ms = FastestMs([&]()
+			{
+				parallel = OBJTokenizer::OBJFileData();
+				OBJTokenizer::ParseParallel(text.data(), text.size(), true, threadCounts[t], parallel);
+			});
+
+			bool same = SameData(serial, parallel);
+			resultsWrong = resultsWrong || !same;
+
+			printf("%-10u %10.2f %10.1f %10.2f %10s\n", threadCounts[t], ms, megabytes / ms * 1000.0, serialMs / ms, same ? "yes" : "NO");
+		}
+	}
+
+	//Post-transform cache efficiency of the full mesh as it's welded, after OptimizeVertexCache, and after BuildClusters moves the
+	//triangles around again, which is the order the cooker writes
+	void BenchCache(std::vector<Mesh*>& meshes)
+	{
+		printf("\ncache: ACMR / ATVR with a %u entry FIFO, welded -> OptimizeVertexCache -> BuildClusters\n%-16s %10s %16s %16s %16s %10s\n",
+			MeshOptimizer::DefaultCacheSize, "mesh", "triangles", "welded", "optimized", "clustered", "opt ms");
+
+		for (size_t i = 0; i < meshes.size(); ++i)
+		{
+			std::vector<unsigned int> welded;
+			std::vector<SimpleVertex> vertices;
+			OBJLoader::CreateIndices(meshes[i]->Data, welded, vertices);
+			unsigned int numVertices = (unsigned int)vertices.size();
+
+			MeshOptimizer::VertexCacheStats before = MeshOptimizer::AnalyzeVertexCache(welded, numVertices);
+
+			std::vector<unsigned int> optimized;
+			double ms = FastestMs([&]()
+			{
+				optimized = welded;
+				MeshOptimizer::OptimizeVertexCache(optimized, numVertices);
+			});
+
+			MeshOptimizer::VertexCacheStats after = MeshOptimizer::AnalyzeVertexCache(optimized, numVertices);
+
+			std::vector<MeshCluster> clusters;
+			MeshOptimizer::BuildClusters(optimized, numVertices, vertices.empty() ? nullptr : &vertices[0].Pos, sizeof(SimpleVertex), clusters);
+			MeshOptimizer::VertexCacheStats clustered = MeshOptimizer::AnalyzeVertexCache(optimized, numVertices);
+
+			printf("%-16s %10u %7.3f / %6.3f %7.3f / %6.3f %7.3f / %6.3f %10.3f\n", meshes[i]->Name.c_str(), (unsigned int)welded.size() / 3,
+				before.ACMR, before.ATVR, after.ACMR, after.ATVR, clustered.ACMR, clustered.ATVR, ms);
+		}
+	}
+
+	//The level of detail chain BuildLods makes for each mesh, and at what distance GameObject::SelectLod would switch to and from each level
+	//with the game's defaults: a 1 pixel error, 25% hysteresis, a 90 degree vertical field of view and a 600 pixel high window. Distances are
+	//from the mesh's bounding sphere, at a scale of 1. SelectLod can't be linked without D3D, so its sums are repeated here.
+	//Flies the camera from the surface of a mesh's bounds out to 256 times their radius and back, one step a frame, and gives the triangles
+	//drawn per frame at the levels MeshSimplifier::SelectLod picks and how many times it changed level
+	void FlyThrough(const std::vector<MeshLod>& lods, float radius, float unitsToPixels, float pixelError, double& triangles,
+		unsigned int& switches)
+	{
+		const unsigned int frames = 1000;
+
+		triangles = 0.0;
+		switches = 0;
+		unsigned int lod = 0;
+
+		for (unsigned int frame = 0; frame < frames; ++frame)
+		{
+			//Out and back with the distance to the centre growing geometrically, so every doubling gets as many frames
+			float t = 2.0f * frame / frames;
+			float toCenter = radius * std::pow(256.0f, t < 1.0f ? t : 2.0f - t);
+
+			unsigned int selected = MeshSimplifier::SelectLod(lods.data(), (unsigned int)lods.size(), lod, toCenter - radius, unitsToPixels,
+				pixelError);
+			switches += selected != lod ? 1 : 0;
+			lod = selected;
+
+			triangles += lods[lod].IndexCount / 3;
+		}
+
+		triangles /= frames;
+	}
+
+	void BenchLods(std::vector<Mesh*>& meshes)
+	{
+		const float pixelError = 1.0f;
+		const float projectionScale = 1.0f;		//m[1][1], 1 / tan(fov / 2)
+		const float viewportHeight = 600.0f;
+		const float unitsToPixels = projectionScale * viewportHeight * 0.5f;
+
+		printf("\nlods: MeshSimplifier::BuildLods, and SelectLod's switch distances\n%-16s %4s %10s %8s %12s %10s %10s %10s %10s\n", "mesh", "lod",
+			"triangles", "of full", "error", "of radius", "coarser at", "finer at", "build ms");
+
+		std::vector<std::vector<MeshLod> > meshLods(meshes.size());
+		std::vector<float> radii(meshes.size());
+
+		for (size_t i = 0; i < meshes.size(); ++i)
+		{
+			std::vector<unsigned int> indices;
+			std::vector<SimpleVertex> vertices;
+			OBJLoader::CreateIndices(meshes[i]->Data, indices, vertices);
+			MeshBounds bounds = Bounds::Compute(vertices.empty() ? nullptr : &vertices[0].Pos, vertices.size(), sizeof(SimpleVertex));
+
+			std::vector<std::vector<unsigned int> > lodIndices;
+			std::vector<float> lodErrors;
+			double ms = FastestMs([&]()
+			{
+				lodIndices.clear();
+				lodErrors.clear();
+				MeshSimplifier::BuildLods(indices, vertices.data(), (unsigned int)vertices.size(), lodIndices, lodErrors);
+			}, 3);
+
+			unsigned int fullTriangles = (unsigned int)indices.size() / 3;
+			printf("%-16s %4u %10u %7.1f%% %12s %10s %10s %10s %10.2f\n", meshes[i]->Name.c_str(), 0, fullTriangles, 100.0, "-", "-", "-", "-", ms);
+
+			//The levels as a cache lays them out, one after another in the same index buffer
+			MeshLod full = { 0, (uint32_t)indices.size(), 0.0f, 0 };
+			meshLods[i].push_back(full);
+			radii[i] = bounds.Radius;
+
+			for (size_t l = 0; l < lodIndices.size(); ++l)
+			{
+				unsigned int triangles = (unsigned int)lodIndices[l].size() / 3;
+				float coarserAt, finerAt;
+				MeshSimplifier::LodSwitchDistances(lodErrors[l], unitsToPixels, pixelError, coarserAt, finerAt);
+
+				printf("%-16s %4u %10u %7.1f%% %12.4g %9.3f%% %10.2f %10.2f\n", "", (unsigned int)l + 1, triangles,
+					fullTriangles > 0 ? 100.0 * triangles / fullTriangles : 0.0, lodErrors[l],
+					bounds.Radius > 0.0f ? 100.0 * lodErrors[l] / bounds.Radius : 0.0, coarserAt, finerAt);
+
+				const MeshLod& previous = meshLods[i].back();
+				MeshLod lod = { previous.IndexStart + previous.IndexCount, (uint32_t)lodIndices[l].size(), lodErrors[l], 0 };
+				meshLods[i].push_back(lod);
+			}
+		}
+
+		printf("\nlods: fly-through from the bounds out to 256 radii and back, %.0f pixel error, %.0f pixel high viewport\n"
+			"%-16s %14s %14s %8s %10s\n", pixelError, viewportHeight, "mesh", "full tris/frm", "lod tris/frm", "of full", "switches");
+
+		double fullTotal = 0.0;
+		double lodTotal = 0.0;
+
+		for (size_t i = 0; i < meshes.size(); ++i)
+		{
+			double triangles;
+			unsigned int switches;
+			FlyThrough(meshLods[i], radii[i], unitsToPixels, pixelError, triangles, switches);
+
+			double fullTriangles = meshLods[i][0].IndexCount / 3;
+			fullTotal += fullTriangles;
+			lodTotal += triangles;
+
+			printf("%-16s %14.0f %14.1f %7.1f%% %10u\n", meshes[i]->Name.c_str(), fullTriangles, triangles,
+				fullTriangles > 0.0 ? 100.0 * triangles / fullTriangles : 0.0, switches);
+		}
+
+		printf("%-16s %14.0f %14.1f %7.1f%%\n", "all", fullTotal, lodTotal, fullTotal > 0.0 ? 100.0 * lodTotal / fullTotal : 0.0);
+	}
+
+	//Puts a welded mesh's triangles and vertices in the order the cooker stores them: levels of detail appended, cache and cluster order,
+	//then vertices in first use order. Same steps as OBJLoader::LoadOrCook for a full (uncompressed) mesh.
+	void CookOrder(const OBJTokenizer::OBJFileData& data, std::vector<unsigned int>& indices, std::vector<SimpleVertex>& vertices)
+	{
+		OBJLoader::CreateIndices(data, indices, vertices);
+		unsigned int numVertices = (unsigned int)vertices.size();
+
+		std::vector<std::vector<unsigned int> > lodIndices;
+		std::vector<float> lodErrors;
+		MeshSimplifier::BuildLods(indices, vertices.data(), numVertices, lodIndices, lodErrors);
+
+		MeshOptimizer::OptimizeVertexCache(indices, numVertices);
+		for (size_t l = 0; l < lodIndices.size(); ++l)
+		{
+			MeshOptimizer::OptimizeVertexCache(lodIndices[l], numVertices);
+		}
+
+		std::vector<MeshCluster> clusters;
+		MeshOptimizer::BuildClusters(indices, numVertices, vertices.empty() ? nullptr : &vertices[0].Pos, sizeof(SimpleVertex), clusters);
+
+		for (size_t l = 0; l < lodIndices.size(); ++l)
+		{
+			indices.insert(indices.end(), lodIndices[l].begin(), lodIndices[l].end());
+		}
+
+		vertices.resize(MeshOptimizer::OptimizeVertexFetch(vertices.data(), numVertices, sizeof(SimpleVertex), indices));
+	}
+
+	//Encodes a stream, checks it decodes back exactly, and prints its sizes and decode speed
+	template<typename Encode, typename Decode> void BenchStream(const char* mesh, const char* stream, const void* raw, size_t rawSize,
+		Encode encode, Decode decode)
+	{
+		std::vector<uint8_t> encoded;
+		double encodeMs = FastestMs([&]() { encode(encoded); }, 3);
+
+		std::vector<uint8_t> decoded(rawSize);
+		bool ok = true;
+		double decodeMs = FastestMs([&]() { ok = decode(encoded, decoded.data()) && ok; });
+
+		bool same = ok && (rawSize == 0 || memcmp(decoded.data(), raw, rawSize) == 0);
+		resultsWrong = resultsWrong || !same;
+
+		printf("%-16s %-10s %10u %10u %7.1f%% %10.3f %10.1f %10.1f %6s\n", mesh, stream, (unsigned int)rawSize, (unsigned int)encoded.size(),
+			rawSize > 0 ? 100.0 * encoded.size() / rawSize : 0.0, decodeMs, rawSize / decodeMs / 1000.0, rawSize / encodeMs / 1000.0,
+			same ? "yes" : "NO");
+	}
+
+	//MeshCodec on the streams a cache would hold: full vertices, compressed vertices, and the packed indices
+	void BenchCodec(std::vector<Mesh*>& meshes)
+	{
+		printf("\ncodec: MeshCodec on cooked streams\n%-16s %-10s %10s %10s %8s %10s %10s %10s %6s\n", "mesh", "stream", "raw", "encoded",
+			"of raw", "decode ms", "dec MB/s", "enc MB/s", "same");
+
+		for (size_t i = 0; i < meshes.size(); ++i)
+		{
+			std::vector<unsigned int> indices;
+			std::vector<SimpleVertex> vertices;
+			CookOrder(meshes[i]->Data, indices, vertices);
+
+			if (vertices.empty())
+			{
+				continue;
+			}
+
+			const char* name = meshes[i]->Name.c_str();
+			size_t count = vertices.size();
+
+			BenchStream(name, "vertices", vertices.data(), count * sizeof(SimpleVertex),
+				[&](std::vector<uint8_t>& out) { MeshCodec::EncodeVertices(vertices.data(), count, sizeof(SimpleVertex), out); },
+				[&](const std::vector<uint8_t>& in, void* out) { return MeshCodec::DecodeVertices(in.data(), in.size(), out, count, sizeof(SimpleVertex)); });
+
+			VertexCompression::PositionQuantization quantization = VertexCompression::ComputeQuantization(vertices.data(), count);
+			std::vector<CompressedVertex> compressed(count);
+			VertexCompression::Compress(vertices.data(), count, quantization, compressed.data());
+
+			BenchStream(name, "qvertices", compressed.data(), count * sizeof(CompressedVertex),
+				[&](std::vector<uint8_t>& out) { MeshCodec::EncodeVertices(compressed.data(), count, sizeof(CompressedVertex), out); },
+				[&](const std::vector<uint8_t>& in, void* out) { return MeshCodec::DecodeVertices(in.data(), in.size(), out, count, sizeof(CompressedVertex)); });
+
+			unsigned int indexSize = OBJLoader::ChooseIndexSize((unsigned int)count);
+			std::vector<char> packed;
+			OBJLoader::PackIndices(indices, indexSize, packed);
+
+			BenchStream(name, indexSize == 2 ? "indices16" : "indices32", packed.data(), packed.size(),
+				[&](std::vector<uint8_t>& out) { MeshCodec::EncodeIndices(packed.data(), indices.size(), indexSize, out); },
+				[&](const std::vector<uint8_t>& in, void* out) { return MeshCodec::DecodeIndices(in.data(), in.size(), out, indices.size(), indexSize); });
+		}
+	}
+
+	//XMMatrixLookAtLH(eye, at, up) * XMMatrixPerspectiveFovLH(fovY, aspect, nearZ, farZ), written out since the DirectXMath in Linux/ has
+	//no matrix functions
+	XMFLOAT4X4 ViewProjection(const XMFLOAT3& eye, const XMFLOAT3& at, float fovY, float aspect, float nearZ, float farZ)
+	{
+		XMVECTOR eyeVector = XMLoadFloat3(&eye);
+		XMVECTOR zAxis = XMVector3Normalize(XMVectorSubtract(XMLoadFloat3(&at), eyeVector));
+		XMVECTOR xAxis = XMVector3Normalize(XMVector3Cross(XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f), zAxis));
+		XMVECTOR yAxis = XMVector3Cross(zAxis, xAxis);
+
+		XMFLOAT3 axes[3];
+		XMStoreFloat3(&axes[0], xAxis);
+		XMStoreFloat3(&axes[1], yAxis);
+		XMStoreFloat3(&axes[2], zAxis);
+
+		float view[4][4] = {};
+		for (int a = 0; a < 3; ++a)
+		{
+			view[0][a] = axes[a].x;
+			view[1][a] = axes[a].y;
+			view[2][a] = axes[a].z;
+			view[3][a] = -(axes[a].x * eye.x + axes[a].y * eye.y + axes[a].z * eye.z);
+		}
+
+		view[3][3] = 1.0f;
+
+		float height = 1.0f / std::tan(fovY * 0.5f);
+		float depth = farZ / (farZ - nearZ);
+		float projection[4][4] = {};
+		projection[0][0] = height / aspect;
+		projection[1][1] = height;
+		projection[2][2] = depth;
+		projection[2][3] = 1.0f;
+		projection[3][2] = -depth * nearZ;
+
+		XMFLOAT4X4 viewProjection;
+		for (int r = 0; r < 4; ++r)
+		{
+			for (int c = 0; c < 4; ++c)
+			{
+				viewProjection.m[r][c] = 0.0f;
+				for (int k = 0; k < 4; ++k)
+				{
+					viewProjection.m[r][c] += view[r][k] * projection[k][c];
+				}
+			}
+		}
+
+		return viewProjection;
+	}
+
+	//Where a culling camera sits and looks, in radii of the mesh's bounds from their centre
+	struct CullCamera
+	{
+		const char* Name;
+		XMFLOAT3 Eye;
+		XMFLOAT3 At;
+	};
+
+	//How much of each mesh MeshClusters::Cull throws away from a few viewpoints, split into what the bounds' frustum test culls and what the
+	//normal cones cull on top of that. Culled gaps of up to MergeGapIndices are drawn anyway, so these are what a draw really skips.
+	void BenchCulling(std::vector<Mesh*>& meshes)
+	{
+		static const CullCamera cameras[] =
+		{
+			{ "front", { 0.0f, 0.0f, -3.0f }, { 0.0f, 0.0f, 0.0f } },			//All of it in view, so only the cones cull
+			{ "above", { 0.0f, 2.0f, -2.0f }, { 0.0f, 0.0f, 0.0f } },
+			{ "side", { 0.0f, 0.0f, -2.0f }, { 2.0f, 0.0f, -1.0f } },			//Looking past it, so part of it is off the side of the screen
+			{ "inside", { 0.0f, 0.0f, 0.0f }, { 0.0f, 0.0f, 1.0f } },			//Half of it behind the camera
+		};
+		const float fovY = XM_PIDIV2;
+		const float aspect = 900.0f / 600.0f;
+
+		printf("\nculling: MeshClusters::Cull from the camera positions below, 90 degree field of view\n%-16s %-8s %9s %10s %9s %9s %9s %9s\n",
+			"mesh", "camera", "clusters", "triangles", "bounds", "cones", "culled", "cull us");
+
+		std::vector<std::vector<MeshCluster> > meshClusters(meshes.size());
+		std::vector<MeshBounds> meshBounds(meshes.size());
+		std::vector<uint32_t> indexCounts(meshes.size());
+
+		for (size_t i = 0; i < meshes.size(); ++i)
+		{
+			std::vector<unsigned int> indices;
+			std::vector<SimpleVertex> vertices;
+			OBJLoader::CreateIndices(meshes[i]->Data, indices, vertices);
+			const XMFLOAT3* positions = vertices.empty() ? nullptr : &vertices[0].Pos;
+
+			MeshOptimizer::OptimizeVertexCache(indices, (unsigned int)vertices.size());
+			MeshOptimizer::BuildClusters(indices, (unsigned int)vertices.size(), positions, sizeof(SimpleVertex), meshClusters[i]);
+			meshBounds[i] = Bounds::Compute(positions, vertices.size(), sizeof(SimpleVertex));
+			indexCounts[i] = (uint32_t)indices.size();
+		}
+
+		for (size_t c = 0; c < sizeof(cameras) / sizeof(cameras[0]); ++c)
+		{
+			double allTriangles = 0.0;
+			double allBounds = 0.0;
+			double allCones = 0.0;
+
+			for (size_t i = 0; i < meshes.size(); ++i)
+			{
+				const MeshBounds& bounds = meshBounds[i];
+				XMFLOAT3 eye(bounds.Center.x + cameras[c].Eye.x * bounds.Radius, bounds.Center.y + cameras[c].Eye.y * bounds.Radius,
+					bounds.Center.z + cameras[c].Eye.z * bounds.Radius);
+				XMFLOAT3 at(bounds.Center.x + cameras[c].At.x * bounds.Radius, bounds.Center.y + cameras[c].At.y * bounds.Radius,
+					bounds.Center.z + cameras[c].At.z * bounds.Radius);
+				XMFLOAT4X4 viewProjection = ViewProjection(eye, at, fovY, aspect, bounds.Radius * 0.01f, bounds.Radius * 100.0f);
+
+				const std::vector<MeshCluster>& clusters = meshClusters[i];
+				std::vector<IndexRange> ranges;
+				uint32_t inFrustum = MeshClusters::Cull(clusters.data(), clusters.size(), viewProjection, eye, false, ranges);
+				uint32_t drawn = 0;
+				double us = 1000.0 * FastestMs([&]()
+				{
+					drawn = MeshClusters::Cull(clusters.data(), clusters.size(), viewProjection, eye, true, ranges);
+				});
+
+				double triangles = indexCounts[i] / 3;
+				double boundsCulled = (indexCounts[i] - inFrustum) / 3;
+				double conesCulled = (inFrustum - drawn) / 3;
+				allTriangles += triangles;
+				allBounds += boundsCulled;
+				allCones += conesCulled;
+
+				printf("%-16s %-8s %9u %10.0f %8.1f%% %8.1f%% %8.1f%% %9.2f\n", meshes[i]->Name.c_str(), cameras[c].Name, (unsigned int)clusters.size(),
+					triangles, triangles > 0.0 ? 100.0 * boundsCulled / triangles : 0.0, triangles > 0.0 ? 100.0 * conesCulled / triangles : 0.0,
+					triangles > 0.0 ? 100.0 * (boundsCulled + conesCulled) / triangles : 0.0, us);
+			}
+
+			printf("%-16s %-8s %9s %10.0f %8.1f%% %8.1f%% %8.1f%%\n", "all", cameras[c].Name, "", allTriangles,
+				allTriangles > 0.0 ? 100.0 * allBounds / allTriangles : 0.0, allTriangles > 0.0 ? 100.0 * allCones / allTriangles : 0.0,
+				allTriangles > 0.0 ? 100.0 * (allBounds + allCones) / allTriangles : 0.0);
+		}
+	}
+
+	struct Section
+	{
+		const char* Name;
+		void (*Run)(std::vector<Mesh*>& meshes);
+	};
+
+	const Section Sections[] =
+	{
+		{ "parse", BenchParse },
+		{ "numbers", BenchNumbers },
+		{ "threads", BenchThreads },
+		{ "weld", BenchWeld },
+		{ "cache", BenchCache },
+		{ "lods", BenchLods },
+		{ "culling", BenchCulling },
+		{ "codec", BenchCodec },
+	};
+	const size_t NumSections = sizeof(Sections) / sizeof(Sections[0]);
+}
+
+int main(int argc, char* argv[])
+{
+	if (argc < 2)
+	{
+		printf("Usage: MeshBench <directory with the OBJ files> [section ...]\nSections:");
+		for (size_t s = 0; s < NumSections; ++s)
+		{
+			printf(" %s", Sections[s].Name);
+		}
+
+		printf("\n");
+		return 2;
+	}
+
+	std::string directory = argv[1];
+
+	std::vector<Mesh*> meshes;
+	for (size_t i = 0; i < NumMeshes; ++i)
+	{
+		Mesh* mesh = new Mesh;
+		mesh->Name = MeshNames[i];
+		mesh->Path = directory + "/" + MeshNames[i];
+
+		if (!mesh->File.Open(mesh->Path.c_str()))
+		{
+			printf("Couldn't open %s/%s\n", directory.c_str(), MeshNames[i]);
+			delete mesh;
+			continue;
+		}
+
+		OBJTokenizer::Parse(mesh->File.GetData(), mesh->File.GetSize(), true, mesh->Data);
+		meshes.push_back(mesh);
+	}
+
+	int result = meshes.size() == NumMeshes ? 0 : 1;
+
+	for (size_t s = 0; s < NumSections; ++s)
+	{
+		bool run = argc == 2;
+		for (int a = 2; a < argc; ++a)
+		{
+			run = run || strcmp(argv[a], Sections[s].Name) == 0;
+		}
+
+		if (run)
+		{
+			Sections[s].Run(meshes);
+		}
+	}
+
+	for (size_t i = 0; i < meshes.size(); ++i)
+	{
+		delete meshes[i];
+	}
+
+	return resultsWrong ? 1 : result;
+}
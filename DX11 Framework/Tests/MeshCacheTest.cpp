@@ -0,0 +1,223 @@
+//Cooks a copy of donut.obj with encoded streams (it encodes smaller with either vertex format), then loads it back with the header's counts
+//and the encoded sections corrupted. Every corrupt cache has to fail to load rather than throw, which a count too big to allocate used to
+//do. Exits 1 if any check fails.
+//
+//Usage: MeshCacheTest <directory with the shipped meshes> <directory to cook in>
+
+#include "MeshAsset.h"
+#include "MeshCache.h"
+#include "OBJLoader.h"
+
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <new>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace
+{
+	int failures = 0;
+
+	void Check(bool passed, const char* what, int line)
+	{
+		if (!passed)
+		{
+			printf("FAILED line %d: %s\n", line, what);
+			failures++;
+		}
+	}
+
+#define CHECK(condition) Check((condition), #condition, __LINE__)
+
+	bool CopyFile(const std::string& from, const std::string& to)
+	{
+		MappedFile source;
+		if (!source.Open(from.c_str()))
+		{
+			return false;
+		}
+
+		FILE* file = fopen(to.c_str(), "wb");
+		if (!file)
+		{
+			return false;
+		}
+
+		bool written = fwrite(source.GetData(), 1, source.GetSize(), file) == source.GetSize();
+		return fclose(file) == 0 && written;
+	}
+
+	//A cache in memory on a SectionAlignment boundary, as LoadCooked wants it, that the tests can scribble over
+	class CacheCopy
+	{
+	public:
+		explicit CacheCopy(const MappedFile& file) : _original(file.GetData(), file.GetData() + file.GetSize()),
+			_storage(file.GetSize() + MeshCache::SectionAlignment)
+		{
+			size_t misalignment = (size_t)_storage.data() % MeshCache::SectionAlignment;
+			_data = _storage.data() + (misalignment ? MeshCache::SectionAlignment - misalignment : 0);
+			Reset();
+		}
+
+		void Reset() { memcpy(_data, _original.data(), _original.size()); };
+
+		char* GetData() const { return _data; };
+		size_t GetSize() const { return _original.size(); };
+		MeshCacheHeader& GetHeader() const { return *(MeshCacheHeader*)_data; };
+
+		//Offset and size of a section, as the section table has them
+		bool FindSection(uint32_t type, uint64_t& offset, uint64_t& size) const
+		{
+			const MeshCacheSectionEntry* sections = (const MeshCacheSectionEntry*)(_data + sizeof(MeshCacheHeader));
+			for (uint32_t i = 0; i < GetHeader().NumSections; ++i)
+			{
+				if (sections[i].Type == type)
+				{
+					offset = sections[i].Offset;
+					size = sections[i].Size;
+					return true;
+				}
+			}
+
+			return false;
+		}
+
+	private:
+		std::vector<char> _original;
+		std::vector<char> _storage;
+		char* _data;
+	};
+
+	//True if it loaded, false if it failed the way a bad cache should. Anything thrown is a failure of its own.
+	bool Load(const CacheCopy& cache, bool compressVertices, bool& threw)
+	{
+		threw = false;
+
+		try
+		{
+			MeshAsset asset;
+			return OBJLoader::LoadCooked(cache.GetData(), cache.GetSize(), asset, compressVertices);
+		}
+		catch (const std::bad_alloc&)
+		{
+			threw = true;
+			return false;
+		}
+	}
+
+	void TestCounts(CacheCopy& cache, bool compressVertices)
+	{
+		bool threw;
+		CHECK(Load(cache, compressVertices, threw) && !threw);
+
+		uint64_t offset, size;
+		CHECK(cache.FindSection(MeshCache::Section_EncodedVertices, offset, size));
+		CHECK(cache.FindSection(MeshCache::Section_EncodedIndices, offset, size));
+
+		//Counts past anything the encoded sections could decode to, up to the largest the header can hold
+		static const uint32_t counts[] = { 0x10000000, 0x40000000, 0x7FFFFFFF, 0xFFFFFFFF };
+		for (size_t c = 0; c < sizeof(counts) / sizeof(counts[0]); ++c)
+		{
+			cache.Reset();
+			cache.GetHeader().VertexCount = counts[c];
+			CHECK(!Load(cache, compressVertices, threw) && !threw);
+
+			cache.Reset();
+			cache.GetHeader().IndexCount = counts[c];
+			CHECK(!Load(cache, compressVertices, threw) && !threw);
+		}
+
+		//Counts a little off the real ones get as far as decoding, which has to notice they're wrong
+		cache.Reset();
+		uint32_t vertexCount = cache.GetHeader().VertexCount;
+		uint32_t indexCount = cache.GetHeader().IndexCount;
+		static const int offsets[] = { -3, -1, 1, 3 };
+		for (size_t o = 0; o < sizeof(offsets) / sizeof(offsets[0]); ++o)
+		{
+			cache.Reset();
+			cache.GetHeader().VertexCount = vertexCount + offsets[o];
+			CHECK(!Load(cache, compressVertices, threw) && !threw);
+
+			cache.Reset();
+			cache.GetHeader().IndexCount = indexCount + offsets[o];
+			CHECK(!Load(cache, compressVertices, threw) && !threw);
+		}
+
+		cache.Reset();
+	}
+
+	void TestCorruptSections(CacheCopy& cache, bool compressVertices, std::mt19937& random)
+	{
+		//Random bytes changed in the encoded streams can decode to something that still looks like a mesh, so this only checks nothing throws
+		static const uint32_t types[] = { MeshCache::Section_EncodedVertices, MeshCache::Section_EncodedIndices };
+		for (size_t t = 0; t < sizeof(types) / sizeof(types[0]); ++t)
+		{
+			uint64_t offset, size;
+			if (!cache.FindSection(types[t], offset, size) || size == 0)
+			{
+				continue;
+			}
+
+			for (unsigned int i = 0; i < 2000; ++i)
+			{
+				cache.Reset();
+
+				unsigned int changes = 1 + random() % 8;
+				for (unsigned int c = 0; c < changes; ++c)
+				{
+					cache.GetData()[offset + random() % size] = (char)random();
+				}
+
+				bool threw;
+				Load(cache, compressVertices, threw);
+				CHECK(!threw);
+			}
+		}
+
+		cache.Reset();
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	if (argc < 3)
+	{
+		printf("Usage: MeshCacheTest <directory with the shipped meshes> <directory to cook in>\n");
+		return 1;
+	}
+
+	std::string source = std::string(argv[1]) + "/donut.obj";
+	std::string cooked = std::string(argv[2]) + "/donut.obj";
+	if (!CopyFile(source, cooked))
+	{
+		printf("Couldn't copy %s to %s\n", source.c_str(), cooked.c_str());
+		return 1;
+	}
+
+	std::mt19937 random(20141021);
+
+	for (int compressVertices = 0; compressVertices < 2; ++compressVertices)
+	{
+		if (OBJLoader::Cook(cooked.c_str(), true, compressVertices != 0, true, true) != OBJLoader::Cook_Cooked)
+		{
+			printf("Couldn't cook %s\n", cooked.c_str());
+			return 1;
+		}
+
+		MappedFile file;
+		if (!file.Open((cooked + MeshCache::CacheSuffix(true, compressVertices != 0)).c_str()))
+		{
+			printf("Couldn't open the cache for %s\n", cooked.c_str());
+			return 1;
+		}
+
+		CacheCopy cache(file);
+		TestCounts(cache, compressVertices != 0);
+		TestCorruptSections(cache, compressVertices != 0, random);
+	}
+
+	printf("%s\n", failures == 0 ? "All MeshCache checks passed" : "MeshCache checks FAILED");
+	return failures == 0 ? 0 : 1;
+}
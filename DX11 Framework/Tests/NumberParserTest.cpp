@@ -0,0 +1,220 @@
+//Checks NumberParser against the C library: every float has to come out exactly as strtof gives it, and every int as strtol does, with
+//ptr left in the same place. strtof is correctly rounded in glibc, which is what this is run against. Exits 1 on any mismatch.
+
+#include "NumberParser.h"
+
+#include <cerrno>
+#include <climits>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+
+namespace
+{
+	unsigned int checked = 0;
+	unsigned int failures = 0;
+
+	//Parses text[0, length) both ways. Only used on text strtof reads the same way, so no whitespace, hex, inf or nan.
+	void CheckFloat(const char* text, size_t length)
+	{
+		std::string terminated(text, length);
+		char* expectedEnd;
+		float expected = strtof(terminated.c_str(), &expectedEnd);
+		size_t expectedLength = expectedEnd - terminated.c_str();
+
+		//The parser is handed exactly length bytes in a buffer of their own, so reading past the end shows up under ASan
+		char* copy = new char[length > 0 ? length : 1];
+		memcpy(copy, text, length);
+
+		const char* ptr = copy;
+		float value = -1.0f;
+		bool parsed = NumberParser::ParseFloat(ptr, copy + length, value);
+		size_t parsedLength = ptr - copy;
+		delete[] copy;
+
+		checked++;
+
+		bool same = parsed ? expectedLength > 0 && parsedLength == expectedLength && memcmp(&value, &expected, sizeof(value)) == 0 :
+			expectedLength == 0 && parsedLength == 0;
+
+		if (!same && failures++ < 20)
+		{
+			printf("FAILED \"%s\": got %s %.9g after %u chars, strtof %.9g after %u\n", terminated.c_str(), parsed ? "ok" : "fail", value,
+				(unsigned int)parsedLength, expected, (unsigned int)expectedLength);
+		}
+	}
+
+	void CheckFloat(const char* text)
+	{
+		CheckFloat(text, strlen(text));
+	}
+
+	void CheckInt(const char* text)
+	{
+		char* expectedEnd;
+		errno = 0;
+		long long expected = strtoll(text, &expectedEnd, 10);
+		size_t expectedLength = expectedEnd - text;
+		bool fits = errno == 0 && expected >= INT_MIN && expected <= INT_MAX;
+
+		const char* ptr = text;
+		int value = 12345;
+		bool parsed = NumberParser::ParseInt(ptr, text + strlen(text), value);
+		size_t parsedLength = ptr - text;
+
+		checked++;
+
+		//Out of range values still move ptr past the digits, but leave value alone
+		bool same = parsedLength == expectedLength && parsed == (expectedLength > 0 && fits) && value == (parsed ? (int)expected : 12345);
+
+		if (!same && failures++ < 20)
+		{
+			printf("FAILED int \"%s\": got %s %d after %u chars, strtoll %lld after %u\n", text, parsed ? "ok" : "fail", value,
+				(unsigned int)parsedLength, expected, (unsigned int)expectedLength);
+		}
+	}
+
+	float RandomFloat(std::mt19937& random)
+	{
+		//Any finite bit pattern, so subnormals and the largest floats come up as often as everything else
+		float value;
+		do
+		{
+			uint32_t bits = random();
+			memcpy(&value, &bits, sizeof(value));
+		}
+		while (!std::isfinite(value));
+
+		return value;
+	}
+
+	void TestEdgeCases()
+	{
+		static const char* const floats[] =
+		{
+			"", "+", "-", ".", "+.", "-.e5", "e5", "1", "-1", "+1", "0", "-0", "00000", "1.", ".5", "-.5", "1.e2", "1e", "1e+", "1e-", "1E5",
+			"1e+05", "1x", "1.5.5", "1e5e5", "3.40282347e38", "3.40282357e38", "3.4028236e38", "1e39", "-1e39",
+			"1.17549435e-38", "1.4e-45", "7.006e-46", "7.0064923e-46", "7.0064924e-46", "1e-46", "1e-400", "1e400", "1e2147483648",
+			"1e-2147483649", "0e999999999999", "0.000000000000000000000000000000000000000000001401298464324817",
+			"16777216", "16777217", "16777218", "16777219", "33554435", "9007199254740993", "18446744073709551615",
+			"18446744073709551616", "123456789012345678901234567890", "0.1", "0.2", "0.3", "2.5e-8", "-2.5e-8", "1.000000059604644775390625",
+			"1.0000000596046447753906249", "1.0000000596046447753906251", "0.00000000000000000000000000000000000000000000000000001e60",
+		};
+
+		for (size_t i = 0; i < sizeof(floats) / sizeof(floats[0]); ++i)
+		{
+			CheckFloat(floats[i]);
+		}
+
+		//Ends in the middle of a number, which has to stop there as if the rest wasn't there
+		const char* cut = "1.2345e+12";
+		for (size_t length = 0; length <= strlen(cut); ++length)
+		{
+			CheckFloat(cut, length);
+		}
+
+		static const char* const ints[] =
+		{
+			"", "+", "-", "0", "-0", "7", "-7", "+7", "12a", "2147483647", "2147483648", "-2147483648", "-2147483649", "99999999999999999999",
+			"00000000000000000000000001", "-00000000000000000002147483648", "1.5",
+		};
+
+		for (size_t i = 0; i < sizeof(ints) / sizeof(ints[0]); ++i)
+		{
+			CheckInt(ints[i]);
+		}
+	}
+
+	void TestRandomFloats(std::mt19937& random, unsigned int count)
+	{
+		static const char* const formats[] = { "%.6g", "%.9g", "%.12g", "%.17g" };
+		char text[512];
+
+		for (unsigned int i = 0; i < count; ++i)
+		{
+			float value = RandomFloat(random);
+			for (size_t f = 0; f < sizeof(formats) / sizeof(formats[0]); ++f)
+			{
+				sprintf(text, formats[f], value);
+				CheckFloat(text);
+			}
+
+			//Halfway between value and the next float up, written out exactly, then a hair above it. Ties have to go to even.
+			float next = std::nextafter(value, INFINITY);
+			if (std::isfinite(next))
+			{
+				double halfway = ((double)value + (double)next) / 2.0;
+				sprintf(text, "%.200e", halfway);
+				CheckFloat(text);
+
+				char* exponent = strchr(text, 'e');
+				std::string above = std::string(text, exponent) + "1" + exponent;
+				CheckFloat(above.c_str());
+			}
+		}
+	}
+
+	void TestRandomDigits(std::mt19937& random, unsigned int count)
+	{
+		//Digit strings of any length, with or without a point and an exponent, as nothing prints them
+		std::string text;
+
+		for (unsigned int i = 0; i < count; ++i)
+		{
+			text.clear();
+
+			uint32_t shape = random();
+			if (shape & 1) text += (shape & 2) ? '-' : '+';
+
+			unsigned int digits = random() % 40;
+			unsigned int point = (shape & 4) ? random() % (digits + 1) : digits + 1;
+
+			for (unsigned int d = 0; d <= digits; ++d)
+			{
+				if (d == point) text += '.';
+				if (d < digits) text += (char)('0' + random() % 10);
+			}
+
+			if (shape & 8)
+			{
+				text += (shape & 16) ? 'e' : 'E';
+				if (shape & 32) text += (shape & 64) ? '-' : '+';
+
+				char exponent[16];
+				sprintf(exponent, "%u", (unsigned int)(random() % 90));
+				text += exponent;
+			}
+
+			CheckFloat(text.c_str());
+		}
+	}
+
+	void TestRandomInts(std::mt19937& random, unsigned int count)
+	{
+		char text[32];
+
+		for (unsigned int i = 0; i < count; ++i)
+		{
+			//Spread over every magnitude, including just past the ends of int
+			long long value = (long long)(random() % 2 ? 1 : -1) * (long long)((uint64_t)random() << (random() % 33) >> 32);
+			sprintf(text, "%lld", value);
+			CheckInt(text);
+		}
+	}
+}
+
+int main()
+{
+	std::mt19937 random(20141021);
+
+	TestEdgeCases();
+	TestRandomFloats(random, 100000);
+	TestRandomDigits(random, 200000);
+	TestRandomInts(random, 200000);
+
+	printf("%u of %u numbers parsed differently from the C library\n", failures, checked);
+	return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,169 @@
+//Runs OBJTokenizer over small OBJ files written here: every corner form, relative indices, and faces with malformed corners, which have
+//to end the face where they are rather than stall the parser. Then checks ParseParallel splits a large file into the same result.
+//Exits 1 if any check fails.
+
+#include "OBJTokenizer.h"
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace
+{
+	int failures = 0;
+
+	void Check(bool passed, const char* what, int line)
+	{
+		if (!passed)
+		{
+			printf("FAILED line %d: %s\n", line, what);
+			failures++;
+		}
+	}
+
+#define CHECK(condition) Check((condition), #condition, __LINE__)
+
+	const unsigned int Missing = OBJTokenizer::MissingIndex;
+
+	//Four of everything, so any index from -4 to 4 is in range
+	const char* const Header =
+		"v 0 0 0\nv 1 0 0\nv 1 1 0\nv 0 1 0\n"
+		"vt 0 0\nvt 1 0\nvt 1 1\nvt 0 1\n"
+		"vn 0 0 1\nvn 0 1 0\nvn 1 0 0\nvn 0 0 -1\n";
+
+	void Parse(const std::string& faces, OBJTokenizer::OBJFileData& data)
+	{
+		std::string text = std::string(Header) + faces;
+		data = OBJTokenizer::OBJFileData();
+		OBJTokenizer::Parse(text.data(), text.size(), false, data);
+	}
+
+	//The corners of the parsed triangles, as position/texcoord/normal triples
+	bool CornersAre(const OBJTokenizer::OBJFileData& data, const unsigned int* expected, size_t corners)
+	{
+		if (data.PositionIndices.size() != corners || data.TexCoordIndices.size() != corners || data.NormalIndices.size() != corners)
+		{
+			return false;
+		}
+
+		for (size_t i = 0; i < corners; ++i)
+		{
+			if (data.PositionIndices[i] != expected[i * 3] || data.TexCoordIndices[i] != expected[i * 3 + 1] ||
+				data.NormalIndices[i] != expected[i * 3 + 2])
+			{
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	size_t Triangles(const std::string& faces)
+	{
+		OBJTokenizer::OBJFileData data;
+		Parse(faces, data);
+		return data.PositionIndices.size() / 3;
+	}
+
+	void TestCorners()
+	{
+		OBJTokenizer::OBJFileData data;
+		CHECK(data.Positions.empty());
+
+		Parse("f 1 2 3\n", data);
+		CHECK(data.Positions.size() == 4 && data.TexCoords.size() == 4 && data.Normals.size() == 4);
+		const unsigned int plain[] = { 0, Missing, Missing, 1, Missing, Missing, 2, Missing, Missing };
+		CHECK(CornersAre(data, plain, 3));
+
+		Parse("f 1/2 2/3 3/4\n", data);
+		const unsigned int texCoords[] = { 0, 1, Missing, 1, 2, Missing, 2, 3, Missing };
+		CHECK(CornersAre(data, texCoords, 3));
+
+		Parse("f 1//4 2//3 3//2\n", data);
+		const unsigned int normals[] = { 0, Missing, 3, 1, Missing, 2, 2, Missing, 1 };
+		CHECK(CornersAre(data, normals, 3));
+
+		Parse("f 1/1/1 2/2/2 3/3/3\n", data);
+		const unsigned int full[] = { 0, 0, 0, 1, 1, 1, 2, 2, 2 };
+		CHECK(CornersAre(data, full, 3));
+
+		//Empty fields read as missing
+		Parse("f 1/ 2// 3/1/\r\n", data);
+		const unsigned int empty[] = { 0, Missing, Missing, 1, Missing, Missing, 2, 0, Missing };
+		CHECK(CornersAre(data, empty, 3));
+
+		//Relative indices count back from the last element so far
+		Parse("f -4/-4/-4 -3/-3/-3 -1/-2/-1\n", data);
+		const unsigned int relative[] = { 0, 0, 0, 1, 1, 1, 3, 2, 3 };
+		CHECK(CornersAre(data, relative, 3));
+
+		//Quads fan out from the first corner
+		Parse("f 1 2 3 4\n", data);
+		const unsigned int quad[] = { 0, Missing, Missing, 1, Missing, Missing, 2, Missing, Missing,
+			0, Missing, Missing, 2, Missing, Missing, 3, Missing, Missing };
+		CHECK(CornersAre(data, quad, 6));
+
+		//Out of range indices, including ones too big for an int, are missing rather than wrapped
+		Parse("f 1 2 -5\nf 1 2 -2147483648\nf 1 2 99999999999\n", data);
+		CHECK(data.PositionIndices.size() == 9 && data.PositionIndices[2] == Missing && data.PositionIndices[5] == Missing &&
+			data.PositionIndices[8] == Missing);
+	}
+
+	void TestMalformedFaces()
+	{
+		//A corner that isn't a number ends the face there, keeping the triangles before it, and parsing goes on with the next line
+		CHECK(Triangles("f 1 2 -x\n") == 0);
+		CHECK(Triangles("f 1/-/2 3 4\n") == 0);
+		CHECK(Triangles("f - 1 2 3\n") == 0);
+		CHECK(Triangles("f 1 2 3 -\n") == 1);
+		CHECK(Triangles("f 1 2 3 4 -x 1\n") == 2);
+		CHECK(Triangles("f 1 2 3/-\n") == 0);
+		CHECK(Triangles("f 1/x 2 3\n") == 0);
+		CHECK(Triangles("f 1//- 2 3\n") == 0);
+		CHECK(Triangles("f 1//2 2//3 3//x\n") == 0);
+		CHECK(Triangles("f 1 2 3/-/\n") == 0);
+		CHECK(Triangles("f 1 2 -x\nf 1 2 3\nf 1/-/2 3 4\nf 2 3 4\n") == 2);
+
+		//Ends in the middle of a corner
+		CHECK(Triangles("f 1 2 -") == 0);
+		CHECK(Triangles("f 1 2 3/") == 1);
+		CHECK(Triangles("f 1 2 3//") == 1);
+	}
+
+	void TestParallel()
+	{
+		//Big enough to be split across every thread, with malformed faces among the good ones
+		std::string text = Header;
+		while (text.size() < 4 << 20)
+		{
+			text += "v 0.5 0.25 -1\nvt 0.5 0.5\nvn 0 1 0\nf -1/-1/-1 -2/-2/-2 -3/-3/-3\nf 1 2 -x\nf 1/-/2 3 4\nf 1/1/1 2/2/2 3/3/3 4/4/4\n";
+		}
+
+		OBJTokenizer::OBJFileData serial;
+		OBJTokenizer::Parse(text.data(), text.size(), false, serial);
+		CHECK(serial.PositionIndices.size() > 0 && serial.PositionIndices.size() % 9 == 0);
+
+		static const unsigned int threadCounts[] = { 2, 3, 8 };
+		for (size_t t = 0; t < sizeof(threadCounts) / sizeof(threadCounts[0]); ++t)
+		{
+			OBJTokenizer::OBJFileData parallel;
+			OBJTokenizer::ParseParallel(text.data(), text.size(), false, threadCounts[t], parallel);
+
+			CHECK(parallel.Positions.size() == serial.Positions.size());
+			CHECK(parallel.PositionIndices == serial.PositionIndices);
+			CHECK(parallel.TexCoordIndices == serial.TexCoordIndices);
+			CHECK(parallel.NormalIndices == serial.NormalIndices);
+		}
+	}
+}
+
+int main()
+{
+	TestCorners();
+	TestMalformedFaces();
+	TestParallel();
+
+	printf("%s\n", failures == 0 ? "All OBJTokenizer checks passed" : "OBJTokenizer checks FAILED");
+	return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,290 @@
+//Drives TextureResidency with a fake allocator that records which mips it's told to keep: which textures lose mips first as the budget
+//shrinks, that they get them back in the opposite order, and that whatever can fit in the budget does. Exits 1 if any check fails.
+
+#include "TextureResidency.h"
+#include "DDSLayout.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <map>
+#include <random>
+#include <utility>
+#include <vector>
+
+namespace
+{
+	int failures = 0;
+
+	void Check(bool passed, const char* what, int line)
+	{
+		if (!passed)
+		{
+			printf("FAILED line %d: %s\n", line, what);
+			failures++;
+		}
+	}
+
+#define CHECK(condition) Check((condition), #condition, __LINE__)
+
+	//Keeps the top mip of every texture it's told about, and every call since the test last cleared them
+	class FakeAllocator : public TextureMipAllocator
+	{
+	public:
+		virtual void SetTopMip(uint32_t texture, unsigned int topMip)
+		{
+			TopMips[texture] = topMip;
+			Calls.push_back(std::make_pair(texture, topMip));
+		}
+
+		unsigned int GetTopMip(uint32_t texture) const
+		{
+			std::map<uint32_t, unsigned int>::const_iterator found = TopMips.find(texture);
+			return found != TopMips.end() ? found->second : 0;
+		}
+
+		bool Called(uint32_t texture, unsigned int topMip) const
+		{
+			return Calls.size() == 1 && Calls[0].first == texture && Calls[0].second == topMip;
+		}
+
+		std::map<uint32_t, unsigned int> TopMips;
+		std::vector<std::pair<uint32_t, unsigned int> > Calls;
+	};
+
+	const uint32_t Format = DDSLayout::Format_R8G8B8A8_UNorm;
+
+	uint32_t MipCount(uint32_t size)
+	{
+		uint32_t mips = 1;
+		while (size >> mips)
+		{
+			mips++;
+		}
+
+		return mips;
+	}
+
+	//Bytes of a square RGBA8 texture from topMip down, worked out here rather than with GetSurfaceInfo
+	size_t ChainBytes(uint32_t size, unsigned int topMip)
+	{
+		size_t bytes = 0;
+		for (unsigned int mip = topMip; mip < MipCount(size); ++mip)
+		{
+			size_t edge = std::max(size >> mip, 1u);
+			bytes += edge * edge * 4;
+		}
+
+		return bytes;
+	}
+
+	void Track(TextureResidency& residency, uint32_t texture, uint32_t size, bool canDowngrade = true)
+	{
+		residency.Track(texture, Format, size, size, 1, MipCount(size), 1, canDowngrade);
+	}
+
+	void TestNoBudget()
+	{
+		TextureResidency residency;
+		FakeAllocator allocator;
+
+		Track(residency, 1, 256);
+		Track(residency, 2, 64);
+		residency.Update(allocator);
+
+		//Everything at full size, which is what a tracked texture starts as, so the allocator isn't told anything
+		CHECK(allocator.Calls.empty());
+		CHECK(residency.GetUsedBytes() == ChainBytes(256, 0) + ChainBytes(64, 0));
+		CHECK(residency.GetTopMip(1) == 0 && residency.GetTopMip(2) == 0 && residency.GetTopMip(3) == 0);
+
+		//A bias applies with or without a budget
+		residency.SetMipBias(1, 2);
+		residency.Update(allocator);
+		CHECK(allocator.Called(1, 2));
+		CHECK(residency.GetUsedBytes() == ChainBytes(256, 2) + ChainBytes(64, 0));
+	}
+
+	void TestEvictionOrder()
+	{
+		TextureResidency residency;
+		FakeAllocator allocator;
+
+		//Bound in the order 1, 2, 3, a frame apart, so 1 is the least recently bound
+		Track(residency, 1, 256);
+		Track(residency, 2, 256);
+		Track(residency, 3, 256);
+		residency.Update(allocator);
+
+		for (uint32_t texture = 1; texture <= 3; ++texture)
+		{
+			residency.MarkBound(texture);
+			residency.Update(allocator);
+		}
+
+		const size_t full = ChainBytes(256, 0);
+		const size_t smallest = ChainBytes(256, MipCount(256) - 1);
+
+		//A byte over, so only the least recently bound loses its top mip
+		allocator.Calls.clear();
+		residency.SetBudget(full * 3 - 1);
+		residency.Update(allocator);
+		CHECK(allocator.Called(1, 1));
+		CHECK(residency.GetUsedBytes() == full * 2 + ChainBytes(256, 1));
+
+		//It goes all the way down to its smallest mip before the next one loses anything
+		allocator.Calls.clear();
+		residency.SetBudget(full * 2 + smallest);
+		residency.Update(allocator);
+		CHECK(allocator.Called(1, MipCount(256) - 1));
+		CHECK(residency.GetTopMip(2) == 0 && residency.GetTopMip(3) == 0);
+		CHECK(residency.GetUsedBytes() == residency.GetBudget());
+
+		allocator.Calls.clear();
+		residency.SetBudget(full * 2 + smallest - 1);
+		residency.Update(allocator);
+		CHECK(allocator.Called(2, 1));
+		CHECK(residency.GetTopMip(1) == MipCount(256) - 1 && residency.GetTopMip(3) == 0);
+
+		//Binding 1 again makes 2 the least recently bound, so 2 loses the mips and 1 gets them back
+		residency.MarkBound(1);
+		allocator.Calls.clear();
+		residency.SetBudget(full * 2 + smallest);
+		residency.Update(allocator);
+		CHECK(residency.GetTopMip(1) == 0 && residency.GetTopMip(2) == MipCount(256) - 1 && residency.GetTopMip(3) == 0);
+		CHECK(allocator.Calls.size() == 2);
+
+		//Given the room, everything gets its mips back
+		allocator.Calls.clear();
+		residency.SetBudget(0);
+		residency.Update(allocator);
+		CHECK(allocator.Called(2, 0));
+		CHECK(residency.GetUsedBytes() == full * 3);
+	}
+
+	void TestSameFrame()
+	{
+		TextureResidency residency;
+		FakeAllocator allocator;
+
+		//Bound in the same frame, so they take turns losing a mip, the larger first
+		Track(residency, 1, 512);
+		Track(residency, 2, 256);
+		residency.Update(allocator);
+
+		const size_t full = ChainBytes(512, 0) + ChainBytes(256, 0);
+
+		residency.SetBudget(full - 1);
+		residency.Update(allocator);
+		CHECK(residency.GetTopMip(1) == 1 && residency.GetTopMip(2) == 0);
+
+		residency.SetBudget(ChainBytes(512, 1) + ChainBytes(256, 0) - 1);
+		residency.Update(allocator);
+		CHECK(residency.GetTopMip(1) == 1 && residency.GetTopMip(2) == 1);
+
+		residency.SetBudget(ChainBytes(512, 1) + ChainBytes(256, 1) - 1);
+		residency.Update(allocator);
+		CHECK(residency.GetTopMip(1) == 2 && residency.GetTopMip(2) == 1);
+		CHECK(residency.GetUsedBytes() <= residency.GetBudget());
+	}
+
+	void TestFixedTextures()
+	{
+		TextureResidency residency;
+		FakeAllocator allocator;
+
+		//A texture that can't be downgraded keeps every mip however tight the budget, and the others give up all they can for it
+		Track(residency, 1, 256, false);
+		Track(residency, 2, 256);
+		residency.SetBudget(ChainBytes(256, 0) / 2);
+		residency.Update(allocator);
+
+		CHECK(residency.GetTopMip(1) == 0 && residency.GetTopMip(2) == MipCount(256) - 1);
+		CHECK(residency.GetUsedBytes() == ChainBytes(256, 0) + ChainBytes(256, MipCount(256) - 1));
+
+		//Untracking it frees its share of the budget
+		residency.Untrack(1);
+		residency.Update(allocator);
+		CHECK(residency.GetTopMip(2) == 1);
+		CHECK(residency.GetUsedBytes() == ChainBytes(256, 1));
+	}
+
+	void TestRandomFrames(std::mt19937& random)
+	{
+		TextureResidency residency;
+		FakeAllocator allocator;
+
+		std::map<uint32_t, uint32_t> sizes;
+		std::map<uint32_t, bool> fixed;
+
+		for (unsigned int frame = 0; frame < 2000; ++frame)
+		{
+			//Textures come and go, get bound at random, and the budget moves around
+			uint32_t texture = random() % 64;
+			if (sizes.count(texture) && random() % 4 == 0)
+			{
+				//Tracked again it's a new texture at full size, as far as the allocator knows too
+				residency.Untrack(texture);
+				allocator.TopMips.erase(texture);
+				sizes.erase(texture);
+				fixed.erase(texture);
+			}
+			else if (!sizes.count(texture))
+			{
+				uint32_t size = 1 << (random() % 11);
+				bool canDowngrade = random() % 8 != 0;
+				Track(residency, texture, size, canDowngrade);
+				sizes[texture] = size;
+				fixed[texture] = !canDowngrade;
+			}
+
+			for (unsigned int bind = random() % 16; bind > 0; --bind)
+			{
+				residency.MarkBound(random() % 64);
+			}
+
+			if (random() % 32 == 0)
+			{
+				residency.SetBudget(random() % 2 ? 0 : random() % (8 << 20));
+			}
+
+			residency.Update(allocator);
+
+			//What's counted as used is what the allocator was told to keep, and it's within the budget unless nothing more can go
+			size_t used = 0;
+			size_t smallest = 0;
+			for (std::map<uint32_t, uint32_t>::const_iterator i = sizes.begin(); i != sizes.end(); ++i)
+			{
+				unsigned int topMip = residency.GetTopMip(i->first);
+				used += ChainBytes(i->second, topMip);
+				smallest += ChainBytes(i->second, fixed[i->first] ? 0 : MipCount(i->second) - 1);
+
+				if (topMip != allocator.GetTopMip(i->first))
+				{
+					CHECK(topMip == allocator.GetTopMip(i->first));
+					return;
+				}
+			}
+
+			size_t budget = residency.GetBudget();
+			if (used != residency.GetUsedBytes() || (budget > 0 && used > std::max(budget, smallest)))
+			{
+				CHECK(used == residency.GetUsedBytes());
+				CHECK(budget == 0 || used <= std::max(budget, smallest));
+				return;
+			}
+		}
+	}
+}
+
+int main()
+{
+	std::mt19937 random(20141021);
+
+	TestNoBudget();
+	TestEvictionOrder();
+	TestSameFrame();
+	TestFixedTextures();
+	TestRandomFrames(random);
+
+	printf("%s\n", failures == 0 ? "All TextureResidency checks passed" : "TextureResidency checks FAILED");
+	return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,181 @@
+#include "TextureResidency.h"
+#include "DDSLayout.h"
+#include <algorithm>
+
+TextureResidency::TextureResidency()
+{
+	_budget = 0;
+	_usedBytes = 0;
+	_frame = 0;
+}
+
+void TextureResidency::SetBudget(size_t bytes)
+{
+	_budget = bytes;
+}
+
+void TextureResidency::Track(uint32_t texture, uint32_t format, uint32_t width, uint32_t height, uint32_t depth, uint32_t mipCount,
+	uint32_t arraySize, bool canDowngrade)
+{
+	Texture* existing = Find(texture);
+	if (!existing)
+	{
+		_indices[texture] = _textures.size();
+		_textures.push_back(Texture());
+		existing = &_textures.back();
+	}
+
+	Texture& entry = *existing;
+	entry.Id = texture;
+	entry.CanDowngrade = canDowngrade;
+	entry.MipBias = 0;
+	entry.LastBound = _frame;
+	entry.TopMip = 0;
+	entry.Wanted = 0;
+
+	//Mip bytes from GetSurfaceInfo, then summed from the smallest up
+	mipCount = std::max(mipCount, 1u);
+	entry.ChainBytes.assign(mipCount, 0);
+
+	for (uint32_t mip = 0; mip < mipCount; ++mip)
+	{
+		uint64_t surfaceBytes = 0;
+		DDSLayout::GetSurfaceInfo(std::max(width >> mip, 1u), std::max(height >> mip, 1u), format, &surfaceBytes, nullptr, nullptr);
+		entry.ChainBytes[mip] = (size_t)(surfaceBytes * std::max(depth >> mip, 1u) * arraySize);
+	}
+
+	for (uint32_t mip = mipCount - 1; mip > 0; --mip)
+	{
+		entry.ChainBytes[mip - 1] += entry.ChainBytes[mip];
+	}
+}
+
+void TextureResidency::Untrack(uint32_t texture)
+{
+	std::unordered_map<uint32_t, size_t>::iterator found = _indices.find(texture);
+	if (found == _indices.end())
+	{
+		return;
+	}
+
+	//Swap the last one into the gap
+	size_t index = found->second;
+	_indices.erase(found);
+
+	if (index != _textures.size() - 1)
+	{
+		std::swap(_textures[index], _textures.back());
+		_indices[_textures[index].Id] = index;
+	}
+
+	_textures.pop_back();
+}
+
+void TextureResidency::SetMipBias(uint32_t texture, unsigned int bias)
+{
+	Texture* entry = Find(texture);
+	if (entry)
+	{
+		entry->MipBias = bias;
+	}
+}
+
+void TextureResidency::MarkBound(uint32_t texture)
+{
+	Texture* entry = Find(texture);
+	if (entry)
+	{
+		entry->LastBound = _frame;
+	}
+}
+
+void TextureResidency::Update(TextureMipAllocator& allocator)
+{
+	//Everything as large as it's allowed to be
+	size_t used = 0;
+	for (size_t i = 0; i < _textures.size(); ++i)
+	{
+		Texture& entry = _textures[i];
+		entry.Wanted = entry.CanDowngrade ? std::min(entry.MipBias, (unsigned int)entry.ChainBytes.size() - 1) : 0;
+		used += entry.ChainBytes[entry.Wanted];
+	}
+
+	if (_budget > 0 && used > _budget)
+	{
+		_candidates.clear();
+		for (size_t i = 0; i < _textures.size(); ++i)
+		{
+			const Texture& entry = _textures[i];
+			if (entry.CanDowngrade && entry.Wanted + 1 < entry.ChainBytes.size())
+			{
+				Candidate candidate;
+				candidate.LastBound = entry.LastBound;
+				candidate.Bytes = entry.ChainBytes[entry.Wanted];
+				candidate.Index = i;
+				_candidates.push_back(candidate);
+			}
+		}
+
+		std::sort(_candidates.begin(), _candidates.end());
+
+		//One frame's textures at a time, a mip from each in turn, until it fits or they're down to their smallest mips
+		size_t group = 0;
+		while (group < _candidates.size() && used > _budget)
+		{
+			size_t groupEnd = group + 1;
+			while (groupEnd < _candidates.size() && _candidates[groupEnd].LastBound == _candidates[group].LastBound)
+			{
+				groupEnd++;
+			}
+
+			bool dropped = true;
+			while (dropped && used > _budget)
+			{
+				dropped = false;
+				for (size_t i = group; i < groupEnd && used > _budget; ++i)
+				{
+					Texture& entry = _textures[_candidates[i].Index];
+					if (entry.Wanted + 1 < entry.ChainBytes.size())
+					{
+						used -= entry.ChainBytes[entry.Wanted] - entry.ChainBytes[entry.Wanted + 1];
+						entry.Wanted++;
+						dropped = true;
+					}
+				}
+			}
+
+			group = groupEnd;
+		}
+	}
+
+	for (size_t i = 0; i < _textures.size(); ++i)
+	{
+		Texture& entry = _textures[i];
+		if (entry.Wanted != entry.TopMip)
+		{
+			entry.TopMip = entry.Wanted;
+			allocator.SetTopMip(entry.Id, entry.TopMip);
+		}
+	}
+
+	_usedBytes = used;
+	_frame++;
+}
+
+unsigned int TextureResidency::GetTopMip(uint32_t texture) const
+{
+	const Texture* entry = Find(texture);
+	return entry ? entry->TopMip : 0;
+}
+
+TextureResidency::Texture* TextureResidency::Find(uint32_t texture)
+{
+	std::unordered_map<uint32_t, size_t>::const_iterator found = _indices.find(texture);
+	return found != _indices.end() ? &_textures[found->second] : nullptr;
+}
+
+const TextureResidency::Texture* TextureResidency::Find(uint32_t texture) const
+{
+	std::unordered_map<uint32_t, size_t>::const_iterator found = _indices.find(texture);
+	return found != _indices.end() ? &_textures[found->second] : nullptr;
+}
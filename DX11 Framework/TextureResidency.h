@@ -0,0 +1,96 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <unordered_map>
+#include <vector>
+
+//Where TextureResidency's decisions go. AssetLoader in the game, which swaps streamed textures for smaller or larger ones. Tests and tools
+//without a GPU can pass their own (e.g. one that just records the calls).
+class TextureMipAllocator
+{
+public:
+	virtual ~TextureMipAllocator() {};
+
+	//Keep the mips from topMip down on the GPU and free the larger ones. It doesn't have to happen straight away.
+	virtual void SetTopMip(uint32_t texture, unsigned int topMip) = 0;
+};
+
+//Keeps the textures it tracks within a memory budget. Every texture is counted, by the size GetSurfaceInfo gives its mips, and when they add up
+//to more than the budget the least recently bound ones lose their largest mips until they fit. Textures bound in the same frame lose a mip
+//each in turn, largest first, rather than one of them losing all of its mips. As the budget allows they get their mips back, most recently
+//bound first, which is the same calculation run the other way.
+//Nothing here touches a device, so the policy can be run against a fake allocator.
+class TextureResidency
+{
+public:
+	TextureResidency();
+
+	//Bytes, 0 for no limit. Takes effect at the next Update.
+	void SetBudget(size_t bytes);
+	size_t GetBudget() const { return _budget; };
+
+	//Starts counting a texture. Those that can't be downgraded (canDowngrade false) always keep every mip, they just take up the budget.
+	//A texture tracked again replaces what was known about it. Its mips are counted from the next Update, and it counts as bound this frame,
+	//so a texture that has only just loaded isn't the first to go.
+	void Track(uint32_t texture, uint32_t format, uint32_t width, uint32_t height, uint32_t depth, uint32_t mipCount, uint32_t arraySize,
+		bool canDowngrade);
+	void Untrack(uint32_t texture);
+
+	//The largest mip a texture is ever given, for textures the owner already wants smaller. 0 by default.
+	void SetMipBias(uint32_t texture, unsigned int bias);
+
+	//Records that the texture was bound for this frame's drawing. Cheap enough to call for every bind.
+	void MarkBound(uint32_t texture);
+
+	//Works out every texture's top mip for the budget and the binds recorded so far, tells the allocator about the ones that changed, and
+	//starts the next frame. Call once a frame.
+	void Update(TextureMipAllocator& allocator);
+
+	//The bytes of every tracked texture at the top mip the last Update gave it. More than the budget if even their smallest mips don't fit.
+	size_t GetUsedBytes() const { return _usedBytes; };
+
+	//The top mip the last Update gave a texture, 0 if it isn't tracked
+	unsigned int GetTopMip(uint32_t texture) const;
+
+private:
+	struct Texture
+	{
+		uint32_t Id;
+		std::vector<size_t> ChainBytes;		//Bytes of every array item from each mip down, so ChainBytes[0] is the whole texture
+		bool CanDowngrade;
+		unsigned int MipBias;
+		uint64_t LastBound;
+		unsigned int TopMip;				//What the allocator was last told
+		unsigned int Wanted;				//Worked out by Update
+	};
+
+	//A texture Update can take mips from
+	struct Candidate
+	{
+		uint64_t LastBound;
+		size_t Bytes;
+		size_t Index;		//Into _textures
+
+		//Least recently bound first. Within a frame the largest first, they free the most for a mip.
+		bool operator<(const Candidate& other) const
+		{
+			if (LastBound != other.LastBound)
+			{
+				return LastBound < other.LastBound;
+			}
+
+			return Bytes != other.Bytes ? Bytes > other.Bytes : Index < other.Index;
+		}
+	};
+
+	Texture* Find(uint32_t texture);
+	const Texture* Find(uint32_t texture) const;
+
+	std::vector<Texture> _textures;
+	std::unordered_map<uint32_t, size_t> _indices;		//Into _textures, by Id
+	std::vector<Candidate> _candidates;		//Scratch for Update, kept to save allocating it every frame
+	size_t _budget;
+	size_t _usedBytes;
+	uint64_t _frame;
+};
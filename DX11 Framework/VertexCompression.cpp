@@ -0,0 +1,279 @@
+#include "VertexCompression.h"
+#include <cmath>
+#include <cstring>
+
+namespace
+{
+	inline float Clamp(float value, float low, float high)
+	{
+		return value < low ? low : (value > high ? high : value);
+	}
+
+	inline float SignNotZero(float value)
+	{
+		return value >= 0.0f ? 1.0f : -1.0f;
+	}
+
+	inline int16_t ToSNorm16(float value)
+	{
+		return (int16_t)lroundf(Clamp(value, -1.0f, 1.0f) * 32767.0f);
+	}
+
+	inline float FromSNorm16(int16_t value)
+	{
+		//Same as the GPU: -32768 and -32767 both mean -1
+		float f = value / 32767.0f;
+		return f < -1.0f ? -1.0f : f;
+	}
+}
+
+VertexCompression::PositionQuantization VertexCompression::ComputeQuantization(const SimpleVertex* vertices, size_t numVertices)
+{
+	PositionQuantization quantization;
+
+	for (int axis = 0; axis < 3; ++axis)
+	{
+		quantization.Scale[axis] = 0.0f;
+		quantization.Offset[axis] = 0.0f;
+	}
+
+	if (numVertices == 0)
+	{
+		return quantization;
+	}
+
+	float minimum[3] = { vertices[0].Pos.x, vertices[0].Pos.y, vertices[0].Pos.z };
+	float maximum[3] = { vertices[0].Pos.x, vertices[0].Pos.y, vertices[0].Pos.z };
+
+	for (size_t i = 1; i < numVertices; ++i)
+	{
+		const float* position = &vertices[i].Pos.x;
+
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			if (position[axis] < minimum[axis]) minimum[axis] = position[axis];
+			if (position[axis] > maximum[axis]) maximum[axis] = position[axis];
+		}
+	}
+
+	for (int axis = 0; axis < 3; ++axis)
+	{
+		quantization.Offset[axis] = minimum[axis];
+		quantization.Scale[axis] = maximum[axis] - minimum[axis];
+	}
+
+	return quantization;
+}
+
+void VertexCompression::Compress(const SimpleVertex* vertices, size_t numVertices, const PositionQuantization& quantization, CompressedVertex* out)
+{
+	float inverseScale[3];
+	for (int axis = 0; axis < 3; ++axis)
+	{
+		inverseScale[axis] = quantization.Scale[axis] > 0.0f ? 1.0f / quantization.Scale[axis] : 0.0f;
+	}
+
+	for (size_t i = 0; i < numVertices; ++i)
+	{
+		const SimpleVertex& vertex = vertices[i];
+		CompressedVertex& compressed = out[i];
+		const float* position = &vertex.Pos.x;
+
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			float unorm = Clamp((position[axis] - quantization.Offset[axis]) * inverseScale[axis], 0.0f, 1.0f);
+			compressed.Pos[axis] = (uint16_t)lroundf(unorm * 65535.0f);
+		}
+		compressed.Pos[3] = 65535; //w = 1
+
+		EncodeOctahedral(vertex.Normal, compressed.Normal);
+
+		compressed.TexC[0] = FloatToHalf(vertex.TexC.x);
+		compressed.TexC[1] = FloatToHalf(vertex.TexC.y);
+	}
+}
+
+void VertexCompression::Decompress(const CompressedVertex* vertices, size_t numVertices, const PositionQuantization& quantization, SimpleVertex* out)
+{
+	for (size_t i = 0; i < numVertices; ++i)
+	{
+		const CompressedVertex& compressed = vertices[i];
+		SimpleVertex& vertex = out[i];
+		float* position = &vertex.Pos.x;
+
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			position[axis] = (compressed.Pos[axis] / 65535.0f) * quantization.Scale[axis] + quantization.Offset[axis];
+		}
+
+		vertex.Normal = DecodeOctahedral(compressed.Normal);
+		vertex.TexC.x = HalfToFloat(compressed.TexC[0]);
+		vertex.TexC.y = HalfToFloat(compressed.TexC[1]);
+	}
+}
+
+VertexCompression::CompressionError VertexCompression::MeasureError(const SimpleVertex* original, const CompressedVertex* compressed, size_t numVertices, const PositionQuantization& quantization)
+{
+	CompressionError error;
+	error.MaxPositionError = 0.0f;
+	error.MaxNormalErrorDegrees = 0.0f;
+
+	const float radiansToDegrees = 57.2957795f;
+
+	for (size_t i = 0; i < numVertices; ++i)
+	{
+		SimpleVertex decoded;
+		Decompress(&compressed[i], 1, quantization, &decoded);
+
+		float dx = decoded.Pos.x - original[i].Pos.x;
+		float dy = decoded.Pos.y - original[i].Pos.y;
+		float dz = decoded.Pos.z - original[i].Pos.z;
+		float positionError = sqrtf(dx * dx + dy * dy + dz * dz);
+
+		if (positionError > error.MaxPositionError) error.MaxPositionError = positionError;
+
+		//Zero normals (corners the OBJ gave no normal for) have no direction to be wrong about
+		const XMFLOAT3& n = original[i].Normal;
+		float length = sqrtf(n.x * n.x + n.y * n.y + n.z * n.z);
+
+		if (length > 0.0f)
+		{
+			float cosine = (n.x * decoded.Normal.x + n.y * decoded.Normal.y + n.z * decoded.Normal.z) / length;
+			float angle = acosf(Clamp(cosine, -1.0f, 1.0f)) * radiansToDegrees;
+
+			if (angle > error.MaxNormalErrorDegrees) error.MaxNormalErrorDegrees = angle;
+		}
+	}
+
+	return error;
+}
+
+void VertexCompression::EncodeOctahedral(const XMFLOAT3& normal, int16_t encoded[2])
+{
+	//Project onto the octahedron |x| + |y| + |z| = 1, then fold the lower half over the diagonals
+	float l1 = fabsf(normal.x) + fabsf(normal.y) + fabsf(normal.z);
+
+	if (l1 == 0.0f)
+	{
+		encoded[0] = 0;
+		encoded[1] = 0;
+		return;
+	}
+
+	float u = normal.x / l1;
+	float v = normal.y / l1;
+
+	if (normal.z < 0.0f)
+	{
+		float foldedU = (1.0f - fabsf(v)) * SignNotZero(u);
+		float foldedV = (1.0f - fabsf(u)) * SignNotZero(v);
+		u = foldedU;
+		v = foldedV;
+	}
+
+	encoded[0] = ToSNorm16(u);
+	encoded[1] = ToSNorm16(v);
+}
+
+XMFLOAT3 VertexCompression::DecodeOctahedral(const int16_t encoded[2])
+{
+	//Must match DecodeOctahedral in DX11 Framework.fx
+	float u = FromSNorm16(encoded[0]);
+	float v = FromSNorm16(encoded[1]);
+	float z = 1.0f - fabsf(u) - fabsf(v);
+
+	if (z < 0.0f)
+	{
+		float unfoldedU = (1.0f - fabsf(v)) * SignNotZero(u);
+		float unfoldedV = (1.0f - fabsf(u)) * SignNotZero(v);
+		u = unfoldedU;
+		v = unfoldedV;
+	}
+
+	float length = sqrtf(u * u + v * v + z * z);
+	return XMFLOAT3(u / length, v / length, z / length);
+}
+
+uint16_t VertexCompression::FloatToHalf(float value)
+{
+	uint32_t bits;
+	memcpy(&bits, &value, sizeof(bits));
+
+	uint32_t sign = (bits >> 16) & 0x8000;
+	uint32_t magnitude = bits & 0x7FFFFFFF;
+
+	if (magnitude >= 0x47800000) //65536 or more, infinity or NaN
+	{
+		return (uint16_t)(sign | (magnitude > 0x7F800000 ? 0x7E00 : 0x7C00));
+	}
+
+	if (magnitude < 0x38800000) //Below the smallest normal half, so it becomes a denormal (or zero)
+	{
+		if (magnitude < 0x33000000)
+		{
+			return (uint16_t)sign;
+		}
+
+		uint32_t exponent = magnitude >> 23;
+		uint32_t mantissa = (magnitude & 0x7FFFFF) | 0x800000;
+		uint32_t shift = 126 - exponent;
+
+		uint32_t result = mantissa >> shift;
+		uint32_t remainder = mantissa & ((1u << shift) - 1);
+		uint32_t halfway = 1u << (shift - 1);
+
+		//Round to nearest, ties to even
+		if (remainder > halfway || (remainder == halfway && (result & 1)))
+		{
+			result++;
+		}
+
+		return (uint16_t)(sign | result);
+	}
+
+	//Rebias the exponent from 127 to 15 and drop 13 bits of mantissa, rounding to nearest even (this can carry up into infinity, which is correct)
+	uint32_t result = (magnitude - 0x38000000) >> 13;
+	uint32_t remainder = magnitude & 0x1FFF;
+
+	if (remainder > 0x1000 || (remainder == 0x1000 && (result & 1)))
+	{
+		result++;
+	}
+
+	return (uint16_t)(sign | result);
+}
+
+float VertexCompression::HalfToFloat(uint16_t value)
+{
+	uint32_t sign = (uint32_t)(value & 0x8000) << 16;
+	uint32_t exponent = (value >> 10) & 0x1F;
+	uint32_t mantissa = value & 0x3FF;
+	uint32_t bits;
+
+	if (exponent == 0x1F) //Infinity or NaN
+	{
+		bits = sign | 0x7F800000 | (mantissa << 13);
+	}
+	else if (exponent != 0)
+	{
+		bits = sign | ((exponent + 112) << 23) | (mantissa << 13);
+	}
+	else if (mantissa != 0) //Denormal, renormalize it
+	{
+		exponent = 113;
+		while (!(mantissa & 0x400))
+		{
+			mantissa <<= 1;
+			exponent--;
+		}
+		bits = sign | (exponent << 23) | ((mantissa & 0x3FF) << 13);
+	}
+	else
+	{
+		bits = sign;
+	}
+
+	float result;
+	memcpy(&result, &bits, sizeof(result));
+	return result;
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+#include "VertexFormats.h"
+
+//Converts SimpleVertex data into the 16 byte CompressedVertex format, and back again for measuring the error
+namespace VertexCompression
+{
+	//Maps 16 bit UNORM positions back into mesh space: position = unorm * Scale + Offset
+	struct PositionQuantization
+	{
+		float Scale[3];
+		float Offset[3];
+	};
+
+	struct CompressionError
+	{
+		float MaxPositionError;			//In mesh units
+		float MaxNormalErrorDegrees;
+	};
+
+	PositionQuantization ComputeQuantization(const SimpleVertex* vertices, size_t numVertices);
+
+	void Compress(const SimpleVertex* vertices, size_t numVertices, const PositionQuantization& quantization, CompressedVertex* out);
+	void Decompress(const CompressedVertex* vertices, size_t numVertices, const PositionQuantization& quantization, SimpleVertex* out);
+
+	//Largest difference between the original vertices and what the shader will reconstruct from the compressed ones
+	CompressionError MeasureError(const SimpleVertex* original, const CompressedVertex* compressed, size_t numVertices, const PositionQuantization& quantization);
+
+	void EncodeOctahedral(const XMFLOAT3& normal, int16_t encoded[2]);
+	XMFLOAT3 DecodeOctahedral(const int16_t encoded[2]);
+
+	uint16_t FloatToHalf(float value);
+	float HalfToFloat(uint16_t value);
+};
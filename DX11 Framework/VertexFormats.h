@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstdint>
+#include <directxmath.h>
+
+using namespace DirectX;
+
+//Vertex layouts the mesh pipeline can produce. Kept free of any D3D headers so the CPU side of mesh loading can be built on its own.
+
+enum VertexFormat
+{
+	VertexFormat_Full = 0,			//SimpleVertex, 32 bytes
+	VertexFormat_Compressed = 1,	//CompressedVertex, 16 bytes
+};
+
+struct SimpleVertex
+{
+	XMFLOAT3 Pos;
+	XMFLOAT3 Normal;
+	XMFLOAT2 TexC;
+};
+
+//Position: 16 bit UNORM relative to the mesh's bounds (w is always 1.0), dequantized in the vertex shader with the mesh's PositionScale/PositionOffset.
+//Normal: octahedral encoded into two 16 bit SNORMs.
+//TexC: two half floats.
+struct CompressedVertex
+{
+	uint16_t Pos[4];
+	int16_t Normal[2];
+	uint16_t TexC[2];
+};